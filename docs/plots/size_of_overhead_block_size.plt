@@ -0,0 +1,27 @@
+set title "Memory Overhead per Block by Block Size."
+
+set xlabel "Block Size (bytes)"
+set xrange [1:256]
+set logscale x 2
+
+# First line specification refers to major grid lines in both x and y, the second to minor grid lines in x and y.
+set grid xtics mxtics ytics mytics linetype -1 linewidth 1, linetype 0 linewidth 1
+
+set ylabel "Overhead per block (bytes)"
+set yrange [0:128]
+
+set pointsize 1
+set datafile separator whitespace
+
+set key right
+
+set terminal png size 800,500           # choose the file format
+
+set output "images/size_of_overhead_block_size.png"   # choose the output device
+
+plot "data/size_of_overhead_block_size.dat" using 1:3 t "Heap, std::vector<char>" with linespoints pt 3 lw 3, \
+    "data/size_of_overhead_block_size.dat" using 1:5 t "Heap, inline storage" with linespoints pt 3 lw 3, \
+    "data/size_of_overhead_block_size.dat" using 1:2 t "size_of(), std::vector<char>" with linespoints pt 2 lw 1, \
+    "data/size_of_overhead_block_size.dat" using 1:4 t "size_of(), inline storage" with linespoints pt 2 lw 1
+
+reset
@@ -36,6 +36,9 @@
 #include "svf.h"
 #include "test.h"
 #include "test_svf.h"
+#include "test_svf_paged.h"
+#include "test_svf_fetch.h"
+#include "test_svf_prefetch.h"
 #include "test_svfs.h"
 #include "test_cpp_svfs.h"
 
@@ -58,12 +61,15 @@ int main() {
     std::cout << "Testing SVF all..." << std::endl;
     pass_fail += SVFS::Test::test_svf_all(results);
     pass_fail += SVFS::Test::test_cpp_svfs_all(results);
+    pass_fail += SVFS::Test::test_svf_paged_all(results);
+    pass_fail += SVFS::Test::test_svf_fetch_all(results);
+    pass_fail += SVFS::Test::test_svf_prefetch_all(results);
 #if 1
     std::cout << "Testing SVFS all..." << std::endl;
     pass_fail += SVFS::Test::test_svfs_all(results);
 #endif
     std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
-    auto result = SVFS::Test::TestResult(__PRETTY_FUNCTION__, "All tests", results.size() != 171,
+    auto result = SVFS::Test::TestResult(__PRETTY_FUNCTION__, "All tests", results.size() != 248,
                                          "Hard coded test count to make sure some tests haven't been omitted.",
                                          time_exec.count(), 0);
     pass_fail.add_result(result.result());
@@ -55,6 +55,9 @@ SOURCES = [
 
     'src/cpp/cpp_svfs.cpp',
     'src/cpp/svf.cpp',
+    'src/cpp/svf_spill.cpp',
+    'src/cpp/svf_journal.cpp',
+    'src/cpp/svf_fetch.cpp',
     'src/cpp/svfs.cpp',
 ]
 HEADERS = [
@@ -63,6 +66,9 @@ HEADERS = [
 
     'src/cpp/cpp_svfs.h',
     'src/cpp/svf.h',
+    'src/cpp/svf_spill.h',
+    'src/cpp/svf_journal.h',
+    'src/cpp/svf_fetch.h',
     'src/cpp/svfs.h',
 ]
 
@@ -32,15 +32,15 @@
 
 #include "cp_svfs.h"
 
+#include <cstring>
 #include <ctime>
 #include <memory>
 
 #include "svf.h"
+#include "svf_fetch.h"
+#include "svf_spill.h"
 #include "svfs_util.h"
 
-/** TODO: Implement the Buffer Protocol rather than returning a copy of the bytes? Look for PyBytes_FromStringAndSize().
- * */
-
 /**
  * This macro is for functions that return a size_t type such as count_write, count_read, bytes_write, bytes_read.
  *
@@ -63,6 +63,7 @@ PyDoc_STRVAR(                                                  \
 static PyObject * \
 cp_SparseVirtualFile_##method_name(cp_SparseVirtualFile *self) { \
     ASSERT_FUNCTION_ENTRY_SVF(pSvf); \
+    AcquireLockSVF _lock(self); \
     PyObject *ret = NULL; \
     try { \
         ret = PyLong_FromLong(self->pSvf->method_name()); \
@@ -105,6 +106,9 @@ finally: \
 typedef struct {
     PyObject_HEAD
     SVFS::SparseVirtualFile *pSvf;
+    /// Count of block buffers exported by \c read_view() or \c __reduce_ex__(), while non-zero the SVF can not be
+    /// changed.
+    Py_ssize_t exports;
 #ifdef PY_THREAD_SAFE
     PyThread_type_lock lock;
 #endif
@@ -168,6 +172,86 @@ public:
     assert(! PyErr_Occurred()); \
 } while (0)
 
+/**
+ * Check that there are no exported block buffers before changing the SVF.
+ *
+ * @param self The cp_SparseVirtualFile.
+ * @param function The name of the calling function for the error message.
+ * @return Zero if the SVF can be changed, non-zero with a \c BufferError set if not.
+ */
+static int
+private_SparseVirtualFile_check_exports(cp_SparseVirtualFile *self, const char *function) {
+    if (self->exports > 0) {
+        PyErr_Format(PyExc_BufferError, "%s(): Existing exports of data: the SVF can not be changed.", function);
+        return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief A read only buffer over the data of one block of a cp_SparseVirtualFile.
+ *
+ * These are created by \c read_view() and wrapped in a \c memoryview, or by \c __reduce_ex__() and wrapped in a
+ * \c pickle.PickleBuffer so that, with pickle protocol 5, the block data can be passed out-of-band without copying.
+ * This holds a reference to the cp_SparseVirtualFile and, while it exists, the cp_SparseVirtualFile can not be
+ * changed as that might move the data.
+ */
+typedef struct {
+    PyObject_HEAD
+    cp_SparseVirtualFile *p_svf;
+    const char *data;
+    Py_ssize_t len;
+} cp_SparseVirtualFileBuffer;
+
+static int
+cp_SparseVirtualFileBuffer_getbuffer(cp_SparseVirtualFileBuffer *self, Py_buffer *view, int flags) {
+    return PyBuffer_FillInfo(view, (PyObject *) self, (void *) self->data, self->len, 1, flags);
+}
+
+static void
+cp_SparseVirtualFileBuffer_dealloc(cp_SparseVirtualFileBuffer *self) {
+    self->p_svf->exports -= 1;
+    Py_DECREF(self->p_svf);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static PyBufferProcs cp_SparseVirtualFileBuffer_as_buffer = {
+        .bf_getbuffer = (getbufferproc) cp_SparseVirtualFileBuffer_getbuffer,
+        .bf_releasebuffer = NULL,
+};
+
+static PyTypeObject svfsc_cSVFBuffer = {
+        PyVarObject_HEAD_INIT(NULL, 0)
+        .tp_name = "svfsc._cSVFBuffer",
+        .tp_basicsize = sizeof(cp_SparseVirtualFileBuffer),
+        .tp_itemsize = 0,
+        .tp_dealloc = (destructor) cp_SparseVirtualFileBuffer_dealloc,
+        .tp_as_buffer = &cp_SparseVirtualFileBuffer_as_buffer,
+        .tp_flags = Py_TPFLAGS_DEFAULT,
+        .tp_doc = "A read only buffer over the data of one block of a cSVF.",
+};
+
+/**
+ * Create a new buffer over the data of a block, this prevents changes to the SVF until it is deallocated.
+ *
+ * @param p_svf The cp_SparseVirtualFile.
+ * @param data The block data.
+ * @param len The length of the block data.
+ * @return A new reference or NULL on failure.
+ */
+static PyObject *
+private_SparseVirtualFileBuffer_new(cp_SparseVirtualFile *p_svf, const char *data, size_t len) {
+    cp_SparseVirtualFileBuffer *ret = PyObject_New(cp_SparseVirtualFileBuffer, &svfsc_cSVFBuffer);
+    if (ret) {
+        Py_INCREF(p_svf);
+        ret->p_svf = p_svf;
+        ret->data = data;
+        ret->len = static_cast<Py_ssize_t>(len);
+        p_svf->exports += 1;
+    }
+    return (PyObject *) ret;
+}
 
 // Construction and destruction
 #pragma mark Construction and destruction
@@ -188,8 +272,15 @@ cp_SparseVirtualFile_new(PyTypeObject *type, PyObject *Py_UNUSED(args), PyObject
     self = (cp_SparseVirtualFile *) type->tp_alloc(type, 0);
     if (self != NULL) {
         self->pSvf = nullptr;
+        self->exports = 0;
 #ifdef PY_THREAD_SAFE
-        self->lock = NULL;
+        /* Allocated here rather than in __init__ as __setstate__() is called without __init__() when unpickling. */
+        self->lock = PyThread_allocate_lock();
+        if (self->lock == NULL) {
+            Py_DECREF(self);
+            PyErr_SetString(PyExc_MemoryError, "Unable to allocate thread lock.");
+            return NULL;
+        }
 #endif
     }
 //    PyObject_Print((PyObject *)self, stdout);
@@ -209,10 +300,16 @@ cp_SparseVirtualFile_new(PyTypeObject *type, PyObject *Py_UNUSED(args), PyObject
  * - @c mod_time Optional, float, modification time, defaults to 0.0
  * - @c overwrite_on_exit Optional, bool, See the defaults for SVFS::SparseVirtualFileConfig
  * - @c compare_for_diff Optional, bool, See the defaults for SVFS::SparseVirtualFileConfig
+ * - @c coverage_page_size Optional, int, See the defaults for SVFS::SparseVirtualFileConfig
+ * - @c dense_gap Optional, int, See the defaults for SVFS::SparseVirtualFileConfig
+ * - @c spill_capacity Optional, int, See the defaults for SVFS::SparseVirtualFileConfig
+ * - @c spill_directory Optional, str, See the defaults for SVFS::SparseVirtualFileConfig
  *
  * @param self The cp_SparseVirtualFile.
- * @param args Order: "id", "mod_time", "overwrite_on_exit", "compare_for_diff".
- * @param kwargs Can be "id", "mod_time", "overwrite_on_exit", "compare_for_diff".
+ * @param args Order: "id", "mod_time", "overwrite_on_exit", "compare_for_diff", "coverage_page_size", "dense_gap",
+ * "spill_capacity", "spill_directory".
+ * @param kwargs Can be "id", "mod_time", "overwrite_on_exit", "compare_for_diff", "coverage_page_size", "dense_gap",
+ * "spill_capacity", "spill_directory".
  * @return Zero on success, non-zero on failure.
  */
 static int
@@ -221,7 +318,8 @@ cp_SparseVirtualFile_init(cp_SparseVirtualFile *self, PyObject *args, PyObject *
 
     char *c_id = NULL;
     double mod_time = 0.0;
-    static const char *kwlist[] = {"id", "mod_time", "overwrite_on_exit", "compare_for_diff", NULL};
+    static const char *kwlist[] = {"id", "mod_time", "overwrite_on_exit", "compare_for_diff", "coverage_page_size",
+                                   "dense_gap", "spill_capacity", "spill_directory", NULL};
     SVFS::tSparseVirtualFileConfig config;
 
 //    TRACE_SELF_ARGS_KWARGS;
@@ -231,14 +329,38 @@ cp_SparseVirtualFile_init(cp_SparseVirtualFile *self, PyObject *args, PyObject *
     // NOTE: With format unit 'p' we need to pass in an int.
     int overwrite_on_exit = config.overwrite_on_exit ? 1 : 0;
     int compare_for_diff = config.compare_for_diff ? 1 : 0;
-
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|dpp", (char **) kwlist, &c_id, &mod_time,
-                                     &overwrite_on_exit, &compare_for_diff)) {
+    Py_ssize_t coverage_page_size = static_cast<Py_ssize_t>(config.coverage_page_size);
+    Py_ssize_t dense_gap = static_cast<Py_ssize_t>(config.dense_gap);
+    Py_ssize_t spill_capacity = static_cast<Py_ssize_t>(config.spill_capacity);
+    char *c_spill_directory = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|dppnnns", (char **) kwlist, &c_id, &mod_time,
+                                     &overwrite_on_exit, &compare_for_diff, &coverage_page_size, &dense_gap,
+                                     &spill_capacity, &c_spill_directory)) {
         assert(PyErr_Occurred());
         return -1;
     }
+    if (coverage_page_size < 0 || (coverage_page_size & (coverage_page_size - 1))) {
+        PyErr_Format(PyExc_ValueError, "coverage_page_size %zd must be zero or a positive power of two",
+                     coverage_page_size);
+        return -1;
+    }
+    if (dense_gap < 0) {
+        PyErr_Format(PyExc_ValueError, "dense_gap %zd must not be negative", dense_gap);
+        return -1;
+    }
+    if (spill_capacity < 0) {
+        PyErr_Format(PyExc_ValueError, "spill_capacity %zd must not be negative", spill_capacity);
+        return -1;
+    }
     config.overwrite_on_exit = overwrite_on_exit != 0;
     config.compare_for_diff = compare_for_diff != 0;
+    config.coverage_page_size = static_cast<size_t>(coverage_page_size);
+    config.dense_gap = static_cast<size_t>(dense_gap);
+    config.spill_capacity = static_cast<size_t>(spill_capacity);
+    if (c_spill_directory) {
+        config.spill_directory = c_spill_directory;
+    }
 
 //    fprintf(stdout, "Config now compare_for_diff=%d overwrite_on_exit=%d\n", config.compare_for_diff,
 //            config.overwrite_on_exit);
@@ -249,14 +371,6 @@ cp_SparseVirtualFile_init(cp_SparseVirtualFile *self, PyObject *args, PyObject *
         PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
         return -1;
     }
-#ifdef PY_THREAD_SAFE
-    self->lock = PyThread_allocate_lock();
-    if (self->lock == NULL) {
-        delete self->pSvf;
-        PyErr_SetString(PyExc_MemoryError, "Unable to allocate thread lock.");
-        return -2;
-    }
-#endif
 //    fprintf(stdout, "cp_SparseVirtualFile_init() self->pSvf %p\n", (void *)self->pSvf);
     assert(!PyErr_Occurred());
     return 0;
@@ -356,6 +470,7 @@ cp_SparseVirtualFile_has_data(cp_SparseVirtualFile *self, PyObject *args, PyObje
     unsigned long long fpos = 0;
     unsigned long long len = 0;
     static const char *kwlist[] = {"file_position", "length", NULL};
+    AcquireLockSVF _lock(self);
 
     if (!PyArg_ParseTupleAndKeywords(args, kwargs, "KK", (char **) kwlist, &fpos, &len)) {
         goto except;
@@ -385,11 +500,13 @@ cp_SparseVirtualFile_has_data(cp_SparseVirtualFile *self, PyObject *args, PyObje
 
 PyDoc_STRVAR(
         cp_SparseVirtualFile_write_docstring,
-        "write(self, file_position: int, data: bytes) -> None\n\n"
-        "Writes the data to the Sparse Virtual File of the given ID at ``file_position`` and ``data`` as a ``bytes`` object."
+        "write(self, file_position: int, data: typing.Union[bytes, bytearray, memoryview]) -> None\n\n"
+        "Writes the data to the Sparse Virtual File of the given ID at ``file_position`` and ``data`` as a ``bytes``"
+        " object or any other contiguous object that supports the buffer protocol such as a ``bytearray``,"
+        " ``memoryview``, ``array.array`` or ``mmap.mmap``. The data is copied directly from the buffer."
         " This will raise an ``IOError`` if ``self.compare_for_diff`` is True and given data is different than"
         " that seen before and only new data up to this point will be written."
-        " If the ``byte`` data is empty nothing will be done."
+        " If the data is empty nothing will be done."
         " This will raise a RuntimeError if the data can not be written for any other reason"
 );
 
@@ -399,17 +516,22 @@ cp_SparseVirtualFile_write(cp_SparseVirtualFile *self, PyObject *args, PyObject
 
     PyObject * ret = NULL;
     unsigned long long fpos = 0;
-    PyObject * py_bytes_data = NULL;
+    // Any contiguous buffer, NULL obj until parsed so that it can always be released.
+    Py_buffer data_buffer = {};
     static const char *kwlist[] = {"file_position", "data", NULL};
     AcquireLockSVF _lock(self);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "KS", (char **) kwlist, &fpos, &py_bytes_data)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Ky*", (char **) kwlist, &fpos, &data_buffer)) {
+        goto except;
+    }
+    if (private_SparseVirtualFile_check_exports(self, __FUNCTION__)) {
         goto except;
     }
-    if (PyBytes_GET_SIZE(py_bytes_data) > 0) {
+    if (data_buffer.len > 0) {
         try {
-//            fprintf(stdout, "TRACE: %s Writing fpos %llu length %zd\n", __FUNCTION__, fpos, PyBytes_Size(py_bytes_data));
-            self->pSvf->write(fpos, PyBytes_AS_STRING(py_bytes_data), PyBytes_Size(py_bytes_data));
+//            fprintf(stdout, "TRACE: %s Writing fpos %llu length %zd\n", __FUNCTION__, fpos, data_buffer.len);
+            ReleaseGIL _release(static_cast<size_t>(data_buffer.len) >= PY_RELEASE_GIL_BYTES);
+            self->pSvf->write(fpos, static_cast<const char *>(data_buffer.buf), data_buffer.len);
         } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileDiff &err) {
             PyErr_Format(PyExc_IOError,
                          "%s: Can not write to a SVF as the given data is different from what is there. ERROR: %s",
@@ -434,6 +556,7 @@ cp_SparseVirtualFile_write(cp_SparseVirtualFile *self, PyObject *args, PyObject
     Py_XDECREF(ret);
     ret = NULL;
     finally:
+    PyBuffer_Release(&data_buffer);
     return ret;
 }
 
@@ -456,6 +579,7 @@ private_SparseVirtualFile_svf_read_as_py_bytes(cp_SparseVirtualFile *self, unsig
         return NULL;
     }
     try {
+        ReleaseGIL _release(len >= PY_RELEASE_GIL_BYTES);
         self->pSvf->read(fpos, len, PyBytes_AS_STRING(ret));
     } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileRead &err) {
         PyErr_Format(PyExc_IOError, "%s()#%d: Can not read from a SVF. ERROR: %s",
@@ -489,6 +613,11 @@ cp_SparseVirtualFile_read(cp_SparseVirtualFile *self, PyObject *args, PyObject *
     if (!PyArg_ParseTupleAndKeywords(args, kwargs, "KK", (char **) kwlist, &fpos, &len)) {
         goto except;
     }
+    // A read promotes spilled blocks which might coalesce exported blocks.
+    if (self->pSvf->spill() && self->pSvf->spill()->num_blocks()
+        && private_SparseVirtualFile_check_exports(self, __FUNCTION__)) {
+        goto except;
+    }
     // Create a bytes object
     ret = private_SparseVirtualFile_svf_read_as_py_bytes(self, fpos, len);
     if (ret == NULL) {
@@ -506,6 +635,136 @@ cp_SparseVirtualFile_read(cp_SparseVirtualFile *self, PyObject *args, PyObject *
 }
 
 
+PyDoc_STRVAR(
+        cp_SparseVirtualFile_read_view_docstring,
+        "read_view(self, file_position: int, length: int) -> memoryview\n\n"
+        "Read the data from the Sparse Virtual File at ``file_position`` and ``length`` returning a read only"
+        " ``memoryview`` of the data in the SVF without copying it."
+        " While the ``memoryview``, or any object made from it, exists the SVF can not be changed and ``write()``,"
+        " ``erase()``, ``clear()``, ``lru_punt()`` and ``compact()`` raise a ``BufferError``."
+        " Call ``release()`` on the ``memoryview``, or use it in a ``with`` statement, to allow changes again."
+        " This will raise an ``IOError`` if any data is not present"
+        " This will raise a ``RuntimeError`` if the data can not be read for any other reason"
+);
+
+static PyObject *
+cp_SparseVirtualFile_read_view(cp_SparseVirtualFile *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVF(pSvf);
+
+    PyObject * ret = NULL;
+    PyObject * buffer = NULL;
+    unsigned long long fpos = 0;
+    unsigned long long len = 0;
+    const char *data = NULL;
+    static const char *kwlist[] = {"file_position", "length", NULL};
+    AcquireLockSVF _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "KK", (char **) kwlist, &fpos, &len)) {
+        goto except;
+    }
+    // A read promotes spilled blocks which might coalesce exported blocks.
+    if (self->pSvf->spill() && self->pSvf->spill()->num_blocks()
+        && private_SparseVirtualFile_check_exports(self, __FUNCTION__)) {
+        goto except;
+    }
+    try {
+        data = self->pSvf->read_view(fpos, len);
+    } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileRead &err) {
+        PyErr_Format(PyExc_IOError, "%s()#%d: Can not read from a SVF. ERROR: %s",
+                     __FUNCTION__, __LINE__, err.message().c_str());
+        goto except;
+    } catch (const SVFS::Exceptions::ExceptionSparseVirtualFile &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s()#%d: Fatal error reading from a SVF. ERROR: %s",
+                     __FUNCTION__, __LINE__, err.message().c_str());
+        goto except;
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s()#%d: FATAL caught std::exception %s", __FUNCTION__, __LINE__,
+                     err.what());
+        goto except;
+    }
+    buffer = private_SparseVirtualFileBuffer_new(self, data, len);
+    if (!buffer) {
+        goto except;
+    }
+    ret = PyMemoryView_FromObject(buffer);
+    if (!ret) {
+        goto except;
+    }
+    assert(!PyErr_Occurred());
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    Py_XDECREF(buffer);
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFile_read_into_docstring,
+        "read_into(self, file_position: int, buffer: typing.Union[bytearray, memoryview]) -> int\n\n"
+        "Read the data from the Sparse Virtual File at ``file_position`` into a writable contiguous ``buffer``"
+        " such as a ``bytearray``, ``memoryview``, ``array.array`` or ``mmap.mmap``."
+        " The length read is the length of the buffer in bytes and that is returned."
+        " The GIL is released during a large copy and no Python objects are created so this can be used in a loop"
+        " with a reused buffer."
+        " This will raise an ``IOError`` if any data is not present"
+        " This will raise a ``RuntimeError`` if the data can not be read for any other reason"
+);
+
+static PyObject *
+cp_SparseVirtualFile_read_into(cp_SparseVirtualFile *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVF(pSvf);
+
+    PyObject * ret = NULL;
+    unsigned long long fpos = 0;
+    // Any writable contiguous buffer, NULL obj until parsed so that it can always be released.
+    Py_buffer buffer = {};
+    static const char *kwlist[] = {"file_position", "buffer", NULL};
+    AcquireLockSVF _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Kw*", (char **) kwlist, &fpos, &buffer)) {
+        goto except;
+    }
+    // A read promotes spilled blocks which might coalesce exported blocks.
+    if (self->pSvf->spill() && self->pSvf->spill()->num_blocks()
+        && private_SparseVirtualFile_check_exports(self, __FUNCTION__)) {
+        goto except;
+    }
+    if (buffer.len > 0) {
+        try {
+            ReleaseGIL _release(static_cast<size_t>(buffer.len) >= PY_RELEASE_GIL_BYTES);
+            self->pSvf->read(fpos, buffer.len, static_cast<char *>(buffer.buf));
+        } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileRead &err) {
+            PyErr_Format(PyExc_IOError, "%s()#%d: Can not read from a SVF. ERROR: %s",
+                         __FUNCTION__, __LINE__, err.message().c_str());
+            goto except;
+        } catch (const SVFS::Exceptions::ExceptionSparseVirtualFile &err) {
+            PyErr_Format(PyExc_RuntimeError, "%s()#%d: Fatal error reading from a SVF. ERROR: %s",
+                         __FUNCTION__, __LINE__, err.message().c_str());
+            goto except;
+        } catch (const std::exception &err) {
+            PyErr_Format(PyExc_RuntimeError, "%s()#%d: FATAL caught std::exception %s", __FUNCTION__, __LINE__,
+                         err.what());
+            goto except;
+        }
+    }
+    ret = PyLong_FromSsize_t(buffer.len);
+    if (!ret) {
+        goto except;
+    }
+    assert(!PyErr_Occurred());
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    PyBuffer_Release(&buffer);
+    return ret;
+}
+
 PyDoc_STRVAR(
         cp_SparseVirtualFile_erase_docstring,
         "erase(self, file_position: int) -> None\n\n"
@@ -525,6 +784,9 @@ cp_SparseVirtualFile_erase(cp_SparseVirtualFile *self, PyObject *args, PyObject
     if (!PyArg_ParseTupleAndKeywords(args, kwargs, "K", (char **) kwlist, &fpos)) {
         return NULL;
     }
+    if (private_SparseVirtualFile_check_exports(self, __FUNCTION__)) {
+        return NULL;
+    }
     try {
         self->pSvf->erase(fpos);
     } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileErase &err) {
@@ -560,11 +822,46 @@ cp_SparseVirtualFile_clear(cp_SparseVirtualFile *self) {
 
     AcquireLockSVF _lock(self);
 
+    if (private_SparseVirtualFile_check_exports(self, __FUNCTION__)) {
+        return NULL;
+    }
     self->pSvf->clear();
 
     Py_RETURN_NONE;
 }
 
+/**
+ * Create an \c array.array('Q') of unsigned 64 bit integers from pairs of integers, each pair is consecutive.
+ * This is a single object, rather than a tuple of N 2-tuples, that numpy can use directly with
+ * \c numpy.frombuffer(result, dtype=numpy.uint64).reshape(-1, 2).
+ *
+ * @tparam T A container of pairs such as SVFS::t_seek_reads or SVFS::t_block_touches.
+ * @param pairs The pairs.
+ * @return A new array or NULL with an exception set on failure.
+ */
+template<typename T>
+static PyObject *
+private_pairs_as_array(const T &pairs) {
+    PyObject * ret = NULL;
+    PyObject * array_module = NULL;
+    PyObject * bytes = PyBytes_FromStringAndSize(NULL, pairs.size() * 2 * sizeof(uint64_t));
+    if (!bytes) {
+        return NULL;
+    }
+    uint64_t *p = reinterpret_cast<uint64_t *>(PyBytes_AS_STRING(bytes));
+    for (const auto &pair: pairs) {
+        *p++ = pair.first;
+        *p++ = pair.second;
+    }
+    array_module = PyImport_ImportModule("array");
+    if (array_module) {
+        ret = PyObject_CallMethod(array_module, "array", "sO", "Q", bytes);
+        Py_DECREF(array_module);
+    }
+    Py_DECREF(bytes);
+    return ret;
+}
+
 PyDoc_STRVAR(
         cp_SparseVirtualFile_need_docstring,
         "need(self, file_position: int, length: int, greedy_length: int = 0) -> typing.Tuple[typing.Tuple[int, int], ...]\n\n"
@@ -677,18 +974,149 @@ cp_SparseVirtualFile_need(cp_SparseVirtualFile *self, PyObject *args, PyObject *
     return ret;
 }
 
+PyDoc_STRVAR(
+        cp_SparseVirtualFile_need_array_docstring,
+        "need_array(self, file_position: int, length: int, greedy_length: int = 0) -> array.array\n\n"
+        "As :py:meth:`svfsc.cSVF.need` but this returns an ``array.array('Q')`` of unsigned 64 bit integers"
+        " ``[file_position, length, file_position, length, ...]`` rather than a list of tuples."
+        " This is a single object that ``need_many()``, ``write_many()`` and ``read_many()`` accept and numpy can use"
+        " with ``numpy.frombuffer(result, dtype=numpy.uint64).reshape(-1, 2)``."
+);
+
+static PyObject *
+cp_SparseVirtualFile_need_array(cp_SparseVirtualFile *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVF(pSvf);
+
+    PyObject * ret = NULL;
+    unsigned long long fpos = 0;
+    unsigned long long len = 0;
+    unsigned long long greedy_len = 0;
+    static const char *kwlist[] = {"file_position", "length", "greedy_length", NULL};
+    AcquireLockSVF _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "KK|K", (char **) kwlist, &fpos, &len, &greedy_len)) {
+        goto except;
+    }
+    try {
+        ret = private_pairs_as_array(self->pSvf->need(fpos, len, greedy_len));
+        if (!ret) {
+            goto except;
+        }
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    assert(!PyErr_Occurred());
+    assert(ret);
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return ret;
+}
+
 PyDoc_STRVAR(
         cp_SparseVirtualFile_need_many_docstring,
         "need_many(self, seek_reads: typing.List[typing.Tuple[int, int]], greedy_length: int = 0) -> typing.Tuple[typing.Tuple[int, int], ...]\n\n"
         "Given a list of (file_position, length) this returns a ordered list ``[(file_position, length), ...]`` of seek/read"
         " instructions of data that is required to be written to the Sparse Virtual File so that a subsequent read will"
         " succeed.\n\n"
+        "``seek_reads`` can also be a contiguous buffer of unsigned 64 bit integers in pairs such as the result of"
+        " ``need_array()``, an ``array.array('Q')`` or a numpy ``uint64`` array of shape ``(N, 2)``.\n\n"
         "If greedy_length is > 0 then, if possible, blocks will be coalesced to reduce the size of the return value."
         "\n\n"
         "See also :py:meth:`svfsc.cSVF.need`"
 );
 
 
+/**
+ * Check the format of a buffer of pairs of (file_position, length), it must be native unsigned 64 bit integers.
+ *
+ * @param format The buffer format, NULL means unsigned bytes.
+ * @return True if the format is acceptable.
+ */
+static bool
+private_seek_reads_buffer_format_ok(const char *format) {
+    if (!format) {
+        return false;
+    }
+    if (*format == '@' || *format == '=') {
+        ++format;
+    }
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    else if (*format == '<') {
+        ++format;
+    }
+#endif
+    return (strcmp(format, "Q") == 0) || (sizeof(unsigned long) == 8 && strcmp(format, "L") == 0);
+}
+
+/**
+ * Parse pairs of (file_position, length) from a Python object.
+ * This is either a sequence of 2-tuples of ints or a C contiguous buffer of unsigned 64 bit integers such as an
+ * \c array.array('Q') or a numpy array of shape (N, 2) with a dtype of uint64.
+ *
+ * @param py_seek_reads The Python object.
+ * @param seek_reads The vector to append the pairs to.
+ * @param function The name of the calling function for the error message.
+ * @return Zero on success, non-zero with a \c TypeError or \c ValueError set on failure.
+ */
+static int
+private_parse_seek_reads(PyObject *py_seek_reads, SVFS::t_seek_reads &seek_reads, const char *function) {
+    if (PyObject_CheckBuffer(py_seek_reads)) {
+        Py_buffer buffer;
+        if (PyObject_GetBuffer(py_seek_reads, &buffer, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT)) {
+            return -1;
+        }
+        if (buffer.itemsize != 8 || !private_seek_reads_buffer_format_ok(buffer.format)) {
+            PyErr_Format(PyExc_TypeError, "%s: seek_reads buffer must be of unsigned 64 bit integers not \"%s\".",
+                         function, buffer.format ? buffer.format : "B");
+            PyBuffer_Release(&buffer);
+            return -1;
+        }
+        if (buffer.len % (2 * sizeof(uint64_t))) {
+            PyErr_Format(PyExc_ValueError, "%s: seek_reads buffer must have an even number of integers.",
+                         function);
+            PyBuffer_Release(&buffer);
+            return -1;
+        }
+        const uint64_t *p = static_cast<const uint64_t *>(buffer.buf);
+        size_t count = buffer.len / (2 * sizeof(uint64_t));
+        seek_reads.reserve(seek_reads.size() + count);
+        for (size_t i = 0; i < count; ++i) {
+            seek_reads.push_back({p[2 * i], p[2 * i + 1]});
+        }
+        PyBuffer_Release(&buffer);
+        return 0;
+    }
+    PyObject * py_sequence = PySequence_Fast(py_seek_reads, "seek_reads must be a sequence or a buffer.");
+    if (!py_sequence) {
+        return -1;
+    }
+    Py_ssize_t size = PySequence_Fast_GET_SIZE(py_sequence);
+    seek_reads.reserve(seek_reads.size() + size);
+    for (Py_ssize_t i = 0; i < size; ++i) {
+        PyObject * py_fpos_len = PySequence_Fast_GET_ITEM(py_sequence, i);
+        unsigned long long fpos;
+        unsigned long long length;
+        if (!PyTuple_Check(py_fpos_len) || PyTuple_GET_SIZE(py_fpos_len) != 2) {
+            PyErr_Format(PyExc_TypeError, "%s: seek_reads[%zd] is not a tuple of (file_position, length).",
+                         function, i);
+            Py_DECREF(py_sequence);
+            return -1;
+        }
+        if (!PyArg_ParseTuple(py_fpos_len, "KK", &fpos, &length)) {
+            Py_DECREF(py_sequence);
+            return -1;
+        }
+        seek_reads.push_back({fpos, length});
+    }
+    Py_DECREF(py_sequence);
+    return 0;
+}
+
 /**
  * Shared by SVF and SVFS.
  */
@@ -699,38 +1127,49 @@ cp_SparseVirtualFile_need_many_internal(PyObject *py_seek_reads,
     PyObject * ret = NULL; // PyListObject
     Py_ssize_t i = 0;
     SVFS::t_seek_reads cpp_seek_reads;
-    /* Check that we have a list of tuples of the right size.*/
-    if (!PyList_Check(py_seek_reads)) {
-        PyErr_Format(PyExc_TypeError, "%s: seek_reads is not a list.", __FUNCTION__);
-        goto except;
-    }
-    for (i = 0; i < PyList_Size(py_seek_reads); ++i) {
-        if (!PyTuple_Check(PyList_GetItem(py_seek_reads, i))) {
-            PyErr_Format(PyExc_TypeError, "%s: seek_reads[%ld] is not a tuple.", __FUNCTION__, i);
+    if (PyObject_CheckBuffer(py_seek_reads)) {
+        /* A buffer of unsigned 64 bit integers in pairs. */
+        if (private_parse_seek_reads(py_seek_reads, cpp_seek_reads, __FUNCTION__)) {
             goto except;
         }
-        if (PyTuple_Size(PyList_GetItem(py_seek_reads, i)) != 2) {
-            PyErr_Format(
-                    PyExc_TypeError,
-                    "%s: seek_reads[%ld] length %ld is not a tuple of length 2.",
-                    __FUNCTION__, i, PyTuple_Size(PyList_GetItem(py_seek_reads, i))
-            );
+    } else {
+        /* Check that we have a list of tuples of the right size.*/
+        if (!PyList_Check(py_seek_reads)) {
+            PyErr_Format(PyExc_TypeError, "%s: seek_reads is not a list.", __FUNCTION__);
             goto except;
         }
-    }
-    /* Create a std::vector<std::pair<fpos, length>> */
-    for (i = 0; i < PyList_Size(py_seek_reads); ++i) {
-        PyObject * py_fpos_len = PyList_GetItem(py_seek_reads, i);
-        SVFS::t_fpos fpos;
-        size_t length;
-        if (!PyArg_ParseTuple(py_fpos_len, "KK", &fpos, &length)) {
-            PyErr_Format(PyExc_TypeError, "%s: can not parse list element[%ld].", __FUNCTION__, i);
-            goto except;
+        for (i = 0; i < PyList_Size(py_seek_reads); ++i) {
+            if (!PyTuple_Check(PyList_GetItem(py_seek_reads, i))) {
+                PyErr_Format(PyExc_TypeError, "%s: seek_reads[%ld] is not a tuple.", __FUNCTION__, i);
+                goto except;
+            }
+            if (PyTuple_Size(PyList_GetItem(py_seek_reads, i)) != 2) {
+                PyErr_Format(
+                        PyExc_TypeError,
+                        "%s: seek_reads[%ld] length %ld is not a tuple of length 2.",
+                        __FUNCTION__, i, PyTuple_Size(PyList_GetItem(py_seek_reads, i))
+                );
+                goto except;
+            }
+        }
+        /* Create a std::vector<std::pair<fpos, length>> */
+        for (i = 0; i < PyList_Size(py_seek_reads); ++i) {
+            PyObject * py_fpos_len = PyList_GetItem(py_seek_reads, i);
+            SVFS::t_fpos fpos;
+            size_t length;
+            if (!PyArg_ParseTuple(py_fpos_len, "KK", &fpos, &length)) {
+                PyErr_Format(PyExc_TypeError, "%s: can not parse list element[%ld].", __FUNCTION__, i);
+                goto except;
+            }
+            cpp_seek_reads.push_back({fpos, length});
         }
-        cpp_seek_reads.push_back({fpos, length});
     }
     /* Create the new seek-reads vector. */
-    cpp_seek_reads = pSvf->need_many(cpp_seek_reads, greedy_len);
+    {
+        ReleaseGIL _release(cpp_seek_reads.size() >= PY_RELEASE_GIL_BLOCKS
+                            || pSvf->num_blocks() >= PY_RELEASE_GIL_BLOCKS);
+        cpp_seek_reads = pSvf->need_many(cpp_seek_reads, greedy_len);
+    }
     /* Create the Python list */
     ret = PyList_New(cpp_seek_reads.size());
     if (!ret) {
@@ -804,27 +1243,488 @@ cp_SparseVirtualFile_need_many(cp_SparseVirtualFile *self, PyObject *args, PyObj
     return ret;
 }
 
-/**
-// ---- Meta information about the SVF ----
-// The existing blocks.
-t_seek_reads blocks() const noexcept;
-
-// Information about memory used:
-// size_of() gives best guess of total memory usage.
-size_t size_of() const noexcept;
-
-// Gives exact number of data bytes held.
-size_t num_bytes() const noexcept { return m_bytes_total; };
-
-// Gives exact number of blocks used.
-size_t num_blocks() const noexcept { return m_svf.size(); }
-t_fpos last_file_position() const noexcept;
+// Batch operations that take many (file_position, length) pairs in one call.
 
-// Check the clients file modification time has changed.
-// Caller has to decide what to do...
-bool file_mod_time_matches(const double &file_mod_time) const noexcept {
-    return file_mod_time == m_file_mod_time;
-}
+/**
+ * Write many blocks from one buffer where the blocks are consecutive in the buffer.
+ *
+ * @param svf The SVF.
+ * @param seek_reads The (file_position, length) pairs.
+ * @param data The data, the total length must be the sum of the lengths.
+ * @param function The name of the calling function for the error message.
+ * @return Zero on success, non-zero with an exception set on failure.
+ */
+static int
+private_SparseVirtualFile_write_many(SVFS::SparseVirtualFile &svf, const SVFS::t_seek_reads &seek_reads,
+                                     const Py_buffer &data, const char *function) {
+    size_t total = 0;
+    for (const auto &seek_read: seek_reads) {
+        total += seek_read.second;
+    }
+    if (total != static_cast<size_t>(data.len)) {
+        PyErr_Format(PyExc_ValueError, "%s: The sum of the lengths %zu is not the length of the data %zd.",
+                     function, total, data.len);
+        return -1;
+    }
+    try {
+        ReleaseGIL _release(total >= PY_RELEASE_GIL_BYTES || seek_reads.size() >= PY_RELEASE_GIL_BLOCKS);
+        const char *p = static_cast<const char *>(data.buf);
+        for (const auto &seek_read: seek_reads) {
+            if (seek_read.second) {
+                svf.write(seek_read.first, p, seek_read.second);
+                p += seek_read.second;
+            }
+        }
+    } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileDiff &err) {
+        PyErr_Format(PyExc_IOError,
+                     "%s: Can not write to a SVF as the given data is different from what is there. ERROR: %s",
+                     function, err.message().c_str());
+        return -1;
+    } catch (const SVFS::Exceptions::ExceptionSparseVirtualFile &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: Can not write to a SVF. ERROR: %s", function, err.message().c_str());
+        return -1;
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", function, err.what());
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Read many blocks into one bytes object where the blocks are consecutive.
+ *
+ * @param svf The SVF.
+ * @param seek_reads The (file_position, length) pairs.
+ * @param function The name of the calling function for the error message.
+ * @return A bytes object or NULL with an exception set on failure.
+ */
+static PyObject *
+private_SparseVirtualFile_read_many(SVFS::SparseVirtualFile &svf, const SVFS::t_seek_reads &seek_reads,
+                                    const char *function) {
+    size_t total = 0;
+    for (const auto &seek_read: seek_reads) {
+        total += seek_read.second;
+    }
+    PyObject * ret = PyBytes_FromStringAndSize(NULL, total);
+    if (!ret) {
+        return NULL;
+    }
+    try {
+        ReleaseGIL _release(total >= PY_RELEASE_GIL_BYTES || seek_reads.size() >= PY_RELEASE_GIL_BLOCKS);
+        char *p = PyBytes_AS_STRING(ret);
+        for (const auto &seek_read: seek_reads) {
+            if (seek_read.second) {
+                svf.read(seek_read.first, seek_read.second, p);
+                p += seek_read.second;
+            }
+        }
+    } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileRead &err) {
+        PyErr_Format(PyExc_IOError, "%s: Can not read from a SVF. ERROR: %s", function, err.message().c_str());
+        Py_DECREF(ret);
+        return NULL;
+    } catch (const SVFS::Exceptions::ExceptionSparseVirtualFile &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: Fatal error reading from a SVF. ERROR: %s", function,
+                     err.message().c_str());
+        Py_DECREF(ret);
+        return NULL;
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", function, err.what());
+        Py_DECREF(ret);
+        return NULL;
+    }
+    return ret;
+}
+
+/**
+ * Check for the data of many blocks.
+ *
+ * @param svf The SVF.
+ * @param seek_reads The (file_position, length) pairs.
+ * @return A bytes object with one byte, 1 or 0, for each pair or NULL with an exception set on failure.
+ */
+static PyObject *
+private_SparseVirtualFile_has_data_many(const SVFS::SparseVirtualFile &svf, const SVFS::t_seek_reads &seek_reads) {
+    PyObject * ret = PyBytes_FromStringAndSize(NULL, seek_reads.size());
+    if (!ret) {
+        return NULL;
+    }
+    char *p = PyBytes_AS_STRING(ret);
+    for (const auto &seek_read: seek_reads) {
+        *p++ = svf.has(seek_read.first, seek_read.second) ? 1 : 0;
+    }
+    return ret;
+}
+
+// Read-through, see SVFS::ReadThroughSparseVirtualFile.
+
+/**
+ * Check the greedy length and alignment of a read-through.
+ *
+ * @param greedy_length The greedy length from Python.
+ * @param alignment The alignment from Python.
+ * @param config Set from the arguments.
+ * @param function The name of the calling function for the error message.
+ * @return Zero on success, non-zero with a ValueError set on failure.
+ */
+static int
+private_read_through_config(Py_ssize_t greedy_length, Py_ssize_t alignment, SVFS::tReadThroughConfig &config,
+                            const char *function) {
+    if (greedy_length < 0) {
+        PyErr_Format(PyExc_ValueError, "%s: greedy_length %zd must not be negative", function, greedy_length);
+        return -1;
+    }
+    if (alignment < 0 || (alignment & (alignment - 1))) {
+        PyErr_Format(PyExc_ValueError, "%s: alignment %zd must be zero or a positive power of two", function,
+                     alignment);
+        return -1;
+    }
+    config.greedy_length = static_cast<size_t>(greedy_length);
+    config.alignment = static_cast<size_t>(alignment);
+    return 0;
+}
+
+/**
+ * Call a Python fetch function for each (file_position, length) pair of a read-through plan.
+ *
+ * The function is called as ``fetch(file_position, length)`` or, with an ID, ``fetch(id, file_position, length)``
+ * and must return a bytes like object of at most that length.
+ * A shorter result means the end of the file so any later pairs are not fetched.
+ * This must be called without holding a lock on the SVF as the function might use it.
+ *
+ * @param fetch The Python callable.
+ * @param c_id The SVF ID or NULL.
+ * @param plan The (file_position, length) pairs, see SVFS::read_through_plan().
+ * @param fetched Set to the (file_position, length) pairs fetched.
+ * @param data Set to the data of every pair fetched, one after the other.
+ * @param function The name of the calling function for the error message.
+ * @return Zero on success, non-zero with an exception set on failure.
+ */
+static int
+private_read_through_fetch(PyObject *fetch, const char *c_id, const SVFS::t_seek_reads &plan,
+                           SVFS::t_seek_reads &fetched, std::string &data, const char *function) {
+    for (const auto &seek_read: plan) {
+        PyObject * result = NULL;
+        Py_buffer buffer = {};
+        if (c_id) {
+            result = PyObject_CallFunction(fetch, "sKK", c_id, static_cast<unsigned long long>(seek_read.first),
+                                           static_cast<unsigned long long>(seek_read.second));
+        } else {
+            result = PyObject_CallFunction(fetch, "KK", static_cast<unsigned long long>(seek_read.first),
+                                           static_cast<unsigned long long>(seek_read.second));
+        }
+        if (!result) {
+            return -1;
+        }
+        if (PyObject_GetBuffer(result, &buffer, PyBUF_SIMPLE)) {
+            Py_DECREF(result);
+            return -1;
+        }
+        size_t len = static_cast<size_t>(buffer.len);
+        if (len > seek_read.second) {
+            PyErr_Format(PyExc_ValueError, "%s: fetch returned %zu bytes, more than the %zu asked for.", function,
+                         len, seek_read.second);
+            PyBuffer_Release(&buffer);
+            Py_DECREF(result);
+            return -1;
+        }
+        if (len) {
+            fetched.emplace_back(seek_read.first, len);
+            data.append(static_cast<const char *>(buffer.buf), len);
+        }
+        PyBuffer_Release(&buffer);
+        Py_DECREF(result);
+        if (len < seek_read.second) {
+            break;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Wait for ranges that another thread is fetching, see SVFS::SparseVirtualFile::reserve_need().
+ *
+ * The GIL is always released, even without \c PY_THREAD_SAFE, as the thread that is fetching needs it to call its
+ * fetch function.
+ *
+ * @param in_flight The futures of the ranges.
+ */
+static void
+private_read_through_wait(const SVFS::t_in_flight_futures &in_flight) {
+    Py_BEGIN_ALLOW_THREADS
+        for (const auto &future: in_flight) {
+            future.wait();
+        }
+    Py_END_ALLOW_THREADS
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFile_read_through_docstring,
+        "read_through(self, file_position: int, length: int,"
+        " fetch: typing.Callable[[int, int], typing.Union[bytes, bytearray, memoryview]],"
+        " greedy_length: int = 0, alignment: int = 0) -> bytes\n\n"
+        "Read the data at file_position and length, fetching and writing any that is missing first.\n"
+        "If all the data is held this is the same as ``read()``."
+        " Otherwise the read is widened to ``alignment``, which must be zero or a power of two, and"
+        " ``fetch(file_position, length)`` is called for each part that ``need()`` with ``greedy_length`` returns."
+        " ``fetch`` must return at most that many bytes, fewer only at the end of the file."
+        " The SVF is not locked while ``fetch`` is called.\n"
+        "If several threads miss on the same data at once only one of them calls ``fetch`` for it, the others wait."
+        " ``fetch`` must not call ``read_through()`` on this SVF.\n"
+        "This raises the same errors as ``write()`` and ``read()`` and any error from ``fetch``."
+);
+
+static PyObject *
+cp_SparseVirtualFile_read_through(cp_SparseVirtualFile *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVF(pSvf);
+
+    PyObject * ret = NULL;
+    unsigned long long fpos = 0;
+    unsigned long long len = 0;
+    PyObject * fetch = NULL;
+    Py_ssize_t greedy_length = 0;
+    Py_ssize_t alignment = 0;
+    SVFS::tReadThroughConfig config;
+    SVFS::t_seek_reads plan;
+    SVFS::t_seek_reads fetched;
+    SVFS::t_in_flight_futures in_flight;
+    bool reserved = false;
+    std::string data;
+    Py_buffer data_buffer = {};
+    static const char *kwlist[] = {"file_position", "length", "fetch", "greedy_length", "alignment", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "KKO|nn", (char **) kwlist, &fpos, &len, &fetch, &greedy_length,
+                                     &alignment)) {
+        goto except;
+    }
+    if (!PyCallable_Check(fetch)) {
+        PyErr_Format(PyExc_TypeError, "%s: fetch must be callable not \"%s\"", __FUNCTION__, Py_TYPE(fetch)->tp_name);
+        goto except;
+    }
+    if (private_read_through_config(greedy_length, alignment, config, __FUNCTION__)) {
+        goto except;
+    }
+    retry:
+    plan.clear();
+    fetched.clear();
+    in_flight.clear();
+    data.clear();
+    try {
+        AcquireLockSVF _lock(self);
+        // A read promotes spilled blocks which might coalesce exported blocks.
+        if (self->pSvf->spill() && self->pSvf->spill()->num_blocks()
+            && private_SparseVirtualFile_check_exports(self, __FUNCTION__)) {
+            goto except;
+        }
+        if (self->pSvf->has(fpos, len)) {
+            ret = private_SparseVirtualFile_read_many(*self->pSvf, {{fpos, len}}, __FUNCTION__);
+            if (!ret) {
+                goto except;
+            }
+            goto finally;
+        }
+        plan = SVFS::read_through_reserve(*self->pSvf, fpos, len, config, in_flight);
+        reserved = !plan.empty();
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    if (reserved) {
+        if (private_read_through_fetch(fetch, NULL, plan, fetched, data, __FUNCTION__)) {
+            goto except;
+        }
+        PyBuffer_FillInfo(&data_buffer, NULL, data.data(), static_cast<Py_ssize_t>(data.size()), 1, PyBUF_SIMPLE);
+        AcquireLockSVF _lock(self);
+        if (private_SparseVirtualFile_check_exports(self, __FUNCTION__)) {
+            goto except;
+        }
+        if (private_SparseVirtualFile_write_many(*self->pSvf, fetched, data_buffer, __FUNCTION__)) {
+            goto except;
+        }
+        self->pSvf->release_need(plan);
+        reserved = false;
+    }
+    if (!in_flight.empty()) {
+        // Another thread has fetched, or failed to fetch, some of the data so look again.
+        private_read_through_wait(in_flight);
+        goto retry;
+    }
+    {
+        AcquireLockSVF _lock(self);
+        ret = private_SparseVirtualFile_read_many(*self->pSvf, {{fpos, len}}, __FUNCTION__);
+        if (!ret) {
+            goto except;
+        }
+    }
+    assert(!PyErr_Occurred());
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    if (reserved) {
+        AcquireLockSVF _lock(self);
+        self->pSvf->release_need(plan);
+    }
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFile_write_many_docstring,
+        "write_many(self, seek_reads: typing.Union[typing.Sequence[typing.Tuple[int, int]], memoryview],"
+        " data: typing.Union[bytes, bytearray, memoryview]) -> None\n\n"
+        "Write many blocks in one call."
+        " ``seek_reads`` is a sequence of ``(file_position, length)`` tuples or a contiguous buffer of unsigned 64 bit"
+        " integers, in pairs, such as an ``array.array('Q')`` or a numpy ``uint64`` array of shape ``(N, 2)``."
+        " ``data`` is the data of every block one after the other so its length must be the sum of the lengths."
+        " This raises the same errors as ``write()`` and the blocks before the one that failed will have been"
+        " written."
+);
+
+static PyObject *
+cp_SparseVirtualFile_write_many(cp_SparseVirtualFile *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVF(pSvf);
+
+    PyObject * ret = NULL;
+    PyObject * py_seek_reads = NULL;
+    Py_buffer data_buffer = {};
+    SVFS::t_seek_reads seek_reads;
+    static const char *kwlist[] = {"seek_reads", "data", NULL};
+    AcquireLockSVF _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Oy*", (char **) kwlist, &py_seek_reads, &data_buffer)) {
+        goto except;
+    }
+    if (private_SparseVirtualFile_check_exports(self, __FUNCTION__)) {
+        goto except;
+    }
+    if (private_parse_seek_reads(py_seek_reads, seek_reads, __FUNCTION__)) {
+        goto except;
+    }
+    if (private_SparseVirtualFile_write_many(*self->pSvf, seek_reads, data_buffer, __FUNCTION__)) {
+        goto except;
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+    assert(!PyErr_Occurred());
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    PyBuffer_Release(&data_buffer);
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFile_read_many_docstring,
+        "read_many(self, seek_reads: typing.Union[typing.Sequence[typing.Tuple[int, int]], memoryview]) -> bytes\n\n"
+        "Read many blocks in one call and return the data of every block one after the other in a single ``bytes``"
+        " object."
+        " ``seek_reads`` is a sequence of ``(file_position, length)`` tuples or a contiguous buffer of unsigned 64 bit"
+        " integers, in pairs, such as an ``array.array('Q')`` or a numpy ``uint64`` array of shape ``(N, 2)``."
+        " The offset of each block in the result is the sum of the preceding lengths."
+        " This will raise an ``IOError`` if any data is not present."
+);
+
+static PyObject *
+cp_SparseVirtualFile_read_many(cp_SparseVirtualFile *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVF(pSvf);
+
+    PyObject * ret = NULL;
+    PyObject * py_seek_reads = NULL;
+    SVFS::t_seek_reads seek_reads;
+    static const char *kwlist[] = {"seek_reads", NULL};
+    AcquireLockSVF _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", (char **) kwlist, &py_seek_reads)) {
+        goto except;
+    }
+    // A read promotes spilled blocks which might coalesce exported blocks.
+    if (self->pSvf->spill() && self->pSvf->spill()->num_blocks()
+        && private_SparseVirtualFile_check_exports(self, __FUNCTION__)) {
+        goto except;
+    }
+    if (private_parse_seek_reads(py_seek_reads, seek_reads, __FUNCTION__)) {
+        goto except;
+    }
+    ret = private_SparseVirtualFile_read_many(*self->pSvf, seek_reads, __FUNCTION__);
+    if (!ret) {
+        goto except;
+    }
+    assert(!PyErr_Occurred());
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFile_has_data_many_docstring,
+        "has_data_many(self, seek_reads: typing.Union[typing.Sequence[typing.Tuple[int, int]], memoryview])"
+        " -> bytes\n\n"
+        "Check for the data of many blocks in one call."
+        " ``seek_reads`` is a sequence of ``(file_position, length)`` tuples or a contiguous buffer of unsigned 64 bit"
+        " integers, in pairs, such as an ``array.array('Q')`` or a numpy ``uint64`` array of shape ``(N, 2)``."
+        " This returns a ``bytes`` object with a byte for each pair that is 1 if the SVF has the data, 0 otherwise."
+        " This can be used directly as a numpy boolean array with ``numpy.frombuffer(result, dtype=bool)``."
+);
+
+static PyObject *
+cp_SparseVirtualFile_has_data_many(cp_SparseVirtualFile *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVF(pSvf);
+
+    PyObject * ret = NULL;
+    PyObject * py_seek_reads = NULL;
+    SVFS::t_seek_reads seek_reads;
+    static const char *kwlist[] = {"seek_reads", NULL};
+    AcquireLockSVF _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", (char **) kwlist, &py_seek_reads)) {
+        goto except;
+    }
+    if (private_parse_seek_reads(py_seek_reads, seek_reads, __FUNCTION__)) {
+        goto except;
+    }
+    ret = private_SparseVirtualFile_has_data_many(*self->pSvf, seek_reads);
+    if (!ret) {
+        goto except;
+    }
+    assert(!PyErr_Occurred());
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return ret;
+}
+
+/**
+// ---- Meta information about the SVF ----
+// The existing blocks.
+t_seek_reads blocks() const noexcept;
+
+// Information about memory used:
+// size_of() gives best guess of total memory usage.
+size_t size_of() const noexcept;
+
+// Gives exact number of data bytes held.
+size_t num_bytes() const noexcept { return m_bytes_total; };
+
+// Gives exact number of blocks used.
+size_t num_blocks() const noexcept { return m_svf.size(); }
+t_fpos last_file_position() const noexcept;
+
+// Check the clients file modification time has changed.
+// Caller has to decide what to do...
+bool file_mod_time_matches(const double &file_mod_time) const noexcept {
+    return file_mod_time == m_file_mod_time;
+}
 */
 
 PyDoc_STRVAR(
@@ -878,6 +1778,26 @@ cp_SparseVirtualFile_blocks(cp_SparseVirtualFile *self) {
     return ret;
 }
 
+PyDoc_STRVAR(
+        cp_SparseVirtualFile_blocks_array_docstring,
+        "blocks_array(self) -> array.array\n\n"
+        "As :py:meth:`svfsc.cSVF.blocks` but this returns an ``array.array('Q')`` of unsigned 64 bit integers"
+        " ``[file_position, length, file_position, length, ...]`` rather than a tuple of tuples."
+);
+
+static PyObject *
+cp_SparseVirtualFile_blocks_array(cp_SparseVirtualFile *self) {
+    ASSERT_FUNCTION_ENTRY_SVF(pSvf);
+
+    AcquireLockSVF _lock(self);
+    try {
+        return private_pairs_as_array(self->pSvf->blocks());
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        return NULL;
+    }
+}
+
 SVFS_SVF_METHOD_SIZE_T_WRAPPER(
         block_touch,
         "Return the latest value of the monotonically increasing block_touch value."
@@ -939,6 +1859,39 @@ cp_SparseVirtualFile_block_touches(cp_SparseVirtualFile *self) {
     return ret;
 }
 
+PyDoc_STRVAR(
+        cp_SparseVirtualFile_block_touches_array_docstring,
+        "block_touches_array(self) -> array.array\n\n"
+        "As :py:meth:`svfsc.cSVF.block_touches` but this returns an ``array.array('Q')`` of unsigned 64 bit integers"
+        " ``[touch_int, file_position, touch_int, file_position, ...]``, in touch order, rather than a dict."
+);
+
+static PyObject *
+cp_SparseVirtualFile_block_touches_array(cp_SparseVirtualFile *self) {
+    ASSERT_FUNCTION_ENTRY_SVF(pSvf);
+
+    AcquireLockSVF _lock(self);
+    try {
+        return private_pairs_as_array(self->pSvf->block_touches());
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        return NULL;
+    }
+}
+
+/**
+ * Decide if the GIL is worth releasing for \c lru_punt() as it sorts every block or writes to the spill file.
+ *
+ * @param svf The SVF.
+ * @param cache_size_upper_bound The upper bound of the number of bytes held by the cache.
+ * @return True if the GIL should be released.
+ */
+static bool
+private_SparseVirtualFile_lru_punt_release_gil(const SVFS::SparseVirtualFile &svf, size_t cache_size_upper_bound) {
+    return svf.num_bytes() > cache_size_upper_bound
+           && (svf.num_blocks() >= PY_RELEASE_GIL_BLOCKS || svf.config().spill_capacity);
+}
+
 PyDoc_STRVAR(
         cp_SparseVirtualFile_lru_punt_docstring,
         "lru_punt(self, cache_size_upper_bound: int) -> int\n\n"
@@ -966,8 +1919,73 @@ cp_SparseVirtualFile_lru_punt(cp_SparseVirtualFile *self, PyObject *args, PyObje
     if (!PyArg_ParseTupleAndKeywords(args, kwargs, "K", (char **) kwlist, &cache_size_upper_bound)) {
         goto except;
     }
+    if (private_SparseVirtualFile_check_exports(self, __FUNCTION__)) {
+        goto except;
+    }
     try {
-        ret = Py_BuildValue("K", self->pSvf->lru_punt(cache_size_upper_bound));
+        size_t bytes_removed;
+        {
+            ReleaseGIL _release(private_SparseVirtualFile_lru_punt_release_gil(*self->pSvf, cache_size_upper_bound));
+            bytes_removed = self->pSvf->lru_punt(cache_size_upper_bound);
+        }
+        ret = Py_BuildValue("K", bytes_removed);
+        if (!ret) {
+            PyErr_Format(PyExc_MemoryError, "%s: Can not create long", __FUNCTION__);
+            goto except;
+        }
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    assert(!PyErr_Occurred());
+    assert(ret);
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFile_compact_docstring,
+        "compact(self, max_time: float = 0.0) -> int\n\n"
+        "Right sizes the memory of every block and returns the number of bytes reclaimed.\n"
+        "If max_time is non-zero this stops after roughly that many seconds and the next call continues from where"
+        " this one stopped.\n"
+        "Once complete further calls return 0 until there has been a write or erase."
+);
+
+/**
+ * See cp_SparseVirtualFile_compact_docstring
+ *
+ * @param self The cp_SparseVirtualFile
+ * @param args The time budget in seconds.
+ * @param kwargs "max_time".
+ * @return Number of bytes reclaimed.
+ */
+static PyObject *
+cp_SparseVirtualFile_compact(cp_SparseVirtualFile *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVF(pSvf);
+
+    PyObject * ret = NULL; // Long
+    double max_time = 0.0;
+    static const char *kwlist[] = {"max_time", NULL};
+    AcquireLockSVF _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|d", (char **) kwlist, &max_time)) {
+        goto except;
+    }
+    if (max_time < 0.0) {
+        PyErr_SetString(PyExc_ValueError, "max_time must not be negative");
+        goto except;
+    }
+    if (private_SparseVirtualFile_check_exports(self, __FUNCTION__)) {
+        goto except;
+    }
+    try {
+        ret = Py_BuildValue("K", self->pSvf->compact(max_time));
         if (!ret) {
             PyErr_Format(PyExc_MemoryError, "%s: Can not create long", __FUNCTION__);
             goto except;
@@ -996,6 +2014,7 @@ PyDoc_STRVAR(
 static PyObject *
 cp_SparseVirtualFile_file_mod_time_matches(cp_SparseVirtualFile *self, PyObject *args, PyObject *kwargs) {
     ASSERT_FUNCTION_ENTRY_SVF(pSvf);
+    AcquireLockSVF _lock(self);
 
     PyObject * ret = NULL;
     double file_mod_time;
@@ -1050,6 +2069,7 @@ PyDoc_STRVAR(
 static PyObject *
 cp_SparseVirtualFile_file_mod_time(cp_SparseVirtualFile *self) {
     ASSERT_FUNCTION_ENTRY_SVF(pSvf);
+    AcquireLockSVF _lock(self);
 
     PyObject * ret = NULL;
     try {
@@ -1122,6 +2142,7 @@ PyDoc_STRVAR(
 static PyObject *
 cp_SparseVirtualFile_time_write(cp_SparseVirtualFile *self) {
     ASSERT_FUNCTION_ENTRY_SVF(pSvf);
+    AcquireLockSVF _lock(self);
     PyObject * ret = NULL;
     try {
         if (self->pSvf->count_write()) {
@@ -1167,6 +2188,7 @@ PyDoc_STRVAR(
 static PyObject *
 cp_SparseVirtualFile_time_read(cp_SparseVirtualFile *self) {
     ASSERT_FUNCTION_ENTRY_SVF(pSvf);
+    AcquireLockSVF _lock(self);
 
     PyObject * ret = NULL;
     try {
@@ -1203,21 +2225,30 @@ cp_SparseVirtualFile_time_read(cp_SparseVirtualFile *self) {
 
 PyDoc_STRVAR(
         cp_SparseVirtualFile_config_docstring,
-        "config(self) -> typing.Dict[str, bool]\n\n"
+        "config(self) -> typing.Dict[str, typing.Union[bool, int]]\n\n"
         "Returns the SVF configuration as a dict."
 );
 
 static PyObject *
 cp_SparseVirtualFile_config(cp_SparseVirtualFile *self) {
     ASSERT_FUNCTION_ENTRY_SVF(pSvf);
+    AcquireLockSVF _lock(self);
 
     PyObject * ret = Py_BuildValue(
             "{"
             "s:N"   /* compare_for_diff */
             ",s:N"  /* overwrite_on_exit */
+            ",s:n"  /* coverage_page_size */
+            ",s:n"  /* dense_gap */
+            ",s:n"  /* spill_capacity */
+            ",s:s"  /* spill_directory */
             "}",
             "compare_for_diff", PyBool_FromLong(self->pSvf->config().compare_for_diff ? 1 : 0),
-            "overwrite_on_exit", PyBool_FromLong(self->pSvf->config().overwrite_on_exit ? 1 : 0)
+            "overwrite_on_exit", PyBool_FromLong(self->pSvf->config().overwrite_on_exit ? 1 : 0),
+            "coverage_page_size", static_cast<Py_ssize_t>(self->pSvf->config().coverage_page_size),
+            "dense_gap", static_cast<Py_ssize_t>(self->pSvf->config().dense_gap),
+            "spill_capacity", static_cast<Py_ssize_t>(self->pSvf->config().spill_capacity),
+            "spill_directory", self->pSvf->config().spill_directory.c_str()
     );
     return ret;
 }
@@ -1231,6 +2262,38 @@ static const char *PICKLE_BLOCKS_KEY = "blocks";
 static const char *PICKLE_VERSION_KEY = "pickle_version";
 static int PICKLE_VERSION = 1;
 
+/**
+ * Returns a Python dict suitable for pickling.
+ * Key/values are:
+ * id, file_mod_time, blocks, pickle_version
+ *
+ * @param self The cp_SparseVirtualFile.
+ * @param blocks_fpos_data A tuple of ((fpos, data), ...), this reference is stolen.
+ * @return The dict or NULL on failure.
+ */
+static PyObject *
+private_SparseVirtualFile_pickle_dict(cp_SparseVirtualFile *self, PyObject *blocks_fpos_data) {
+    PyObject * ret = Py_BuildValue(
+            "{"
+            "s:N"   /* id */
+            ",s:d"  /* file_mod_time */
+            ",s:N"  /* blocks */
+            ",s:i"  /* pickle_version */
+            "}",
+            PICKLE_ID_KEY, PyUnicode_FromKindAndData(PyUnicode_1BYTE_KIND,
+                                                     self->pSvf->id().c_str(),
+                                                     self->pSvf->id().size()
+            ),
+            PICKLE_FILE_MOD_TIME_KEY, self->pSvf->file_mod_time(),
+            PICKLE_BLOCKS_KEY, blocks_fpos_data,
+            PICKLE_VERSION_KEY, PICKLE_VERSION
+    );
+    if (!ret) {
+        Py_DECREF(blocks_fpos_data);
+    }
+    return ret;
+}
+
 /**
  * Returns a Python dict suitable for pickling.
  * Key/values are:
@@ -1242,6 +2305,7 @@ static int PICKLE_VERSION = 1;
 static PyObject *
 cp_SparseVirtualFile___getstate__(cp_SparseVirtualFile *self, PyObject *Py_UNUSED(ignored)) {
     ASSERT_FUNCTION_ENTRY_SVF(pSvf);
+    AcquireLockSVF _lock(self);
 
     SVFS::t_seek_reads blocks_fpos_len = self->pSvf->blocks();
     /* Build a tuple of ((fpos, bytes), ...) */
@@ -1270,24 +2334,121 @@ cp_SparseVirtualFile___getstate__(cp_SparseVirtualFile *self, PyObject *Py_UNUSE
         ++index;
     }
     /* Now build the pickle dict. */
-    PyObject * ret = Py_BuildValue(
-            "{"
-            "s:N"   /* id */
-            ",s:d"  /* file_mod_time */
-            ",s:N"  /* blocks */
-            ",s:i"  /* pickle_version */
-            "}",
-            PICKLE_ID_KEY, PyUnicode_FromKindAndData(PyUnicode_1BYTE_KIND,
-                                                     self->pSvf->id().c_str(),
-                                                     self->pSvf->id().size()
-            ),
-            PICKLE_FILE_MOD_TIME_KEY, self->pSvf->file_mod_time(),
-            PICKLE_BLOCKS_KEY, blocks_fpos_bytes,
-            PICKLE_VERSION_KEY, PICKLE_VERSION
-    );
+    return private_SparseVirtualFile_pickle_dict(self, blocks_fpos_bytes);
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFile___reduce_ex___docstring,
+        "__reduce_ex__(self, protocol: int) -> tuple\n\n"
+        "Support for pickling."
+        " With protocol 5 or greater the block data is a ``pickle.PickleBuffer`` that refers to the SVF memory so,"
+        " given a ``buffer_callback``, it is passed out-of-band without copying."
+        " The SVF can not be changed while any of those buffers exist, doing so raises a ``BufferError``."
+        " With earlier protocols the block data is copied into ``bytes``."
+);
+
+/**
+ * Support pickle protocol 5 out-of-band buffers.
+ *
+ * For a protocol less than 5 this is \c object.__reduce_ex__() which uses \c __getstate__().
+ * Otherwise this returns the same state as \c __getstate__() but with the data of each block as a
+ * \c pickle.PickleBuffer over the block memory.
+ *
+ * @param self The cp_SparseVirtualFile.
+ * @param args The protocol.
+ * @return The tuple (copyreg.__newobj__, (type,), state) or NULL on failure.
+ */
+static PyObject *
+cp_SparseVirtualFile___reduce_ex__(cp_SparseVirtualFile *self, PyObject *args) {
+    ASSERT_FUNCTION_ENTRY_SVF(pSvf);
+
+    PyObject * ret = NULL;
+    PyObject * copyreg = NULL;
+    PyObject * newobj = NULL;
+    PyObject * blocks_fpos_data = NULL;
+    PyObject * state = NULL;
+    int protocol = 0;
+    std::vector<std::pair<SVFS::t_fpos, std::pair<const char *, size_t>>> block_data;
+    Py_ssize_t index = 0;
+
+    if (!PyArg_ParseTuple(args, "i", &protocol)) {
+        goto except;
+    }
+    if (protocol < 5) {
+        ret = PyObject_CallMethod((PyObject *) &PyBaseObject_Type, "__reduce_ex__", "Oi", self, protocol);
+        if (!ret) {
+            goto except;
+        }
+        goto finally;
+    }
+    copyreg = PyImport_ImportModule("copyreg");
+    if (!copyreg) {
+        goto except;
+    }
+    newobj = PyObject_GetAttrString(copyreg, "__newobj__");
+    if (!newobj) {
+        goto except;
+    }
+    /* Not at the start as protocol < 5 calls __getstate__() which acquires the lock.
+     * The lock is held until the block data is pinned by the exporters. */
+    {
+        AcquireLockSVF _lock(self);
+        try {
+            self->pSvf->visit_blocks(
+                    [&block_data](SVFS::t_fpos fpos, const char *data, size_t len) {
+                        block_data.push_back({fpos, {data, len}});
+                    },
+                    false
+            );
+        } catch (const std::exception &err) {
+            PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+            goto except;
+        }
+        /* Build a tuple of ((fpos, PickleBuffer), ...) */
+        blocks_fpos_data = PyTuple_New(block_data.size());
+        if (!blocks_fpos_data) {
+            goto except;
+        }
+        for (const auto &block: block_data) {
+            PyObject * buffer = private_SparseVirtualFileBuffer_new(self, block.second.first, block.second.second);
+            if (!buffer) {
+                goto except;
+            }
+            PyObject * pickle_buffer = PyPickleBuffer_FromObject(buffer);
+            Py_DECREF(buffer);
+            if (!pickle_buffer) {
+                goto except;
+            }
+            /* value is (fpos, PickleBuffer) */
+            PyObject * fpos_data = Py_BuildValue("KN", static_cast<unsigned long long>(block.first),
+                                                 pickle_buffer);
+            if (!fpos_data) {
+                goto except;
+            }
+            PyTuple_SET_ITEM(blocks_fpos_data, index, fpos_data);
+            ++index;
+        }
+    }
+    state = private_SparseVirtualFile_pickle_dict(self, blocks_fpos_data);
+    blocks_fpos_data = NULL;
+    if (!state) {
+        goto except;
+    }
+    ret = Py_BuildValue("O(O)N", newobj, Py_TYPE(self), state);
+    state = NULL;
     if (!ret) {
-        Py_DECREF(blocks_fpos_bytes);
+        goto except;
     }
+    assert(!PyErr_Occurred());
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(blocks_fpos_data);
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    Py_XDECREF(newobj);
+    Py_XDECREF(copyreg);
     return ret;
 }
 
@@ -1295,11 +2456,15 @@ static PyObject *
 cp_SparseVirtualFile___setstate__(cp_SparseVirtualFile *self, PyObject *state) {
 //    PyObject * key, *value;
 //    Py_ssize_t pos = 0;
+    AcquireLockSVF _lock(self);
 
     if (!PyDict_CheckExact(state)) {
         PyErr_Format(PyExc_ValueError, "%s()#%d: Pickled object is not a dict.", __FUNCTION__, __LINE__);
         return NULL;
     }
+    if (private_SparseVirtualFile_check_exports(self, __FUNCTION__)) {
+        return NULL;
+    }
     /* Version check. */
     /* Borrowed reference but no need to increment as we create a C long from it. */
     PyObject * temp = PyDict_GetItemString(state, PICKLE_VERSION_KEY);
@@ -1372,29 +2537,57 @@ cp_SparseVirtualFile___setstate__(cp_SparseVirtualFile *self, PyObject *state) {
         return NULL;
     }
     Py_INCREF(blocks);
+    SVFS::t_block_values block_values;
+    block_values.reserve(PyTuple_Size(blocks));
     for (Py_ssize_t i = 0; i < PyTuple_Size(blocks); ++i) {
         PyObject * fpos_bytes = PyTuple_GetItem(blocks, i); /* Borrowed reference. */
         Py_INCREF(fpos_bytes);
         unsigned long long fpos;
-        PyObject * block_bytes = NULL; /* Borrowed reference. */
-        if (!PyArg_ParseTuple(fpos_bytes, "KO", &fpos, &block_bytes)) {
+        /* The data is bytes or, with pickle protocol 5 out-of-band buffers, any contiguous buffer. */
+        Py_buffer block_buffer;
+        if (!PyArg_ParseTuple(fpos_bytes, "Ky*", &fpos, &block_buffer)) {
             PyErr_Format(PyExc_ValueError, "%s()#%d: Can not parse block (fpos, bytes) tuple.", __FUNCTION__,
                          __LINE__, PICKLE_BLOCKS_KEY);
             Py_DECREF(fpos_bytes);
+            Py_DECREF(blocks);
             return NULL;
         }
-        Py_INCREF(block_bytes);
-        if (!PyBytes_Check(block_bytes)) {
-            PyErr_Format(PyExc_TypeError, "%s()#%d: Second item of \"%s\" is not a bytes object.", __FUNCTION__,
-                         __LINE__, PICKLE_BLOCKS_KEY);
-            Py_DECREF(block_bytes);
+        try {
+            /* As write() ignore empty data. */
+            if (block_buffer.len > 0) {
+                block_values.emplace_back(fpos, SVFS::BlockValue());
+                block_values.back().second.append(static_cast<const char *>(block_buffer.buf), block_buffer.len);
+            }
+        } catch (const std::exception &err) {
+            PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+            PyBuffer_Release(&block_buffer);
             Py_DECREF(fpos_bytes);
+            Py_DECREF(blocks);
             return NULL;
         }
-        self->pSvf->write(fpos, PyBytes_AS_STRING(block_bytes), PyBytes_GET_SIZE(block_bytes));
-        Py_DECREF(block_bytes);
+        PyBuffer_Release(&block_buffer);
         Py_DECREF(fpos_bytes);
     }
+    /* The blocks are sorted and do not touch so they are moved in without searching or coalescing.
+     * A state that was not created by __getstate__() might not be so those blocks are appended instead. */
+    try {
+        try {
+            self->pSvf->load_blocks(std::move(block_values));
+        } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileWrite &) {
+            for (const auto &block: block_values) {
+                self->pSvf->append(block.first, block.second.data(), block.second.size());
+            }
+        }
+    } catch (const SVFS::Exceptions::ExceptionSparseVirtualFile &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: Can not write to a SVF. ERROR: %s", __FUNCTION__,
+                     err.message().c_str());
+        Py_DECREF(blocks);
+        return NULL;
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        Py_DECREF(blocks);
+        return NULL;
+    }
     Py_DECREF(blocks);
     blocks = NULL;
     Py_RETURN_NONE;
@@ -1434,6 +2627,36 @@ static PyMethodDef cp_SparseVirtualFile_methods[] = {
                                                                                                 METH_KEYWORDS,
                         cp_SparseVirtualFile_read_docstring
         },
+        {
+                "read_view",             (PyCFunction) cp_SparseVirtualFile_read_view,          METH_VARARGS |
+                                                                                                METH_KEYWORDS,
+                        cp_SparseVirtualFile_read_view_docstring
+        },
+        {
+                "read_into",             (PyCFunction) cp_SparseVirtualFile_read_into,          METH_VARARGS |
+                                                                                                METH_KEYWORDS,
+                        cp_SparseVirtualFile_read_into_docstring
+        },
+        {
+                "write_many",            (PyCFunction) cp_SparseVirtualFile_write_many,         METH_VARARGS |
+                                                                                                METH_KEYWORDS,
+                        cp_SparseVirtualFile_write_many_docstring
+        },
+        {
+                "read_many",             (PyCFunction) cp_SparseVirtualFile_read_many,          METH_VARARGS |
+                                                                                                METH_KEYWORDS,
+                        cp_SparseVirtualFile_read_many_docstring
+        },
+        {
+                "has_data_many",         (PyCFunction) cp_SparseVirtualFile_has_data_many,      METH_VARARGS |
+                                                                                                METH_KEYWORDS,
+                        cp_SparseVirtualFile_has_data_many_docstring
+        },
+        {
+                "read_through",          (PyCFunction) cp_SparseVirtualFile_read_through,       METH_VARARGS |
+                                                                                                METH_KEYWORDS,
+                        cp_SparseVirtualFile_read_through_docstring
+        },
         {
                 "erase",                 (PyCFunction) cp_SparseVirtualFile_erase,              METH_VARARGS |
                                                                                                 METH_KEYWORDS,
@@ -1453,22 +2676,41 @@ static PyMethodDef cp_SparseVirtualFile_methods[] = {
                                                                                                 METH_KEYWORDS,
                         cp_SparseVirtualFile_need_many_docstring
         },
+        {
+                "need_array",            (PyCFunction) cp_SparseVirtualFile_need_array,         METH_VARARGS |
+                                                                                                METH_KEYWORDS,
+                        cp_SparseVirtualFile_need_array_docstring
+        },
         // ---- Meta information about the specific SVF ----
         {
                 "blocks",                (PyCFunction) cp_SparseVirtualFile_blocks,             METH_NOARGS,
                 cp_SparseVirtualFile_blocks_docstring
         },
+        {
+                "blocks_array",          (PyCFunction) cp_SparseVirtualFile_blocks_array,       METH_NOARGS,
+                cp_SparseVirtualFile_blocks_array_docstring
+        },
         SVFS_SVF_METHOD_SIZE_T_REGISTER(block_touch),
         {
                 "block_touches",         (PyCFunction) cp_SparseVirtualFile_block_touches,      METH_NOARGS,
                 cp_SparseVirtualFile_block_touches_docstring
         },
+        {
+                "block_touches_array",   (PyCFunction) cp_SparseVirtualFile_block_touches_array,
+                                                                                                METH_NOARGS,
+                cp_SparseVirtualFile_block_touches_array_docstring
+        },
         {
                 "lru_punt",              (PyCFunction) cp_SparseVirtualFile_lru_punt,
                                                                                                 METH_VARARGS |
                                                                                                 METH_KEYWORDS,
                         cp_SparseVirtualFile_lru_punt_docstring
         },
+        {
+                "compact",               (PyCFunction) cp_SparseVirtualFile_compact,            METH_VARARGS |
+                                                                                                METH_KEYWORDS,
+                        cp_SparseVirtualFile_compact_docstring
+        },
         {
                 "file_mod_time_matches", (PyCFunction) cp_SparseVirtualFile_file_mod_time_matches,
                                                                                                 METH_VARARGS |
@@ -1506,6 +2748,9 @@ static PyMethodDef cp_SparseVirtualFile_methods[] = {
         {       "__setstate__",          (PyCFunction) cp_SparseVirtualFile___setstate__,       METH_O,
                 "Set the state from a pickled object."
         },
+        {       "__reduce_ex__",         (PyCFunction) cp_SparseVirtualFile___reduce_ex__,      METH_VARARGS,
+                cp_SparseVirtualFile___reduce_ex___docstring
+        },
         {NULL, NULL, 0, NULL}  /* Sentinel */
 };
 
@@ -1525,6 +2770,16 @@ PyDoc_STRVAR(
         " - ``compare_for_diff``, a boolean that will check that overlapping writes match (default ``True``)."
         " If ``True`` this adds about 25% time to an overlapping write but gives better chance of catching changes to the"
         " original file.\n"
+        " - ``coverage_page_size``, an integer power of two that, if non-zero, maintains a bitmap of pages wholly"
+        " held by the SVF (default 0)."
+        " This makes ``has()`` and ``need()`` constant time for cached data at the cost of one bit per page.\n"
+        " - ``dense_gap``, an integer that, if non-zero, holds blocks separated by up to this many bytes in a single"
+        " dense region (default 0)."
+        " This greatly reduces the memory overhead of many small, nearly adjacent, blocks.\n"
+        " - ``spill_capacity``, an integer that, if non-zero, is the size of a memory mapped file that blocks removed by"
+        " ``lru_punt()`` are spilled to (default 0)."
+        " Spilled blocks are still reported by ``has()`` and omitted by ``need()`` so do not have to be fetched again.\n"
+        " - ``spill_directory``, the directory for the spill file (default ``''``, the system temporary directory).\n"
         "\n\n"
         "For example::"
         "\n\n"
@@ -1536,7 +2791,7 @@ PyDoc_STRVAR(
         "       svf.need(10, 12)  # Returns ((10, 2), 16, 6)), the file positions and lengths the the SVF needs\n"
         "       svf.read(1024, 18)  # SVF raises an error as it has no data here.\n"
         "\n"
-        "Signature:\n\n``svfsc.cSVF(id: str, mod_time: float = 0.0, overwrite_on_exit: bool = False, compare_for_diff: bool = True)``"
+        "Signature:\n\n``svfsc.cSVF(id: str, mod_time: float = 0.0, overwrite_on_exit: bool = False, compare_for_diff: bool = True, coverage_page_size: int = 0, dense_gap: int = 0, spill_capacity: int = 0, spill_directory: str = '')``"
 );
 // @formatter:on
 // clang-format on
@@ -36,12 +36,16 @@
 
 #include <ctime>
 #include <memory>
+#include <new>
+#include <unordered_map>
+#include <unordered_set>
 
+#include "svf_journal.h"
+#include "svf_spill.h"
 #include "svfs.h"
 #include "svfs_util.h"
 
 /* TODO: Implement pickling an SVFS?
- * TODO: Implement the Buffer Protocol rather than returning a copy of the bytes? Look for PyBytes_FromStringAndSize().
  * */
 
 /**
@@ -59,16 +63,17 @@ cp_SparseVirtualFileSystem_svf_##method_name(cp_SparseVirtualFileSystem *self, P
     PyObject *ret = NULL; \
     char *c_id = NULL; \
     std::string cpp_id; \
-    AcquireLockSVFS _lock(self); \
+    SVFS::SparseVirtualFile *p_svf = NULL; \
+    AcquireLockSVFSFile _lock(self); \
     static const char *kwlist[] = { "id", NULL}; \
     if (! PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **)kwlist, &c_id)) { \
         goto except; \
     } \
     cpp_id = std::string(c_id); \
     try { \
-        if (self->p_svfs->has(cpp_id)) { \
-            const SVFS::SparseVirtualFile &svf = self->p_svfs->at(cpp_id); \
-            ret = PyLong_FromLong(svf.method_name()); \
+        p_svf = _lock.acquire(cpp_id); \
+        if (p_svf) { \
+            ret = PyLong_FromLong(p_svf->method_name()); \
         } else { \
             PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id); \
             goto except; \
@@ -89,22 +94,83 @@ finally: \
 }
 
 
+#ifdef PY_THREAD_SAFE
+
+/**
+ * @brief The lock for one SVF in a cp_SparseVirtualFileSystem.
+ *
+ * These are created when first needed and are shared by every thread using that SVF.
+ */
+struct cp_SparseVirtualFileSystemFileLock {
+    PyThread_type_lock lock = NULL;
+    /// Set when the SVF might have been removed while a thread waited for the lock, that thread must look again.
+    bool stale = false;
+
+    ~cp_SparseVirtualFileSystemFileLock() {
+        if (lock) {
+            PyThread_free_lock(lock);
+        }
+    }
+};
+
+/// Map of SVF ID to its lock.
+typedef std::unordered_map<std::string, std::shared_ptr<cp_SparseVirtualFileSystemFileLock>> t_file_locks;
+
+#endif
+
 /**
  * @brief Python wrapper around a C++ SparseVirtualFile.
  *
- * If \c PY_THREAD_SAFE is defined then this also contains a mutex.
+ * If \c PY_THREAD_SAFE is defined then this also contains a lock for the map of SVFs and a lock for each SVF.
+ * See AcquireLockSVFS, AcquireLockSVFSFile and AcquireLockSVFSAll.
  */
 typedef struct {
     PyObject_HEAD
     SVFS::SparseVirtualFileSystem *p_svfs;
+    /// Count of block buffers exported by \c read_view() for each SVF ID, while non-zero that SVF can not be changed.
+    std::unordered_map<std::string, Py_ssize_t> *exports;
+    /// A thread is evicting after a write, see private_SparseVirtualFileSystem_evict_after_write().
+    /// This is guarded by the GIL.
+    bool evicting;
 #ifdef PY_THREAD_SAFE
     PyThread_type_lock lock;
+    /// The lock of each SVF, guarded by \c lock.
+    t_file_locks *file_locks;
 #endif
 } cp_SparseVirtualFileSystem;
 
+/**
+ * @brief The state of a SVF handle returned by \c cSVFS.open(), see cp_SparseVirtualFileSystemHandle.
+ */
+struct t_svfs_handle_state {
+    /// The SVF ID.
+    std::string id;
+    /// The SVF, this keeps it alive.
+    SVFS::t_svf_handle svf;
+#ifdef PY_THREAD_SAFE
+    /// The lock of the SVF, if this is stale the SVF is found again by ID.
+    std::shared_ptr<cp_SparseVirtualFileSystemFileLock> file_lock;
+#endif
+};
+
 #ifdef PY_THREAD_SAFE
 
+/**
+ * Acquire a lock, releasing the GIL if we have to wait.
+ */
+static void
+private_acquire_lock(PyThread_type_lock lock) {
+    assert(lock);
+    if (!PyThread_acquire_lock(lock, NOWAIT_LOCK)) {
+        Py_BEGIN_ALLOW_THREADS
+            PyThread_acquire_lock(lock, WAIT_LOCK);
+        Py_END_ALLOW_THREADS
+    }
+}
+
 /** @brief A RAII wrapper around the PyThread_type_lock for the CPython SVFS.
+ *
+ * This is for operations on the map of SVFs such as \c insert() and \c keys() that do not touch the data of any SVF.
  *
  * See https://pythonextensionpatterns.readthedocs.io/en/latest/thread_safety.html
  * */
@@ -112,12 +178,7 @@ class AcquireLockSVFS {
 public:
     explicit AcquireLockSVFS(cp_SparseVirtualFileSystem *pSVFS) : _pSVFS(pSVFS) {
         assert(_pSVFS);
-        assert(_pSVFS->lock);
-        if (!PyThread_acquire_lock(_pSVFS->lock, NOWAIT_LOCK)) {
-            Py_BEGIN_ALLOW_THREADS
-                PyThread_acquire_lock(_pSVFS->lock, WAIT_LOCK);
-            Py_END_ALLOW_THREADS
-        }
+        private_acquire_lock(_pSVFS->lock);
     }
 
     ~AcquireLockSVFS() {
@@ -130,12 +191,205 @@ private:
     cp_SparseVirtualFileSystem *_pSVFS;
 };
 
+/** @brief A RAII lock of a single SVF in the CPython SVFS.
+ *
+ * \c acquire() holds the SVFS lock only while it finds the SVF, then it holds the lock of that SVF so threads using
+ * different SVFs do not wait for each other.
+ * The SVF handle keeps the SVF alive until this is destroyed.
+ * If \c acquire() is for a change and the SVFS has a journal the SVFS lock is held as well as the journal is shared.
+ */
+class AcquireLockSVFSFile {
+public:
+    explicit AcquireLockSVFSFile(cp_SparseVirtualFileSystem *pSVFS) : _pSVFS(pSVFS) {
+        assert(_pSVFS);
+    }
+
+    /**
+     * Find and lock a SVF.
+     *
+     * @param id The SVF ID.
+     * @param change True if this will change the SVF.
+     * @return The SVF or \c nullptr if there is no SVF of that ID.
+     */
+    SVFS::SparseVirtualFile *acquire(const std::string &id, bool change = false) {
+        assert(!_file_lock);
+        while (true) {
+            private_acquire_lock(_pSVFS->lock);
+            _svf = _pSVFS->p_svfs->handle(id);
+            if (!_svf) {
+                PyThread_release_lock(_pSVFS->lock);
+                return nullptr;
+            }
+            try {
+                std::shared_ptr<cp_SparseVirtualFileSystemFileLock> &file_lock = (*_pSVFS->file_locks)[id];
+                if (!file_lock) {
+                    file_lock = std::make_shared<cp_SparseVirtualFileSystemFileLock>();
+                    file_lock->lock = PyThread_allocate_lock();
+                    if (!file_lock->lock) {
+                        _pSVFS->file_locks->erase(id);
+                        throw std::bad_alloc();
+                    }
+                }
+                _file_lock = file_lock;
+            } catch (...) {
+                PyThread_release_lock(_pSVFS->lock);
+                throw;
+            }
+            _holds_svfs_lock = change && _pSVFS->p_svfs->journal();
+            if (!_holds_svfs_lock) {
+                PyThread_release_lock(_pSVFS->lock);
+            }
+            private_acquire_lock(_file_lock->lock);
+            if (!_file_lock->stale) {
+                return _svf.get();
+            }
+            // Can not be stale if we held the SVFS lock throughout.
+            assert(!_holds_svfs_lock);
+            PyThread_release_lock(_file_lock->lock);
+            _file_lock.reset();
+        }
+    }
+
+    /**
+     * Lock the SVF of a handle from \c open() without finding it by ID.
+     * The SVF is only found again by ID if its lock is stale or if this is a change and there is a journal.
+     *
+     * @param state The handle state, this is updated if the SVF is found again.
+     * @param change True if this will change the SVF.
+     * @return The SVF or \c nullptr if the SVF has been removed.
+     */
+    SVFS::SparseVirtualFile *acquire(t_svfs_handle_state &state, bool change = false) {
+        assert(!_file_lock);
+        if (state.file_lock) {
+            private_acquire_lock(state.file_lock->lock);
+            // The journal can not be opened or closed while we hold a lock that is not stale.
+            if (!state.file_lock->stale && !(change && _pSVFS->p_svfs->journal())) {
+                _file_lock = state.file_lock;
+                _svf = state.svf;
+                return _svf.get();
+            }
+            PyThread_release_lock(state.file_lock->lock);
+        }
+        SVFS::SparseVirtualFile *ret = acquire(state.id, change);
+        state.svf = _svf;
+        state.file_lock = _file_lock;
+        return ret;
+    }
+
+    /**
+     * Release the locks before this goes out of scope, for example to take AcquireLockSVFSAll.
+     */
+    void release() {
+        if (_file_lock) {
+            PyThread_release_lock(_file_lock->lock);
+            _file_lock.reset();
+        }
+        if (_holds_svfs_lock) {
+            PyThread_release_lock(_pSVFS->lock);
+            _holds_svfs_lock = false;
+        }
+        _svf.reset();
+    }
+
+    ~AcquireLockSVFSFile() {
+        release();
+    }
+
+private:
+    cp_SparseVirtualFileSystem *_pSVFS;
+    /// Keeps the SVF alive while this is in scope.
+    SVFS::t_svf_handle _svf;
+    std::shared_ptr<cp_SparseVirtualFileSystemFileLock> _file_lock;
+    bool _holds_svfs_lock = false;
+};
+
+/** @brief A RAII lock of the CPython SVFS and every SVF in it.
+ *
+ * This is for operations across every SVF such as \c lru_punt_all() and \c save().
+ * If \c stale is true the SVF locks are discarded on release as the SVFs might have been removed, for example by
+ * replaying a journal.
+ */
+class AcquireLockSVFSAll {
+public:
+    explicit AcquireLockSVFSAll(cp_SparseVirtualFileSystem *pSVFS, bool stale = false) : _pSVFS(pSVFS),
+                                                                                           _stale(stale) {
+        assert(_pSVFS);
+        private_acquire_lock(_pSVFS->lock);
+        for (auto &iter: *_pSVFS->file_locks) {
+            private_acquire_lock(iter.second->lock);
+        }
+    }
+
+    ~AcquireLockSVFSAll() {
+        for (auto &iter: *_pSVFS->file_locks) {
+            iter.second->stale = _stale;
+            PyThread_release_lock(iter.second->lock);
+        }
+        if (_stale) {
+            _pSVFS->file_locks->clear();
+        }
+        PyThread_release_lock(_pSVFS->lock);
+    }
+
+private:
+    cp_SparseVirtualFileSystem *_pSVFS;
+    bool _stale;
+};
+
+/**
+ * Wait until no thread is using a SVF and discard its lock, the SVFS lock must be held.
+ * This is called before the SVF is removed.
+ */
+static void
+private_SparseVirtualFileSystem_retire_file_lock(cp_SparseVirtualFileSystem *self, const std::string &id) {
+    auto iter = self->file_locks->find(id);
+    if (iter != self->file_locks->end()) {
+        std::shared_ptr<cp_SparseVirtualFileSystemFileLock> file_lock = iter->second;
+        self->file_locks->erase(iter);
+        private_acquire_lock(file_lock->lock);
+        file_lock->stale = true;
+        PyThread_release_lock(file_lock->lock);
+    }
+}
+
 #else
-/* Make the class a NOP which should get optimised out. */
+/* Make the classes a NOP which should get optimised out. */
 class AcquireLockSVFS {
 public:
     AcquireLockSVFS(cp_SparseVirtualFileSystem *) {}
 };
+
+class AcquireLockSVFSFile {
+public:
+    explicit AcquireLockSVFSFile(cp_SparseVirtualFileSystem *pSVFS) : _pSVFS(pSVFS) {}
+
+    SVFS::SparseVirtualFile *acquire(const std::string &id, bool = false) {
+        _svf = _pSVFS->p_svfs->handle(id);
+        return _svf.get();
+    }
+
+    SVFS::SparseVirtualFile *acquire(t_svfs_handle_state &state, bool = false) {
+        // Without the SVF locks the only way to detect removal is to find the SVF again.
+        state.svf = _pSVFS->p_svfs->handle(state.id);
+        return state.svf.get();
+    }
+
+    void release() {
+        _svf.reset();
+    }
+
+private:
+    cp_SparseVirtualFileSystem *_pSVFS;
+    SVFS::t_svf_handle _svf;
+};
+
+class AcquireLockSVFSAll {
+public:
+    explicit AcquireLockSVFSAll(cp_SparseVirtualFileSystem *, bool = false) {}
+};
+
+static void
+private_SparseVirtualFileSystem_retire_file_lock(cp_SparseVirtualFileSystem *, const std::string &) {}
 #endif
 
 // Function entry point test macro.
@@ -149,113 +403,199 @@ public:
 } while (0)
 
 
-// Construction and destruction
-#pragma mark Construction and destruction
-
-static PyObject *
-cp_SparseVirtualFileSystem_new(PyTypeObject *type, PyObject *Py_UNUSED(args), PyObject *Py_UNUSED(kwds)) {
-    assert(!PyErr_Occurred());
-    cp_SparseVirtualFileSystem *self;
-    self = (cp_SparseVirtualFileSystem *) type->tp_alloc(type, 0);
-    if (self != NULL) {
-        self->p_svfs = nullptr;
-#ifdef PY_THREAD_SAFE
-        self->lock = NULL;
-#endif
+/**
+ * Check that there are no exported block buffers before changing a SVF.
+ *
+ * @param self The cp_SparseVirtualFileSystem.
+ * @param c_id The SVF ID or NULL to check every SVF.
+ * @param function The name of the calling function for the error message.
+ * @return Zero if the SVF can be changed, non-zero with a \c BufferError set if not.
+ */
+static int
+private_SparseVirtualFileSystem_check_exports(cp_SparseVirtualFileSystem *self, const char *c_id,
+                                              const char *function) {
+    if (!self->exports->empty() && (!c_id || self->exports->count(c_id) != 0)) {
+        PyErr_Format(PyExc_BufferError, "%s(): Existing exports of data: the SVF can not be changed.", function);
+        return -1;
     }
-//    PyObject_Print((PyObject *)self, stdout);
-//    fprintf(stdout, "cp_SparseVirtualFileSystem_new() self %p\n", (void *)self);
-    assert(!PyErr_Occurred());
-    return (PyObject *) self;
+    return 0;
 }
 
+/**
+ * After a write evict the least recently used blocks of any SVF down to the low water mark if the SVFS is over its
+ * budget, see SparseVirtualFileSystem::evict_over_budget().
+ * This takes the lock of every SVF so the caller must hold none.
+ * If another thread is already evicting this does not wait for it, as SparseVirtualFileSystem::write().
+ * Blocks of SVFs with exported block buffers are not evicted.
+ *
+ * @param self The cp_SparseVirtualFileSystem.
+ * @param function The name of the calling function for the error message.
+ * @return Zero on success, non-zero with an exception set on failure.
+ */
 static int
-cp_SparseVirtualFileSystem_init(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
-    assert(!PyErr_Occurred());
-    static const char *kwlist[] = {"overwrite_on_exit", "compare_for_diff", NULL};
-    SVFS::tSparseVirtualFileConfig config;
+private_SparseVirtualFileSystem_evict_after_write(cp_SparseVirtualFileSystem *self, const char *function) {
+    const size_t budget = self->p_svfs->budget();
+    if (budget == 0 || self->p_svfs->num_bytes() <= budget || self->evicting) {
+        return 0;
+    }
+    int ret = 0;
+    self->evicting = true;
+    {
+        AcquireLockSVFSAll _lock(self);
+
+        // No new exports can be made while every SVF is locked.
+        std::unordered_set<std::string> pinned;
+        for (const auto &iter: *self->exports) {
+            pinned.insert(iter.first);
+        }
+        SVFS::SparseVirtualFileSystem::t_evict_skip_function skip;
+        if (!pinned.empty()) {
+            skip = [&pinned](const SVFS::SparseVirtualFile &svf) { return pinned.count(svf.id()) != 0; };
+        }
+        try {
+            const size_t max_blocks = self->p_svfs->evict_max_blocks();
+            ReleaseGIL _release(max_blocks == 0 || max_blocks >= PY_RELEASE_GIL_BLOCKS);
+            self->p_svfs->evict_over_budget(skip);
+        } catch (const std::exception &err) {
+            PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", function, err.what());
+            ret = -1;
+        }
+    }
+    self->evicting = false;
+    return ret;
+}
 
-//    TRACE_SELF_ARGS_KWARGS;
-//    fprintf(stdout, "Config was compare_for_diff=%d overwrite_on_exit=%d\n", config.compare_for_diff,
-//            config.overwrite_on_exit);
+/**
+ * @brief A read only buffer over the data of one block of a SVF in a cp_SparseVirtualFileSystem.
+ *
+ * These are created by \c read_view() and wrapped in a \c memoryview.
+ * This holds a reference to the cp_SparseVirtualFileSystem and, while it exists, the SVF can not be changed or
+ * removed as that might move the data.
+ */
+typedef struct {
+    PyObject_HEAD
+    cp_SparseVirtualFileSystem *p_svfs;
+    std::string *id;
+    const char *data;
+    Py_ssize_t len;
+} cp_SparseVirtualFileSystemBuffer;
 
-    // NOTE: With format unit 'p' we need to pass in an int.
-    int overwrite_on_exit = config.overwrite_on_exit ? 1 : 0;
-    int compare_for_diff = config.compare_for_diff ? 1 : 0;
+static int
+cp_SparseVirtualFileSystemBuffer_getbuffer(cp_SparseVirtualFileSystemBuffer *self, Py_buffer *view, int flags) {
+    return PyBuffer_FillInfo(view, (PyObject *) self, (void *) self->data, self->len, 1, flags);
+}
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|pp", (char **) kwlist, &overwrite_on_exit, &compare_for_diff)) {
-        assert(PyErr_Occurred());
-        return -1;
+static void
+cp_SparseVirtualFileSystemBuffer_dealloc(cp_SparseVirtualFileSystemBuffer *self) {
+    auto iter = self->p_svfs->exports->find(*self->id);
+    assert(iter != self->p_svfs->exports->end());
+    if (--iter->second == 0) {
+        self->p_svfs->exports->erase(iter);
     }
-    config.overwrite_on_exit = overwrite_on_exit != 0;
-    config.compare_for_diff = compare_for_diff != 0;
+    delete self->id;
+    Py_DECREF(self->p_svfs);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
 
-//    fprintf(stdout, "Config now compare_for_diff=%d overwrite_on_exit=%d\n", config.compare_for_diff,
-//            config.overwrite_on_exit);
+static PyBufferProcs cp_SparseVirtualFileSystemBuffer_as_buffer = {
+        .bf_getbuffer = (getbufferproc) cp_SparseVirtualFileSystemBuffer_getbuffer,
+        .bf_releasebuffer = NULL,
+};
 
-    self->p_svfs = new SVFS::SparseVirtualFileSystem(config);
-#ifdef PY_THREAD_SAFE
-    self->lock = PyThread_allocate_lock();
-    if (self->lock == NULL) {
-        delete self->p_svfs;
-        PyErr_SetString(PyExc_MemoryError, "Unable to allocate thread lock.");
-        return -2;
+static PyTypeObject svfsc_cSVFSBuffer = {
+        PyVarObject_HEAD_INIT(NULL, 0)
+        .tp_name = "svfsc._cSVFSBuffer",
+        .tp_basicsize = sizeof(cp_SparseVirtualFileSystemBuffer),
+        .tp_itemsize = 0,
+        .tp_dealloc = (destructor) cp_SparseVirtualFileSystemBuffer_dealloc,
+        .tp_as_buffer = &cp_SparseVirtualFileSystemBuffer_as_buffer,
+        .tp_flags = Py_TPFLAGS_DEFAULT,
+        .tp_doc = "A read only buffer over the data of one block of a SVF in a cSVFS.",
+};
+
+/**
+ * Create a new buffer over the data of a block, this prevents changes to the SVF until it is deallocated.
+ *
+ * @param p_svfs The cp_SparseVirtualFileSystem.
+ * @param id The SVF ID.
+ * @param data The block data.
+ * @param len The length of the block data.
+ * @return A new reference or NULL on failure.
+ */
+static PyObject *
+private_SparseVirtualFileSystemBuffer_new(cp_SparseVirtualFileSystem *p_svfs, const std::string &id, const char *data,
+                                          size_t len) {
+    cp_SparseVirtualFileSystemBuffer *ret = PyObject_New(cp_SparseVirtualFileSystemBuffer, &svfsc_cSVFSBuffer);
+    if (ret) {
+        try {
+            ret->id = new std::string(id);
+            (*p_svfs->exports)[id] += 1;
+        } catch (const std::exception &err) {
+            PyErr_Format(PyExc_MemoryError, "%s: Can not create buffer %s", __FUNCTION__, err.what());
+            PyObject_Del(ret);
+            return NULL;
+        }
+        Py_INCREF(p_svfs);
+        ret->p_svfs = p_svfs;
+        ret->data = data;
+        ret->len = static_cast<Py_ssize_t>(len);
     }
-#endif
-//    fprintf(stdout, "cp_SparseVirtualFileSystem_init() self->p_svfs %p\n", (void *)self->p_svfs);
-    assert(!PyErr_Occurred());
-    return 0;
+    return (PyObject *) ret;
 }
 
+// SVF handles
+#pragma mark SVF handles
+
+/**
+ * @brief A handle to one SVF in a cp_SparseVirtualFileSystem returned by \c cSVFS.open().
+ *
+ * This holds the SVF and its lock so calls do not parse, hash and find the ID each time.
+ * The handle refers to the ID so if that SVF is removed calls raise an \c IndexError.
+ * This holds a reference to the cp_SparseVirtualFileSystem.
+ */
+typedef struct {
+    PyObject_HEAD
+    cp_SparseVirtualFileSystem *p_svfs;
+    t_svfs_handle_state *state;
+} cp_SparseVirtualFileSystemHandle;
+
 static void
-cp_SparseVirtualFileSystem_dealloc(cp_SparseVirtualFileSystem *self) {
-#ifdef PY_THREAD_SAFE
-    if (self->lock) {
-        PyThread_free_lock(self->lock);
-        self->lock = NULL;
-    }
-#endif
-    delete self->p_svfs;
+cp_SparseVirtualFileSystemHandle_dealloc(cp_SparseVirtualFileSystemHandle *self) {
+    delete self->state;
+    Py_XDECREF(self->p_svfs);
     Py_TYPE(self)->tp_free((PyObject *) self);
 }
 
-// END: Construction and destruction
-#pragma mark END: Construction and destruction
-
-// SVFS functions
-#pragma mark SVFS functions
+static PyObject *
+cp_SparseVirtualFileSystemHandle_id(cp_SparseVirtualFileSystemHandle *self, void *Py_UNUSED(closure)) {
+    return PyUnicode_FromStringAndSize(self->state->id.c_str(), static_cast<Py_ssize_t>(self->state->id.size()));
+}
 
 PyDoc_STRVAR(
-        cp_SparseVirtualFileSystem_keys_docstring,
-        "keys(self) -> typing.List[str]\n\n"
-        "Returns the IDs of all the Sparse Virtual Files in the Sparse Virtual File System."
+        cp_SparseVirtualFileSystemHandle_has_data_docstring,
+        "has_data(self, file_position: int, length: int) -> bool\n\n"
+        "As :py:meth:`svfsc.cSVFS.has_data` for the SVF of this handle."
 );
 
 static PyObject *
-cp_SparseVirtualFileSystem_keys(cp_SparseVirtualFileSystem *self) {
-    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
-
-    Py_ssize_t index = 0;
-    PyObject * key = NULL;
-    // All items set to NULL on construction.
-    PyObject * ret = PyList_New(self->p_svfs->size());
-    AcquireLockSVFS _lock(self);
+cp_SparseVirtualFileSystemHandle_has_data(cp_SparseVirtualFileSystemHandle *self, PyObject *args, PyObject *kwargs) {
+    PyObject * ret = NULL;
+    unsigned long long fpos = 0;
+    unsigned long long len = 0;
+    static const char *kwlist[] = {"file_position", "length", NULL};
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self->p_svfs);
 
-    if (!ret) {
-        PyErr_Format(PyExc_RuntimeError, "%s: Can create list of size %d", __FUNCTION__, self->p_svfs->size());
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "KK", (char **) kwlist, &fpos, &len)) {
         goto except;
     }
     try {
-        for (const auto &cpp_key: self->p_svfs->keys()) {
-            key = PyUnicode_FromKindAndData(PyUnicode_1BYTE_KIND, cpp_key.c_str(), cpp_key.size());
-            if (!key) {
-                PyErr_Format(PyExc_RuntimeError, "%s: Can create key for %s", __FUNCTION__, cpp_key.c_str());
-                goto except;
-            }
-            // No error checking for this line. Steals reference.
-            PyList_SET_ITEM(ret, index, key);
-            key = NULL; // Safety habit with stolen reference.
-            ++index;
+        p_svf = _lock.acquire(*self->state);
+        if (p_svf) {
+            ret = PyBool_FromLong(p_svf->has(fpos, len) ? 1 : 0);
+        } else {
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, self->state->id.c_str());
+            goto except;
         }
     } catch (const std::exception &err) {
         PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
@@ -266,11 +606,6 @@ cp_SparseVirtualFileSystem_keys(cp_SparseVirtualFileSystem *self) {
     goto finally;
     except:
     assert(PyErr_Occurred());
-    if (ret) {
-        for (Py_ssize_t i = 0; i < PyList_Size(ret); ++i) {
-            Py_XDECREF(PyList_GET_ITEM(ret, i));
-        }
-    }
     Py_XDECREF(ret);
     ret = NULL;
     finally:
@@ -278,80 +613,1505 @@ cp_SparseVirtualFileSystem_keys(cp_SparseVirtualFileSystem *self) {
 }
 
 PyDoc_STRVAR(
-        cp_SparseVirtualFileSystem_insert_docstring,
-        "insert(self, id: str) -> None\n\n"
-        "Inserts a Sparse Virtual File of ID and Unix file modification time as a float."
+        cp_SparseVirtualFileSystemHandle_write_docstring,
+        "write(self, file_position: int, data: typing.Union[bytes, bytearray, memoryview]) -> None\n\n"
+        "As :py:meth:`svfsc.cSVFS.write` for the SVF of this handle."
 );
 
 static PyObject *
-cp_SparseVirtualFileSystem_insert(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
-    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
-
+cp_SparseVirtualFileSystemHandle_write(cp_SparseVirtualFileSystemHandle *self, PyObject *args, PyObject *kwargs) {
     PyObject * ret = NULL;
-    char *c_id = NULL;
-    double mod_time;
-    static const char *kwlist[] = {"id", "mod_time", NULL};
-    AcquireLockSVFS _lock(self);
+    unsigned long long fpos = 0;
+    // Any contiguous buffer, NULL obj until parsed so that it can always be released.
+    Py_buffer data_buffer = {};
+    static const char *kwlist[] = {"file_position", "data", NULL};
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self->p_svfs);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sd", (char **) kwlist, &c_id, &mod_time)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Ky*", (char **) kwlist, &fpos, &data_buffer)) {
         goto except;
     }
     try {
-        self->p_svfs->insert(c_id, mod_time);
-    } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileSystemInsert &err) {
-        PyErr_Format(
-                PyExc_RuntimeError, "%s: Can not insert a new Sparse Virtual File ID = \"%s\". ERROR: %s",
-                __FUNCTION__, c_id, err.message().c_str()
-        );
-        goto except;
+        p_svf = _lock.acquire(*self->state, true);
+        if (p_svf) {
+            if (private_SparseVirtualFileSystem_check_exports(self->p_svfs, self->state->id.c_str(), __FUNCTION__)) {
+                goto except;
+            }
+            try {
+                ReleaseGIL _release(static_cast<size_t>(data_buffer.len) >= PY_RELEASE_GIL_BYTES);
+                p_svf->write(fpos, static_cast<const char *>(data_buffer.buf), data_buffer.len);
+            } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileDiff &err) {
+                PyErr_Format(PyExc_IOError,
+                             "%s: Can not write to a SVF id = \"%s\" as the given data is different from what is there. ERROR: %s",
+                             __FUNCTION__, self->state->id.c_str(), err.message().c_str());
+                goto except;
+            } catch (const SVFS::Exceptions::ExceptionSparseVirtualFile &err) {
+                PyErr_Format(PyExc_RuntimeError, "%s: Can not write to a SVF id = \"%s\". ERROR: %s",
+                             __FUNCTION__, self->state->id.c_str(), err.message().c_str());
+                goto except;
+            }
+        } else {
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, self->state->id.c_str());
+            goto except;
+        }
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    _lock.release();
+    if (private_SparseVirtualFileSystem_evict_after_write(self->p_svfs, __FUNCTION__)) {
+        goto except;
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+    assert(!PyErr_Occurred());
+    assert(ret);
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    PyBuffer_Release(&data_buffer);
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystemHandle_read_docstring,
+        "read(self, file_position: int, length: int) -> bytes\n\n"
+        "As :py:meth:`svfsc.cSVFS.read` for the SVF of this handle."
+);
+
+static PyObject *
+cp_SparseVirtualFileSystemHandle_read(cp_SparseVirtualFileSystemHandle *self, PyObject *args, PyObject *kwargs) {
+    PyObject * ret = NULL;
+    unsigned long long fpos = 0;
+    unsigned long long len = 0;
+    static const char *kwlist[] = {"file_position", "length", NULL};
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self->p_svfs);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "KK", (char **) kwlist, &fpos, &len)) {
+        goto except;
+    }
+    try {
+        p_svf = _lock.acquire(*self->state);
+        if (p_svf) {
+            // A read promotes spilled blocks which might coalesce exported blocks.
+            if (p_svf->spill() && p_svf->spill()->num_blocks()
+                && private_SparseVirtualFileSystem_check_exports(self->p_svfs, self->state->id.c_str(),
+                                                                 __FUNCTION__)) {
+                goto except;
+            }
+            ret = PyBytes_FromStringAndSize(NULL, len);
+            if (!ret) {
+                goto except;
+            }
+            try {
+                ReleaseGIL _release(len >= PY_RELEASE_GIL_BYTES);
+                p_svf->read(fpos, len, PyBytes_AS_STRING(ret));
+            } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileRead &err) {
+                PyErr_Format(PyExc_IOError, "%s: Can not read from a SVF id= \"%s\". ERROR: %s",
+                             __FUNCTION__, self->state->id.c_str(), err.message().c_str());
+                goto except;
+            } catch (const SVFS::Exceptions::ExceptionSparseVirtualFile &err) {
+                PyErr_Format(PyExc_RuntimeError, "%s: Fatal error reading from a SVF id= \"%s\". ERROR: %s",
+                             __FUNCTION__, self->state->id.c_str(), err.message().c_str());
+                goto except;
+            }
+        } else {
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, self->state->id.c_str());
+            goto except;
+        }
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    assert(!PyErr_Occurred());
+    assert(ret);
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystemHandle_need_docstring,
+        "need(self, file_position: int, length: int, greedy_length: int = 0) -> typing.Tuple[typing.Tuple[int, int], ...]\n\n"
+        "As :py:meth:`svfsc.cSVFS.need` for the SVF of this handle."
+);
+
+static PyObject *
+cp_SparseVirtualFileSystemHandle_need(cp_SparseVirtualFileSystemHandle *self, PyObject *args, PyObject *kwargs) {
+    PyObject * ret = NULL;
+    unsigned long long fpos = 0;
+    unsigned long long len = 0;
+    unsigned long long greedy_length = 0;
+    static const char *kwlist[] = {"file_position", "length", "greedy_length", NULL};
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self->p_svfs);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "KK|K", (char **) kwlist, &fpos, &len, &greedy_length)) {
+        goto except;
+    }
+    try {
+        p_svf = _lock.acquire(*self->state);
+        if (p_svf) {
+            ret = cp_SparseVirtualFile_need_internal(p_svf, fpos, len, greedy_length);
+            if (!ret) {
+                goto except;
+            }
+        } else {
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, self->state->id.c_str());
+            goto except;
+        }
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    assert(!PyErr_Occurred());
+    assert(ret);
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return ret;
+}
+
+static PyGetSetDef cp_SparseVirtualFileSystemHandle_getset[] = {
+        {"id", (getter) cp_SparseVirtualFileSystemHandle_id, NULL, "The SVF ID.", NULL},
+        {NULL, NULL, NULL, NULL, NULL}  /* Sentinel */
+};
+
+static PyMethodDef cp_SparseVirtualFileSystemHandle_methods[] = {
+        {
+                "has_data",              (PyCFunction) cp_SparseVirtualFileSystemHandle_has_data,    METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystemHandle_has_data_docstring
+        },
+        {
+                "write",                 (PyCFunction) cp_SparseVirtualFileSystemHandle_write,       METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystemHandle_write_docstring
+        },
+        {
+                "read",                  (PyCFunction) cp_SparseVirtualFileSystemHandle_read,        METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystemHandle_read_docstring
+        },
+        {
+                "need",                  (PyCFunction) cp_SparseVirtualFileSystemHandle_need,        METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystemHandle_need_docstring
+        },
+        {NULL, NULL, 0, NULL}  /* Sentinel */
+};
+
+static PyTypeObject svfsc_cSVFSHandle = {
+        PyVarObject_HEAD_INIT(NULL, 0)
+        .tp_name = "svfsc.cSVFSHandle",
+        .tp_basicsize = sizeof(cp_SparseVirtualFileSystemHandle),
+        .tp_itemsize = 0,
+        .tp_dealloc = (destructor) cp_SparseVirtualFileSystemHandle_dealloc,
+        .tp_flags = Py_TPFLAGS_DEFAULT,
+        .tp_doc = "A handle to one SVF in a cSVFS returned by cSVFS.open().",
+        .tp_methods = cp_SparseVirtualFileSystemHandle_methods,
+        .tp_getset = cp_SparseVirtualFileSystemHandle_getset,
+};
+
+// END: SVF handles
+#pragma mark END: SVF handles
+
+// Construction and destruction
+#pragma mark Construction and destruction
+
+static PyObject *
+cp_SparseVirtualFileSystem_new(PyTypeObject *type, PyObject *Py_UNUSED(args), PyObject *Py_UNUSED(kwds)) {
+    assert(!PyErr_Occurred());
+    cp_SparseVirtualFileSystem *self;
+    self = (cp_SparseVirtualFileSystem *) type->tp_alloc(type, 0);
+    if (self != NULL) {
+        self->p_svfs = nullptr;
+        self->evicting = false;
+        self->exports = new (std::nothrow) std::unordered_map<std::string, Py_ssize_t>();
+        if (!self->exports) {
+            Py_DECREF(self);
+            return PyErr_NoMemory();
+        }
+#ifdef PY_THREAD_SAFE
+        self->lock = NULL;
+        self->file_locks = new (std::nothrow) t_file_locks();
+        if (!self->file_locks) {
+            Py_DECREF(self);
+            return PyErr_NoMemory();
+        }
+#endif
+    }
+//    PyObject_Print((PyObject *)self, stdout);
+//    fprintf(stdout, "cp_SparseVirtualFileSystem_new() self %p\n", (void *)self);
+    assert(!PyErr_Occurred());
+    return (PyObject *) self;
+}
+
+static int
+cp_SparseVirtualFileSystem_init(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+    assert(!PyErr_Occurred());
+    static const char *kwlist[] = {"overwrite_on_exit", "compare_for_diff", "coverage_page_size", "dense_gap",
+                                   "spill_capacity", "spill_directory", "budget", "evict_max_blocks", NULL};
+    SVFS::tSparseVirtualFileConfig config;
+
+//    TRACE_SELF_ARGS_KWARGS;
+//    fprintf(stdout, "Config was compare_for_diff=%d overwrite_on_exit=%d\n", config.compare_for_diff,
+//            config.overwrite_on_exit);
+
+    // NOTE: With format unit 'p' we need to pass in an int.
+    int overwrite_on_exit = config.overwrite_on_exit ? 1 : 0;
+    int compare_for_diff = config.compare_for_diff ? 1 : 0;
+    Py_ssize_t coverage_page_size = static_cast<Py_ssize_t>(config.coverage_page_size);
+    Py_ssize_t dense_gap = static_cast<Py_ssize_t>(config.dense_gap);
+    Py_ssize_t spill_capacity = static_cast<Py_ssize_t>(config.spill_capacity);
+    char *c_spill_directory = NULL;
+    Py_ssize_t budget = 0;
+    Py_ssize_t evict_max_blocks = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|ppnnnsnn", (char **) kwlist, &overwrite_on_exit,
+                                     &compare_for_diff, &coverage_page_size, &dense_gap, &spill_capacity,
+                                     &c_spill_directory, &budget, &evict_max_blocks)) {
+        assert(PyErr_Occurred());
+        return -1;
+    }
+    if (coverage_page_size < 0 || (coverage_page_size & (coverage_page_size - 1))) {
+        PyErr_Format(PyExc_ValueError, "coverage_page_size %zd must be zero or a positive power of two",
+                     coverage_page_size);
+        return -1;
+    }
+    if (dense_gap < 0) {
+        PyErr_Format(PyExc_ValueError, "dense_gap %zd must not be negative", dense_gap);
+        return -1;
+    }
+    if (spill_capacity < 0) {
+        PyErr_Format(PyExc_ValueError, "spill_capacity %zd must not be negative", spill_capacity);
+        return -1;
+    }
+    if (budget < 0 || evict_max_blocks < 0) {
+        PyErr_Format(PyExc_ValueError, "budget %zd and evict_max_blocks %zd must not be negative", budget,
+                     evict_max_blocks);
+        return -1;
+    }
+    config.overwrite_on_exit = overwrite_on_exit != 0;
+    config.compare_for_diff = compare_for_diff != 0;
+    config.coverage_page_size = static_cast<size_t>(coverage_page_size);
+    config.dense_gap = static_cast<size_t>(dense_gap);
+    config.spill_capacity = static_cast<size_t>(spill_capacity);
+    if (c_spill_directory) {
+        config.spill_directory = c_spill_directory;
+    }
+
+//    fprintf(stdout, "Config now compare_for_diff=%d overwrite_on_exit=%d\n", config.compare_for_diff,
+//            config.overwrite_on_exit);
+
+    self->p_svfs = new SVFS::SparseVirtualFileSystem(config);
+    self->p_svfs->set_budget(static_cast<size_t>(budget), static_cast<size_t>(evict_max_blocks));
+#ifdef PY_THREAD_SAFE
+    self->lock = PyThread_allocate_lock();
+    if (self->lock == NULL) {
+        delete self->p_svfs;
+        PyErr_SetString(PyExc_MemoryError, "Unable to allocate thread lock.");
+        return -2;
+    }
+#endif
+//    fprintf(stdout, "cp_SparseVirtualFileSystem_init() self->p_svfs %p\n", (void *)self->p_svfs);
+    assert(!PyErr_Occurred());
+    return 0;
+}
+
+static void
+cp_SparseVirtualFileSystem_dealloc(cp_SparseVirtualFileSystem *self) {
+#ifdef PY_THREAD_SAFE
+    if (self->lock) {
+        PyThread_free_lock(self->lock);
+        self->lock = NULL;
+    }
+    delete self->file_locks;
+#endif
+    delete self->p_svfs;
+    delete self->exports;
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+// END: Construction and destruction
+#pragma mark END: Construction and destruction
+
+// SVFS functions
+#pragma mark SVFS functions
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_keys_docstring,
+        "keys(self) -> typing.List[str]\n\n"
+        "Returns the IDs of all the Sparse Virtual Files in the Sparse Virtual File System."
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_keys(cp_SparseVirtualFileSystem *self) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+
+    Py_ssize_t index = 0;
+    PyObject * key = NULL;
+    // All items set to NULL on construction.
+    PyObject * ret = PyList_New(self->p_svfs->size());
+    AcquireLockSVFS _lock(self);
+
+    if (!ret) {
+        PyErr_Format(PyExc_RuntimeError, "%s: Can create list of size %d", __FUNCTION__, self->p_svfs->size());
+        goto except;
+    }
+    try {
+        for (const auto &cpp_key: self->p_svfs->keys()) {
+            key = PyUnicode_FromKindAndData(PyUnicode_1BYTE_KIND, cpp_key.c_str(), cpp_key.size());
+            if (!key) {
+                PyErr_Format(PyExc_RuntimeError, "%s: Can create key for %s", __FUNCTION__, cpp_key.c_str());
+                goto except;
+            }
+            // No error checking for this line. Steals reference.
+            PyList_SET_ITEM(ret, index, key);
+            key = NULL; // Safety habit with stolen reference.
+            ++index;
+        }
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    assert(!PyErr_Occurred());
+    assert(ret);
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    if (ret) {
+        for (Py_ssize_t i = 0; i < PyList_Size(ret); ++i) {
+            Py_XDECREF(PyList_GET_ITEM(ret, i));
+        }
+    }
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_insert_docstring,
+        "insert(self, id: str) -> None\n\n"
+        "Inserts a Sparse Virtual File of ID and Unix file modification time as a float."
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_insert(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+
+    PyObject * ret = NULL;
+    char *c_id = NULL;
+    double mod_time;
+    static const char *kwlist[] = {"id", "mod_time", NULL};
+    AcquireLockSVFS _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sd", (char **) kwlist, &c_id, &mod_time)) {
+        goto except;
+    }
+    try {
+        self->p_svfs->insert(c_id, mod_time);
+    } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileSystemInsert &err) {
+        PyErr_Format(
+                PyExc_RuntimeError, "%s: Can not insert a new Sparse Virtual File ID = \"%s\". ERROR: %s",
+                __FUNCTION__, c_id, err.message().c_str()
+        );
+        goto except;
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+    assert(!PyErr_Occurred());
+    assert(ret);
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_remove_docstring,
+        "remove(self, id: str) -> None\n\n"
+        "Removes a Sparse Virtual File of ID freeing that file's memory. Will raise an ``IndexError`` if the ID is absent."
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_remove(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+
+    PyObject * ret = NULL;
+    char *c_id = NULL;
+    static const char *kwlist[] = {"id", NULL};
+    AcquireLockSVFS _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) kwlist, &c_id)) {
+        goto except;
+    }
+    if (private_SparseVirtualFileSystem_check_exports(self, c_id, __FUNCTION__)) {
+        goto except;
+    }
+    try {
+        private_SparseVirtualFileSystem_retire_file_lock(self, c_id);
+        self->p_svfs->remove(c_id);
+    } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileSystemRemove &err) {
+        PyErr_Format(PyExc_IndexError, "%s: Can not remove a Sparse Virtual File. ERROR: %s",
+                     __FUNCTION__, err.message().c_str()
+        );
+        goto except;
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+    assert(!PyErr_Occurred());
+    assert(ret);
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_has_docstring,
+        "has(self, id: str) -> bool\n\n"
+        "Returns True if the Sparse Virtual File for the ID is in the Sparse Virtual File System."
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_has(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+
+    PyObject * ret = NULL;
+    char *c_id = NULL;
+    static const char *kwlist[] = {"id", NULL};
+    AcquireLockSVFS _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) kwlist, &c_id)) {
+        goto except;
+    }
+    try {
+        if (self->p_svfs->has(c_id)) {
+            Py_INCREF(Py_True);
+            ret = Py_True;
+        } else {
+            Py_INCREF(Py_False);
+            ret = Py_False;
+        }
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    assert(!PyErr_Occurred());
+    assert(ret);
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_open_docstring,
+        "open(self, id: str) -> cSVFSHandle\n\n"
+        "Returns a handle to the Sparse Virtual File of the ID with the methods ``has_data()``, ``write()``, ``read()``"
+        " and ``need()``.\n"
+        "These are as the methods of the SVFS without the ID but they do not parse, hash and find the ID on each call so"
+        " are faster for small reads and writes.\n"
+        "This will raise an ``IndexError`` if the ID does not exist, as will the methods of the handle if that SVF is"
+        " removed."
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_open(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+
+    cp_SparseVirtualFileSystemHandle *ret = NULL;
+    char *c_id = NULL;
+    static const char *kwlist[] = {"id", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) kwlist, &c_id)) {
+        goto except;
+    }
+    ret = PyObject_New(cp_SparseVirtualFileSystemHandle, &svfsc_cSVFSHandle);
+    if (!ret) {
+        goto except;
+    }
+    ret->state = NULL;
+    Py_INCREF(self);
+    ret->p_svfs = self;
+    try {
+        ret->state = new t_svfs_handle_state();
+        ret->state->id = c_id;
+        AcquireLockSVFSFile _lock(self);
+        if (!_lock.acquire(*ret->state)) {
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
+            goto except;
+        }
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    assert(!PyErr_Occurred());
+    assert(ret);
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return (PyObject *) ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_total_size_of_docstring,
+        "total_size_of(self) -> int\n\n"
+        "Returns the estimate of total memory usage of the Sparse Virtual File System.\n"
+        "This is a running total so it is constant time and does not wait for any other thread."
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_total_size_of(cp_SparseVirtualFileSystem *self) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+    // This is a running total so needs no lock.
+    try {
+        return PyLong_FromLong(self->p_svfs->size_of());
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        return NULL;
+    }
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_total_bytes_docstring,
+        "total_bytes(self) -> int\n\n"
+        "Returns the total number of file bytes held by the Sparse Virtual File System.\n"
+        "This is a running total so it is constant time and does not wait for any other thread."
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_total_bytes(cp_SparseVirtualFileSystem *self) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+    // This is a running total so needs no lock.
+    try {
+        return PyLong_FromLong(self->p_svfs->num_bytes());
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        return NULL;
+    }
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_total_blocks_docstring,
+        "total_blocks(self) -> int\n\n"
+        "Returns the total number of blocks of data held by the Sparse Virtual File System.\n"
+        "This is a running total so it is constant time and does not wait for any other thread."
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_total_blocks(cp_SparseVirtualFileSystem *self) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+    // This is a running total so needs no lock.
+    try {
+        return PyLong_FromLong(self->p_svfs->num_blocks());
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        return NULL;
+    }
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_svf_has_data_docstring,
+        "has_data(self, id: str, file_position: int, length: int) -> bool\n\n"
+        "Checks if the Sparse Virtual File of the ID has data at the given file_position and length."
+        " This takes a string as an id, a file position and a length."
+        " This returns True if the Sparse Virtual File of that id has the data, False otherwise."
+        " This will raise an ``IndexError`` if the SVF of that id does not exist."
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_svf_has_data(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+
+    PyObject * ret = NULL;
+    char *c_id = NULL;
+    std::string cpp_id;
+    unsigned long long fpos = 0;
+    unsigned long long len = 0;
+    static const char *kwlist[] = {"id", "file_position", "length", NULL};
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sKK", (char **) kwlist, &c_id, &fpos, &len)) {
+        goto except;
+    }
+    cpp_id = std::string(c_id);
+    try {
+        p_svf = _lock.acquire(cpp_id);
+        if (p_svf) {
+            const SVFS::SparseVirtualFile &svf = *p_svf;
+            if (svf.has(fpos, len)) {
+                Py_INCREF(Py_True);
+                ret = Py_True;
+            } else {
+                Py_INCREF(Py_False);
+                ret = Py_False;
+            }
+        } else {
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
+            goto except;
+        }
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    assert(!PyErr_Occurred());
+    assert(ret);
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_svf_write_docstring,
+        "write(self, id: str, file_position: int, data: typing.Union[bytes, bytearray, memoryview]) -> None\n\n"
+        "Writes the data to the Sparse Virtual File of the given ID at file_position and length.\n\n"
+        "This takes a string as an id, a file position and data as a bytes object or any other contiguous object\n"
+        "that supports the buffer protocol such as a ``bytearray``, ``memoryview``, ``array.array`` or ``mmap.mmap``.\n"
+        "The data is copied directly from the buffer.\n"
+        "This will raise an ``IndexError`` if the SVF of that id does not exist.\n"
+        "This will raise an ``IOError`` if the given data is different than that seen before and only\n"
+        "new data up to this point will be written.\n"
+        "This will raise a ``RuntimeError`` if the data can not be written for any other reason.\n"
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_svf_write(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+
+    PyObject * ret = NULL;
+    char *c_id = NULL;
+    std::string cpp_id;
+    unsigned long long fpos = 0;
+    // Any contiguous buffer, NULL obj until parsed so that it can always be released.
+    Py_buffer data_buffer = {};
+    static const char *kwlist[] = {"id", "file_position", "data", NULL};
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sKy*", (char **) kwlist, &c_id, &fpos, &data_buffer)) {
+        goto except;
+    }
+    cpp_id = std::string(c_id);
+    try {
+        p_svf = _lock.acquire(cpp_id, true);
+        if (p_svf) {
+            // Check while holding the file lock, acquire() releases the GIL so a view might be made while waiting.
+            if (private_SparseVirtualFileSystem_check_exports(self, c_id, __FUNCTION__)) {
+                goto except;
+            }
+            SVFS::SparseVirtualFile &svf = *p_svf;
+            try {
+                ReleaseGIL _release(static_cast<size_t>(data_buffer.len) >= PY_RELEASE_GIL_BYTES);
+                svf.write(fpos, static_cast<const char *>(data_buffer.buf), data_buffer.len);
+            } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileDiff &err) {
+                PyErr_Format(PyExc_IOError,
+                             "%s: Can not write to a SVF id = \"%s\" as the given data is different from what is there. ERROR: %s",
+                             __FUNCTION__, c_id, err.message().c_str());
+                goto except;
+            } catch (const SVFS::Exceptions::ExceptionSparseVirtualFile &err) {
+                PyErr_Format(PyExc_RuntimeError, "%s: Can not write to a SVF id = \"%s\". ERROR: %s",
+                             __FUNCTION__, c_id, err.message().c_str());
+                goto except;
+            }
+        } else {
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
+            goto except;
+        }
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    _lock.release();
+    if (private_SparseVirtualFileSystem_evict_after_write(self, __FUNCTION__)) {
+        goto except;
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+    assert(!PyErr_Occurred());
+    assert(ret);
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    PyBuffer_Release(&data_buffer);
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_svf_read_docstring,
+        "read(self, id: str, file_position: int, length: int) -> bytes\n\n"
+        "Read the data to the Sparse Virtual File at file_position and length returning a bytes object.\n"
+        "This takes a string as an id, a file position and a length.\n"
+        "\nThis will raise an ``IndexError`` if the Sparse Virtual File of that id does not exist.\n"
+        "This will raise an ``IOError`` if any data is not present\n"
+        "This will raise a ``RuntimeError`` if the data can not be read for any other reason.\n"
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_svf_read(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+
+    PyObject * ret = NULL;
+    char *c_id = NULL;
+    std::string cpp_id;
+    unsigned long long fpos = 0;
+    unsigned long long len = 0;
+    static const char *kwlist[] = {"id", "file_position", "length", NULL};
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sKK", (char **) kwlist, &c_id, &fpos, &len)) {
+        goto except;
+    }
+    cpp_id = std::string(c_id);
+    try {
+        p_svf = _lock.acquire(cpp_id);
+        if (p_svf) {
+            SVFS::SparseVirtualFile &svf = *p_svf;
+            // A read promotes spilled blocks which might coalesce exported blocks.
+            if (svf.spill() && svf.spill()->num_blocks()
+                && private_SparseVirtualFileSystem_check_exports(self, c_id, __FUNCTION__)) {
+                goto except;
+            }
+            // Create a bytes object
+            ret = PyBytes_FromStringAndSize(NULL, len);
+            try {
+                ReleaseGIL _release(len >= PY_RELEASE_GIL_BYTES);
+                svf.read(fpos, len, PyBytes_AS_STRING(ret));
+            } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileRead &err) {
+                PyErr_Format(PyExc_IOError, "%s: Can not read from a SVF id= \"%s\". ERROR: %s",
+                             __FUNCTION__, c_id, err.message().c_str());
+                goto except;
+            } catch (const SVFS::Exceptions::ExceptionSparseVirtualFile &err) {
+                PyErr_Format(PyExc_RuntimeError, "%s: Fatal error reading from a SVF id= \"%s\". ERROR: %s",
+                             __FUNCTION__, c_id, err.message().c_str());
+                goto except;
+            }
+        } else {
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
+            goto except;
+        }
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    assert(!PyErr_Occurred());
+    assert(ret);
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_svf_read_through_docstring,
+        "read_through(self, id: str, file_position: int, length: int,"
+        " fetch: typing.Callable[[str, int, int], typing.Union[bytes, bytearray, memoryview]],"
+        " greedy_length: int = 0, alignment: int = 0) -> bytes\n\n"
+        "Read the data of the Sparse Virtual File of the given ID at file_position and length, fetching and writing"
+        " any that is missing first.\n"
+        "As :py:meth:`svfsc.cSVF.read_through` where ``fetch`` is called as ``fetch(id, file_position, length)``.\n"
+        "If this fetches anything and the cSVFS is then over its budget blocks are evicted as with ``write()``.\n"
+        "\nThis will raise an ``IndexError`` if the Sparse Virtual File of that id does not exist.\n"
+        "This raises the same errors as ``write()`` and ``read()`` and any error from ``fetch``."
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_svf_read_through(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+
+    PyObject * ret = NULL;
+    char *c_id = NULL;
+    std::string cpp_id;
+    unsigned long long fpos = 0;
+    unsigned long long len = 0;
+    PyObject * fetch = NULL;
+    Py_ssize_t greedy_length = 0;
+    Py_ssize_t alignment = 0;
+    SVFS::tReadThroughConfig config;
+    SVFS::t_seek_reads plan;
+    SVFS::t_seek_reads fetched;
+    SVFS::t_in_flight_futures in_flight;
+    std::string data;
+    Py_buffer data_buffer = {};
+    static const char *kwlist[] = {"id", "file_position", "length", "fetch", "greedy_length", "alignment", NULL};
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    // The SVF that the plan is reserved in, this keeps it alive if it is removed while fetching.
+    SVFS::t_svf_handle svf_reserved;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sKKO|nn", (char **) kwlist, &c_id, &fpos, &len, &fetch,
+                                     &greedy_length, &alignment)) {
+        goto except;
+    }
+    if (!PyCallable_Check(fetch)) {
+        PyErr_Format(PyExc_TypeError, "%s: fetch must be callable not \"%s\"", __FUNCTION__, Py_TYPE(fetch)->tp_name);
+        goto except;
+    }
+    if (private_read_through_config(greedy_length, alignment, config, __FUNCTION__)) {
+        goto except;
+    }
+    cpp_id = std::string(c_id);
+    retry:
+    plan.clear();
+    fetched.clear();
+    in_flight.clear();
+    data.clear();
+    try {
+        AcquireLockSVFSFile _lock(self);
+        p_svf = _lock.acquire(cpp_id);
+        if (!p_svf) {
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
+            goto except;
+        }
+        // A read promotes spilled blocks which might coalesce exported blocks.
+        if (p_svf->spill() && p_svf->spill()->num_blocks()
+            && private_SparseVirtualFileSystem_check_exports(self, c_id, __FUNCTION__)) {
+            goto except;
+        }
+        if (p_svf->has(fpos, len)) {
+            ret = private_SparseVirtualFile_read_many(*p_svf, {{fpos, len}}, __FUNCTION__);
+            if (!ret) {
+                goto except;
+            }
+            goto finally;
+        }
+        plan = SVFS::read_through_reserve(*p_svf, fpos, len, config, in_flight);
+        if (!plan.empty()) {
+            svf_reserved = self->p_svfs->handle(cpp_id);
+        }
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    if (svf_reserved) {
+        if (private_read_through_fetch(fetch, c_id, plan, fetched, data, __FUNCTION__)) {
+            goto except;
+        }
+        PyBuffer_FillInfo(&data_buffer, NULL, data.data(), static_cast<Py_ssize_t>(data.size()), 1, PyBUF_SIMPLE);
+        try {
+            AcquireLockSVFSFile _lock(self);
+            // The SVF might have been removed while fetching.
+            p_svf = _lock.acquire(cpp_id, true);
+            if (p_svf != svf_reserved.get()) {
+                PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
+                goto except;
+            }
+            // A view might also have been made while fetching or waiting for the file lock.
+            if (private_SparseVirtualFileSystem_check_exports(self, c_id, __FUNCTION__)) {
+                goto except;
+            }
+            if (private_SparseVirtualFile_write_many(*p_svf, fetched, data_buffer, __FUNCTION__)) {
+                goto except;
+            }
+            p_svf->release_need(plan);
+            svf_reserved.reset();
+        } catch (const std::exception &err) {
+            PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+            goto except;
+        }
+    }
+    if (!in_flight.empty()) {
+        // Another thread has fetched, or failed to fetch, some of the data so look again.
+        private_read_through_wait(in_flight);
+        goto retry;
+    }
+    try {
+        AcquireLockSVFSFile _lock(self);
+        p_svf = _lock.acquire(cpp_id);
+        if (!p_svf) {
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
+            goto except;
+        }
+        ret = private_SparseVirtualFile_read_many(*p_svf, {{fpos, len}}, __FUNCTION__);
+        if (!ret) {
+            goto except;
+        }
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    // Evict after the read so that the data just fetched is not evicted before it is read.
+    if (private_SparseVirtualFileSystem_evict_after_write(self, __FUNCTION__)) {
+        goto except;
+    }
+    assert(!PyErr_Occurred());
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    if (svf_reserved) {
+        try {
+            AcquireLockSVFSFile _lock(self);
+            // If the SVF has been removed only threads that have ranges reserved in it use it and they hold the GIL.
+            _lock.acquire(cpp_id);
+            svf_reserved->release_need(plan);
+        } catch (const std::exception &) {
+            svf_reserved->release_need(plan);
+        }
+    }
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_svf_read_view_docstring,
+        "read_view(self, id: str, file_position: int, length: int) -> memoryview\n\n"
+        "Read the data from the Sparse Virtual File at file_position and length returning a read only ``memoryview``"
+        " of the data in the SVF without copying it.\n"
+        "This takes a string as an id, a file position and a length.\n"
+        "While the ``memoryview``, or any object made from it, exists that SVF can not be changed or removed and"
+        " ``write()``, ``erase()``, ``remove()``, ``lru_punt()``, ``lru_punt_all()``, ``compact()`` and"
+        " ``journal_open()`` raise a ``BufferError``.\n"
+        "Call ``release()`` on the ``memoryview``, or use it in a ``with`` statement, to allow changes again.\n"
+        "\nThis will raise an ``IndexError`` if the Sparse Virtual File of that id does not exist.\n"
+        "This will raise an ``IOError`` if any data is not present\n"
+        "This will raise a ``RuntimeError`` if the data can not be read for any other reason.\n"
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_svf_read_view(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+
+    PyObject * ret = NULL;
+    PyObject * buffer = NULL;
+    char *c_id = NULL;
+    std::string cpp_id;
+    unsigned long long fpos = 0;
+    unsigned long long len = 0;
+    const char *data = NULL;
+    static const char *kwlist[] = {"id", "file_position", "length", NULL};
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sKK", (char **) kwlist, &c_id, &fpos, &len)) {
+        goto except;
+    }
+    cpp_id = std::string(c_id);
+    try {
+        p_svf = _lock.acquire(cpp_id);
+        if (p_svf) {
+            SVFS::SparseVirtualFile &svf = *p_svf;
+            // A read promotes spilled blocks which might coalesce exported blocks.
+            if (svf.spill() && svf.spill()->num_blocks()
+                && private_SparseVirtualFileSystem_check_exports(self, c_id, __FUNCTION__)) {
+                goto except;
+            }
+            try {
+                data = svf.read_view(fpos, len);
+            } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileRead &err) {
+                PyErr_Format(PyExc_IOError, "%s: Can not read from a SVF id= \"%s\". ERROR: %s",
+                             __FUNCTION__, c_id, err.message().c_str());
+                goto except;
+            } catch (const SVFS::Exceptions::ExceptionSparseVirtualFile &err) {
+                PyErr_Format(PyExc_RuntimeError, "%s: Fatal error reading from a SVF id= \"%s\". ERROR: %s",
+                             __FUNCTION__, c_id, err.message().c_str());
+                goto except;
+            }
+        } else {
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
+            goto except;
+        }
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    buffer = private_SparseVirtualFileSystemBuffer_new(self, cpp_id, data, len);
+    if (!buffer) {
+        goto except;
+    }
+    ret = PyMemoryView_FromObject(buffer);
+    if (!ret) {
+        goto except;
+    }
+    assert(!PyErr_Occurred());
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    Py_XDECREF(buffer);
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_svf_read_into_docstring,
+        "read_into(self, id: str, file_position: int, buffer: typing.Union[bytearray, memoryview]) -> int\n\n"
+        "Read the data from the Sparse Virtual File at file_position into a writable contiguous buffer such as a\n"
+        "``bytearray``, ``memoryview``, ``array.array`` or ``mmap.mmap``.\n"
+        "This takes a string as an id, a file position and a buffer.\n"
+        "The length read is the length of the buffer in bytes and that is returned.\n"
+        "The GIL is released during a large copy and no Python objects are created so this can be used in a loop\n"
+        "with a reused buffer.\n"
+        "\nThis will raise an ``IndexError`` if the Sparse Virtual File of that id does not exist.\n"
+        "This will raise an ``IOError`` if any data is not present\n"
+        "This will raise a ``RuntimeError`` if the data can not be read for any other reason.\n"
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_svf_read_into(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+
+    PyObject * ret = NULL;
+    char *c_id = NULL;
+    std::string cpp_id;
+    unsigned long long fpos = 0;
+    // Any writable contiguous buffer, NULL obj until parsed so that it can always be released.
+    Py_buffer buffer = {};
+    static const char *kwlist[] = {"id", "file_position", "buffer", NULL};
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sKw*", (char **) kwlist, &c_id, &fpos, &buffer)) {
+        goto except;
+    }
+    cpp_id = std::string(c_id);
+    try {
+        p_svf = _lock.acquire(cpp_id);
+        if (p_svf) {
+            SVFS::SparseVirtualFile &svf = *p_svf;
+            // A read promotes spilled blocks which might coalesce exported blocks.
+            if (svf.spill() && svf.spill()->num_blocks()
+                && private_SparseVirtualFileSystem_check_exports(self, c_id, __FUNCTION__)) {
+                goto except;
+            }
+            if (buffer.len > 0) {
+                try {
+                    ReleaseGIL _release(static_cast<size_t>(buffer.len) >= PY_RELEASE_GIL_BYTES);
+                    svf.read(fpos, buffer.len, static_cast<char *>(buffer.buf));
+                } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileRead &err) {
+                    PyErr_Format(PyExc_IOError, "%s: Can not read from a SVF id= \"%s\". ERROR: %s",
+                                 __FUNCTION__, c_id, err.message().c_str());
+                    goto except;
+                } catch (const SVFS::Exceptions::ExceptionSparseVirtualFile &err) {
+                    PyErr_Format(PyExc_RuntimeError, "%s: Fatal error reading from a SVF id= \"%s\". ERROR: %s",
+                                 __FUNCTION__, c_id, err.message().c_str());
+                    goto except;
+                }
+            }
+        } else {
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
+            goto except;
+        }
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    ret = PyLong_FromSsize_t(buffer.len);
+    if (!ret) {
+        goto except;
+    }
+    assert(!PyErr_Occurred());
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    PyBuffer_Release(&buffer);
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_svf_erase_docstring,
+        "erase(self, id: str, file_position: int) -> None\n\n"
+        "Erases the data block in the Sparse Virtual File at a file position.\n"
+        "This takes a string as an id and a file_position.\n"
+        "This will raise an ``IndexError`` if the Sparse Virtual File of that id does not exist.\n"
+        "This will raise an ``IOError`` if there is not a block at the position.\n"
+        "This will raise a ``RuntimeError`` if the data can not be read for any other reason.\n"
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_svf_erase(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+
+    PyObject * ret = NULL;
+    char *c_id = NULL;
+    std::string cpp_id;
+    unsigned long long fpos = 0;
+    static const char *kwlist[] = {"id", "file_position", NULL};
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sK", (char **) kwlist, &c_id, &fpos)) {
+        goto except;
+    }
+    cpp_id = std::string(c_id);
+    try {
+        p_svf = _lock.acquire(cpp_id, true);
+        if (p_svf) {
+            if (private_SparseVirtualFileSystem_check_exports(self, c_id, __FUNCTION__)) {
+                goto except;
+            }
+            SVFS::SparseVirtualFile &svf = *p_svf;
+            try {
+                svf.erase(fpos);
+            } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileErase &err) {
+                PyErr_Format(PyExc_IOError, "%s: Can not erase block from a SVF id= \"%s\". ERROR: %s",
+                             __FUNCTION__, c_id, err.message().c_str());
+                goto except;
+            } catch (const SVFS::Exceptions::ExceptionSparseVirtualFile &err) {
+                PyErr_Format(PyExc_RuntimeError, "%s: Fatal error erasing from a SVF id= \"%s\". ERROR: %s",
+                             __FUNCTION__, c_id, err.message().c_str());
+                goto except;
+            }
+        } else {
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
+            goto except;
+        }
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+    assert(!PyErr_Occurred());
+    assert(ret);
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_svf_need_docstring,
+        "need(self, id: str, file_position: int, length: int, greedy_length: int = 0) -> typing.Tuple[typing.Tuple[int, int], ...]\n\n"
+        "Given a file_position and length this returns a ordered list ``[(file_position, length), ...]`` of seek/read"
+        " instructions of data that is required to be written to the Sparse Virtual File so that a subsequent read will succeed.\n"
+        "If greedy_length is > 0 then, if possible, blocks will be coalesced to reduce the size of the return value."
+        "\nUsage::\n\n"
+        "    if not svfs.has(identity, file_position, length):\n"
+        "        for fpos, read_len in svfs.need(identity, file_position, length):\n"
+        "            # Somehow get the data at that seek/read position...\n"
+        "            svfs.write(identity, fpos, data)\n"
+        "    return svfs.read(identity, file_position, length):\n"
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_svf_need(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+
+    PyObject * ret = NULL; // PyListObject
+    char *c_id = NULL; // PyUnicodeObject
+    std::string cpp_id;
+    unsigned long long fpos = 0;
+    unsigned long long len = 0;
+    unsigned long long greedy_length = 0;
+    static const char *kwlist[] = {"id", "file_position", "length", "greedy_length", NULL};
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sKK|K", (char **) kwlist, &c_id, &fpos, &len, &greedy_length)) {
+        goto except;
+    }
+    cpp_id = std::string(c_id);
+    try {
+        p_svf = _lock.acquire(cpp_id);
+        if (p_svf) {
+            const SVFS::SparseVirtualFile &svf = *p_svf;
+            ret = cp_SparseVirtualFile_need_internal(&svf, fpos, len, greedy_length);
+            if (!ret) {
+                goto except;
+            }
+        } else {
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
+            goto except;
+        }
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    assert(!PyErr_Occurred());
+    assert(ret);
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_svf_need_array_docstring,
+        "need_array(self, id: str, file_position: int, length: int, greedy_length: int = 0) -> array.array\n\n"
+        "As :py:meth:`svfsc.cSVFS.need` but this returns an ``array.array('Q')`` of unsigned 64 bit integers"
+        " ``[file_position, length, file_position, length, ...]`` rather than a list of tuples.\n"
+        "This is a single object that ``need_many()``, ``write_many()`` and ``read_many()`` accept and numpy can use"
+        " with ``numpy.frombuffer(result, dtype=numpy.uint64).reshape(-1, 2)``.\n"
+        "This will raise an ``IndexError`` if the Sparse Virtual File of that id does not exist."
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_svf_need_array(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+
+    PyObject * ret = NULL;
+    char *c_id = NULL;
+    std::string cpp_id;
+    unsigned long long fpos = 0;
+    unsigned long long len = 0;
+    unsigned long long greedy_len = 0;
+    static const char *kwlist[] = {"id", "file_position", "length", "greedy_length", NULL};
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sKK|K", (char **) kwlist, &c_id, &fpos, &len, &greedy_len)) {
+        goto except;
+    }
+    cpp_id = std::string(c_id);
+    try {
+        p_svf = _lock.acquire(cpp_id);
+        if (p_svf) {
+            ret = private_pairs_as_array(p_svf->need(fpos, len, greedy_len));
+            if (!ret) {
+                goto except;
+            }
+        } else {
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
+            goto except;
+        }
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    assert(!PyErr_Occurred());
+    assert(ret);
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_svf_need_many_docstring,
+        "need_many(self, id: str, seek_reads: typing.List[typing.Tuple[int, int]], greedy_length: int = 0) -> typing.Tuple[typing.Tuple[int, int], ...]\n\n"
+        "Given a list of (file_position, length) this returns a ordered list ``[(file_position, length), ...]`` of seek/read"
+        " instructions of data that is required to be written to the Sparse Virtual File so that a subsequent read will"
+        " succeed.\n\n"
+        "``seek_reads`` can also be a contiguous buffer of unsigned 64 bit integers in pairs such as the result of"
+        " ``need_array()``, an ``array.array('Q')`` or a numpy ``uint64`` array of shape ``(N, 2)``.\n\n"
+        "If greedy_length is > 0 then, if possible, blocks will be coalesced to reduce the size of the return value."
+        "\n\n"
+        "See also :py:meth:`svfsc.cSVFS.need`"
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_svf_need_many(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+
+    PyObject * ret = NULL; // PyListObject
+    char *c_id = NULL; // PyUnicodeObject
+    std::string cpp_id;
+
+    PyObject * py_seek_reads = NULL;
+    unsigned long long greedy_len = 0;
+    static const char *kwlist[] = {"id", "seek_reads", "greedy_length", NULL};
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|K", (char **) kwlist, &c_id, &py_seek_reads, &greedy_len)) {
+        goto except;
+    }
+    cpp_id = std::string(c_id);
+    try {
+        p_svf = _lock.acquire(cpp_id);
+        if (p_svf) {
+            const SVFS::SparseVirtualFile &svf = *p_svf;
+            ret = cp_SparseVirtualFile_need_many_internal(py_seek_reads, &svf, greedy_len);
+            if (!ret) {
+                goto except;
+            }
+        } else {
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
+            goto except;
+        }
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    assert(!PyErr_Occurred());
+    assert(ret);
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return ret;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_svf_write_many_docstring,
+        "write_many(self, id: str, seek_reads: typing.Union[typing.Sequence[typing.Tuple[int, int]], memoryview],"
+        " data: typing.Union[bytes, bytearray, memoryview]) -> None\n\n"
+        "Write many blocks to the Sparse Virtual File of the given ID in one call.\n"
+        "``seek_reads`` is a sequence of ``(file_position, length)`` tuples or a contiguous buffer of unsigned 64 bit\n"
+        "integers, in pairs, such as an ``array.array('Q')`` or a numpy ``uint64`` array of shape ``(N, 2)``.\n"
+        "``data`` is the data of every block one after the other so its length must be the sum of the lengths.\n"
+        "This raises the same errors as ``write()`` and the blocks before the one that failed will have been written.\n"
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_svf_write_many(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+
+    PyObject * ret = NULL;
+    char *c_id = NULL;
+    std::string cpp_id;
+    PyObject * py_seek_reads = NULL;
+    Py_buffer data_buffer = {};
+    SVFS::t_seek_reads seek_reads;
+    static const char *kwlist[] = {"id", "seek_reads", "data", NULL};
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sOy*", (char **) kwlist, &c_id, &py_seek_reads, &data_buffer)) {
+        goto except;
+    }
+    if (private_parse_seek_reads(py_seek_reads, seek_reads, __FUNCTION__)) {
+        goto except;
+    }
+    cpp_id = std::string(c_id);
+    try {
+        p_svf = _lock.acquire(cpp_id, true);
+        if (p_svf) {
+            if (private_SparseVirtualFileSystem_check_exports(self, c_id, __FUNCTION__)) {
+                goto except;
+            }
+            if (private_SparseVirtualFile_write_many(*p_svf, seek_reads, data_buffer,
+                                                     __FUNCTION__)) {
+                goto except;
+            }
+        } else {
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
+            goto except;
+        }
     } catch (const std::exception &err) {
         PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
         goto except;
     }
+    _lock.release();
+    if (private_SparseVirtualFileSystem_evict_after_write(self, __FUNCTION__)) {
+        goto except;
+    }
     Py_INCREF(Py_None);
     ret = Py_None;
     assert(!PyErr_Occurred());
-    assert(ret);
     goto finally;
     except:
     assert(PyErr_Occurred());
     Py_XDECREF(ret);
     ret = NULL;
     finally:
+    PyBuffer_Release(&data_buffer);
     return ret;
 }
 
 PyDoc_STRVAR(
-        cp_SparseVirtualFileSystem_remove_docstring,
-        "remove(self, id: str) -> None\n\n"
-        "Removes a Sparse Virtual File of ID freeing that file's memory. Will raise an ``IndexError`` if the ID is absent."
+        cp_SparseVirtualFileSystem_svf_read_many_docstring,
+        "read_many(self, id: str, seek_reads: typing.Union[typing.Sequence[typing.Tuple[int, int]], memoryview])"
+        " -> bytes\n\n"
+        "Read many blocks from the Sparse Virtual File of the given ID in one call and return the data of every block\n"
+        "one after the other in a single ``bytes`` object.\n"
+        "``seek_reads`` is a sequence of ``(file_position, length)`` tuples or a contiguous buffer of unsigned 64 bit\n"
+        "integers, in pairs, such as an ``array.array('Q')`` or a numpy ``uint64`` array of shape ``(N, 2)``.\n"
+        "The offset of each block in the result is the sum of the preceding lengths.\n"
+        "\nThis will raise an ``IndexError`` if the Sparse Virtual File of that id does not exist.\n"
+        "This will raise an ``IOError`` if any data is not present\n"
 );
 
 static PyObject *
-cp_SparseVirtualFileSystem_remove(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+cp_SparseVirtualFileSystem_svf_read_many(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
     ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
 
     PyObject * ret = NULL;
     char *c_id = NULL;
-    static const char *kwlist[] = {"id", NULL};
-    AcquireLockSVFS _lock(self);
+    std::string cpp_id;
+    PyObject * py_seek_reads = NULL;
+    SVFS::t_seek_reads seek_reads;
+    static const char *kwlist[] = {"id", "seek_reads", NULL};
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) kwlist, &c_id)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO", (char **) kwlist, &c_id, &py_seek_reads)) {
         goto except;
     }
-    try {
-        self->p_svfs->remove(c_id);
-    } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileSystemRemove &err) {
-        PyErr_Format(PyExc_IndexError, "%s: Can not remove a Sparse Virtual File. ERROR: %s",
-                     __FUNCTION__, err.message().c_str()
-        );
+    if (private_parse_seek_reads(py_seek_reads, seek_reads, __FUNCTION__)) {
         goto except;
+    }
+    cpp_id = std::string(c_id);
+    try {
+        p_svf = _lock.acquire(cpp_id);
+        if (p_svf) {
+            SVFS::SparseVirtualFile &svf = *p_svf;
+            // A read promotes spilled blocks which might coalesce exported blocks.
+            if (svf.spill() && svf.spill()->num_blocks()
+                && private_SparseVirtualFileSystem_check_exports(self, c_id, __FUNCTION__)) {
+                goto except;
+            }
+            ret = private_SparseVirtualFile_read_many(svf, seek_reads, __FUNCTION__);
+            if (!ret) {
+                goto except;
+            }
+        } else {
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
+            goto except;
+        }
     } catch (const std::exception &err) {
         PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
         goto except;
     }
-    Py_INCREF(Py_None);
-    ret = Py_None;
     assert(!PyErr_Occurred());
     assert(ret);
     goto finally;
@@ -364,29 +2124,46 @@ cp_SparseVirtualFileSystem_remove(cp_SparseVirtualFileSystem *self, PyObject *ar
 }
 
 PyDoc_STRVAR(
-        cp_SparseVirtualFileSystem_has_docstring,
-        "has(self, id: str) -> bool\n\n"
-        "Returns True if the Sparse Virtual File for the ID is in the Sparse Virtual File System."
+        cp_SparseVirtualFileSystem_svf_has_data_many_docstring,
+        "has_data_many(self, id: str, seek_reads: typing.Union[typing.Sequence[typing.Tuple[int, int]], memoryview])"
+        " -> bytes\n\n"
+        "Check for the data of many blocks in the Sparse Virtual File of the given ID in one call.\n"
+        "``seek_reads`` is a sequence of ``(file_position, length)`` tuples or a contiguous buffer of unsigned 64 bit\n"
+        "integers, in pairs, such as an ``array.array('Q')`` or a numpy ``uint64`` array of shape ``(N, 2)``.\n"
+        "This returns a ``bytes`` object with a byte for each pair that is 1 if the SVF has the data, 0 otherwise.\n"
+        "\nThis will raise an ``IndexError`` if the Sparse Virtual File of that id does not exist.\n"
 );
 
 static PyObject *
-cp_SparseVirtualFileSystem_has(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+cp_SparseVirtualFileSystem_svf_has_data_many(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
     ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
 
     PyObject * ret = NULL;
     char *c_id = NULL;
-    static const char *kwlist[] = {"id", NULL};
+    std::string cpp_id;
+    PyObject * py_seek_reads = NULL;
+    SVFS::t_seek_reads seek_reads;
+    static const char *kwlist[] = {"id", "seek_reads", NULL};
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) kwlist, &c_id)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO", (char **) kwlist, &c_id, &py_seek_reads)) {
+        goto except;
+    }
+    if (private_parse_seek_reads(py_seek_reads, seek_reads, __FUNCTION__)) {
         goto except;
     }
+    cpp_id = std::string(c_id);
     try {
-        if (self->p_svfs->has(c_id)) {
-            Py_INCREF(Py_True);
-            ret = Py_True;
+        p_svf = _lock.acquire(cpp_id);
+        if (p_svf) {
+            ret = private_SparseVirtualFile_has_data_many(*p_svf, seek_reads);
+            if (!ret) {
+                goto except;
+            }
         } else {
-            Py_INCREF(Py_False);
-            ret = Py_False;
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
+            goto except;
         }
     } catch (const std::exception &err) {
         PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
@@ -403,98 +2180,132 @@ cp_SparseVirtualFileSystem_has(cp_SparseVirtualFileSystem *self, PyObject *args,
     return ret;
 }
 
-PyDoc_STRVAR(
-        cp_SparseVirtualFileSystem_total_size_of_docstring,
-        "total_size_of(self) -> int\n\n"
-        "Returns the estimate of total memory usage of the Sparse Virtual File System."
-);
+/**
+// ---- Meta information about the SVF ----
+// The existing blocks.
+t_seek_reads blocks() const noexcept;
 
-static PyObject *
-cp_SparseVirtualFileSystem_total_size_of(cp_SparseVirtualFileSystem *self) {
-    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
-    try {
-        return PyLong_FromLong(self->p_svfs->size_of());
-    } catch (const std::exception &err) {
-        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
-        return NULL;
-    }
-}
+// Information about memory used:
+// size_of() gives best guess of total memory usage.
+size_t size_of() const noexcept;
 
-PyDoc_STRVAR(
-        cp_SparseVirtualFileSystem_total_bytes_docstring,
-        "total_bytes(self) -> int\n\n"
-        "Returns the total number of file bytes held by the Sparse Virtual File System."
-);
+// Gives exact number of data bytes held.
+size_t num_bytes() const noexcept { return m_bytes_total; };
 
-static PyObject *
-cp_SparseVirtualFileSystem_total_bytes(cp_SparseVirtualFileSystem *self) {
-    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
-    try {
-        return PyLong_FromLong(self->p_svfs->num_bytes());
-    } catch (const std::exception &err) {
-        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
-        return NULL;
-    }
+// Gives exact number of blocks used.
+size_t num_blocks() const noexcept { return m_svf.size(); }
+t_fpos last_file_position() const noexcept;
+
+// Check the clients file modification time has changed.
+// Caller has to decide what to do...
+bool file_mod_time_matches(const double &file_mod_time) const noexcept {
+    return file_mod_time == m_file_mod_time;
 }
+*/
 
 PyDoc_STRVAR(
-        cp_SparseVirtualFileSystem_total_blocks_docstring,
-        "total_blocks(self) -> int\n\n"
-        "Returns the total number of blocks of data held by the Sparse Virtual File System."
+        cp_SparseVirtualFileSystem_svf_blocks_docstring,
+        "blocks(self, id: str) -> typing.Tuple[typing.Tuple[int, int], ...]\n\n"
+        "This returns a ordered tuple ((file_position, length), ...) of all the blocks held by the SVF identified"
+        "by the given id.\n"
+        "This will raise an ``IndexError`` if the Sparse Virtual File of that id does not exist."
 );
 
 static PyObject *
-cp_SparseVirtualFileSystem_total_blocks(cp_SparseVirtualFileSystem *self) {
+cp_SparseVirtualFileSystem_svf_blocks(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
     ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+
+    PyObject * ret = NULL; // PyTupleObject
+    char *c_id = NULL; // PyUnicodeObject
+    std::string cpp_id;
+    PyObject * insert_item = NULL; // PyTupleObject
+    static const char *kwlist[] = {"id", NULL};
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) kwlist, &c_id)) {
+        goto except;
+    }
+    cpp_id = std::string(c_id);
     try {
-        return PyLong_FromLong(self->p_svfs->num_blocks());
+        p_svf = _lock.acquire(cpp_id);
+        if (p_svf) {
+            const SVFS::SparseVirtualFile &svf = *p_svf;
+            SVFS::t_seek_reads seek_read = svf.blocks();
+            ret = PyTuple_New(seek_read.size());
+            if (!ret) {
+                PyErr_Format(PyExc_MemoryError, "%s: Can not create tuple for return", __FUNCTION__);
+                goto except;
+            }
+            for (size_t i = 0; i < seek_read.size(); ++i) {
+                insert_item = Py_BuildValue("KK", seek_read[i].first, seek_read[i].second);
+                if (!insert_item) {
+                    PyErr_Format(PyExc_MemoryError, "%s: Can not create tuple", __FUNCTION__);
+                    goto except;
+                }
+                PyTuple_SET_ITEM(ret, i, insert_item);
+                insert_item = NULL;
+            }
+        } else {
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID %s", __FUNCTION__, c_id);
+            goto except;
+        }
     } catch (const std::exception &err) {
         PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
-        return NULL;
+        goto except;
+    }
+    assert(!PyErr_Occurred());
+    assert(ret);
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    if (ret) {
+        for (Py_ssize_t i = 0; i < PyList_Size(ret); ++i) {
+            Py_XDECREF(PyList_GET_ITEM(ret, i));
+        }
     }
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return ret;
 }
 
 PyDoc_STRVAR(
-        cp_SparseVirtualFileSystem_svf_has_data_docstring,
-        "has_data(self, id: str, file_position: int, length: int) -> bool\n\n"
-        "Checks if the Sparse Virtual File of the ID has data at the given file_position and length."
-        " This takes a string as an id, a file position and a length."
-        " This returns True if the Sparse Virtual File of that id has the data, False otherwise."
-        " This will raise an ``IndexError`` if the SVF of that id does not exist."
+        cp_SparseVirtualFileSystem_svf_blocks_array_docstring,
+        "blocks_array(self, id: str) -> array.array\n\n"
+        "As :py:meth:`svfsc.cSVFS.blocks` but this returns an ``array.array('Q')`` of unsigned 64 bit integers"
+        " ``[file_position, length, file_position, length, ...]`` rather than a tuple of tuples.\n"
+        "This will raise an ``IndexError`` if the Sparse Virtual File of that id does not exist."
 );
 
 static PyObject *
-cp_SparseVirtualFileSystem_svf_has_data(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+cp_SparseVirtualFileSystem_svf_blocks_array(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
     ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
 
     PyObject * ret = NULL;
     char *c_id = NULL;
     std::string cpp_id;
-    unsigned long long fpos = 0;
-    unsigned long long len = 0;
-    static const char *kwlist[] = {"id", "file_position", "length", NULL};
-    AcquireLockSVFS _lock(self);
+    static const char *kwlist[] = {"id", NULL};
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sKK", (char **) kwlist, &c_id, &fpos, &len)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) kwlist, &c_id)) {
         goto except;
     }
     cpp_id = std::string(c_id);
-    if (self->p_svfs->has(cpp_id)) {
-        try {
-            const SVFS::SparseVirtualFile &svf = self->p_svfs->at(cpp_id);
-            if (svf.has(fpos, len)) {
-                Py_INCREF(Py_True);
-                ret = Py_True;
-            } else {
-                Py_INCREF(Py_False);
-                ret = Py_False;
+    try {
+        p_svf = _lock.acquire(cpp_id);
+        if (p_svf) {
+            ret = private_pairs_as_array(p_svf->blocks());
+            if (!ret) {
+                goto except;
             }
-        } catch (const std::exception &err) {
-            PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        } else {
+            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
             goto except;
         }
-    } else {
-        PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
         goto except;
     }
     assert(!PyErr_Occurred());
@@ -508,48 +2319,82 @@ cp_SparseVirtualFileSystem_svf_has_data(cp_SparseVirtualFileSystem *self, PyObje
     return ret;
 }
 
+SVFS_SVFS_METHOD_SIZE_T_WRAPPER(
+        size_of,
+        "Returns the best guess of total memory usage used by the Sparse Virtual File identified by the given id."
+        " This will raise an ``IndexError`` if the Sparse Virtual File of that id does not exist."
+);
+
+SVFS_SVFS_METHOD_SIZE_T_WRAPPER(
+        num_bytes,
+        "Returns the number of bytes of data held by the Sparse Virtual File identified by the given id."
+        " This will raise an ``IndexError`` if the Sparse Virtual File of that id does not exist."
+);
+
+SVFS_SVFS_METHOD_SIZE_T_WRAPPER(
+        num_blocks,
+        "Returns the number of data blocks held by the Sparse Virtual File identified by the given id."
+        " This will raise an ``IndexError`` if the Sparse Virtual File of that id does not exist."
+);
+
+
 PyDoc_STRVAR(
-        cp_SparseVirtualFileSystem_svf_write_docstring,
-        "write(self, id: str, file_position: int, data: bytes) -> None\n\n"
-        "Writes the data to the Sparse Virtual File of the given ID at file_position and length.\n\n"
-        "This takes a string as an id, a file position and data as a bytes object.\n"
-        "This will raise an ``IndexError`` if the SVF of that id does not exist.\n"
-        "This will raise an ``IOError`` if the given data is different than that seen before and only\n"
-        "new data up to this point will be written.\n"
-        "This will raise a ``RuntimeError`` if the data can not be written for any other reason.\n"
+        cp_SparseVirtualFileSystem_svf_block_touches_docstring,
+        "block_touches(self, id: str) -> typing.Dict[int, int]\n\n"
+        "This returns a dict ``{touch_int: file_position, ...}``"
+        " of the touch integer of each block mapped to the file position.\n"
+        "The caller can decide what older blocks can be used the erase(file_position)."
 );
 
+/**
+ * See cp_SparseVirtualFile_lru_punt_docstring
+ *
+ * @param self The cp_SparseVirtualFile
+ * @param args The upper bound of the number of bytes held by the cache.
+ * @param kwargs "cache_size_upper_bound".
+ * @return Number of bytes removed.
+ */
 static PyObject *
-cp_SparseVirtualFileSystem_svf_write(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+cp_SparseVirtualFileSystem_svf_block_touches(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
     ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
 
-    PyObject * ret = NULL;
-    char *c_id = NULL;
+    PyObject * ret = NULL; // Dict
     std::string cpp_id;
-    unsigned long long fpos = 0;
-    PyObject * py_bytes_data = NULL;
-    static const char *kwlist[] = {"id", "file_position", "data", NULL};
-    AcquireLockSVFS _lock(self);
+    static const char *kwlist[] = {"id", NULL};
+    char *c_id = NULL;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sKS", (char **) kwlist, &c_id, &fpos, &py_bytes_data)) {
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) kwlist, &c_id)) {
         goto except;
     }
     cpp_id = std::string(c_id);
-    try {
-        if (self->p_svfs->has(cpp_id)) {
-            SVFS::SparseVirtualFile &svf = self->p_svfs->at(cpp_id);
-            try {
-                svf.write(fpos, PyBytes_AS_STRING(py_bytes_data), PyBytes_Size(py_bytes_data));
-            } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileDiff &err) {
-                PyErr_Format(PyExc_IOError,
-                             "%s: Can not write to a SVF id = \"%s\" as the given data is different from what is there. ERROR: %s",
-                             __FUNCTION__, c_id, err.message().c_str());
-                goto except;
-            } catch (const SVFS::Exceptions::ExceptionSparseVirtualFile &err) {
-                PyErr_Format(PyExc_RuntimeError, "%s: Can not write to a SVF id = \"%s\". ERROR: %s",
-                             __FUNCTION__, c_id, err.message().c_str());
+    try {
+        p_svf = _lock.acquire(cpp_id);
+        if (p_svf) {
+            SVFS::SparseVirtualFile &svf = *p_svf;
+            SVFS::t_block_touches svf_block_touches = svf.block_touches();
+            ret = PyDict_New();
+            if (!ret) {
+                PyErr_Format(PyExc_MemoryError, "%s: Can not create dict for return", __FUNCTION__);
                 goto except;
             }
+            for (const auto &iter: svf_block_touches) {
+                PyObject * key = PyLong_FromLong(iter.first);
+                if (!key) {
+                    PyErr_Format(PyExc_MemoryError, "%s: Can not create key", __FUNCTION__);
+                    goto except;
+                }
+                PyObject * val = PyLong_FromLong(iter.second);
+                if (!val) {
+                    PyErr_Format(PyExc_MemoryError, "%s: Can not create value", __FUNCTION__);
+                    goto except;
+                }
+                PyDict_SetItem(ret, key, val);
+                Py_DECREF(key);
+                Py_DECREF(val);
+            }
         } else {
             PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
             goto except;
@@ -558,8 +2403,6 @@ cp_SparseVirtualFileSystem_svf_write(cp_SparseVirtualFileSystem *self, PyObject
         PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
         goto except;
     }
-    Py_INCREF(Py_None);
-    ret = Py_None;
     assert(!PyErr_Occurred());
     assert(ret);
     goto finally;
@@ -572,45 +2415,33 @@ cp_SparseVirtualFileSystem_svf_write(cp_SparseVirtualFileSystem *self, PyObject
 }
 
 PyDoc_STRVAR(
-        cp_SparseVirtualFileSystem_svf_read_docstring,
-        "read(self, id: str, file_position: int, length: int) -> bytes\n\n"
-        "Read the data to the Sparse Virtual File at file_position and length returning a bytes object.\n"
-        "This takes a string as an id, a file position and a length.\n"
-        "\nThis will raise an ``IndexError`` if the Sparse Virtual File of that id does not exist.\n"
-        "This will raise an ``IOError`` if any data is not present\n"
-        "This will raise a ``RuntimeError`` if the data can not be read for any other reason.\n"
+        cp_SparseVirtualFileSystem_svf_block_touches_array_docstring,
+        "block_touches_array(self, id: str) -> array.array\n\n"
+        "As :py:meth:`svfsc.cSVFS.block_touches` but this returns an ``array.array('Q')`` of unsigned 64 bit integers"
+        " ``[touch_int, file_position, touch_int, file_position, ...]``, in touch order, rather than a dict.\n"
+        "This will raise an ``IndexError`` if the Sparse Virtual File of that id does not exist."
 );
 
 static PyObject *
-cp_SparseVirtualFileSystem_svf_read(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+cp_SparseVirtualFileSystem_svf_block_touches_array(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
     ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
 
     PyObject * ret = NULL;
     char *c_id = NULL;
     std::string cpp_id;
-    unsigned long long fpos = 0;
-    unsigned long long len = 0;
-    static const char *kwlist[] = {"id", "file_position", "length", NULL};
-    AcquireLockSVFS _lock(self);
+    static const char *kwlist[] = {"id", NULL};
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sKK", (char **) kwlist, &c_id, &fpos, &len)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) kwlist, &c_id)) {
         goto except;
     }
     cpp_id = std::string(c_id);
     try {
-        if (self->p_svfs->has(cpp_id)) {
-            SVFS::SparseVirtualFile &svf = self->p_svfs->at(cpp_id);
-            // Create a bytes object
-            ret = PyBytes_FromStringAndSize(NULL, len);
-            try {
-                svf.read(fpos, len, PyBytes_AS_STRING(ret));
-            } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileRead &err) {
-                PyErr_Format(PyExc_IOError, "%s: Can not read from a SVF id= \"%s\". ERROR: %s",
-                             __FUNCTION__, c_id, err.message().c_str());
-                goto except;
-            } catch (const SVFS::Exceptions::ExceptionSparseVirtualFile &err) {
-                PyErr_Format(PyExc_RuntimeError, "%s: Fatal error reading from a SVF id= \"%s\". ERROR: %s",
-                             __FUNCTION__, c_id, err.message().c_str());
+        p_svf = _lock.acquire(cpp_id);
+        if (p_svf) {
+            ret = private_pairs_as_array(p_svf->block_touches());
+            if (!ret) {
                 goto except;
             }
         } else {
@@ -633,42 +2464,52 @@ cp_SparseVirtualFileSystem_svf_read(cp_SparseVirtualFileSystem *self, PyObject *
 }
 
 PyDoc_STRVAR(
-        cp_SparseVirtualFileSystem_svf_erase_docstring,
-        "erase(self, id: str, file_position: int) -> None\n\n"
-        "Erases the data block in the Sparse Virtual File at a file position.\n"
-        "This takes a string as an id and a file_position.\n"
-        "This will raise an ``IndexError`` if the Sparse Virtual File of that id does not exist.\n"
-        "This will raise an ``IOError`` if there is not a block at the position.\n"
-        "This will raise a ``RuntimeError`` if the data can not be read for any other reason.\n"
+        cp_SparseVirtualFileSystem_svf_lru_punt_docstring,
+        "lru_punt(self, id: str, cache_size_upper_bound: int) -> int\n\n"
+        "Reduces the size of the cache to < the given size by removing older blocks, at least one block will be left.\n"
+        "There are limitations to this tactic, see the documentation in Technical Notes -> Cache Punting."
 );
 
+/**
+ * See cp_SparseVirtualFile_lru_punt_docstring
+ *
+ * @param self The cp_SparseVirtualFile
+ * @param args The upper bound of the number of bytes held by the cache.
+ * @param kwargs "cache_size_upper_bound".
+ * @return Number of bytes removed.
+ */
 static PyObject *
-cp_SparseVirtualFileSystem_svf_erase(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+cp_SparseVirtualFileSystem_svf_lru_punt(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
     ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
 
-    PyObject * ret = NULL;
-    char *c_id = NULL;
+    PyObject * ret = NULL; // Long
+    size_t cache_size_upper_bound;
     std::string cpp_id;
-    unsigned long long fpos = 0;
-    static const char *kwlist[] = {"id", "file_position", NULL};
-    AcquireLockSVFS _lock(self);
+    static const char *kwlist[] = {"id", "cache_size_upper_bound", NULL};
+    char *c_id = NULL;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sK", (char **) kwlist, &c_id, &fpos)) {
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sK", (char **) kwlist, &c_id, &cache_size_upper_bound)) {
         goto except;
     }
     cpp_id = std::string(c_id);
     try {
-        if (self->p_svfs->has(cpp_id)) {
-            SVFS::SparseVirtualFile &svf = self->p_svfs->at(cpp_id);
-            try {
-                svf.erase(fpos);
-            } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileErase &err) {
-                PyErr_Format(PyExc_IOError, "%s: Can not erase block from a SVF id= \"%s\". ERROR: %s",
-                             __FUNCTION__, c_id, err.message().c_str());
+        p_svf = _lock.acquire(cpp_id, true);
+        if (p_svf) {
+            if (private_SparseVirtualFileSystem_check_exports(self, c_id, __FUNCTION__)) {
                 goto except;
-            } catch (const SVFS::Exceptions::ExceptionSparseVirtualFile &err) {
-                PyErr_Format(PyExc_RuntimeError, "%s: Fatal error erasing from a SVF id= \"%s\". ERROR: %s",
-                             __FUNCTION__, c_id, err.message().c_str());
+            }
+            SVFS::SparseVirtualFile &svf = *p_svf;
+            size_t bytes_removed;
+            {
+                ReleaseGIL _release(private_SparseVirtualFile_lru_punt_release_gil(svf, cache_size_upper_bound));
+                bytes_removed = svf.lru_punt(cache_size_upper_bound);
+            }
+            ret = Py_BuildValue("K", bytes_removed);
+            if (!ret) {
+                PyErr_Format(PyExc_MemoryError, "%s: Can not create long", __FUNCTION__);
                 goto except;
             }
         } else {
@@ -679,8 +2520,6 @@ cp_SparseVirtualFileSystem_svf_erase(cp_SparseVirtualFileSystem *self, PyObject
         PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
         goto except;
     }
-    Py_INCREF(Py_None);
-    ret = Py_None;
     assert(!PyErr_Occurred());
     assert(ret);
     goto finally;
@@ -693,51 +2532,53 @@ cp_SparseVirtualFileSystem_svf_erase(cp_SparseVirtualFileSystem *self, PyObject
 }
 
 PyDoc_STRVAR(
-        cp_SparseVirtualFileSystem_svf_need_docstring,
-        "need(self, id: str, file_position: int, length: int, greedy_length: int = 0) -> typing.Tuple[typing.Tuple[int, int], ...]\n\n"
-        "Given a file_position and length this returns a ordered list ``[(file_position, length), ...]`` of seek/read"
-        " instructions of data that is required to be written to the Sparse Virtual File so that a subsequent read will succeed.\n"
-        "If greedy_length is > 0 then, if possible, blocks will be coalesced to reduce the size of the return value."
-        "\nUsage::\n\n"
-        "    if not svfs.has(identity, file_position, length):\n"
-        "        for fpos, read_len in svfs.need(identity, file_position, length):\n"
-        "            # Somehow get the data at that seek/read position...\n"
-        "            svfs.write(identity, fpos, data)\n"
-        "    return svfs.read(identity, file_position, length):\n"
+        cp_SparseVirtualFileSystem_svf_lru_punt_all_docstring,
+        "lru_punt_all(self, cache_size_upper_bound: int) -> int\n\n"
+        "Reduces the size of all IDs in the cache to < the given size by removing older blocks."
+        " At least one block will be left for each ID.\n"
+        "There are limitations to this tactic, see the documentation in Technical Notes -> Cache Punting."
 );
 
+/**
+ * See cp_SparseVirtualFile_lru_punt_docstring
+ *
+ * @param self The cp_SparseVirtualFile
+ * @param args The upper bound of the number of bytes held by the cache.
+ * @param kwargs "cache_size_upper_bound".
+ * @return Number of bytes removed.
+ */
 static PyObject *
-cp_SparseVirtualFileSystem_svf_need(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+cp_SparseVirtualFileSystem_svf_lru_punt_all(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
     ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
 
-    PyObject * ret = NULL; // PyListObject
-    char *c_id = NULL; // PyUnicodeObject
-    std::string cpp_id;
-    unsigned long long fpos = 0;
-    unsigned long long len = 0;
-    unsigned long long greedy_length = 0;
-    static const char *kwlist[] = {"id", "file_position", "length", "greedy_length", NULL};
-    AcquireLockSVFS _lock(self);
+    PyObject * ret = NULL; // Long
+    size_t cache_size_upper_bound;
+    size_t total_removed = 0;
+    static const char *kwlist[] = {"cache_size_upper_bound", NULL};
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sKK|K", (char **) kwlist, &c_id, &fpos, &len, &greedy_length)) {
+    AcquireLockSVFSAll _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "K", (char **) kwlist, &cache_size_upper_bound)) {
+        goto except;
+    }
+    if (private_SparseVirtualFileSystem_check_exports(self, NULL, __FUNCTION__)) {
         goto except;
     }
-    cpp_id = std::string(c_id);
     try {
-        if (self->p_svfs->has(cpp_id)) {
-            const SVFS::SparseVirtualFile &svf = self->p_svfs->at(cpp_id);
-            ret = cp_SparseVirtualFile_need_internal(&svf, fpos, len, greedy_length);
-            if (!ret) {
-                goto except;
-            }
-        } else {
-            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
-            goto except;
+        ReleaseGIL _release(self->p_svfs->num_blocks() >= PY_RELEASE_GIL_BLOCKS);
+        for (const auto &iter: self->p_svfs->keys()) {
+            SVFS::SparseVirtualFile &svf = self->p_svfs->at(iter);
+            total_removed += svf.lru_punt(cache_size_upper_bound);
         }
     } catch (const std::exception &err) {
         PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
         goto except;
     }
+    ret = Py_BuildValue("K", total_removed);
+    if (!ret) {
+        PyErr_Format(PyExc_MemoryError, "%s: Can not create long", __FUNCTION__);
+        goto except;
+    }
     assert(!PyErr_Occurred());
     assert(ret);
     goto finally;
@@ -750,42 +2591,45 @@ cp_SparseVirtualFileSystem_svf_need(cp_SparseVirtualFileSystem *self, PyObject *
 }
 
 PyDoc_STRVAR(
-        cp_SparseVirtualFileSystem_svf_need_many_docstring,
-        "need_many(self, id: str, seek_reads: typing.List[typing.Tuple[int, int]], greedy_length: int = 0) -> typing.Tuple[typing.Tuple[int, int], ...]\n\n"
-        "Given a list of (file_position, length) this returns a ordered list ``[(file_position, length), ...]`` of seek/read"
-        " instructions of data that is required to be written to the Sparse Virtual File so that a subsequent read will"
-        " succeed.\n\n"
-        "If greedy_length is > 0 then, if possible, blocks will be coalesced to reduce the size of the return value."
-        "\n\n"
-        "See also :py:meth:`svfsc.cSVFS.need`"
+        cp_SparseVirtualFileSystem_compact_docstring,
+        "compact(self, max_time: float = 0.0) -> int\n\n"
+        "Right sizes the memory of every block of every ID and returns the number of bytes reclaimed.\n"
+        "If max_time is non-zero this stops after roughly that many seconds and the next call continues from where"
+        " this one stopped."
 );
 
+/**
+ * See cp_SparseVirtualFileSystem_compact_docstring
+ *
+ * @param self The cp_SparseVirtualFileSystem
+ * @param args The time budget in seconds.
+ * @param kwargs "max_time".
+ * @return Number of bytes reclaimed.
+ */
 static PyObject *
-cp_SparseVirtualFileSystem_svf_need_many(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+cp_SparseVirtualFileSystem_compact(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
     ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
 
-    PyObject * ret = NULL; // PyListObject
-    char *c_id = NULL; // PyUnicodeObject
-    std::string cpp_id;
+    PyObject * ret = NULL; // Long
+    double max_time = 0.0;
+    static const char *kwlist[] = {"max_time", NULL};
 
-    PyObject * py_seek_reads = NULL;
-    unsigned long long greedy_len = 0;
-    static const char *kwlist[] = {"id", "seek_reads", "greedy_length", NULL};
-    AcquireLockSVFS _lock(self);
+    AcquireLockSVFSAll _lock(self);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|K", (char **) kwlist, &c_id, &py_seek_reads, &greedy_len)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|d", (char **) kwlist, &max_time)) {
+        goto except;
+    }
+    if (private_SparseVirtualFileSystem_check_exports(self, NULL, __FUNCTION__)) {
+        goto except;
+    }
+    if (max_time < 0.0) {
+        PyErr_SetString(PyExc_ValueError, "max_time must not be negative");
         goto except;
     }
-    cpp_id = std::string(c_id);
     try {
-        if (self->p_svfs->has(cpp_id)) {
-            const SVFS::SparseVirtualFile &svf = self->p_svfs->at(cpp_id);
-            ret = cp_SparseVirtualFile_need_many_internal(py_seek_reads, &svf, greedy_len);
-            if (!ret) {
-                goto except;
-            }
-        } else {
-            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
+        ret = Py_BuildValue("K", self->p_svfs->compact(max_time));
+        if (!ret) {
+            PyErr_Format(PyExc_MemoryError, "%s: Can not create long", __FUNCTION__);
             goto except;
         }
     } catch (const std::exception &err) {
@@ -803,72 +2647,93 @@ cp_SparseVirtualFileSystem_svf_need_many(cp_SparseVirtualFileSystem *self, PyObj
     return ret;
 }
 
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_set_budget_docstring,
+        "set_budget(self, budget: int, evict_max_blocks: int = 0) -> None\n\n"
+        "Sets the byte budget for the total of every Sparse Virtual File, zero means no budget.\n"
+        "When ``total_bytes()`` is over the budget ``write()``, ``write_many()`` and the ``write()`` of a handle evict"
+        " the least recently used blocks of any SVF, at most ``evict_max_blocks`` per write if that is non-zero.\n"
+        "This does not evict anything itself, see ``evict()``."
+);
+
 /**
-// ---- Meta information about the SVF ----
-// The existing blocks.
-t_seek_reads blocks() const noexcept;
+ * See cp_SparseVirtualFileSystem_set_budget_docstring
+ *
+ * @param self The cp_SparseVirtualFileSystem
+ * @param args The budget in bytes and the most blocks to evict per write.
+ * @param kwargs "budget", "evict_max_blocks".
+ * @return None.
+ */
+static PyObject *
+cp_SparseVirtualFileSystem_set_budget(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
 
-// Information about memory used:
-// size_of() gives best guess of total memory usage.
-size_t size_of() const noexcept;
+    unsigned long long budget = 0;
+    unsigned long long evict_max_blocks = 0;
+    static const char *kwlist[] = {"budget", "evict_max_blocks", NULL};
 
-// Gives exact number of data bytes held.
-size_t num_bytes() const noexcept { return m_bytes_total; };
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "K|K", (char **) kwlist, &budget, &evict_max_blocks)) {
+        return NULL;
+    }
+    self->p_svfs->set_budget(budget, evict_max_blocks);
+    Py_RETURN_NONE;
+}
 
-// Gives exact number of blocks used.
-size_t num_blocks() const noexcept { return m_svf.size(); }
-t_fpos last_file_position() const noexcept;
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_budget_docstring,
+        "budget(self) -> int\n\n"
+        "Returns the byte budget for the total of every Sparse Virtual File, zero if there is none."
+);
 
-// Check the clients file modification time has changed.
-// Caller has to decide what to do...
-bool file_mod_time_matches(const double &file_mod_time) const noexcept {
-    return file_mod_time == m_file_mod_time;
+static PyObject *
+cp_SparseVirtualFileSystem_budget(cp_SparseVirtualFileSystem *self) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+    return PyLong_FromSize_t(self->p_svfs->budget());
 }
-*/
 
 PyDoc_STRVAR(
-        cp_SparseVirtualFileSystem_svf_blocks_docstring,
-        "blocks(self, id: str) -> typing.Tuple[typing.Tuple[int, int], ...]\n\n"
-        "This returns a ordered tuple ((file_position, length), ...) of all the blocks held by the SVF identified"
-        "by the given id.\n"
-        "This will raise an ``IndexError`` if the Sparse Virtual File of that id does not exist."
+        cp_SparseVirtualFileSystem_evict_docstring,
+        "evict(self, max_blocks: int = 0) -> int\n\n"
+        "Removes the least recently used blocks of any ID until ``total_bytes()`` is within the budget and returns"
+        " the number of bytes removed.\n"
+        "If max_blocks is non-zero this removes at most that many blocks.\n"
+        "Dense regions are removed as a whole.\n"
+        "See the documentation in Technical Notes -> Cache Punting."
 );
 
+/**
+ * See cp_SparseVirtualFileSystem_evict_docstring
+ *
+ * @param self The cp_SparseVirtualFileSystem
+ * @param args The most blocks to evict.
+ * @param kwargs "max_blocks".
+ * @return Number of bytes removed.
+ */
 static PyObject *
-cp_SparseVirtualFileSystem_svf_blocks(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+cp_SparseVirtualFileSystem_evict(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
     ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
 
-    PyObject * ret = NULL; // PyTupleObject
-    char *c_id = NULL; // PyUnicodeObject
-    std::string cpp_id;
-    PyObject * insert_item = NULL; // PyTupleObject
-    static const char *kwlist[] = {"id", NULL};
-    AcquireLockSVFS _lock(self);
+    PyObject * ret = NULL; // Long
+    unsigned long long max_blocks = 0;
+    static const char *kwlist[] = {"max_blocks", NULL};
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) kwlist, &c_id)) {
+    AcquireLockSVFSAll _lock(self);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|K", (char **) kwlist, &max_blocks)) {
         goto except;
     }
-    cpp_id = std::string(c_id);
-    try {
-        if (self->p_svfs->has(cpp_id)) {
-            const SVFS::SparseVirtualFile &svf = self->p_svfs->at(cpp_id);
-            SVFS::t_seek_reads seek_read = svf.blocks();
-            ret = PyTuple_New(seek_read.size());
-            if (!ret) {
-                PyErr_Format(PyExc_MemoryError, "%s: Can not create tuple for return", __FUNCTION__);
-                goto except;
-            }
-            for (size_t i = 0; i < seek_read.size(); ++i) {
-                insert_item = Py_BuildValue("KK", seek_read[i].first, seek_read[i].second);
-                if (!insert_item) {
-                    PyErr_Format(PyExc_MemoryError, "%s: Can not create tuple", __FUNCTION__);
-                    goto except;
-                }
-                PyTuple_SET_ITEM(ret, i, insert_item);
-                insert_item = NULL;
-            }
-        } else {
-            PyErr_Format(PyExc_IndexError, "%s: No SVF ID %s", __FUNCTION__, c_id);
+    if (private_SparseVirtualFileSystem_check_exports(self, NULL, __FUNCTION__)) {
+        goto except;
+    }
+    try {
+        size_t removed = 0;
+        {
+            ReleaseGIL _release(max_blocks == 0 || max_blocks >= PY_RELEASE_GIL_BLOCKS);
+            removed = self->p_svfs->evict(max_blocks);
+        }
+        ret = Py_BuildValue("K", removed);
+        if (!ret) {
+            PyErr_Format(PyExc_MemoryError, "%s: Can not create long", __FUNCTION__);
             goto except;
         }
     } catch (const std::exception &err) {
@@ -880,99 +2745,109 @@ cp_SparseVirtualFileSystem_svf_blocks(cp_SparseVirtualFileSystem *self, PyObject
     goto finally;
     except:
     assert(PyErr_Occurred());
-    if (ret) {
-        for (Py_ssize_t i = 0; i < PyList_Size(ret); ++i) {
-            Py_XDECREF(PyList_GET_ITEM(ret, i));
-        }
-    }
     Py_XDECREF(ret);
     ret = NULL;
     finally:
     return ret;
 }
 
-SVFS_SVFS_METHOD_SIZE_T_WRAPPER(
-        size_of,
-        "Returns the best guess of total memory usage used by the Sparse Virtual File identified by the given id."
-        " This will raise an ``IndexError`` if the Sparse Virtual File of that id does not exist."
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_save_docstring,
+        "save(self, path: str) -> None\n\n"
+        "Writes every Sparse Virtual File, including any spilled blocks, to the file at the given path.\n"
+        "Statistics are not saved.\n"
+        "This will raise an ``OSError`` if the file can not be written."
 );
 
-SVFS_SVFS_METHOD_SIZE_T_WRAPPER(
-        num_bytes,
-        "Returns the number of bytes of data held by the Sparse Virtual File identified by the given id."
-        " This will raise an ``IndexError`` if the Sparse Virtual File of that id does not exist."
-);
+/**
+ * See cp_SparseVirtualFileSystem_save_docstring
+ *
+ * @param self The cp_SparseVirtualFileSystem
+ * @param args The file path.
+ * @param kwargs "path".
+ * @return None.
+ */
+static PyObject *
+cp_SparseVirtualFileSystem_save(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
 
-SVFS_SVFS_METHOD_SIZE_T_WRAPPER(
-        num_blocks,
-        "Returns the number of data blocks held by the Sparse Virtual File identified by the given id."
-        " This will raise an ``IndexError`` if the Sparse Virtual File of that id does not exist."
-);
+    PyObject * ret = NULL;
+    char *c_path = NULL;
+    static const char *kwlist[] = {"path", NULL};
+
+    AcquireLockSVFSAll _lock(self);
 
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) kwlist, &c_path)) {
+        goto except;
+    }
+    try {
+        self->p_svfs->save(c_path);
+    } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileSystemSaveLoad &err) {
+        PyErr_Format(PyExc_OSError, "%s", err.message().c_str());
+        goto except;
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        goto except;
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+    assert(!PyErr_Occurred());
+    assert(ret);
+    goto finally;
+    except:
+    assert(PyErr_Occurred());
+    Py_XDECREF(ret);
+    ret = NULL;
+    finally:
+    return ret;
+}
 
 PyDoc_STRVAR(
-        cp_SparseVirtualFileSystem_svf_block_touches_docstring,
-        "block_touches(self, id: str) -> typing.Dict[int, int]\n\n"
-        "This returns a dict ``{touch_int: file_position, ...}``"
-        " of the touch integer of each block mapped to the file position.\n"
-        "The caller can decide what older blocks can be used the erase(file_position)."
+        cp_SparseVirtualFileSystem_load_docstring,
+        "load(self, path: str) -> None\n\n"
+        "Adds every Sparse Virtual File in a file written by ``save()``.\n"
+        "The file is memory mapped and the data is only read when needed so this is fast regardless of the file size.\n"
+        "Until it is read the loaded data is not counted by ``num_bytes()``, ``num_blocks()`` or ``blocks()`` but"
+        " ``has_data()`` and ``need()`` treat it as present.\n"
+        "This will raise an ``OSError`` if the file can not be read or is invalid or a ``RuntimeError`` if any ID"
+        " already exists, in either case nothing is added."
 );
 
 /**
- * See cp_SparseVirtualFile_lru_punt_docstring
+ * See cp_SparseVirtualFileSystem_load_docstring
  *
- * @param self The cp_SparseVirtualFile
- * @param args The upper bound of the number of bytes held by the cache.
- * @param kwargs "cache_size_upper_bound".
- * @return Number of bytes removed.
+ * @param self The cp_SparseVirtualFileSystem
+ * @param args The file path.
+ * @param kwargs "path".
+ * @return None.
  */
 static PyObject *
-cp_SparseVirtualFileSystem_svf_block_touches(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+cp_SparseVirtualFileSystem_load(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
     ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
 
-    PyObject * ret = NULL; // Dict
-    std::string cpp_id;
-    static const char *kwlist[] = {"id", NULL};
-    char *c_id = NULL;
+    PyObject * ret = NULL;
+    char *c_path = NULL;
+    static const char *kwlist[] = {"path", NULL};
 
-    AcquireLockSVFS _lock(self);
+    AcquireLockSVFSAll _lock(self, true);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) kwlist, &c_id)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) kwlist, &c_path)) {
         goto except;
     }
-    cpp_id = std::string(c_id);
     try {
-        if (self->p_svfs->has(cpp_id)) {
-            SVFS::SparseVirtualFile &svf = self->p_svfs->at(cpp_id);
-            SVFS::t_block_touches svf_block_touches = svf.block_touches();
-            ret = PyDict_New();
-            if (!ret) {
-                PyErr_Format(PyExc_MemoryError, "%s: Can not create dict for return", __FUNCTION__);
-                goto except;
-            }
-            for (const auto &iter: svf_block_touches) {
-                PyObject * key = PyLong_FromLong(iter.first);
-                if (!key) {
-                    PyErr_Format(PyExc_MemoryError, "%s: Can not create key", __FUNCTION__);
-                    goto except;
-                }
-                PyObject * val = PyLong_FromLong(iter.second);
-                if (!val) {
-                    PyErr_Format(PyExc_MemoryError, "%s: Can not create value", __FUNCTION__);
-                    goto except;
-                }
-                PyDict_SetItem(ret, key, val);
-                Py_DECREF(key);
-                Py_DECREF(val);
-            }
-        } else {
-            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
-            goto except;
-        }
+        self->p_svfs->load(c_path);
+    } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileSystemSaveLoad &err) {
+        PyErr_Format(PyExc_OSError, "%s", err.message().c_str());
+        goto except;
+    } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileSystemInsert &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s", err.message().c_str());
+        goto except;
     } catch (const std::exception &err) {
         PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
         goto except;
     }
+    Py_INCREF(Py_None);
+    ret = Py_None;
     assert(!PyErr_Occurred());
     assert(ret);
     goto finally;
@@ -985,52 +2860,55 @@ cp_SparseVirtualFileSystem_svf_block_touches(cp_SparseVirtualFileSystem *self, P
 }
 
 PyDoc_STRVAR(
-        cp_SparseVirtualFileSystem_svf_lru_punt_docstring,
-        "lru_punt(self, id: str, cache_size_upper_bound: int) -> int\n\n"
-        "Reduces the size of the cache to < the given size by removing older blocks, at least one block will be left.\n"
-        "There are limitations to this tactic, see the documentation in Technical Notes -> Cache Punting."
+        cp_SparseVirtualFileSystem_journal_open_docstring,
+        "journal_open(self, path: str, sync_bytes: int = 1048576) -> None\n\n"
+        "Replays the journal at the given path, if it exists, then appends every change to it.\n"
+        "Changes are written and synced once there are ``sync_bytes`` of them, or on ``journal_flush()``,"
+        " so at most that many bytes of changes are lost on a crash.\n"
+        "On startup ``load()`` the last ``checkpoint()`` then call this.\n"
+        "This will raise an ``OSError`` if a journal is already open or the journal can not be read or opened."
 );
 
 /**
- * See cp_SparseVirtualFile_lru_punt_docstring
+ * See cp_SparseVirtualFileSystem_journal_open_docstring
  *
- * @param self The cp_SparseVirtualFile
- * @param args The upper bound of the number of bytes held by the cache.
- * @param kwargs "cache_size_upper_bound".
- * @return Number of bytes removed.
+ * @param self The cp_SparseVirtualFileSystem
+ * @param args The journal path and sync size.
+ * @param kwargs "path", "sync_bytes".
+ * @return None.
  */
 static PyObject *
-cp_SparseVirtualFileSystem_svf_lru_punt(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+cp_SparseVirtualFileSystem_journal_open(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
     ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
 
-    PyObject * ret = NULL; // Long
-    size_t cache_size_upper_bound;
-    std::string cpp_id;
-    static const char *kwlist[] = {"id", "cache_size_upper_bound", NULL};
-    char *c_id = NULL;
+    PyObject * ret = NULL;
+    char *c_path = NULL;
+    Py_ssize_t sync_bytes = static_cast<Py_ssize_t>(SVFS::SVFS_JOURNAL_SYNC_BYTES_DEFAULT);
+    static const char *kwlist[] = {"path", "sync_bytes", NULL};
 
-    AcquireLockSVFS _lock(self);
+    AcquireLockSVFSAll _lock(self, true);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sK", (char **) kwlist, &c_id, &cache_size_upper_bound)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|n", (char **) kwlist, &c_path, &sync_bytes)) {
+        goto except;
+    }
+    if (private_SparseVirtualFileSystem_check_exports(self, NULL, __FUNCTION__)) {
+        goto except;
+    }
+    if (sync_bytes < 0) {
+        PyErr_Format(PyExc_ValueError, "sync_bytes %zd must not be negative", sync_bytes);
         goto except;
     }
-    cpp_id = std::string(c_id);
     try {
-        if (self->p_svfs->has(cpp_id)) {
-            SVFS::SparseVirtualFile &svf = self->p_svfs->at(cpp_id);
-            ret = Py_BuildValue("K", svf.lru_punt(cache_size_upper_bound));
-            if (!ret) {
-                PyErr_Format(PyExc_MemoryError, "%s: Can not create long", __FUNCTION__);
-                goto except;
-            }
-        } else {
-            PyErr_Format(PyExc_IndexError, "%s: No SVF ID \"%s\"", __FUNCTION__, c_id);
-            goto except;
-        }
+        self->p_svfs->journal_open(c_path, static_cast<size_t>(sync_bytes));
+    } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileSystemJournal &err) {
+        PyErr_Format(PyExc_OSError, "%s", err.message().c_str());
+        goto except;
     } catch (const std::exception &err) {
         PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
         goto except;
     }
+    Py_INCREF(Py_None);
+    ret = Py_None;
     assert(!PyErr_Occurred());
     assert(ret);
     goto finally;
@@ -1043,49 +2921,91 @@ cp_SparseVirtualFileSystem_svf_lru_punt(cp_SparseVirtualFileSystem *self, PyObje
 }
 
 PyDoc_STRVAR(
-        cp_SparseVirtualFileSystem_svf_lru_punt_all_docstring,
-        "lru_punt_all(self, cache_size_upper_bound: int) -> int\n\n"
-        "Reduces the size of all IDs in the cache to < the given size by removing older blocks."
-        " At least one block will be left for each ID.\n"
-        "There are limitations to this tactic, see the documentation in Technical Notes -> Cache Punting."
+        cp_SparseVirtualFileSystem_journal_flush_docstring,
+        "journal_flush(self) -> None\n\n"
+        "Writes and syncs any buffered journal changes. This does nothing if there is no journal.\n"
+        "This will raise an ``OSError`` if the journal can not be written."
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_journal_flush(cp_SparseVirtualFileSystem *self) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+
+    AcquireLockSVFS _lock(self);
+    try {
+        self->p_svfs->journal_flush();
+    } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileSystemJournal &err) {
+        PyErr_Format(PyExc_OSError, "%s", err.message().c_str());
+        return NULL;
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_journal_close_docstring,
+        "journal_close(self) -> None\n\n"
+        "Flushes the journal and stops journalling. This does nothing if there is no journal."
+);
+
+static PyObject *
+cp_SparseVirtualFileSystem_journal_close(cp_SparseVirtualFileSystem *self) {
+    ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+
+    AcquireLockSVFSAll _lock(self);
+    try {
+        self->p_svfs->journal_close();
+    } catch (const std::exception &err) {
+        PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(
+        cp_SparseVirtualFileSystem_checkpoint_docstring,
+        "checkpoint(self, path: str) -> None\n\n"
+        "Saves a snapshot to the given path, as ``save()``, and empties the journal.\n"
+        "This will raise an ``OSError`` if there is no journal or the snapshot can not be saved."
 );
 
 /**
- * See cp_SparseVirtualFile_lru_punt_docstring
+ * See cp_SparseVirtualFileSystem_checkpoint_docstring
  *
- * @param self The cp_SparseVirtualFile
- * @param args The upper bound of the number of bytes held by the cache.
- * @param kwargs "cache_size_upper_bound".
- * @return Number of bytes removed.
+ * @param self The cp_SparseVirtualFileSystem
+ * @param args The snapshot path.
+ * @param kwargs "path".
+ * @return None.
  */
 static PyObject *
-cp_SparseVirtualFileSystem_svf_lru_punt_all(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
+cp_SparseVirtualFileSystem_checkpoint(cp_SparseVirtualFileSystem *self, PyObject *args, PyObject *kwargs) {
     ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
 
-    PyObject * ret = NULL; // Long
-    size_t cache_size_upper_bound;
-    size_t total_removed = 0;
-    static const char *kwlist[] = {"cache_size_upper_bound", NULL};
+    PyObject * ret = NULL;
+    char *c_path = NULL;
+    static const char *kwlist[] = {"path", NULL};
 
-    AcquireLockSVFS _lock(self);
+    AcquireLockSVFSAll _lock(self);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "K", (char **) kwlist, &cache_size_upper_bound)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) kwlist, &c_path)) {
         goto except;
     }
     try {
-        for (const auto &iter: self->p_svfs->keys()) {
-            SVFS::SparseVirtualFile &svf = self->p_svfs->at(iter);
-            total_removed += svf.lru_punt(cache_size_upper_bound);
-        }
+        self->p_svfs->checkpoint(c_path);
+    } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileSystemJournal &err) {
+        PyErr_Format(PyExc_OSError, "%s", err.message().c_str());
+        goto except;
+    } catch (const SVFS::Exceptions::ExceptionSparseVirtualFileSystemSaveLoad &err) {
+        PyErr_Format(PyExc_OSError, "%s", err.message().c_str());
+        goto except;
     } catch (const std::exception &err) {
         PyErr_Format(PyExc_RuntimeError, "%s: FATAL caught std::exception %s", __FUNCTION__, err.what());
         goto except;
     }
-    ret = Py_BuildValue("K", total_removed);
-    if (!ret) {
-        PyErr_Format(PyExc_MemoryError, "%s: Can not create long", __FUNCTION__);
-        goto except;
-    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
     assert(!PyErr_Occurred());
     assert(ret);
     goto finally;
@@ -1115,15 +3035,17 @@ cp_SparseVirtualFileSystem_svf_file_mod_time_matches(cp_SparseVirtualFileSystem
     double file_mod_time;
     std::string cpp_id;
     static const char *kwlist[] = {"id", "file_mod_time", NULL};
-    AcquireLockSVFS _lock(self);
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
 
     if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sd", (char **) kwlist, &c_id, &file_mod_time)) {
         goto except;
     }
     cpp_id = std::string(c_id);
     try {
-        if (self->p_svfs->has(cpp_id)) {
-            SVFS::SparseVirtualFile &svf = self->p_svfs->at(cpp_id);
+        p_svf = _lock.acquire(cpp_id);
+        if (p_svf) {
+            SVFS::SparseVirtualFile &svf = *p_svf;
             if (svf.file_mod_time_matches(file_mod_time)) {
                 Py_INCREF(Py_True);
                 ret = Py_True;
@@ -1180,15 +3102,17 @@ cp_SparseVirtualFileSystem_file_mod_time(cp_SparseVirtualFileSystem *self, PyObj
     char *c_id = NULL;
     std::string cpp_id;
     static const char *kwlist[] = {"id", NULL};
-    AcquireLockSVFS _lock(self);
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
 
     if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) kwlist, &c_id)) {
         goto except;
     }
     cpp_id = std::string(c_id);
     try {
-        if (self->p_svfs->has(cpp_id)) {
-            SVFS::SparseVirtualFile &svf = self->p_svfs->at(cpp_id);
+        p_svf = _lock.acquire(cpp_id);
+        if (p_svf) {
+            SVFS::SparseVirtualFile &svf = *p_svf;
             ret = PyFloat_FromDouble(svf.file_mod_time());
         } else {
             PyErr_Format(PyExc_IndexError, "%s: No SVF ID %s", __FUNCTION__, c_id);
@@ -1285,15 +3209,17 @@ cp_SparseVirtualFileSystem_svf_time_write(cp_SparseVirtualFileSystem *self, PyOb
     char *c_id = NULL;
     std::string cpp_id;
     static const char *kwlist[] = {"id", NULL};
-    AcquireLockSVFS _lock(self);
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
 
     if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) kwlist, &c_id)) {
         goto except;
     }
     cpp_id = std::string(c_id);
     try {
-        if (self->p_svfs->has(cpp_id)) {
-            const SVFS::SparseVirtualFile &svf = self->p_svfs->at(cpp_id);
+        p_svf = _lock.acquire(cpp_id);
+        if (p_svf) {
+            const SVFS::SparseVirtualFile &svf = *p_svf;
             if (svf.count_write()) {
                 auto time = svf.time_write();
                 const long seconds = std::chrono::time_point_cast<std::chrono::seconds>(
@@ -1346,15 +3272,17 @@ cp_SparseVirtualFileSystem_svf_time_read(cp_SparseVirtualFileSystem *self, PyObj
     char *c_id = NULL;
     std::string cpp_id;
     static const char *kwlist[] = {"id", NULL};
-    AcquireLockSVFS _lock(self);
+    SVFS::SparseVirtualFile *p_svf = NULL;
+    AcquireLockSVFSFile _lock(self);
 
     if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) kwlist, &c_id)) {
         goto except;
     }
     cpp_id = std::string(c_id);
     try {
-        if (self->p_svfs->has(cpp_id)) {
-            const SVFS::SparseVirtualFile &svf = self->p_svfs->at(cpp_id);
+        p_svf = _lock.acquire(cpp_id);
+        if (p_svf) {
+            const SVFS::SparseVirtualFile &svf = *p_svf;
             if (svf.count_read()) {
                 auto time = svf.time_read();
                 const long seconds = std::chrono::time_point_cast<std::chrono::seconds>(
@@ -1392,7 +3320,7 @@ cp_SparseVirtualFileSystem_svf_time_read(cp_SparseVirtualFileSystem *self, PyObj
 
 PyDoc_STRVAR(
         cp_SparseVirtualFileSystem_config_docstring,
-        "config(self) -> typing.Dict[str, bool]\n\n"
+        "config(self) -> typing.Dict[str, typing.Union[bool, int]]\n\n"
         "Returns the SVFS configuration as a dict."
 );
 
@@ -1402,9 +3330,17 @@ cp_SparseVirtualFileSystem_config(cp_SparseVirtualFileSystem *self) {
             "{"
             "s:N"   /* compare_for_diff */
             ",s:N"  /* overwrite_on_exit */
+            ",s:n"  /* coverage_page_size */
+            ",s:n"  /* dense_gap */
+            ",s:n"  /* spill_capacity */
+            ",s:s"  /* spill_directory */
             "}",
             "compare_for_diff", PyBool_FromLong(self->p_svfs->config().compare_for_diff ? 1 : 0),
-            "overwrite_on_exit", PyBool_FromLong(self->p_svfs->config().overwrite_on_exit ? 1 : 0)
+            "overwrite_on_exit", PyBool_FromLong(self->p_svfs->config().overwrite_on_exit ? 1 : 0),
+            "coverage_page_size", static_cast<Py_ssize_t>(self->p_svfs->config().coverage_page_size),
+            "dense_gap", static_cast<Py_ssize_t>(self->p_svfs->config().dense_gap),
+            "spill_capacity", static_cast<Py_ssize_t>(self->p_svfs->config().spill_capacity),
+            "spill_directory", self->p_svfs->config().spill_directory.c_str()
     );
     return ret;
 }
@@ -1417,6 +3353,7 @@ cp_SparseVirtualFileSystem_config(cp_SparseVirtualFileSystem *self) {
 static Py_ssize_t
 cp_SparseVirtualFileSystem_mapping_length(PyObject * self) {
     ASSERT_FUNCTION_ENTRY_SVFS(p_svfs);
+    AcquireLockSVFS _lock((cp_SparseVirtualFileSystem *) self);
     try {
         return ((cp_SparseVirtualFileSystem *) self)->p_svfs->size();
     } catch (const std::exception &err) {
@@ -1451,6 +3388,11 @@ static PyMethodDef cp_SparseVirtualFileSystem_methods[] = {
                                                                                                      METH_KEYWORDS,
                         cp_SparseVirtualFileSystem_has_docstring
         },
+        {
+                "open",                  (PyCFunction) cp_SparseVirtualFileSystem_open,              METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystem_open_docstring
+        },
         {
                 "total_size_of",         (PyCFunction) cp_SparseVirtualFileSystem_total_size_of,     METH_NOARGS,
                 cp_SparseVirtualFileSystem_total_size_of_docstring
@@ -1478,6 +3420,36 @@ static PyMethodDef cp_SparseVirtualFileSystem_methods[] = {
                                                                                                      METH_KEYWORDS,
                         cp_SparseVirtualFileSystem_svf_read_docstring
         },
+        {
+                "read_view",             (PyCFunction) cp_SparseVirtualFileSystem_svf_read_view,     METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystem_svf_read_view_docstring
+        },
+        {
+                "read_into",             (PyCFunction) cp_SparseVirtualFileSystem_svf_read_into,     METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystem_svf_read_into_docstring
+        },
+        {
+                "write_many",            (PyCFunction) cp_SparseVirtualFileSystem_svf_write_many,    METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystem_svf_write_many_docstring
+        },
+        {
+                "read_many",             (PyCFunction) cp_SparseVirtualFileSystem_svf_read_many,     METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystem_svf_read_many_docstring
+        },
+        {
+                "has_data_many",         (PyCFunction) cp_SparseVirtualFileSystem_svf_has_data_many, METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystem_svf_has_data_many_docstring
+        },
+        {
+                "read_through",          (PyCFunction) cp_SparseVirtualFileSystem_svf_read_through,  METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystem_svf_read_through_docstring
+        },
         {
                 "erase",                 (PyCFunction) cp_SparseVirtualFileSystem_svf_erase,         METH_VARARGS |
                                                                                                      METH_KEYWORDS,
@@ -1493,12 +3465,22 @@ static PyMethodDef cp_SparseVirtualFileSystem_methods[] = {
                                                                                                      METH_KEYWORDS,
                         cp_SparseVirtualFileSystem_svf_need_many_docstring
         },
+        {
+                "need_array",            (PyCFunction) cp_SparseVirtualFileSystem_svf_need_array,    METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystem_svf_need_array_docstring
+        },
         // ---- Meta information about the specific SVF ----
         {
                 "blocks",                (PyCFunction) cp_SparseVirtualFileSystem_svf_blocks,        METH_VARARGS |
                                                                                                      METH_KEYWORDS,
                         cp_SparseVirtualFileSystem_svf_blocks_docstring
         },
+        {
+                "blocks_array",          (PyCFunction) cp_SparseVirtualFileSystem_svf_blocks_array,  METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystem_svf_blocks_array_docstring
+        },
         {
                 "size_of",               (PyCFunction) cp_SparseVirtualFileSystem_svf_size_of,       METH_VARARGS |
                                                                                                      METH_KEYWORDS,
@@ -1565,6 +3547,12 @@ static PyMethodDef cp_SparseVirtualFileSystem_methods[] = {
                                                                                                      METH_KEYWORDS,
                         cp_SparseVirtualFileSystem_svf_block_touches_docstring
         },
+        {
+                "block_touches_array",   (PyCFunction) cp_SparseVirtualFileSystem_svf_block_touches_array,
+                                                                                                     METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystem_svf_block_touches_array_docstring
+        },
         {
                 "lru_punt",              (PyCFunction) cp_SparseVirtualFileSystem_svf_lru_punt,      METH_VARARGS |
                                                                                                      METH_KEYWORDS,
@@ -1575,6 +3563,53 @@ static PyMethodDef cp_SparseVirtualFileSystem_methods[] = {
                                                                                                      METH_KEYWORDS,
                         cp_SparseVirtualFileSystem_svf_lru_punt_all_docstring
         },
+        {
+                "compact",               (PyCFunction) cp_SparseVirtualFileSystem_compact,           METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystem_compact_docstring
+        },
+        {
+                "set_budget",            (PyCFunction) cp_SparseVirtualFileSystem_set_budget,        METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystem_set_budget_docstring
+        },
+        {
+                "budget",                (PyCFunction) cp_SparseVirtualFileSystem_budget,            METH_NOARGS,
+                        cp_SparseVirtualFileSystem_budget_docstring
+        },
+        {
+                "evict",                 (PyCFunction) cp_SparseVirtualFileSystem_evict,             METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystem_evict_docstring
+        },
+        {
+                "save",                  (PyCFunction) cp_SparseVirtualFileSystem_save,              METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystem_save_docstring
+        },
+        {
+                "load",                  (PyCFunction) cp_SparseVirtualFileSystem_load,              METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystem_load_docstring
+        },
+        {
+                "journal_open",          (PyCFunction) cp_SparseVirtualFileSystem_journal_open,      METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystem_journal_open_docstring
+        },
+        {
+                "journal_flush",         (PyCFunction) cp_SparseVirtualFileSystem_journal_flush,     METH_NOARGS,
+                cp_SparseVirtualFileSystem_journal_flush_docstring
+        },
+        {
+                "journal_close",         (PyCFunction) cp_SparseVirtualFileSystem_journal_close,     METH_NOARGS,
+                cp_SparseVirtualFileSystem_journal_close_docstring
+        },
+        {
+                "checkpoint",            (PyCFunction) cp_SparseVirtualFileSystem_checkpoint,        METH_VARARGS |
+                                                                                                     METH_KEYWORDS,
+                        cp_SparseVirtualFileSystem_checkpoint_docstring
+        },
         {NULL, NULL, 0, NULL}  /* Sentinel */
 };
 
@@ -1591,6 +3626,12 @@ PyDoc_STRVAR(
         "This class implements a Sparse Virtual File System where Sparse Virtual Files are mapped to a key (a string).\n"
         "This can be constructed with an optional boolean overwrite flag that ensures in-memory data is overwritten"
         " on destruction of any SVF."
+        " The optional ``coverage_page_size``, ``dense_gap``, ``spill_capacity`` and ``spill_directory`` are passed"
+        " to every SVF, see ``svfsc.cSVF``."
+        " All the SVFs share one spill file of ``spill_capacity`` bytes."
+        " If ``budget`` is non-zero then ``write()`` evicts the least recently used blocks of any SVF to keep"
+        " ``total_bytes()`` within that many bytes, evicting at most ``evict_max_blocks`` blocks per write if that is"
+        " non-zero, see ``set_budget()``."
 );
 // clang-format on
 // @formatter.on
@@ -106,6 +106,20 @@ PyInit_svfsc(void)
         return NULL;
     }
 
+    if (PyType_Ready(&svfsc_cSVFBuffer) < 0) {
+        return NULL;
+    }
+
+    if (PyType_Ready(&svfsc_cSVFSBuffer) < 0) {
+        return NULL;
+    }
+
+    if (PyType_Ready(&svfsc_cSVFSHandle) < 0) {
+        return NULL;
+    }
+    Py_INCREF(&svfsc_cSVFSHandle);
+    PyModule_AddObject(m, "cSVFSHandle", (PyObject *) &svfsc_cSVFSHandle);
+
     if (PyType_Ready(&svfsc_cSVF) < 0) {
         return NULL;
     }
@@ -47,5 +47,50 @@
 
 #endif
 
+/// Release the GIL around C++ copies of at least this many bytes.
+static const size_t PY_RELEASE_GIL_BYTES = 64 * 1024;
+/// Release the GIL around C++ operations over at least this many blocks.
+static const size_t PY_RELEASE_GIL_BLOCKS = 1024;
+
+#ifdef PY_THREAD_SAFE
+/**
+ * @brief Release the GIL for the lifetime of this object, typically around a long copy in C++.
+ *
+ * This is exception safe as the GIL is re-acquired when the stack unwinds.
+ * This must only be used when the Python object lock is held so that other threads can not change the object,
+ * the C++ object does not need to be built with \c SVF_THREAD_SAFE.
+ * No Python API may be called while this exists.
+ */
+class ReleaseGIL {
+public:
+    /**
+     * Release the GIL.
+     *
+     * @param release If false this does nothing, for work that is too small to be worth the switch.
+     */
+    explicit ReleaseGIL(bool release = true) : _save(release ? PyEval_SaveThread() : NULL) {}
+
+    ~ReleaseGIL() {
+        if (_save) {
+            PyEval_RestoreThread(_save);
+        }
+    }
+
+    /// Eliminate copying.
+    ReleaseGIL(const ReleaseGIL &rhs) = delete;
+
+    /// Eliminate copying.
+    ReleaseGIL &operator=(const ReleaseGIL &rhs) = delete;
+
+private:
+    PyThreadState *_save;
+};
+#else
+/** Make the class a NOP as, without the object lock, the GIL is all that protects the object. */
+class ReleaseGIL {
+public:
+    explicit ReleaseGIL(bool = true) {}
+};
+#endif
 
 #endif //CPPSVF_CP_SVFS_H
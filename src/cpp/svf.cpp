@@ -37,6 +37,8 @@
 #include <set>
 
 #include "svf.h"
+#include "svf_journal.h"
+#include "svf_spill.h"
 
 namespace SVFS {
     /**
@@ -44,11 +46,365 @@ namespace SVFS {
      */
     static const char OVERWRITE_CHAR = '0';
 
+    /**
+     * @brief The number of 64 bit words needed for a bitmap of the given number of bits.
+     */
+    static inline size_t bits_words(size_t num_bits) {
+        return (num_bits + 63) / 64;
+    }
+
+    /**
+     * @brief The mask of the bits in a single word between \c begin and \c end, both in the range [0, 64].
+     */
+    static inline uint64_t bits_mask(size_t begin, size_t end) {
+        uint64_t mask = end == 64 ? ~static_cast<uint64_t>(0) : (static_cast<uint64_t>(1) << end) - 1;
+        return mask & (~static_cast<uint64_t>(0) << begin);
+    }
+
+    /**
+     * @brief Set or clear the bits in the range [begin, end).
+     */
+    static void bits_set(std::vector<uint64_t> &bits, size_t begin, size_t end, bool value) {
+        while (begin < end) {
+            size_t bit = begin & 63;
+            size_t bit_end = std::min(static_cast<size_t>(64), bit + (end - begin));
+            if (value) {
+                bits[begin >> 6] |= bits_mask(bit, bit_end);
+            } else {
+                bits[begin >> 6] &= ~bits_mask(bit, bit_end);
+            }
+            begin += bit_end - bit;
+        }
+    }
+
+    /**
+     * @brief Returns the count of set bits in the range [begin, end).
+     */
+    static size_t bits_count(const std::vector<uint64_t> &bits, size_t begin, size_t end) {
+        size_t ret = 0;
+        while (begin < end) {
+            size_t bit = begin & 63;
+            size_t bit_end = std::min(static_cast<size_t>(64), bit + (end - begin));
+            ret += __builtin_popcountll(bits[begin >> 6] & bits_mask(bit, bit_end));
+            begin += bit_end - bit;
+        }
+        return ret;
+    }
+
+    /**
+     * @brief Returns the index of the first bit in the range [begin, end) that has the given value, or \c end.
+     */
+    static size_t bits_find(const std::vector<uint64_t> &bits, size_t begin, size_t end, bool value) {
+        while (begin < end) {
+            uint64_t word = value ? bits[begin >> 6] : ~bits[begin >> 6];
+            word >>= (begin & 63);
+            if (word) {
+                return std::min(end, begin + __builtin_ctzll(word));
+            }
+            begin = (begin | 63) + 1;
+        }
+        return end;
+    }
+
+    /**
+     * @brief Returns the index of the last set bit in the range [0, end), the range must contain a set bit.
+     */
+    static size_t bits_find_last(const std::vector<uint64_t> &bits, size_t end) {
+        assert(end);
+        size_t index = end - 1;
+        uint64_t word = bits[index >> 6] & bits_mask(0, (index & 63) + 1);
+        while (!word) {
+            assert(index >= 64);
+            index = (index | 63) - 64;
+            word = bits[index >> 6];
+        }
+        return (index | 63) - __builtin_clzll(word);
+    }
+
+#pragma mark - Block values
+
+    /**
+     * @brief Add the change from the previous value to the new value to an atomic total and update the previous value.
+     */
+    static inline void totals_add(std::atomic<size_t> &total, size_t &value_previous, size_t value_new) noexcept {
+        if (value_new != value_previous) {
+            // Unsigned wrap around makes this a subtraction if the value has fallen.
+            total.fetch_add(value_new - value_previous, std::memory_order_relaxed);
+            value_previous = value_new;
+        }
+    }
+
+    /**
+     * @brief Allocate heap storage for the given capacity with the capacity stored in front of the data.
+     */
+    static char *block_allocate(size_t capacity) {
+        char *buffer = new char[sizeof(size_t) + capacity];
+        std::memcpy(buffer, &capacity, sizeof(size_t));
+        return buffer + sizeof(size_t);
+    }
+
+    /**
+     * @brief Release heap storage allocated with \c block_allocate().
+     */
+    static void block_deallocate(char *ptr) noexcept {
+        delete[] (ptr - sizeof(size_t));
+    }
+
+    BlockValue::BlockValue(BlockValue &&other) noexcept: block_touch(0), m_inline_size(0) {
+        _steal(other);
+    }
+
+    BlockValue &BlockValue::operator=(BlockValue &&other) noexcept {
+        if (this != &other) {
+            _free();
+            _steal(other);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Take the contents of another, empty, value leaving the other empty.
+     */
+    void BlockValue::_steal(BlockValue &other) noexcept {
+        assert(_is_inline() && m_inline_size == 0);
+        block_touch = other.block_touch;
+        m_inline_size = other.m_inline_size;
+        if (other._is_inline()) {
+            std::memcpy(m_inline, other.m_inline, other.m_inline_size);
+        } else {
+            m_heap = other.m_heap;
+        }
+        other.m_inline_size = 0;
+    }
+
+    size_t BlockValue::capacity() const noexcept {
+        if (_is_inline()) {
+            return INLINE_CAPACITY;
+        }
+        size_t ret;
+        std::memcpy(&ret, m_heap.ptr - sizeof(size_t), sizeof(size_t));
+        return ret;
+    }
+
+    /**
+     * @brief Move the data to heap storage of exactly the given capacity which must be at least the size.
+     */
+    void BlockValue::_reallocate(size_t new_capacity) {
+        assert(new_capacity >= size());
+        char *ptr = block_allocate(new_capacity);
+        const size_t old_size = size();
+        std::memcpy(ptr, data(), old_size);
+        if (_is_inline()) {
+            m_heap.bitmap = nullptr;
+        } else {
+            block_deallocate(m_heap.ptr);
+        }
+        m_heap.ptr = ptr;
+        m_heap.size = old_size;
+        m_inline_size = HEAP_TAG;
+    }
+
+    /**
+     * @brief Release any heap storage leaving an empty inline value.
+     */
+    void BlockValue::_free() noexcept {
+        if (!_is_inline()) {
+            block_deallocate(m_heap.ptr);
+            delete m_heap.bitmap;
+        }
+        m_inline_size = 0;
+    }
+
+    void BlockValue::reserve(size_t new_capacity) {
+        if (new_capacity > capacity()) {
+            _reallocate(new_capacity);
+        }
+    }
+
+    void BlockValue::resize(size_t new_size) {
+        const size_t old_size = size();
+        if (new_size > capacity()) {
+            // Grow geometrically as std::vector does.
+            _reallocate(std::max(new_size, 2 * old_size));
+        }
+        if (new_size > old_size) {
+            std::memset(data() + old_size, 0, new_size - old_size);
+        }
+        if (_is_inline()) {
+            m_inline_size = static_cast<uint32_t>(new_size);
+        } else {
+            m_heap.size = new_size;
+        }
+    }
+
+    void BlockValue::assign(size_t count, char value) {
+        resize(count);
+        std::memset(data(), value, count);
+    }
+
+    void BlockValue::push_back(char value) {
+        const size_t old_size = size();
+        if (old_size == capacity()) {
+            _reallocate(2 * old_size);
+        }
+        data()[old_size] = value;
+        if (_is_inline()) {
+            ++m_inline_size;
+        } else {
+            ++m_heap.size;
+        }
+    }
+
+    void BlockValue::append(const char *p, size_t count) {
+        const size_t old_size = size();
+        if (old_size + count > capacity()) {
+            _reallocate(std::max(old_size + count, 2 * old_size));
+        }
+        std::memcpy(data() + old_size, p, count);
+        if (_is_inline()) {
+            m_inline_size += static_cast<uint32_t>(count);
+        } else {
+            m_heap.size += count;
+        }
+    }
+
+    void BlockValue::erase_front(size_t count) noexcept {
+        assert(count <= size());
+        std::memmove(data(), data() + count, size() - count);
+        if (_is_inline()) {
+            m_inline_size -= static_cast<uint32_t>(count);
+        } else {
+            m_heap.size -= count;
+        }
+    }
+
+    void BlockValue::shrink_to_fit() {
+        if (_is_inline()) {
+            return;
+        }
+        if (m_heap.bitmap && m_heap.bitmap->empty()) {
+            clear_bitmap();
+        } else if (m_heap.bitmap) {
+            m_heap.bitmap->shrink_to_fit();
+        }
+        if (m_heap.size <= INLINE_CAPACITY && !m_heap.bitmap) {
+            char *ptr = m_heap.ptr;
+            const size_t old_size = m_heap.size;
+            std::memcpy(m_inline, ptr, old_size);
+            block_deallocate(ptr);
+            m_inline_size = static_cast<uint32_t>(old_size);
+        } else if (m_heap.size != capacity()) {
+            _reallocate(m_heap.size);
+        }
+    }
+
+    size_t BlockValue::heap_bytes() const noexcept {
+        if (_is_inline()) {
+            return 0;
+        }
+        size_t ret = sizeof(size_t) + capacity();
+        if (m_heap.bitmap) {
+            ret += sizeof(std::vector<uint64_t>) + m_heap.bitmap->capacity() * sizeof(uint64_t);
+        }
+        return ret;
+    }
+
+    std::vector<uint64_t> &BlockValue::bitmap() {
+        if (_is_inline()) {
+            // A bitmap is only held with heap storage.
+            _reallocate(INLINE_CAPACITY + 1);
+        }
+        if (!m_heap.bitmap) {
+            m_heap.bitmap = new std::vector<uint64_t>();
+        }
+        return *m_heap.bitmap;
+    }
+
+    const std::vector<uint64_t> &BlockValue::bitmap() const noexcept {
+        static const std::vector<uint64_t> empty_bitmap;
+        return has_bitmap() ? *m_heap.bitmap : empty_bitmap;
+    }
+
+    void BlockValue::clear_bitmap() noexcept {
+        if (!_is_inline()) {
+            delete m_heap.bitmap;
+            m_heap.bitmap = nullptr;
+        }
+    }
+
+#pragma mark - The SVF class
+
+    /**
+     * @brief Create a Sparse Virtual File.
+     *
+     * This will raise an ExceptionSparseVirtualFile if the configuration is invalid.
+     * Any spill file is not created until the first block is punted to it.
+     *
+     * @param id The identifier for this file.
+     * @param mod_time The modification time of the remote file in UNIX seconds, this is used for integrity checking.
+     * @param config See \c SVFS::SparseVirtualFileConfig.
+     */
+    SparseVirtualFile::SparseVirtualFile(const std::string &id, double mod_time,
+                                         const tSparseVirtualFileConfig &config) :
+            m_id(id),
+            m_file_mod_time(mod_time),
+            m_config(config),
+            m_bytes_total(0),
+            m_count_write(0),
+            m_count_read(0),
+            m_bytes_write(0),
+            m_bytes_read(0),
+            m_time_write(std::chrono::time_point<std::chrono::system_clock>::min()),
+            m_time_read(std::chrono::time_point<std::chrono::system_clock>::min()),
+            m_block_touch(0),
+            m_blocks_erased(0),
+            m_bytes_erased(0),
+            m_blocks_punted(0),
+            m_bytes_punted(0) {
+        if (m_config.coverage_page_size) {
+            if (m_config.coverage_page_size & (m_config.coverage_page_size - 1)) {
+                std::ostringstream os;
+                os << "SparseVirtualFile::SparseVirtualFile():";
+                os << " coverage_page_size " << m_config.coverage_page_size << " is not a power of two.";
+                throw Exceptions::ExceptionSparseVirtualFile(os.str());
+            }
+            while ((static_cast<size_t>(1) << m_coverage_page_shift) < m_config.coverage_page_size) {
+                ++m_coverage_page_shift;
+            }
+        }
+    }
+
+    SparseVirtualFile::SparseVirtualFile(const std::string &id, double mod_time, t_block_values &&blocks,
+                                         const tSparseVirtualFileConfig &config) :
+            SparseVirtualFile(id, mod_time, config) {
+        load_blocks(std::move(blocks));
+    }
+
+#ifndef SVF_THREAD_SAFE
+
+    SparseVirtualFile::SparseVirtualFile(SparseVirtualFile &&other) = default;
+
+    SparseVirtualFile &SparseVirtualFile::operator=(SparseVirtualFile &&rhs) = default;
+
+#endif
+
+    /** @brief Destruction clears the internal map, this is not journalled. */
+    SparseVirtualFile::~SparseVirtualFile() {
+        m_journal = nullptr;
+        clear();
+        _totals_unlink_no_lock();
+    }
+
     /**
      * @brief Returns \c true if this SVF already contains this data.
      *
      * If \c false then \c need() can say what exactly is required.
      *
+     * If the coverage bitmap is enabled (see \c SVFS::SparseVirtualFileConfig) this is constant time when the
+     * pages spanned are wholly within a block, otherwise this searches the block map.
+     *
+     * If there is a spill file then data held there, or partly there and partly in memory, counts as present.
+     *
      * @param fpos File position.
      * @param len Read length.
      * @return \c true if this SVF already contains this data, \c false otherwise.
@@ -58,17 +414,38 @@ namespace SVFS {
 #ifdef SVF_THREAD_SAFE
         std::lock_guard<std::mutex> mutex(m_mutex);
 #endif
+        if (_has_no_lock(fpos, len)) {
+            return true;
+        }
+        if (m_spill && m_spill->num_blocks()) {
+            return _need_not_spilled_no_lock(fpos, len).empty();
+        }
+        return false;
+    }
 
+    /**
+     * @brief Returns \c true if the block map contains this data.
+     *
+     * This does not use the mutex.
+     *
+     * @param fpos File position.
+     * @param len Read length.
+     * @return \c true if this SVF already contains this data in memory, \c false otherwise.
+     */
+    bool SparseVirtualFile::_has_no_lock(t_fpos fpos, size_t len) const noexcept {
         if (m_svf.empty()) {
             return false;
         }
+        if (m_config.coverage_page_size && len && _coverage_has(fpos, len)) {
+            return true;
+        }
         t_map::const_iterator iter = m_svf.upper_bound(fpos);
         if (iter != m_svf.begin()) {
             --iter;
         }
         t_fpos fpos_end = _file_position_immediatly_after_block(iter);
         if (fpos >= iter->first && (fpos + len) <= fpos_end) {
-            return true;
+            return _is_held(iter, fpos - iter->first, len);
         }
         return false;
     }
@@ -87,12 +464,12 @@ namespace SVFS {
         assert(iter != m_svf.end());
         assert(m_config.compare_for_diff);
 
-        if (*data != iter->second.data[index_iter]) {
+        if (*data != iter->second[index_iter]) {
             std::ostringstream os;
             os << "SparseVirtualFile::write():";
             os << " Difference at position " << fpos;
-            os << " '" << *(data) << "' != '" << iter->second.data[index_iter] << "'";
-            os << " Ordinal " << static_cast<int>(*data) << " != " << static_cast<int>(iter->second.data[index_iter]);
+            os << " '" << *(data) << "' != '" << iter->second[index_iter] << "'";
+            os << " Ordinal " << static_cast<int>(*data) << " != " << static_cast<int>(iter->second[index_iter]);
             std::string str = os.str();
             throw Exceptions::ExceptionSparseVirtualFileDiff(str);
         }
@@ -114,11 +491,11 @@ namespace SVFS {
         assert(m_svf.count(fpos) == 0);
 
         t_val new_value;
-        new_value.data.reserve(len);
-        new_value.block_touch = m_block_touch++;
+        new_value.reserve(len);
+        new_value.block_touch = _next_block_touch();
 
         // A simpler call thant the loop but not necessarily faster. See git commit 2024-08-28
-        new_value.data.insert(new_value.data.end(), data, data + len);
+        new_value.append(data, len);
         m_bytes_total += len;
 
         auto size_before_insert = m_svf.size();
@@ -185,31 +562,31 @@ namespace SVFS {
         size_t fpos_start = fpos;
         size_t fpos_end = fpos + len;
         t_val new_value;
-        new_value.block_touch = m_block_touch++;
+        new_value.block_touch = _next_block_touch();
 
         while (true) {
             while (len && fpos < iter->first) {
                 // Copy new data 'X' up to start of iter.
                 //       ^===========|  |=====|
                 //  %XXXX+++++++++++++XX++|
-                new_value.data.push_back(*data);
+                new_value.push_back(*data);
                 ++data;
                 ++fpos;
                 --len;
                 ++m_bytes_total;
             }
             size_t index_iter = 0;
-            size_t delta = std::min(len, iter->second.data.size());
+            size_t delta = std::min(len, iter->second.size());
             // Check overlapped data matches 'Y'
             //       ^===========|  |=====|
             //  %++++YYYYYYYYYYYYY++++|
             if (m_config.compare_for_diff) {
-                if (std::memcmp(iter->second.data.data(), data, delta) != 0) {
+                if (std::memcmp(iter->second.data(), data, delta) != 0) {
                     _throw_diff(fpos, data, iter, 0);
                 }
             }
             for (size_t i = 0; i < delta; ++i) {
-                new_value.data.push_back(*data);
+                new_value.push_back(*data);
                 ++data;
             }
             fpos += delta;
@@ -221,25 +598,25 @@ namespace SVFS {
                 //       ^=========ZZZ
                 //  %+++++++++++++|
                 // So append up to the end of iter and (maybe) go round again.
-                while (index_iter < iter->second.data.size()) {
-                    new_value.data.push_back(iter->second.data[index_iter]);
+                while (index_iter < iter->second.size()) {
+                    new_value.push_back(iter->second[index_iter]);
                     ++index_iter;
                 }
                 if (m_config.overwrite_on_exit) {
-                    iter->second.data.assign(iter->second.data.size(), OVERWRITE_CHAR);
+                    iter->second.assign(iter->second.size(), OVERWRITE_CHAR);
                 }
                 m_svf.erase(iter);
                 break;
             }
             // Remove copied and checked old block and move on.
             if (m_config.overwrite_on_exit) {
-                iter->second.data.assign(iter->second.data.size(), OVERWRITE_CHAR);
+                iter->second.assign(iter->second.size(), OVERWRITE_CHAR);
             }
             iter = m_svf.erase(iter);
             if (iter == m_svf.end() || iter->first > fpos + len) {
                 // Copy rest of new and break
                 while (len) {
-                    new_value.data.push_back(*data);
+                    new_value.push_back(*data);
                     ++data;
                     ++fpos;
                     --len;
@@ -328,9 +705,9 @@ namespace SVFS {
         size_t write_index_from_block_start = fpos - base_block_iter->first;
         // Do the check to end of new_data_len or end of base_block_iter which ever comes first.
         size_t len_check_or_copy = std::min(new_data_len,
-                                            base_block_iter->second.data.size() - write_index_from_block_start);
+                                            base_block_iter->second.size() - write_index_from_block_start);
         if (m_config.compare_for_diff) {
-            if (std::memcmp(base_block_iter->second.data.data() + write_index_from_block_start, new_data,
+            if (std::memcmp(base_block_iter->second.data() + write_index_from_block_start, new_data,
                             len_check_or_copy) != 0) {
                 _throw_diff(fpos, new_data, base_block_iter, write_index_from_block_start);
             }
@@ -343,7 +720,7 @@ namespace SVFS {
             if (next_block_iter == m_svf.end()) {
                 // Termination case, copy remainder
                 while (new_data_len) {
-                    base_block_iter->second.data.push_back(*new_data);
+                    base_block_iter->second.push_back(*new_data);
                     ++new_data;
                     ++fpos;
                     --new_data_len;
@@ -353,7 +730,7 @@ namespace SVFS {
             } else {
                 // Copy the new_data up to start of next_block_iter or, we have exhausted the new_data.
                 while (new_data_len && fpos < next_block_iter->first) {
-                    base_block_iter->second.data.push_back(*new_data);
+                    base_block_iter->second.push_back(*new_data);
                     ++new_data;
                     ++fpos;
                     --new_data_len;
@@ -371,13 +748,13 @@ namespace SVFS {
             len_check_or_copy = std::min(new_data_len, _file_position_immediatly_after_block(next_block_iter) - fpos);
             if (len_check_or_copy) {
                 if (m_config.compare_for_diff) {
-                    if (std::memcmp(next_block_iter->second.data.data(), new_data, len_check_or_copy) != 0) {
+                    if (std::memcmp(next_block_iter->second.data(), new_data, len_check_or_copy) != 0) {
                         _throw_diff(fpos, new_data, base_block_iter, 0);
                     }
                 }
                 // We could push_back either the new_data or the existing next block data. We choose the former.
                 for (size_t i = 0; i < len_check_or_copy; ++i) {
-                    base_block_iter->second.data.push_back(*new_data);
+                    base_block_iter->second.push_back(*new_data);
                     ++new_data;
                     ++fpos;
                     --new_data_len;
@@ -388,18 +765,18 @@ namespace SVFS {
             // If new_data is exhausted then copy remaining from next_block_iter to base_block_iter.
             // Do not increment m_bytes_total as this is existing new_data.
             if (new_data_len == 0) {
-                while (write_index_from_block_start < next_block_iter->second.data.size()) {
-                    base_block_iter->second.data.push_back(next_block_iter->second.data[write_index_from_block_start]);
+                while (write_index_from_block_start < next_block_iter->second.size()) {
+                    base_block_iter->second.push_back(next_block_iter->second[write_index_from_block_start]);
                     ++write_index_from_block_start;
                 }
             }
             // New data is not exhausted so erase next_block_iter as we have copied it and move on to the next block.
             if (m_config.overwrite_on_exit) {
-                next_block_iter->second.data.assign(next_block_iter->second.data.size(), OVERWRITE_CHAR);
+                next_block_iter->second.assign(next_block_iter->second.size(), OVERWRITE_CHAR);
             }
             next_block_iter = m_svf.erase(next_block_iter);
         }
-        base_block_iter->second.block_touch = m_block_touch++;
+        base_block_iter->second.block_touch = _next_block_touch();
         assert(new_data_len == 0);
 #ifdef DEBUG
         assert(fpos == fpos_end);
@@ -455,43 +832,216 @@ namespace SVFS {
         std::lock_guard<std::mutex> mutex(m_mutex);
 #endif
         // TODO: throw if !data, len == 0
-        if (m_svf.empty() || fpos > _file_position_immediatly_after_end()) {
-            // Simple insert of new data into empty map or a node beyond the end (common case).
-            _write_new_block(fpos, data, len, m_svf.begin());
+        _write_no_lock(fpos, data, len);
+        if (m_journal) {
+            m_journal->write(m_id, fpos, data, len);
+        }
+        // Update internals.
+        // NOTE: m_block_touch is incremented in one of the three actual write methods.
+        m_count_write += 1;
+        m_bytes_write += len;
+        m_time_write = std::chrono::system_clock::now();
+        _totals_update_no_lock();
+        SVF_ASSERT(integrity() == ERROR_NONE);
+    }
+
+    /**
+     * @brief Write a block that starts beyond the end of every existing block.
+     *
+     * This is intended for restoring blocks that are already sorted and not touching, for example when unpickling.
+     * The new block is inserted at the end of the map without searching or coalescing.
+     * If the block does not start beyond the end of the last block, or dense regions are configured, this falls back
+     * to \c write().
+     *
+     * This updates the write statistics in the same way as \c write().
+     *
+     * If ``SVF_THREAD_SAFE`` is defined then this will acquire a lock on this ``SparseVirtualFile``.
+     *
+     * @param fpos The file position to write to.
+     * @param data The data, assumed to be of the given length.
+     * @param len The length to the data to write.
+     */
+    void SparseVirtualFile::append(t_fpos fpos, const char *data, size_t len) {
+        SVF_ASSERT(integrity() == ERROR_NONE);
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        if (m_config.dense_gap || !(m_svf.empty() || fpos > _file_position_immediatly_after_end())) {
+            _write_no_lock(fpos, data, len);
         } else {
-            t_map::iterator iter = m_svf.upper_bound(fpos);
-            if (iter != m_svf.begin()) {
-                --iter;
-            }
-            if (iter->first > fpos) {
-                // Insert new block, possibly coalescing existing blocks.
-                // New comes earlier so either create a new block or copy existing block on to it.
-                if (iter->first <= fpos + len) {
-                    // Need to coalesce
-                    _write_new_append_old(fpos, data, len, iter);
+            m_compact_clean = false;
+            _write_new_block(fpos, data, len, m_svf.cend());
+            m_heap_bytes += m_svf.crbegin()->second.heap_bytes();
+            m_num_blocks += 1;
+            if (m_config.coverage_page_size) {
+                _coverage_add(fpos, len);
+            }
+        }
+        if (m_journal) {
+            m_journal->write(m_id, fpos, data, len);
+        }
+        m_count_write += 1;
+        m_bytes_write += len;
+        m_time_write = std::chrono::system_clock::now();
+        _totals_update_no_lock();
+        SVF_ASSERT(integrity() == ERROR_NONE);
+    }
+
+    /**
+     * @brief Bulk load blocks that are already sorted, do not overlap and do not touch.
+     *
+     * This is intended for restoring a SVF, for example when unpickling, from a snapshot or from a peer.
+     * The blocks are validated in a single pass and, if any are empty, out of order, overlap or touch each other or
+     * the existing blocks, this throws an ExceptionSparseVirtualFileWrite and the SVF is unchanged.
+     * Each block value is then moved to the end of the map, no data is copied, and there is no searching, coalescing
+     * or comparison of data.
+     * If dense regions are configured the blocks are written with \c write() instead.
+     *
+     * The write count and the bytes written are updated as if each block had been written but the write time is
+     * updated only once.
+     *
+     * If ``SVF_THREAD_SAFE`` is defined then this will acquire a lock on this ``SparseVirtualFile``.
+     *
+     * @param blocks The blocks, these are moved into the SVF and the vector is cleared.
+     */
+    void SparseVirtualFile::load_blocks(t_block_values &&blocks) {
+        SVF_ASSERT(integrity() == ERROR_NONE);
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        // Validate everything first so that a failure leaves the SVF unchanged.
+        bool has_previous = !m_svf.empty();
+        t_fpos fpos_next = _file_position_immediatly_after_end();
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            const auto &block = blocks[i];
+            if (block.second.empty() || block.second.has_bitmap() || (has_previous && block.first <= fpos_next)) {
+                std::ostringstream os;
+                os << "SparseVirtualFile::load_blocks():";
+                os << " Block " << i << " at " << block.first << " length " << block.second.size();
+                if (block.second.empty()) {
+                    os << " is empty.";
+                } else if (block.second.has_bitmap()) {
+                    os << " is a dense region.";
                 } else {
-                    // The new block precedes the old one
-                    _write_new_block(fpos, data, len, iter);
+                    os << " is not beyond the previous block that ends at " << fpos_next << ".";
                 }
+                throw Exceptions::ExceptionSparseVirtualFileWrite(os.str());
+            }
+            has_previous = true;
+            fpos_next = block.first + block.second.size();
+        }
+        size_t bytes_loaded = 0;
+        for (auto &block: blocks) {
+            const size_t len = block.second.size();
+            if (m_config.dense_gap) {
+                _write_no_lock(block.first, block.second.data(), len);
             } else {
-                // Existing block.first is <= fpos
-                if (fpos > _file_position_immediatly_after_block(iter)) {
-                    // No overlap so just write new block after the last one
-                    _write_new_block(fpos, data, len, m_svf.end());
-                } else {
-                    // Append new to existing block, possibly coalescing existing blocks.
-                    _write_append_new_to_old(fpos, data, len, iter);
+                block.second.block_touch = _next_block_touch();
+                auto iter = m_svf.emplace_hint(m_svf.cend(), block.first, std::move(block.second));
+                m_bytes_total += len;
+                m_heap_bytes += iter->second.heap_bytes();
+                m_num_blocks += 1;
+                if (m_config.coverage_page_size) {
+                    _coverage_add(block.first, len);
                 }
             }
+            if (m_journal) {
+                const char *data = m_config.dense_gap ? block.second.data() : m_svf.crbegin()->second.data();
+                m_journal->write(m_id, block.first, data, len);
+            }
+            bytes_loaded += len;
         }
-        // Update internals.
-        // NOTE: m_block_touch is incremented in one of the three actual write methods.
-        m_count_write += 1;
-        m_bytes_write += len;
-        m_time_write = std::chrono::system_clock::now();
+        if (!blocks.empty()) {
+            m_compact_clean = false;
+            m_count_write += blocks.size();
+            m_bytes_write += bytes_loaded;
+            m_time_write = std::chrono::system_clock::now();
+        }
+        blocks.clear();
+        _totals_update_no_lock();
         SVF_ASSERT(integrity() == ERROR_NONE);
     }
 
+    /**
+     * @brief Write data to the block map, coalescing as necessary, without updating the write statistics.
+     *
+     * This does not use the mutex.
+     *
+     * @param fpos The file position to write to.
+     * @param data The data, assumed to be of the given length.
+     * @param len The length to the data to write.
+     */
+    void SparseVirtualFile::_write_no_lock(t_fpos fpos, const char *data, size_t len) {
+        m_compact_clean = false;
+        // Only the entries within the gap of the new data can change.
+        const t_fpos fpos_begin = fpos - std::min(fpos, static_cast<t_fpos>(m_config.dense_gap));
+        const t_fpos fpos_end = fpos + len + m_config.dense_gap;
+        const size_t heap_bytes_before = _count_heap_bytes(fpos_begin, fpos_end);
+        // Every block that overlaps or touches the new data is joined with it into one block.
+        const size_t blocks_joined = m_config.dense_gap && len ? _count_runs(fpos - (fpos > 0), fpos + len + 1) : 0;
+        try {
+            if (m_config.dense_gap) {
+                _write_dense(fpos, data, len);
+            } else if (m_svf.empty() || fpos > _file_position_immediatly_after_end()) {
+                // Simple insert of new data into empty map or a node beyond the end (common case).
+                _write_new_block(fpos, data, len, m_svf.begin());
+            } else {
+                t_map::iterator iter = m_svf.upper_bound(fpos);
+                if (iter != m_svf.begin()) {
+                    --iter;
+                }
+                if (iter->first > fpos) {
+                    // Insert new block, possibly coalescing existing blocks.
+                    // New comes earlier so either create a new block or copy existing block on to it.
+                    if (iter->first <= fpos + len) {
+                        // Need to coalesce
+                        _write_new_append_old(fpos, data, len, iter);
+                    } else {
+                        // The new block precedes the old one
+                        _write_new_block(fpos, data, len, iter);
+                    }
+                } else {
+                    // Existing block.first is <= fpos
+                    if (fpos > _file_position_immediatly_after_block(iter)) {
+                        // No overlap with this block but the new data might reach the next block.
+                        t_map::iterator iter_next = std::next(iter);
+                        if (iter_next != m_svf.end() && iter_next->first <= fpos + len) {
+                            // Need to coalesce with the next block.
+                            _write_new_append_old(fpos, data, len, iter_next);
+                        } else {
+                            // No overlap so just write new block after this one.
+                            _write_new_block(fpos, data, len, iter_next);
+                        }
+                    } else {
+                        // Append new to existing block, possibly coalescing existing blocks.
+                        _write_append_new_to_old(fpos, data, len, iter);
+                    }
+                }
+            }
+        } catch (const Exceptions::ExceptionSparseVirtualFileWrite &) {
+            // A failed write may have already coalesced some blocks so the coverage bitmap is recreated.
+            if (m_config.coverage_page_size) {
+                _coverage_rebuild();
+            }
+            // A dense region is unchanged by a failed write.
+            m_heap_bytes += _count_heap_bytes(fpos_begin, fpos_end) - heap_bytes_before;
+            if (!m_config.dense_gap) {
+                m_num_blocks = m_svf.size();
+            }
+            _totals_update_no_lock();
+            throw;
+        }
+        m_heap_bytes += _count_heap_bytes(fpos_begin, fpos_end) - heap_bytes_before;
+        if (!m_config.dense_gap) {
+            m_num_blocks = m_svf.size();
+        } else if (len) {
+            m_num_blocks += 1 - blocks_joined;
+        }
+        if (m_config.coverage_page_size) {
+            _coverage_add(fpos, len);
+        }
+    }
+
     /**
      * @brief Read data and write to the buffer provided by the caller.
      * This is non-const as it updates the non-const members such as @c m_block_touch etc.
@@ -504,8 +1054,51 @@ namespace SVFS {
 #ifdef SVF_THREAD_SAFE
         std::lock_guard<std::mutex> mutex(m_mutex);
 #endif
+        const char *data = _read_no_lock(fpos, len);
+        if (memcpy(p, data, len) != p) {
+            std::ostringstream os;
+            os << "SparseVirtualFile::read():";
+            os << " memcpy failed " << fpos << " length " << len;
+            throw Exceptions::ExceptionSparseVirtualFileRead(os.str());
+        }
+    }
+
+    /**
+     * @brief Read data without copying it, this returns a pointer to the data in the block.
+     *
+     * This updates the read statistics and block touch in the same way as \c read().
+     *
+     * @warning The pointer is only valid until the next change to the SVF, for example a \c write(), \c erase(),
+     * \c lru_punt(), \c compact() or \c clear(), or a \c read() that brings back data from the spill file.
+     * It is up to the caller to prevent those.
+     *
+     * @param fpos File position to start the read.
+     * @param len Length of the read.
+     * @return A pointer to \c len bytes of data.
+     */
+    const char *SparseVirtualFile::read_view(t_fpos fpos, size_t len) {
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        return _read_no_lock(fpos, len);
+    }
+
+    /**
+     * @brief Find the data to read and update the read statistics.
+     *
+     * This does not use the mutex.
+     *
+     * @param fpos File position to start the read.
+     * @param len Length of the read.
+     * @return A pointer to \c len bytes of data in the block.
+     */
+    const char *SparseVirtualFile::_read_no_lock(t_fpos fpos, size_t len) {
         SVF_ASSERT(integrity() == ERROR_NONE);
 
+        if (m_spill && m_spill->num_blocks()) {
+            _spill_promote_no_lock(fpos, len);
+            _totals_update_no_lock();
+        }
         if (m_svf.empty()) {
             throw Exceptions::ExceptionSparseVirtualFileRead(
                     "SparseVirtualFile::read(): Sparse virtual file is empty.");
@@ -522,28 +1115,33 @@ namespace SVFS {
             --iter;
             offset_into_block = fpos - iter->first;
         }
-        if (offset_into_block + len > iter->second.data.size()) {
+        if (offset_into_block + len > iter->second.size()) {
             std::ostringstream os;
             os << "SparseVirtualFile::read():";
             os << " Requested position " << fpos << " length " << len;
             os << " (end " << fpos + len << ")";
-            os << " overruns block that starts at " << iter->first << " has size " << iter->second.data.size();
-            os << " (end " << iter->first + iter->second.data.size() << ").";
+            os << " overruns block that starts at " << iter->first << " has size " << iter->second.size();
+            os << " (end " << iter->first + iter->second.size() << ").";
             os << " Offset into block is " << offset_into_block;
-            os << " overrun is " << offset_into_block + len - iter->second.data.size() << " bytes";
+            os << " overrun is " << offset_into_block + len - iter->second.size() << " bytes";
             throw Exceptions::ExceptionSparseVirtualFileRead(os.str());
         }
-        if (memcpy(p, iter->second.data.data() + offset_into_block, len) != p) {
+        if (!_is_held(iter, offset_into_block, len)) {
             std::ostringstream os;
             os << "SparseVirtualFile::read():";
-            os << " memcpy failed " << fpos << " length " << len;
-            throw Exceptions::ExceptionSparseVirtualFileRead(os.str());
+            os << " Requested position " << fpos << " length " << len;
+            os << " (end " << fpos + len << ")";
+            os << " is not wholly held by the dense region that starts at " << iter->first;
+            os << " has size " << iter->second.size();
+            os << " (end " << iter->first + iter->second.size() << ").";
+            throw Exceptions::ExceptionSparseVirtualFileRead(os.str());
         }
         // Adjust non-const members
-        iter->second.block_touch = m_block_touch++;
+        iter->second.block_touch = _next_block_touch();
         m_bytes_read += len;
         m_count_read += 1;
         m_time_read = std::chrono::system_clock::now();
+        return iter->second.data() + offset_into_block;
     }
 
     /**
@@ -573,6 +1171,10 @@ namespace SVFS {
      * It is up to the caller to handle this, however, @c reads() in C/C++/Python will ignore read lengths past EOF
      * so the caller does not have to do anything.
      *
+     * @note If there is a spill file then data held there is not needed.
+     *
+     * @note Ranges reserved by \c reserve_need() are being fetched so they are not needed either.
+     *
      * @param fpos File position at the start of the attempted read.
      * @param len Length of the attempted read.
      * @param greedy_length If greater than zero this makes greedy, fewer but larger, reads.
@@ -583,14 +1185,59 @@ namespace SVFS {
 #ifdef SVF_THREAD_SAFE
         std::lock_guard<std::mutex> mutex(m_mutex);
 #endif
+        if (m_in_flight.empty()) {
+            return _need_held_no_lock(fpos, len, greedy_length);
+        }
+        return _subtract_in_flight_no_lock(_need_held_no_lock(fpos, len, greedy_length), nullptr);
+    }
+
+    /**
+     * @brief What data is neither in the block map nor in the spill file, ignoring any ranges in flight.
+     *
+     * This does not use the mutex.
+     *
+     * @param fpos File position at the start of the attempted read.
+     * @param len Length of the attempted read.
+     * @param greedy_length If greater than zero this makes greedy, fewer but larger, reads.
+     * @return A vector of pairs (file_position, length) that this SVF needs.
+     */
+    t_seek_reads SparseVirtualFile::_need_held_no_lock(t_fpos fpos, size_t len, size_t greedy_length) const noexcept {
+        if (m_spill && m_spill->num_blocks()) {
+            t_seek_reads ret = _need_not_spilled_no_lock(fpos, len);
+            if (greedy_length && greedy_length > len && !ret.empty()) {
+                ret = _minimise_seek_reads(ret, greedy_length);
+            }
+            return ret;
+        }
         return _need_no_lock(fpos, len, greedy_length);
     }
 
+    /**
+     * @brief What data is neither in the block map nor in the spill file.
+     *
+     * This does not use the mutex.
+     *
+     * @param fpos File position at the start of the attempted read.
+     * @param len Length of the attempted read.
+     * @return A vector of pairs (file_position, length) that this SVF needs.
+     */
+    t_seek_reads SparseVirtualFile::_need_not_spilled_no_lock(t_fpos fpos, size_t len) const {
+        assert(m_spill);
+        return m_spill->subtract(_need_no_lock(fpos, len, 0));
+    }
+
     t_seek_reads SparseVirtualFile::_need_no_lock(t_fpos fpos, size_t len, size_t greedy_length) const noexcept {
         SVF_ASSERT(integrity() == ERROR_NONE);
         if (m_svf.empty()) {
             return {{fpos, greedy_length > len ? greedy_length : len}};
         }
+        if (m_config.coverage_page_size && len && _coverage_has(fpos, len)) {
+            // Everything is cached.
+            return {};
+        }
+        if (m_config.dense_gap) {
+            return _need_dense_no_lock(fpos, len, greedy_length);
+        }
         size_t original_len = len;
         t_fpos fpos_to = fpos + len;
         t_seek_reads ret;
@@ -660,8 +1307,8 @@ namespace SVFS {
             } else {
                 //          ^======|
                 //          |+++++++++|
-                fpos += iter->second.data.size();
-                len -= iter->second.data.size();
+                fpos += iter->second.size();
+                len -= iter->second.size();
             }
             ++iter;
         }
@@ -711,16 +1358,149 @@ namespace SVFS {
 #endif
 
         std::sort(seek_reads.begin(), seek_reads.end());
-        if (m_svf.empty()) {
+        const bool has_spill = m_spill && m_spill->num_blocks();
+        if (m_svf.empty() && !has_spill) {
             return _minimise_seek_reads(seek_reads, greedy_length);
         }
         t_seek_reads ret;
         for (const auto &iter_seek_read: seek_reads) {
-            for (const auto &iter_need: _need_no_lock(iter_seek_read.first, iter_seek_read.second, 0)) {
+            for (const auto &iter_need: has_spill ?
+                                        _need_not_spilled_no_lock(iter_seek_read.first, iter_seek_read.second) :
+                                        _need_no_lock(iter_seek_read.first, iter_seek_read.second, 0)) {
                 ret.emplace_back(iter_need);
             }
         }
-        return _minimise_seek_reads(ret, greedy_length);
+        if (m_in_flight.empty()) {
+            return _minimise_seek_reads(ret, greedy_length);
+        }
+        return _subtract_in_flight_no_lock(_minimise_seek_reads(ret, greedy_length), nullptr);
+    }
+
+    /**
+     * @brief As \c need() but the ranges returned are reserved for the caller to fetch.
+     *
+     * This is for many threads that might miss on the same data at the same time, only one of them fetches it.
+     * The ranges returned are neither held nor being fetched by another caller, they are now in flight and \c need()
+     * and \c reserve_need() by other callers exclude them until the caller gives them to \c release_need().
+     * The caller must do so whether or not the fetch succeeds, typically after writing the data.
+     *
+     * The futures of any ranges that are in flight and that the read needs are added to \c in_flight.
+     * Once they are ready the caller should call \c reserve_need() again as a fetch might have failed or fallen
+     * short at the end of the file, if so the range is returned to this caller to fetch.
+     *
+     * For example:
+     *
+     * @code
+     *  SVFS::t_in_flight_futures in_flight;
+     *  do {
+     *      in_flight.clear();
+     *      SVFS::t_seek_reads seek_reads = svf.reserve_need(fpos, len, 0, in_flight);
+     *      // Fetch and write seek_reads ...
+     *      svf.release_need(seek_reads);
+     *      for (const auto &future: in_flight) {
+     *          future.wait();
+     *      }
+     *  } while (! in_flight.empty() && ! svf.has(fpos, len));
+     * @endcode
+     *
+     * Futures should be waited on with \c wait() rather than \c get() as if the SVF is destroyed with ranges in
+     * flight their futures hold a \c std::future_error.
+     * A caller must not wait on the futures while it has ranges of its own reserved.
+     *
+     * @param fpos File position at the start of the attempted read.
+     * @param len Length of the attempted read.
+     * @param greedy_length If greater than zero this makes greedy, fewer but larger, reads.
+     * @param in_flight The futures of ranges being fetched by other callers are added to this.
+     * @return A vector of pairs (file_position, length) that this caller is to fetch.
+     */
+    t_seek_reads SparseVirtualFile::reserve_need(t_fpos fpos, size_t len, size_t greedy_length,
+                                                 t_in_flight_futures &in_flight) {
+        SVF_ASSERT(integrity() == ERROR_NONE);
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        t_seek_reads ret = _need_held_no_lock(fpos, len, greedy_length);
+        if (!m_in_flight.empty()) {
+            ret = _subtract_in_flight_no_lock(ret, &in_flight);
+        }
+        for (const auto &seek_read: ret) {
+            t_in_flight &value = m_in_flight[seek_read.first];
+            value.len = seek_read.second;
+            value.future = value.promise.get_future().share();
+        }
+        return ret;
+    }
+
+    /**
+     * @brief Release ranges reserved by \c reserve_need() which makes their futures ready.
+     *
+     * Ranges that are not reserved, for example released already, are ignored.
+     *
+     * @param seek_reads The vector of (file_position, length) from \c reserve_need().
+     */
+    void SparseVirtualFile::release_need(const t_seek_reads &seek_reads) noexcept {
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        for (const auto &seek_read: seek_reads) {
+            auto iter = m_in_flight.find(seek_read.first);
+            if (iter != m_in_flight.end() && iter->second.len == seek_read.second) {
+                iter->second.promise.set_value();
+                m_in_flight.erase(iter);
+            }
+        }
+    }
+
+    /**
+     * @brief The number of ranges reserved by \c reserve_need() and not yet released.
+     */
+    size_t SparseVirtualFile::num_in_flight() const noexcept {
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        return m_in_flight.size();
+    }
+
+    /**
+     * @brief Remove the ranges in flight from seek/reads.
+     *
+     * This does not use the mutex.
+     *
+     * @param seek_reads Sorted, non-overlapping (file_position, length) pairs, for example from \c need().
+     * @param in_flight If not \c nullptr the futures of the ranges in flight that overlap are added to this.
+     * @return The seek/reads less the ranges in flight.
+     */
+    t_seek_reads SparseVirtualFile::_subtract_in_flight_no_lock(const t_seek_reads &seek_reads,
+                                                                t_in_flight_futures *in_flight) const {
+        t_seek_reads ret;
+        // The last range in flight whose future was added so that it is only added once.
+        auto iter_added = m_in_flight.end();
+        for (const auto &seek_read: seek_reads) {
+            t_fpos fpos = seek_read.first;
+            t_fpos fpos_end = seek_read.first + seek_read.second;
+            auto iter = m_in_flight.upper_bound(fpos);
+            if (iter != m_in_flight.begin()) {
+                auto iter_prev = std::prev(iter);
+                if (iter_prev->first + iter_prev->second.len > fpos) {
+                    iter = iter_prev;
+                }
+            }
+            while (fpos < fpos_end && iter != m_in_flight.end() && iter->first < fpos_end) {
+                if (iter->first > fpos) {
+                    ret.emplace_back(fpos, iter->first - fpos);
+                }
+                if (in_flight && iter != iter_added) {
+                    in_flight->push_back(iter->second.future);
+                    iter_added = iter;
+                }
+                fpos = std::max(fpos, iter->first + iter->second.len);
+                ++iter;
+            }
+            if (fpos < fpos_end) {
+                ret.emplace_back(fpos, fpos_end - fpos);
+            }
+        }
+        return ret;
     }
 
     /**
@@ -781,7 +1561,17 @@ namespace SVFS {
 
         t_seek_reads ret;
         for (const auto &iter: m_svf) {
-            ret.emplace_back(iter.first, iter.second.data.size());
+            if (!iter.second.has_bitmap()) {
+                ret.emplace_back(iter.first, iter.second.size());
+            } else {
+                // Each run of held bytes in a dense region is a block.
+                size_t offset = 0;
+                while (offset < iter.second.size()) {
+                    size_t offset_end = bits_find(iter.second.bitmap(), offset, iter.second.size(), false);
+                    ret.emplace_back(iter.first + offset, offset_end - offset);
+                    offset = bits_find(iter.second.bitmap(), offset_end, iter.second.size(), true);
+                }
+            }
         }
         return ret;
     }
@@ -804,19 +1594,30 @@ namespace SVFS {
             throw Exceptions::ExceptionSparseVirtualFileRead(
                     "SparseVirtualFile::block_size(): Sparse virtual file is empty.");
         }
-        t_map::const_iterator iter = m_svf.find(fpos);
-        if (iter == m_svf.end()) {
-            std::ostringstream os;
-            os << "SparseVirtualFile::block_size():";
-            os << " Requested file position " << fpos << " is not at the start of a block";
-            throw Exceptions::ExceptionSparseVirtualFileRead(os.str());
+        t_map::const_iterator iter = m_svf.upper_bound(fpos);
+        if (iter != m_svf.begin()) {
+            --iter;
+            size_t offset = fpos - iter->first;
+            if (offset == 0 && !iter->second.has_bitmap()) {
+                return iter->second.size();
+            }
+            if (offset < iter->second.size() && iter->second.has_bitmap()
+                && _is_held(iter, offset, 1) && (offset == 0 || !_is_held(iter, offset - 1, 1))) {
+                // The start of a run of held bytes in a dense region.
+                return bits_find(iter->second.bitmap(), offset, iter->second.size(), false) - offset;
+            }
         }
-        return iter->second.data.size();
+        std::ostringstream os;
+        os << "SparseVirtualFile::block_size():";
+        os << " Requested file position " << fpos << " is not at the start of a block";
+        throw Exceptions::ExceptionSparseVirtualFileRead(os.str());
     }
 
     /**
      * @brief Returns the total memory usage of this SVF.
      *
+     * This is constant time as the heap bytes of the blocks are counted as they change.
+     *
      * @return Memory used.
      */
     size_t SparseVirtualFile::size_of() const noexcept {
@@ -824,14 +1625,25 @@ namespace SVFS {
 #ifdef SVF_THREAD_SAFE
         std::lock_guard<std::mutex> mutex(m_mutex);
 #endif
+        return _size_of_no_lock();
+    }
+
+    /**
+     * @brief Returns the total memory usage of this SVF without using the mutex.
+     *
+     * @return Memory used.
+     */
+    size_t SparseVirtualFile::_size_of_no_lock() const noexcept {
         size_t ret = sizeof(SparseVirtualFile);
 
         // Add heap referenced data sizes.
         ret += m_id.size();
-        for (const auto &iter: m_svf) {
-            ret += sizeof(iter.first);
-            ret += sizeof(iter.second);
-            ret += iter.second.data.size();
+        ret += m_svf.size() * (sizeof(t_map::key_type) + sizeof(t_map::mapped_type));
+        // Small blocks are held inline and are already counted by sizeof().
+        ret += m_heap_bytes;
+        ret += m_coverage.size() * (sizeof(size_t) + sizeof(t_coverage_leaf));
+        if (m_spill) {
+            ret += m_spill->size_of();
         }
         return ret;
     }
@@ -851,11 +1663,24 @@ namespace SVFS {
         // Maintain ID and constructor arguments.
         if (m_config.overwrite_on_exit) {
             for (auto &iter: m_svf) {
-                iter.second.data.assign(iter.second.data.size(), OVERWRITE_CHAR);
+                iter.second.assign(iter.second.size(), OVERWRITE_CHAR);
             }
         }
         m_svf.clear();
+        m_coverage.clear();
+        if (m_spill) {
+            m_spill->clear();
+        }
+        if (m_journal) {
+            try {
+                m_journal->clear(m_id);
+            } catch (const std::exception &) {
+                // This is noexcept, the journal will replay the earlier state.
+            }
+        }
         m_bytes_total = 0;
+        m_heap_bytes = 0;
+        m_num_blocks = 0;
         m_count_write = 0;
         m_count_read = 0;
         m_bytes_write = 0;
@@ -867,6 +1692,10 @@ namespace SVFS {
         m_bytes_erased = 0;
         m_blocks_punted = 0;
         m_bytes_punted = 0;
+        m_compact_in_pass = false;
+        m_compact_clean = true;
+        m_compact_fpos = 0;
+        _totals_update_no_lock();
         SVF_ASSERT(integrity() == ERROR_NONE);
     }
 
@@ -881,6 +1710,9 @@ namespace SVFS {
     size_t SparseVirtualFile::_erase_no_lock(t_fpos fpos) {
         SVF_ASSERT(integrity() == ERROR_NONE);
 
+        if (m_config.dense_gap) {
+            return _erase_dense_no_lock(fpos);
+        }
         auto iter = m_svf.find(fpos);
         if (iter == m_svf.end()) {
             std::ostringstream os;
@@ -888,8 +1720,13 @@ namespace SVFS {
             os << " Non-existent file position " << fpos << " at start of block.";
             throw Exceptions::ExceptionSparseVirtualFileErase(os.str());
         }
-        size_t ret = iter->second.data.size();
+        size_t ret = iter->second.size();
+        if (m_config.coverage_page_size) {
+            _coverage_remove(fpos, ret);
+        }
         m_bytes_total -= ret;
+        m_heap_bytes -= iter->second.heap_bytes();
+        m_num_blocks -= 1;
         m_svf.erase(iter);
         m_blocks_erased++;
         m_bytes_erased += ret;
@@ -909,7 +1746,47 @@ namespace SVFS {
 #ifdef SVF_THREAD_SAFE
         std::lock_guard<std::mutex> mutex(m_mutex);
 #endif
-        return _erase_no_lock(fpos);
+        m_compact_clean = false;
+        size_t ret = _erase_no_lock(fpos);
+        if (m_spill) {
+            m_spill->discard(fpos, ret);
+        }
+        if (m_journal) {
+            m_journal->erase(m_id, fpos);
+        }
+        _totals_update_no_lock();
+        return ret;
+    }
+
+    /**
+     * @brief Remove the whole map entry at the given file position, for a dense region this is all of its blocks.
+     *
+     * This will raise an ExceptionSparseVirtualFileErase if the file position is not exactly at the start of an entry.
+     *
+     * @param fpos File position of the start of the entry.
+     * @param blocks_erased Set to the number of blocks removed.
+     * @return Number of bytes removed.
+     */
+    size_t SparseVirtualFile::_erase_region_no_lock(t_fpos fpos, size_t &blocks_erased) {
+        auto iter = m_svf.find(fpos);
+        if (iter == m_svf.end()) {
+            std::ostringstream os;
+            os << "SparseVirtualFile::erase():";
+            os << " Non-existent file position " << fpos << " at start of block.";
+            throw Exceptions::ExceptionSparseVirtualFileErase(os.str());
+        }
+        if (m_config.coverage_page_size) {
+            _coverage_remove(fpos, iter->second.size());
+        }
+        size_t ret = _held_bytes(iter);
+        blocks_erased = _held_runs(iter);
+        m_bytes_total -= ret;
+        m_heap_bytes -= iter->second.heap_bytes();
+        m_num_blocks -= blocks_erased;
+        m_svf.erase(iter);
+        m_blocks_erased += blocks_erased;
+        m_bytes_erased += ret;
+        return ret;
     }
 
     /**
@@ -922,6 +1799,7 @@ namespace SVFS {
      * - Adjacent blocks.
      * - Overlapping blocks.
      * - Byte count missmatch.
+     * - Coverage bitmap mismatch.
      *
      * @return An error condition or \c ERROR_NONE if the integrity is correct.
      */
@@ -931,14 +1809,29 @@ namespace SVFS {
         size_t prev_size = 0;
         t_map::const_iterator iter = m_svf.begin();
         size_t byte_count = 0;
+        size_t heap_bytes = 0;
+        size_t num_blocks = 0;
         std::set<t_block_touch> block_touches;
 
         while (iter != m_svf.end()) {
-            if (iter->second.data.empty()) {
+            if (iter->second.empty()) {
                 return ERROR_EMPTY_BLOCK;
             }
+            if (iter->second.has_bitmap()) {
+                const auto &valid = iter->second.bitmap();
+                const size_t size = iter->second.size();
+                if (!m_config.dense_gap || valid.size() != bits_words(size)) {
+                    return ERROR_DENSE_REGION;
+                }
+                if (!_is_held(iter, 0, 1) || !_is_held(iter, size - 1, 1)) {
+                    return ERROR_DENSE_REGION;
+                }
+                if (bits_count(valid, size, valid.size() * 64)) {
+                    return ERROR_DENSE_REGION;
+                }
+            }
             if (iter != m_svf.begin()) {
-                if (prev_fpos == iter->first && prev_size == iter->second.data.size()) {
+                if (prev_fpos == iter->first && prev_size == iter->second.size()) {
                     return ERROR_DUPLICATE_BLOCK;
                 }
                 if (prev_fpos + prev_size == iter->first) {
@@ -947,19 +1840,55 @@ namespace SVFS {
                 if (prev_fpos + prev_size > iter->first) {
                     return ERROR_BLOCKS_OVERLAP;
                 }
+                if (prev_fpos + prev_size + m_config.dense_gap >= iter->first) {
+                    // Dense regions this close should have been merged.
+                    return ERROR_ADJACENT_BLOCKS;
+                }
             }
             if (block_touches.find(iter->second.block_touch) != block_touches.end()) {
                 // Duplicate block_touches value
                 return ERROR_DUPLICATE_BLOCK_TOUCH;
             }
             prev_fpos = iter->first;
-            prev_size = iter->second.data.size();
-            byte_count += prev_size;
+            prev_size = iter->second.size();
+            byte_count += _held_bytes(iter);
+            heap_bytes += iter->second.heap_bytes();
+            num_blocks += _held_runs(iter);
             ++iter;
         }
         if (byte_count != m_bytes_total) {
             return ERROR_BYTE_COUNT_MISMATCH;
         }
+        if (heap_bytes != m_heap_bytes || num_blocks != m_num_blocks) {
+            return ERROR_COUNT_MISMATCH;
+        }
+        if (m_config.coverage_page_size) {
+            // Every page in the coverage bitmap must be wholly within a block.
+            // The converse is not checked as it is only a performance issue.
+            const size_t page_size = m_config.coverage_page_size;
+            for (const auto &leaf: m_coverage) {
+                // The summary bit of a word must be set if, and only if, the word is full.
+                for (size_t word = 0; word < COVERAGE_LEAF_WORDS; ++word) {
+                    if (((leaf.second.full >> word) & 1) != (leaf.second.words[word] == ~static_cast<uint64_t>(0))) {
+                        return ERROR_COVERAGE_MISMATCH;
+                    }
+                }
+                for (size_t i = 0; i < COVERAGE_LEAF_PAGES; ++i) {
+                    if ((leaf.second.words[i / 64] >> (i % 64)) & 1) {
+                        t_fpos fpos = (leaf.first * COVERAGE_LEAF_PAGES + i) * page_size;
+                        t_map::const_iterator iter = m_svf.upper_bound(fpos);
+                        if (iter == m_svf.begin()) {
+                            return ERROR_COVERAGE_MISMATCH;
+                        }
+                        --iter;
+                        if (fpos + page_size > _file_position_immediatly_after_block(iter)
+                            || !_is_held(iter, fpos - iter->first, page_size)) {
+                            return ERROR_COVERAGE_MISMATCH;
+                        }
+                    }
+                }
+            }
+        }
         return ERROR_NONE;
     }
 
@@ -1015,6 +1944,7 @@ namespace SVFS {
     /**
      * Implements a simple punting strategy based a Last Recently Used blocks.
      * This brings the cache size to < cache_size_upper_bound but leaving at least one block in place.
+     * Dense regions are punted as a whole.
      *
      * This will block in a multi-threaded environment.
      *
@@ -1030,17 +1960,875 @@ namespace SVFS {
             auto touch_fpos_map = _block_touches_no_lock();
             for (const auto &iter: touch_fpos_map) {
                 if (m_svf.size() > 1 and m_bytes_total >= cache_size_upper_bound) {
-                    ret += _erase_no_lock(iter.second);
-                    m_blocks_punted++;
+                    ret += _punt_region_no_lock(iter.second);
                 } else {
                     break;
                 }
             }
         }
+        _totals_update_no_lock();
+        return ret;
+    }
+
+    /**
+     * @brief Punt the map entry at the file position if it has not been touched since it had the given block touch.
+     *
+     * This is for callers that order blocks across many SVFs such as SparseVirtualFileSystem::evict().
+     * As with \c lru_punt() a dense region is punted as a whole and the entry goes to any spill file.
+     *
+     * This will block in a multi-threaded environment.
+     *
+     * @param fpos The file position of the start of the map entry.
+     * @param block_touch The block touch of the entry when it was chosen, see \c block_touches().
+     * @return The number of bytes punted, zero if there is no such entry or it has been touched since.
+     */
+    size_t SparseVirtualFile::punt(t_fpos fpos, t_block_touch block_touch) {
+        SVF_ASSERT(integrity() == ERROR_NONE);
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        auto iter = m_svf.find(fpos);
+        if (iter == m_svf.end() || iter->second.block_touch != block_touch) {
+            return 0;
+        }
+        size_t ret = _punt_region_no_lock(fpos);
+        _totals_update_no_lock();
+        return ret;
+    }
+
+    /**
+     * @brief Punt the map entry at the file position, writing it to any spill file and journal.
+     *
+     * This does not use the mutex or update the running totals.
+     *
+     * @param fpos The file position of the start of the map entry.
+     * @return The number of bytes punted.
+     */
+    size_t SparseVirtualFile::_punt_region_no_lock(t_fpos fpos) {
+        if (m_config.spill_capacity) {
+            _spill_region_no_lock(fpos);
+        }
+        if (m_journal) {
+            // Journal each block of a dense region as they are erased individually on replay.
+            _visit_region_no_lock(m_svf.find(fpos), [this](t_fpos block_fpos, const char *, size_t) {
+                m_journal->erase(m_id, block_fpos);
+            });
+        }
+        size_t blocks_erased = 0;
+        size_t ret = _erase_region_no_lock(fpos, blocks_erased);
+        m_blocks_punted += blocks_erased;
         m_bytes_punted += ret;
         return ret;
     }
 
+    /**
+     * @brief Right size the memory of every block returning the number of heap bytes reclaimed.
+     *
+     * Coalescing blocks grows them geometrically so a block may have up to twice the capacity that it needs.
+     * Erasing part of a dense region can leave its bitmap larger than needed.
+     * This reduces both to their size, small blocks are moved inline.
+     *
+     * If \c max_time is non-zero this stops after roughly that many seconds and the next call continues from where
+     * this one stopped, this allows the caller to compact incrementally, for example when idle.
+     * Once a pass is complete further calls return immediately until there has been a \c write() or \c erase().
+     *
+     * This will block in a multi-threaded environment.
+     *
+     * @param max_time The time budget in seconds, zero means no limit.
+     * @return The number of heap bytes reclaimed.
+     */
+    size_t SparseVirtualFile::compact(double max_time) {
+        SVF_ASSERT(integrity() == ERROR_NONE);
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        if (! m_compact_in_pass) {
+            if (m_compact_clean) {
+                return 0;
+            }
+            // Any write or erase during this pass will mark it as not clean.
+            m_compact_in_pass = true;
+            m_compact_clean = true;
+            m_compact_fpos = 0;
+        }
+        auto time_start = std::chrono::steady_clock::now();
+        size_t ret = 0;
+        size_t count = 0;
+        for (auto iter = m_svf.lower_bound(m_compact_fpos); iter != m_svf.end(); ++iter) {
+            // Only check the time occasionally.
+            if (max_time > 0.0 && ++count % 64 == 0) {
+                std::chrono::duration<double> time_exec = std::chrono::steady_clock::now() - time_start;
+                if (time_exec.count() > max_time) {
+                    m_compact_fpos = iter->first;
+                    m_heap_bytes -= ret;
+                    _totals_update_no_lock();
+                    return ret;
+                }
+            }
+            size_t heap_bytes = iter->second.heap_bytes();
+            iter->second.shrink_to_fit();
+            ret += heap_bytes - iter->second.heap_bytes();
+        }
+        m_compact_in_pass = false;
+        m_compact_fpos = 0;
+        m_heap_bytes -= ret;
+        _totals_update_no_lock();
+        SVF_ASSERT(integrity() == ERROR_NONE);
+        return ret;
+    }
+
+    /**
+     * @brief Returns \c true if every page spanned by the file position and length is wholly within a block.
+     *
+     * Consecutive wholly covered pages must belong to the same block as blocks are never adjacent so a \c true
+     * result means that a single block contains all the data.
+     * A \c false result means that the block map has to be searched.
+     * Each leaf spanned is one lookup, the words at either end are tested with a mask and any whole words between
+     * them with a single test of the summary so this does not visit every page.
+     * This does not use a lock.
+     *
+     * @param fpos File position.
+     * @param len Length, must be non-zero.
+     * @return \c true if the data is certainly held, \c false if unknown.
+     */
+    bool SparseVirtualFile::_coverage_has(t_fpos fpos, size_t len) const noexcept {
+        assert(m_config.coverage_page_size);
+        assert(len);
+        size_t page = fpos >> m_coverage_page_shift;
+        const size_t page_end = ((fpos + len - 1) >> m_coverage_page_shift) + 1;
+        while (page < page_end) {
+            const size_t leaf_index = page / COVERAGE_LEAF_PAGES;
+            auto iter = m_coverage.find(leaf_index);
+            if (iter == m_coverage.end()) {
+                return false;
+            }
+            const t_coverage_leaf &leaf = iter->second;
+            const size_t bit = page % COVERAGE_LEAF_PAGES;
+            const size_t bit_end = std::min(page_end - leaf_index * COVERAGE_LEAF_PAGES, COVERAGE_LEAF_PAGES);
+            const size_t word = bit / 64;
+            const size_t word_last = (bit_end - 1) / 64;
+            if (word == word_last) {
+                const uint64_t mask = bits_mask(bit % 64, bit_end - word * 64);
+                if ((leaf.words[word] & mask) != mask) {
+                    return false;
+                }
+            } else {
+                const uint64_t mask_first = bits_mask(bit % 64, 64);
+                const uint64_t mask_last = bits_mask(0, bit_end - word_last * 64);
+                const uint64_t mask_full = bits_mask(word + 1, word_last);
+                if ((leaf.words[word] & mask_first) != mask_first
+                    || (leaf.words[word_last] & mask_last) != mask_last
+                    || (leaf.full & mask_full) != mask_full) {
+                    return false;
+                }
+            }
+            page = leaf_index * COVERAGE_LEAF_PAGES + bit_end;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Update the coverage bitmap after a successful write.
+     *
+     * Only pages that overlap the written data can have become wholly covered so only those are examined.
+     * This does not use a lock.
+     *
+     * @param fpos File position of the write.
+     * @param len Length of the write.
+     */
+    void SparseVirtualFile::_coverage_add(t_fpos fpos, size_t len) {
+        assert(m_config.coverage_page_size);
+        if (len == 0) {
+            return;
+        }
+        // The (possibly coalesced) block that now contains the write.
+        t_map::const_iterator iter = m_svf.upper_bound(fpos);
+        assert(iter != m_svf.begin());
+        --iter;
+        const size_t page_size = m_config.coverage_page_size;
+        size_t page_begin = std::max((iter->first + page_size - 1) / page_size, fpos / page_size);
+        size_t page_end = std::min(_file_position_immediatly_after_block(iter) / page_size,
+                                   (fpos + len - 1) / page_size + 1);
+        if (!iter->second.has_bitmap()) {
+            _coverage_set(page_begin, page_end, true);
+        } else {
+            // A dense region, only pages that are wholly held count.
+            for (size_t page = page_begin; page < page_end; ++page) {
+                if (_is_held(iter, page * page_size - iter->first, page_size)) {
+                    _coverage_set(page, page + 1, true);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Update the coverage bitmap before a block is removed.
+     *
+     * Every page that overlaps the block is cleared.
+     * This does not use a lock.
+     *
+     * @param fpos File position of the start of the block.
+     * @param len Length of the block.
+     */
+    void SparseVirtualFile::_coverage_remove(t_fpos fpos, size_t len) noexcept {
+        assert(m_config.coverage_page_size);
+        if (len == 0) {
+            return;
+        }
+        const size_t page_size = m_config.coverage_page_size;
+        _coverage_set(fpos / page_size, (fpos + len - 1) / page_size + 1, false);
+    }
+
+    /**
+     * @brief Recreate the coverage bitmap from the block map.
+     *
+     * This does not use a lock.
+     */
+    void SparseVirtualFile::_coverage_rebuild() {
+        assert(m_config.coverage_page_size);
+        const size_t page_size = m_config.coverage_page_size;
+        m_coverage.clear();
+        for (t_map::const_iterator iter = m_svf.begin(); iter != m_svf.end(); ++iter) {
+            if (!iter->second.has_bitmap()) {
+                _coverage_set((iter->first + page_size - 1) / page_size,
+                              _file_position_immediatly_after_block(iter) / page_size, true);
+            } else {
+                _coverage_add(iter->first, iter->second.size());
+            }
+        }
+    }
+
+    /**
+     * @brief Set or clear a range of pages in the coverage bitmap.
+     *
+     * Leaves are created on demand when setting and removed when they become empty when clearing.
+     * This does not use a lock.
+     *
+     * @param page_begin First page.
+     * @param page_end One past the last page.
+     * @param value The value to set.
+     */
+    void SparseVirtualFile::_coverage_set(size_t page_begin, size_t page_end, bool value) {
+        size_t page = page_begin;
+        while (page < page_end) {
+            size_t leaf_index = page / COVERAGE_LEAF_PAGES;
+            size_t leaf_page_end = std::min(page_end, (leaf_index + 1) * COVERAGE_LEAF_PAGES);
+            t_coverage_leaf *p_leaf = nullptr;
+            if (value) {
+                p_leaf = &m_coverage[leaf_index];
+            } else {
+                auto iter = m_coverage.find(leaf_index);
+                if (iter == m_coverage.end()) {
+                    page = leaf_page_end;
+                    continue;
+                }
+                p_leaf = &iter->second;
+            }
+            while (page < leaf_page_end) {
+                size_t word = (page % COVERAGE_LEAF_PAGES) / 64;
+                size_t bit = page % 64;
+                size_t bit_end = std::min(static_cast<size_t>(64), bit + (leaf_page_end - page));
+                if (value) {
+                    p_leaf->words[word] |= bits_mask(bit, bit_end);
+                    if (p_leaf->words[word] == ~static_cast<uint64_t>(0)) {
+                        p_leaf->full |= static_cast<uint64_t>(1) << word;
+                    }
+                } else {
+                    p_leaf->words[word] &= ~bits_mask(bit, bit_end);
+                    p_leaf->full &= ~(static_cast<uint64_t>(1) << word);
+                }
+                page += bit_end - bit;
+            }
+            if (!value && std::all_of(std::begin(p_leaf->words), std::end(p_leaf->words),
+                                      [](uint64_t w) { return w == 0; })) {
+                m_coverage.erase(leaf_index);
+            }
+        }
+    }
+
+#pragma mark - Spill file
+
+    /**
+     * @brief The spill file, creating it if necessary with the store from \c set_spill_store() or one of its own.
+     *
+     * This does not use the mutex.
+     */
+    SpillFile &SparseVirtualFile::_spill_no_lock() {
+        if (!m_spill) {
+            if (m_spill_store) {
+                m_spill = std::make_unique<SpillFile>(m_spill_store);
+            } else {
+                m_spill = std::make_unique<SpillFile>(m_config.spill_directory, m_config.spill_capacity);
+            }
+        }
+        return *m_spill;
+    }
+
+    /**
+     * @brief Set the store that the spill file uses when it is created.
+     *
+     * A SparseVirtualFileSystem uses this to share one store, and so one file and one capacity, between all of its
+     * SVFs.
+     * This has no effect if the spill file has already been created.
+     *
+     * @param store The store.
+     */
+    void SparseVirtualFile::set_spill_store(const std::shared_ptr<SpillStore> &store) noexcept {
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        m_spill_store = store;
+    }
+
+    /**
+     * @brief Write every held run of the block map entry at the file position to the spill file.
+     *
+     * This does not use the mutex.
+     * The first block spilled creates the store file, this will raise an ExceptionSparseVirtualFile if that fails.
+     *
+     * @param fpos The file position of the start of the entry.
+     */
+    void SparseVirtualFile::_spill_region_no_lock(t_fpos fpos) {
+        SpillFile &spill = _spill_no_lock();
+        auto iter = m_svf.find(fpos);
+        assert(iter != m_svf.end());
+        _visit_region_no_lock(iter, [&spill](t_fpos fpos_block, const char *data, size_t len_block) {
+            spill.put(fpos_block, data, len_block);
+        });
+    }
+
+    /**
+     * @brief Call a function with every held run of a block map entry.
+     *
+     * This does not use the mutex.
+     *
+     * @param iter The block map entry.
+     * @param function Called with the file position, data and length of each run.
+     */
+    void SparseVirtualFile::_visit_region_no_lock(t_map::const_iterator iter, const t_visit_function &function) const {
+        if (!iter->second.has_bitmap()) {
+            function(iter->first, iter->second.data(), iter->second.size());
+        } else {
+            size_t offset = 0;
+            while (offset < iter->second.size()) {
+                size_t offset_end = bits_find(iter->second.bitmap(), offset, iter->second.size(), false);
+                function(iter->first + offset, iter->second.data() + offset, offset_end - offset);
+                offset = bits_find(iter->second.bitmap(), offset_end, iter->second.size(), true);
+            }
+        }
+    }
+
+    /**
+     * @brief Call a function with every block held in memory and then every block held in the spill file.
+     *
+     * This does not change the read statistics or the block touch values.
+     * A block in the spill file may overlap a block in memory, the data is the same.
+     * The blocks held in memory are visited in file position order and never overlap or touch.
+     *
+     * @param function Called with the file position, data and length of each block.
+     * @param include_spill If false only the blocks held in memory are visited.
+     */
+    void SparseVirtualFile::visit_blocks(const t_visit_function &function, bool include_spill) const {
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        for (auto iter = m_svf.cbegin(); iter != m_svf.cend(); ++iter) {
+            _visit_region_no_lock(iter, function);
+        }
+        if (include_spill && m_spill) {
+            m_spill->visit(function);
+        }
+    }
+
+    /**
+     * @brief Add a block that is held in a read only memory mapping.
+     *
+     * The block is treated as a spilled block, \c has() and \c need() treat it as present and \c read() copies it
+     * into memory.
+     * This creates a spill file if there is not one already.
+     *
+     * @param mapping The memory mapping, this is kept alive until the block is read, erased or cleared.
+     * @param fpos File position.
+     * @param data The data within the mapping.
+     * @param len Length of the data.
+     */
+    void SparseVirtualFile::map_block(const std::shared_ptr<const char> &mapping, t_fpos fpos, const char *data,
+                                      size_t len) {
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        _spill_no_lock().map(mapping, fpos, data, len);
+        _totals_update_no_lock();
+    }
+
+    /**
+     * @brief Move every spilled block that overlaps the given bytes back into the block map.
+     *
+     * This does not use the mutex.
+     *
+     * @param fpos File position.
+     * @param len Length.
+     */
+    void SparseVirtualFile::_spill_promote_no_lock(t_fpos fpos, size_t len) {
+        assert(m_spill);
+        m_spill->take(fpos, len, [this](t_fpos fpos_block, const char *data, size_t len_block) {
+            _write_no_lock(fpos_block, data, len_block);
+        });
+    }
+
+#pragma mark - Journal
+
+    /**
+     * @brief Set the journal that records every \c write(), \c erase(), punt and \c clear().
+     *
+     * @param journal The journal, this is not owned. \c nullptr stops journalling.
+     */
+    void SparseVirtualFile::set_journal(Journal *journal) noexcept {
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        m_journal = journal;
+    }
+
+#pragma mark - Running totals
+
+    SparseVirtualFile::t_totals_link::t_totals_link(t_totals_link &&other) noexcept:
+            totals(other.totals), num_bytes(other.num_bytes), num_blocks(other.num_blocks), size_of(other.size_of) {
+        other.totals = nullptr;
+    }
+
+    SparseVirtualFile::t_totals_link &SparseVirtualFile::t_totals_link::operator=(t_totals_link &&other) noexcept {
+        if (this != &other) {
+            if (totals) {
+                // Remove what was added for the data that is being replaced.
+                totals_add(totals->num_bytes, num_bytes, 0);
+                totals_add(totals->num_blocks, num_blocks, 0);
+                totals_add(totals->size_of, size_of, 0);
+            }
+            totals = other.totals;
+            num_bytes = other.num_bytes;
+            num_blocks = other.num_blocks;
+            size_of = other.size_of;
+            other.totals = nullptr;
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Set the running totals that this SVF adds to, for example those of a SparseVirtualFileSystem.
+     *
+     * This SVF is removed from any previous totals and added to the new ones.
+     * Thereafter every change to this SVF adds the change in \c num_bytes(), \c num_blocks() and \c size_of() to
+     * the totals.
+     *
+     * @param totals The totals, these are not owned. \c nullptr removes this SVF from the totals.
+     */
+    void SparseVirtualFile::set_totals(tSparseVirtualFileTotals *totals) noexcept {
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        _totals_unlink_no_lock();
+        m_totals.totals = totals;
+        _totals_update_no_lock();
+    }
+
+    /**
+     * @brief The total of \c BlockValue::heap_bytes() of every map entry that starts within the given file positions.
+     *
+     * This includes the entry that starts before them as that might extend into them.
+     * This does not use the mutex.
+     *
+     * @param fpos_begin The first file position.
+     * @param fpos_end The last file position.
+     * @return The heap bytes.
+     */
+    size_t SparseVirtualFile::_count_heap_bytes(t_fpos fpos_begin, t_fpos fpos_end) const noexcept {
+        size_t ret = 0;
+        t_map::const_iterator iter = m_svf.lower_bound(fpos_begin);
+        if (iter != m_svf.begin()) {
+            --iter;
+        }
+        for (; iter != m_svf.end() && iter->first <= fpos_end; ++iter) {
+            ret += iter->second.heap_bytes();
+        }
+        return ret;
+    }
+
+    /**
+     * @brief The number of blocks, runs of held bytes, that hold any byte from \c fpos_begin up to \c fpos_end.
+     *
+     * This only searches the bitmaps between those file positions, not the whole of any dense region.
+     * This does not use the mutex.
+     *
+     * @param fpos_begin The first file position.
+     * @param fpos_end The file position after the last.
+     * @return The number of blocks.
+     */
+    size_t SparseVirtualFile::_count_runs(t_fpos fpos_begin, t_fpos fpos_end) const noexcept {
+        size_t ret = 0;
+        t_map::const_iterator iter = m_svf.upper_bound(fpos_begin);
+        if (iter != m_svf.begin()) {
+            --iter;
+        }
+        for (; iter != m_svf.end() && iter->first < fpos_end; ++iter) {
+            const size_t size = iter->second.size();
+            if (iter->first + size <= fpos_begin) {
+                continue;
+            }
+            if (!iter->second.has_bitmap()) {
+                ++ret;
+                continue;
+            }
+            const auto &bitmap = iter->second.bitmap();
+            size_t offset = fpos_begin > iter->first ? fpos_begin - iter->first : 0;
+            const size_t offset_end = std::min(size, fpos_end - iter->first);
+            while (offset < offset_end) {
+                offset = bits_find(bitmap, offset, offset_end, true);
+                if (offset < offset_end) {
+                    ++ret;
+                    offset = bits_find(bitmap, offset, offset_end, false);
+                }
+            }
+        }
+        return ret;
+    }
+
+    /**
+     * @brief Add any change in \c num_bytes(), \c num_blocks() and \c size_of() to the running totals.
+     *
+     * This is constant time and does not use the mutex.
+     */
+    void SparseVirtualFile::_totals_update_no_lock() noexcept {
+        if (m_totals.totals) {
+            totals_add(m_totals.totals->num_bytes, m_totals.num_bytes, m_bytes_total);
+            totals_add(m_totals.totals->num_blocks, m_totals.num_blocks, m_num_blocks);
+            totals_add(m_totals.totals->size_of, m_totals.size_of, _size_of_no_lock());
+        }
+    }
+
+    /**
+     * @brief The block touch for a block being touched now.
+     *
+     * If this SVF is linked to running totals this comes from their shared clock so that the block touches of every
+     * linked SVF can be ordered together, \c block_touch() is still one more than the latest.
+     * This does not use the mutex.
+     */
+    t_block_touch SparseVirtualFile::_next_block_touch() noexcept {
+        if (m_totals.totals) {
+            t_block_touch ret = m_totals.totals->block_touch++;
+            m_block_touch = ret + 1;
+            return ret;
+        }
+        return m_block_touch++;
+    }
+
+    /**
+     * @brief Remove everything that this SVF has added to the running totals and stop adding to them.
+     *
+     * This does not use the mutex.
+     */
+    void SparseVirtualFile::_totals_unlink_no_lock() noexcept {
+        if (m_totals.totals) {
+            totals_add(m_totals.totals->num_bytes, m_totals.num_bytes, 0);
+            totals_add(m_totals.totals->num_blocks, m_totals.num_blocks, 0);
+            totals_add(m_totals.totals->size_of, m_totals.size_of, 0);
+            m_totals.totals = nullptr;
+        }
+    }
+
+#pragma mark - Dense regions
+
+    /**
+     * @brief Are all the bytes in the map entry from the offset for the length held?
+     *
+     * This is always true for an ordinary block, for a dense region this checks the bitmap.
+     * The caller must make sure the offset and length are within the entry.
+     *
+     * @param iter The map entry.
+     * @param offset Offset from the start of the entry.
+     * @param len Length.
+     * @return \c true if every byte is held.
+     */
+    bool SparseVirtualFile::_is_held(t_map::const_iterator iter, size_t offset, size_t len) const noexcept {
+        assert(iter != m_svf.end());
+        assert(offset + len <= iter->second.size());
+        if (!iter->second.has_bitmap()) {
+            return true;
+        }
+        return bits_find(iter->second.bitmap(), offset, offset + len, false) == offset + len;
+    }
+
+    /**
+     * @brief The number of bytes held by the map entry.
+     */
+    size_t SparseVirtualFile::_held_bytes(t_map::const_iterator iter) const noexcept {
+        assert(iter != m_svf.end());
+        if (!iter->second.has_bitmap()) {
+            return iter->second.size();
+        }
+        return bits_count(iter->second.bitmap(), 0, iter->second.size());
+    }
+
+    /**
+     * @brief The number of blocks, runs of held bytes, in the map entry.
+     */
+    size_t SparseVirtualFile::_held_runs(t_map::const_iterator iter) const noexcept {
+        assert(iter != m_svf.end());
+        if (!iter->second.has_bitmap()) {
+            return 1;
+        }
+        size_t ret = 0;
+        size_t offset = 0;
+        while (offset < iter->second.size()) {
+            offset = bits_find(iter->second.bitmap(), offset, iter->second.size(), false);
+            offset = bits_find(iter->second.bitmap(), offset, iter->second.size(), true);
+            ++ret;
+        }
+        return ret;
+    }
+
+    /**
+     * @brief Write data when dense regions are enabled.
+     *
+     * Any existing entries within \c m_config.dense_gap bytes of the new data are merged with it into a single
+     * dense region.
+     * The common case of extending a single entry is done in place, the gap bytes are held as unused data and the
+     * bitmap marks which bytes are held.
+     *
+     * Data differences are checked for before anything is changed so an exception leaves the SVF unchanged.
+     *
+     * @param fpos The file position to write to.
+     * @param data The data, assumed to be of the given length.
+     * @param len The length to the data to write.
+     */
+    void SparseVirtualFile::_write_dense(t_fpos fpos, const char *data, size_t len) {
+        assert(m_config.dense_gap);
+        const size_t gap = m_config.dense_gap;
+        // Only one entry can precede fpos and be within reach as entries are separated by more than the gap.
+        t_map::iterator iter_first = m_svf.upper_bound(fpos);
+        if (iter_first != m_svf.begin()) {
+            t_map::iterator iter_prev = std::prev(iter_first);
+            if (_file_position_immediatly_after_block(iter_prev) + gap >= fpos) {
+                iter_first = iter_prev;
+            }
+        }
+        t_map::iterator iter_last = iter_first;
+        while (iter_last != m_svf.end() && iter_last->first <= fpos + len + gap) {
+            ++iter_last;
+        }
+        if (iter_first == iter_last) {
+            // Nothing within reach.
+            _write_new_block(fpos, data, len, iter_first);
+            return;
+        }
+        if (m_config.compare_for_diff) {
+            for (t_map::iterator iter = iter_first; iter != iter_last; ++iter) {
+                t_fpos overlap_begin = std::max(fpos, iter->first);
+                t_fpos overlap_end = std::min(fpos + len, _file_position_immediatly_after_block(iter));
+                for (t_fpos pos = overlap_begin; pos < overlap_end; ++pos) {
+                    size_t index_iter = pos - iter->first;
+                    if (iter->second[index_iter] != data[pos - fpos] && _is_held(iter, index_iter, 1)) {
+                        _throw_diff(pos, data + (pos - fpos), iter, index_iter);
+                    }
+                }
+            }
+        }
+        if (std::next(iter_first) == iter_last && iter_first->first <= fpos) {
+            // Extend a single entry in place.
+            t_val &value = iter_first->second;
+            const size_t offset = fpos - iter_first->first;
+            const size_t size_old = value.size();
+            const size_t size_new = std::max(size_old, offset + len);
+            if (size_new > size_old) {
+                value.resize(size_new);
+            }
+            if (!value.has_bitmap() && offset <= size_old) {
+                // Still an ordinary block.
+                m_bytes_total += size_new - size_old;
+            } else {
+                if (!value.has_bitmap()) {
+                    value.bitmap().assign(bits_words(size_new), 0);
+                    bits_set(value.bitmap(), 0, size_old, true);
+                } else {
+                    value.bitmap().resize(bits_words(size_new), 0);
+                }
+                m_bytes_total += len - bits_count(value.bitmap(), offset, offset + len);
+                bits_set(value.bitmap(), offset, offset + len, true);
+                // Only a write that starts within the region can fill its last gap.
+                if (offset < size_old && bits_find(value.bitmap(), 0, size_new, false) == size_new) {
+                    // The gaps are filled so an ordinary block.
+                    value.clear_bitmap();
+                }
+            }
+            std::memcpy(value.data() + offset, data, len);
+            value.block_touch = _next_block_touch();
+            return;
+        }
+        // Merge all the entries and the new data into a new dense region.
+        const t_fpos region_begin = std::min(iter_first->first, fpos);
+        const t_fpos region_end = std::max(_file_position_immediatly_after_block(std::prev(iter_last)), fpos + len);
+        const size_t region_size = region_end - region_begin;
+        t_val new_value;
+        new_value.resize(region_size);
+        new_value.bitmap().assign(bits_words(region_size), 0);
+        size_t bytes_before = 0;
+        for (t_map::iterator iter = iter_first; iter != iter_last; ++iter) {
+            const size_t offset = iter->first - region_begin;
+            const size_t size = iter->second.size();
+            std::memcpy(new_value.data() + offset, iter->second.data(), size);
+            if (!iter->second.has_bitmap()) {
+                bits_set(new_value.bitmap(), offset, offset + size, true);
+            } else {
+                for (size_t i = 0; i < size;) {
+                    size_t i_end = bits_find(iter->second.bitmap(), i, size, false);
+                    bits_set(new_value.bitmap(), offset + i, offset + i_end, true);
+                    i = bits_find(iter->second.bitmap(), i_end, size, true);
+                }
+            }
+            bytes_before += _held_bytes(iter);
+        }
+        std::memcpy(new_value.data() + (fpos - region_begin), data, len);
+        bits_set(new_value.bitmap(), fpos - region_begin, fpos - region_begin + len, true);
+        size_t bytes_after = bits_count(new_value.bitmap(), 0, region_size);
+        if (bytes_after == region_size) {
+            // No gaps so an ordinary block.
+            new_value.clear_bitmap();
+        }
+        m_bytes_total += bytes_after - bytes_before;
+        new_value.block_touch = _next_block_touch();
+        for (t_map::iterator iter = iter_first; iter != iter_last;) {
+            if (m_config.overwrite_on_exit) {
+                iter->second.assign(iter->second.size(), OVERWRITE_CHAR);
+            }
+            iter = m_svf.erase(iter);
+        }
+        m_svf.insert(iter_last, {region_begin, std::move(new_value)});
+    }
+
+    /**
+     * @brief The equivalent of \c _need_no_lock() when dense regions are enabled.
+     *
+     * This is like \c _need_no_lock() but also adds the gaps within dense regions.
+     *
+     * @param fpos File position at the start of the attempted read.
+     * @param len Length of the attempted read.
+     * @param greedy_length If greater than zero this makes greedy, fewer but larger, reads.
+     * @return A vector of pairs (file_position, length) that this SVF needs.
+     */
+    t_seek_reads
+    SparseVirtualFile::_need_dense_no_lock(t_fpos fpos, size_t len, size_t greedy_length) const noexcept {
+        t_seek_reads ret;
+        const t_fpos fpos_to = fpos + len;
+        t_map::const_iterator iter = m_svf.upper_bound(fpos);
+        if (iter != m_svf.begin() && _file_position_immediatly_after_block(std::prev(iter)) > fpos) {
+            --iter;
+        }
+        while (fpos < fpos_to) {
+            if (iter == m_svf.end() || iter->first >= fpos_to) {
+                ret.emplace_back(fpos, fpos_to - fpos);
+                break;
+            }
+            if (fpos < iter->first) {
+                ret.emplace_back(fpos, iter->first - fpos);
+                fpos = iter->first;
+            }
+            const t_fpos entry_to = std::min(fpos_to, _file_position_immediatly_after_block(iter));
+            if (iter->second.has_bitmap()) {
+                // Add the gaps within the dense region.
+                const size_t offset_to = entry_to - iter->first;
+                size_t offset = fpos - iter->first;
+                while (offset < offset_to) {
+                    size_t gap_begin = bits_find(iter->second.bitmap(), offset, offset_to, false);
+                    if (gap_begin == offset_to) {
+                        break;
+                    }
+                    size_t gap_end = bits_find(iter->second.bitmap(), gap_begin, offset_to, true);
+                    ret.emplace_back(iter->first + gap_begin, gap_end - gap_begin);
+                    offset = gap_end;
+                }
+            }
+            fpos = entry_to;
+            ++iter;
+        }
+        if (greedy_length && greedy_length > len && !ret.empty()) {
+            ret = _minimise_seek_reads(ret, greedy_length);
+        }
+        return ret;
+    }
+
+    /**
+     * @brief Remove the block at the given file position when dense regions are enabled.
+     *
+     * The block may be a whole map entry or a run of held bytes in a dense region.
+     * The region is trimmed so that it always starts and ends with a held byte.
+     *
+     * This will raise an ExceptionSparseVirtualFileErase if the file position is not exactly at the start of a block.
+     *
+     * @param fpos File position of the start of the block.
+     * @return Size of the block that was removed.
+     */
+    size_t SparseVirtualFile::_erase_dense_no_lock(t_fpos fpos) {
+        assert(m_config.dense_gap);
+        t_map::iterator iter = m_svf.upper_bound(fpos);
+        size_t offset = 0;
+        if (iter != m_svf.begin()) {
+            --iter;
+            offset = fpos - iter->first;
+        }
+        if (iter == m_svf.end() || offset >= iter->second.size() || !_is_held(iter, offset, 1)
+            || (offset > 0 && _is_held(iter, offset - 1, 1))) {
+            std::ostringstream os;
+            os << "SparseVirtualFile::erase():";
+            os << " Non-existent file position " << fpos << " at start of block.";
+            throw Exceptions::ExceptionSparseVirtualFileErase(os.str());
+        }
+        t_val &value = iter->second;
+        const size_t size = value.size();
+        const size_t offset_end = !value.has_bitmap() ? size : bits_find(value.bitmap(), offset, size, false);
+        if (offset == 0 && offset_end == size) {
+            // The whole entry.
+            size_t blocks_erased = 0;
+            return _erase_region_no_lock(fpos, blocks_erased);
+        }
+        const size_t ret = offset_end - offset;
+        if (m_config.coverage_page_size) {
+            _coverage_remove(fpos, ret);
+        }
+        // This removes one run from the entry, the entry is changed in place even if its key changes.
+        m_heap_bytes -= value.heap_bytes();
+        m_num_blocks -= 1;
+        bits_set(value.bitmap(), offset, offset_end, false);
+        if (offset_end == size) {
+            // Trailing block, trim the region to its last held byte.
+            size_t size_new = bits_find_last(value.bitmap(), offset) + 1;
+            value.resize(size_new);
+            value.bitmap().resize(bits_words(size_new));
+        } else if (offset == 0) {
+            // Leading block, move the region to start at its next held byte.
+            size_t offset_new = bits_find(value.bitmap(), offset_end, size, true);
+            std::vector<uint64_t> valid_new(bits_words(size - offset_new), 0);
+            for (size_t i = offset_new; i < size;) {
+                size_t i_end = bits_find(value.bitmap(), i, size, false);
+                bits_set(valid_new, i - offset_new, i_end - offset_new, true);
+                i = bits_find(value.bitmap(), i_end, size, true);
+            }
+            value.bitmap().swap(valid_new);
+            value.erase_front(offset_new);
+            auto node = m_svf.extract(iter);
+            node.key() += offset_new;
+            m_svf.insert(std::move(node));
+        }
+        if (bits_count(value.bitmap(), 0, value.size()) == value.size()) {
+            // No gaps remain so an ordinary block.
+            value.clear_bitmap();
+        }
+        m_heap_bytes += value.heap_bytes();
+        m_bytes_total -= ret;
+        m_blocks_erased++;
+        m_bytes_erased += ret;
+        return ret;
+    }
+
     /**
      * @brief Returns the file position immediately after the last block.
      *
@@ -1073,7 +2861,7 @@ namespace SVFS {
         // NOTE: do not SVF_ASSERT(integrity() == ERROR_NONE); as integrity() calls this so infinite recursion.
         assert(iter != m_svf.end());
 
-        auto ret = iter->first + iter->second.data.size();
+        auto ret = iter->first + iter->second.size();
         return ret;
     }
 
@@ -177,11 +177,18 @@ Then read directly:
 #ifndef CPPSVF_SVF_H
 #define CPPSVF_SVF_H
 
+#include <atomic>
 #include <string>
+#include <sstream>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <memory>
 #include <chrono>
 #include <cassert>
+#include <cstdint>
+#include <functional>
+#include <future>
 
 #ifdef SVF_THREAD_SAFE
 
@@ -254,6 +261,12 @@ namespace SVFS {
     /** Map of block touch (smallest is younger) to file position block. */
     typedef std::map<t_block_touch, t_fpos> t_block_touches;
 
+    /// A future that is ready when a range reserved by \c SparseVirtualFile::reserve_need() is released.
+    typedef std::shared_future<void> t_in_flight_future;
+
+    /// The futures of the ranges that another caller is fetching, see \c SparseVirtualFile::reserve_need().
+    typedef std::vector<t_in_flight_future> t_in_flight_futures;
+
 #pragma mark - SVF configuration
 
     /**
@@ -273,10 +286,192 @@ namespace SVFS {
          * If \c true writing is 0.321 ms, if \c false 0.264 m.
          */
         bool compare_for_diff = true;
+        /**
+         * If non-zero then maintain a coverage bitmap of pages of this size (in bytes) that are wholly within a block.
+         * This makes \c has() and the all-cached case of \c need() a few word tests per 4096 pages without a search of
+         * the block map, the map is only consulted for pages that are partially covered.
+         * The cost is one bit per page of the file extent, allocated lazily, and a small amount of work per
+         * \c write(), \c erase() and \c lru_punt().
+         * This must be a power of two, zero, the default, disables the bitmap.
+         * See \c test_perf_has_coverage_off() and \c test_perf_has_coverage_on() for a performance comparison.
+         */
+        size_t coverage_page_size = 0;
+        /**
+         * If non-zero then blocks that are separated by a gap of no more than this many bytes share a single
+         * allocation, a *dense region*, with a bitmap of which bytes are held.
+         * This trades the memory used by the gaps for the per-block overhead of a map node and a vector which is
+         * several times the payload for very small blocks.
+         * Blocks become logical views of the held bytes so \c has(), \c need(), \c read(), \c blocks() and so on
+         * behave exactly as if this were zero.
+         * The exception is \c lru_punt() which punts whole regions.
+         * Zero, the default, disables dense regions.
+         * See \c test_perf_write_1M_uncoalesced_dense_size_of() for the memory saving.
+         */
+        size_t dense_gap = 0;
+        /**
+         * If non-zero then blocks punted by \c lru_punt() are written to a local spill file of this many bytes rather
+         * than being discarded.
+         * \c has() and \c need() treat spilled blocks as present and \c read() moves them back into memory.
+         * When the spill file is full the oldest spilled blocks are evicted.
+         * The file is not created until the first block is punted.
+         * A SparseVirtualFileSystem shares one spill file of this capacity between all of its SVFs.
+         * Zero, the default, disables the spill file.
+         * See \c test_perf_spill_refetch_avoided() for the performance.
+         */
+        size_t spill_capacity = 0;
+        /**
+         * The directory to create the spill file in, if empty the system temporary directory is used.
+         * The file is unlinked as soon as it is created.
+         */
+        std::string spill_directory;
     } tSparseVirtualFileConfig;
 
+#pragma mark - SVF totals
+
+    /**
+     * @brief Running totals of \c num_bytes(), \c num_blocks() and \c size_of() over many Sparse Virtual Files.
+     *
+     * Each SVF linked by \c SparseVirtualFile::set_totals() adds the change in its own values after every change
+     * so the totals can be read in constant time without any lock.
+     */
+    typedef struct SparseVirtualFileTotals {
+        /// Total of \c SparseVirtualFile::num_bytes().
+        std::atomic<size_t> num_bytes{0};
+        /// Total of \c SparseVirtualFile::num_blocks().
+        std::atomic<size_t> num_blocks{0};
+        /// Total of \c SparseVirtualFile::size_of().
+        std::atomic<size_t> size_of{0};
+        /// The block touch clock shared by every linked SVF so that block touches can be compared across them.
+        std::atomic<t_block_touch> block_touch{0};
+    } tSparseVirtualFileTotals;
+
+#pragma mark - Block values
+
+    /**
+     * @brief The value of a block in a SparseVirtualFile, its data, block touch and any dense region bitmap.
+     *
+     * The data has a subset of the interface of \c std::vector<char> with a small buffer optimisation.
+     * Blocks of up to \c INLINE_CAPACITY bytes are held inline with no heap allocation.
+     * Larger blocks are held on the heap with the capacity stored in front of the data.
+     * The block touch shares a word with the inline length so nothing is lost to padding.
+     * This is 32 bytes, the same as a \c std::vector<char> and a block touch.
+     * See \c test_perf_write_1M_uncoalesced_size_of() for the effect on small blocks.
+     *
+     * A dense region (see \c tSparseVirtualFileConfig::dense_gap) also has a bitmap of the bytes that are held, this
+     * is always held on the heap.
+     */
+    class BlockValue {
+    public:
+        /// Number of bytes that can be held without a heap allocation.
+        static constexpr size_t INLINE_CAPACITY = 24;
+
+        BlockValue() noexcept: block_touch(0), m_inline_size(0) {}
+
+        BlockValue(BlockValue &&other) noexcept;
+
+        BlockValue &operator=(BlockValue &&other) noexcept;
+
+        BlockValue(const BlockValue &other) = delete;
+
+        BlockValue &operator=(const BlockValue &other) = delete;
+
+        ~BlockValue() { _free(); }
+
+        [[nodiscard]] size_t size() const noexcept { return _is_inline() ? m_inline_size : m_heap.size; }
+
+        [[nodiscard]] size_t capacity() const noexcept;
+
+        [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+        /// Is the data held inline rather than on the heap.
+        [[nodiscard]] bool is_inline() const noexcept { return _is_inline(); }
+
+        [[nodiscard]] char *data() noexcept { return _is_inline() ? m_inline : m_heap.ptr; }
+
+        [[nodiscard]] const char *data() const noexcept { return _is_inline() ? m_inline : m_heap.ptr; }
+
+        char &operator[](size_t index) noexcept { return data()[index]; }
+
+        const char &operator[](size_t index) const noexcept { return data()[index]; }
+
+        void reserve(size_t new_capacity);
+
+        /// Resize, any new bytes are zero.
+        void resize(size_t new_size);
+
+        /// Set to \c count copies of \c value.
+        void assign(size_t count, char value);
+
+        void push_back(char value);
+
+        /// Append \c count bytes from \c p.
+        void append(const char *p, size_t count);
+
+        /// Remove \c count bytes from the front.
+        void erase_front(size_t count) noexcept;
+
+        /// Reduce the capacity, and that of any bitmap, to the size, this may move the data inline.
+        void shrink_to_fit();
+
+        /// Bytes held on the heap for the data and any bitmap.
+        [[nodiscard]] size_t heap_bytes() const noexcept;
+
+        /// Does this have a dense region bitmap.
+        [[nodiscard]] bool has_bitmap() const noexcept {
+            return !_is_inline() && m_heap.bitmap && !m_heap.bitmap->empty();
+        }
+
+        /// The dense region bitmap, this allocates if needed.
+        [[nodiscard]] std::vector<uint64_t> &bitmap();
+
+        /// The dense region bitmap, empty if there is none.
+        [[nodiscard]] const std::vector<uint64_t> &bitmap() const noexcept;
+
+        /// Release the dense region bitmap.
+        void clear_bitmap() noexcept;
+
+    private:
+        /// Heap storage used when the data does not fit inline.
+        struct t_heap {
+            /// The data, the capacity is held in a \c size_t immediately before this.
+            char *ptr;
+            size_t size;
+            /// Dense regions only, one bit per byte of data that is set if the byte is held.
+            std::vector<uint64_t> *bitmap;
+        };
+        union {
+            t_heap m_heap;
+            char m_inline[INLINE_CAPACITY];
+        };
+    public:
+        /// A monotonically increasing integer that indicates the age of a block, smaller is older.
+        t_block_touch block_touch;
+    private:
+        /// Value of \c m_inline_size that marks the data as held in \c m_heap.
+        static constexpr uint32_t HEAP_TAG = UINT32_MAX;
+        /// The size of the inline data or \c HEAP_TAG.
+        uint32_t m_inline_size;
+
+        [[nodiscard]] bool _is_inline() const noexcept { return m_inline_size != HEAP_TAG; }
+
+        void _reallocate(size_t new_capacity);
+
+        void _steal(BlockValue &other) noexcept;
+
+        void _free() noexcept;
+    };
+
+    /// A list of (file_position, block value) pairs, see \c SparseVirtualFile::load_blocks().
+    typedef std::vector<std::pair<t_fpos, BlockValue>> t_block_values;
+
 #pragma mark - The SVF class
 
+    class SpillFile;
+
+    class SpillStore;
+
+    class Journal;
+
     /**
      * @brief Implementation of a *Sparse Virtual File*.
      *
@@ -295,23 +490,18 @@ namespace SVFS {
          * @param config See \c SVFS::SparseVirtualFileConfig.
          */
         explicit SparseVirtualFile(const std::string &id, double mod_time,
-                                   const tSparseVirtualFileConfig &config = tSparseVirtualFileConfig()) :
-                m_id(id),
-                m_file_mod_time(mod_time),
-                m_config(config),
-                m_bytes_total(0),
-                m_count_write(0),
-                m_count_read(0),
-                m_bytes_write(0),
-                m_bytes_read(0),
-                m_time_write(std::chrono::time_point<std::chrono::system_clock>::min()),
-                m_time_read(std::chrono::time_point<std::chrono::system_clock>::min()),
-                m_block_touch(0),
-                m_blocks_erased(0),
-                m_bytes_erased(0),
-                m_blocks_punted(0),
-                m_bytes_punted(0) {
-        }
+                                   const tSparseVirtualFileConfig &config = tSparseVirtualFileConfig());
+
+        /**
+         * @brief Create a Sparse Virtual File and bulk load it with blocks, see \c load_blocks().
+         *
+         * @param id The identifier for this file.
+         * @param mod_time The modification time of the remote file in UNIX seconds, this is used for integrity checking.
+         * @param blocks Sorted, non-overlapping, non-touching blocks, these are moved into the SVF.
+         * @param config See \c SVFS::SparseVirtualFileConfig.
+         */
+        SparseVirtualFile(const std::string &id, double mod_time, t_block_values &&blocks,
+                          const tSparseVirtualFileConfig &config = tSparseVirtualFileConfig());
 
         // ---- Read and write etc. ----
         /// Do I have the data at the given file position and length?
@@ -319,16 +509,37 @@ namespace SVFS {
 
         void write(t_fpos fpos, const char *data, size_t len);
 
+        /// Write a block that starts beyond the end of every existing block without searching or coalescing.
+        void append(t_fpos fpos, const char *data, size_t len);
+
+        /// Move sorted, non-overlapping, non-touching blocks beyond the end of every existing block into the SVF.
+        void load_blocks(t_block_values &&blocks);
+
         /** Read data and write to the buffer provided by the caller.
          * Not const as we update m_bytes_read, m_count_read, m_time_read. */
         void read(t_fpos fpos, size_t len, char *p);
 
+        /// Read data without copying, the pointer is valid until the next change to the SVF.
+        [[nodiscard]] const char *read_view(t_fpos fpos, size_t len);
+
         /// Create a new fragmentation list of seek/read instructions.
         [[nodiscard]] t_seek_reads need(t_fpos fpos, size_t len, size_t greedy_length = 0) const noexcept;
         /// Create a new fragmentation list of seek/read instructions from a list of seek read instructions.
         /// Non-const argument as it will be sorted in-place.
         [[nodiscard]] t_seek_reads need_many(t_seek_reads &seek_reads, size_t greedy_length = 0) const noexcept;
 
+        // ---- Single flight fetching ----
+        /// As \c need() but the ranges returned are reserved for the caller to fetch and release.
+        /// \c in_flight gains the futures of the ranges that other callers are fetching.
+        [[nodiscard]] t_seek_reads reserve_need(t_fpos fpos, size_t len, size_t greedy_length,
+                                                t_in_flight_futures &in_flight);
+
+        /// Release ranges from \c reserve_need() whether or not they have been written, this readies their futures.
+        void release_need(const t_seek_reads &seek_reads) noexcept;
+
+        /// The number of ranges reserved by \c reserve_need() and not yet released.
+        [[nodiscard]] size_t num_in_flight() const noexcept;
+
         /// Executes the data deletion strategy.
         void clear() noexcept;
 
@@ -351,7 +562,7 @@ namespace SVFS {
         [[nodiscard]] size_t num_bytes() const noexcept { return m_bytes_total; };
 
         /// Number of blocks used.
-        [[nodiscard]] size_t num_blocks() const noexcept { return m_svf.size(); }
+        [[nodiscard]] size_t num_blocks() const noexcept { return m_num_blocks; };
 
         /// The position of the last byte.
         [[nodiscard]] t_fpos last_file_position() const noexcept;
@@ -411,6 +622,32 @@ namespace SVFS {
         [[nodiscard]] t_block_touch block_touch() const noexcept { return m_block_touch; }
         [[nodiscard]] t_block_touches block_touches() const noexcept;
         size_t lru_punt(size_t cache_size_upper_bound);
+        size_t punt(t_fpos fpos, t_block_touch block_touch);
+        size_t compact(double max_time = 0.0);
+
+        /// The spill file or \c nullptr if nothing has been punted to it and there are no mapped blocks.
+        [[nodiscard]] const SpillFile *spill() const noexcept { return m_spill.get(); }
+
+        /// Type of the function called by \c visit_blocks().
+        typedef std::function<void(t_fpos fpos, const char *data, size_t len)> t_visit_function;
+
+        /// Call a function with every block held in memory and, optionally, in the spill file.
+        void visit_blocks(const t_visit_function &function, bool include_spill = true) const;
+
+        /// Add a block that is read lazily from a read only memory mapping, see SparseVirtualFileSystem::load().
+        void map_block(const std::shared_ptr<const char> &mapping, t_fpos fpos, const char *data, size_t len);
+
+        /// Set the journal that records every change, this is not owned. \c nullptr stops journalling.
+        void set_journal(Journal *journal) noexcept;
+
+        /// The journal or \c nullptr.
+        [[nodiscard]] Journal *journal() const noexcept { return m_journal; }
+
+        /// Set the running totals that this SVF adds to, this is not owned. \c nullptr removes this SVF from them.
+        void set_totals(tSparseVirtualFileTotals *totals) noexcept;
+
+        /// Set the store that the spill file uses, for example one shared by a SparseVirtualFileSystem.
+        void set_spill_store(const std::shared_ptr<SpillStore> &store) noexcept;
 
         /// Eliminate copying.
         SparseVirtualFile(const SparseVirtualFile &rhs) = delete;
@@ -427,12 +664,12 @@ namespace SVFS {
 
 #else
         /// Allow moving
-        SparseVirtualFile(SparseVirtualFile &&other) = default;
-        SparseVirtualFile& operator=(SparseVirtualFile &&rhs) = default;
+        SparseVirtualFile(SparseVirtualFile &&other);
+        SparseVirtualFile& operator=(SparseVirtualFile &&rhs);
 #endif
 
         /// Destruction just clears the internal map.
-        ~SparseVirtualFile() { clear(); }
+        ~SparseVirtualFile();
 
     private:
         /// The SVF ID
@@ -443,6 +680,10 @@ namespace SVFS {
         tSparseVirtualFileConfig m_config;
         /// Total number of bytes in this SVF
         size_t m_bytes_total = 0;
+        /// Total of \c BlockValue::heap_bytes() of every block.
+        size_t m_heap_bytes = 0;
+        /// Total number of blocks, each run of held bytes in a dense region counts as a block.
+        size_t m_num_blocks = 0;
         /// Access statistics: count of write operations.
         size_t m_count_write = 0;
         /// Access statistics: count of read operations.
@@ -457,18 +698,29 @@ namespace SVFS {
         std::chrono::time_point<std::chrono::system_clock> m_time_write;
         /// Last access real-time timestamp for a read.
         std::chrono::time_point<std::chrono::system_clock> m_time_read;
-        /// Typedef for the data. This allows for extra per-block fields in the future.
-        typedef struct {
-            std::vector<char> data;
-            // Potentially more fields here such as time of access.
-            t_block_touch block_touch;
-        } t_val;
+        /// Typedef for the data and per-block fields.
+        typedef BlockValue t_val;
         /// Typedef for the map of file blocks <file_position, data>.
         typedef std::map<t_fpos, t_val> t_map;
         /// The actual SVF.
         t_map m_svf;
         /// A monotonically increasing integer that indicates the age of a block, smaller is older.
         t_block_touch m_block_touch;
+        /// Number of pages in each leaf of the coverage bitmap.
+        static constexpr size_t COVERAGE_LEAF_PAGES = 4096;
+        /// Number of 64 bit words in each leaf of the coverage bitmap, one summary bit each.
+        static constexpr size_t COVERAGE_LEAF_WORDS = COVERAGE_LEAF_PAGES / 64;
+        static_assert(COVERAGE_LEAF_WORDS == 64, "The summary of a coverage leaf must be a single word.");
+        /// A leaf of the coverage bitmap, one bit per page and a summary bit per word that is set if the word is full.
+        struct t_coverage_leaf {
+            uint64_t words[COVERAGE_LEAF_WORDS] = {};
+            uint64_t full = 0;
+        };
+        /// Two level coverage bitmap of pages wholly within a block, keyed by <tt>page / COVERAGE_LEAF_PAGES</tt>.
+        /// Only used if \c m_config.coverage_page_size is non-zero.
+        std::unordered_map<size_t, t_coverage_leaf> m_coverage;
+        /// log2 of \c m_config.coverage_page_size.
+        unsigned int m_coverage_page_shift = 0;
 #ifdef SVF_THREAD_SAFE
         /// Thread mutex. This adds about 5-10% execution time compared with a single threaded version.
         mutable std::mutex m_mutex;
@@ -481,6 +733,48 @@ namespace SVFS {
         size_t m_blocks_punted;
         /// The count of bytes that have been erased by punting.
         size_t m_bytes_punted;
+        /// \c compact() is part way through a pass and will continue from \c m_compact_fpos.
+        bool m_compact_in_pass = false;
+        /// There have been no writes or erasures since the last \c compact() pass.
+        bool m_compact_clean = true;
+        /// Where an incremental \c compact() continues from.
+        t_fpos m_compact_fpos = 0;
+        /// Second tier for punted blocks, see \c tSparseVirtualFileConfig::spill_capacity.
+        std::unique_ptr<SpillFile> m_spill;
+        /// The store for \c m_spill when it is created, \c nullptr for a store of its own.
+        std::shared_ptr<SpillStore> m_spill_store;
+        /// Journal of every change, not owned, see SparseVirtualFileSystem::journal_open().
+        Journal *m_journal = nullptr;
+
+        /** @brief The running totals that this SVF adds to and the values that it last added to them. */
+        struct t_totals_link {
+            /// Not owned, see SparseVirtualFileSystem.
+            tSparseVirtualFileTotals *totals = nullptr;
+            size_t num_bytes = 0;
+            size_t num_blocks = 0;
+            size_t size_of = 0;
+
+            t_totals_link() noexcept = default;
+
+            /// Moving hands over the values added so that they are only removed once.
+            t_totals_link(t_totals_link &&other) noexcept;
+
+            t_totals_link &operator=(t_totals_link &&other) noexcept;
+
+            ~t_totals_link() = default;
+        };
+        /// Running totals, see \c set_totals().
+        t_totals_link m_totals;
+
+        /** @brief A range reserved by \c reserve_need(). */
+        struct t_in_flight {
+            size_t len;
+            /// Set by \c release_need() or broken if the SVF is destroyed first.
+            std::promise<void> promise;
+            t_in_flight_future future;
+        };
+        /// Ranges being fetched, keyed by file position, these never overlap.
+        std::map<t_fpos, t_in_flight> m_in_flight;
     private:
         void _throw_diff(t_fpos fpos, const char *data, t_map::const_iterator iter, size_t index_iter) const;
 
@@ -502,9 +796,49 @@ namespace SVFS {
         [[nodiscard]] static t_seek_reads
         _minimise_seek_reads(const t_seek_reads &seek_reads, size_t greedy_length) noexcept;
 
+        [[nodiscard]] bool _has_no_lock(t_fpos fpos, size_t len) const noexcept;
         [[nodiscard]] t_seek_reads _need_no_lock(t_fpos fpos, size_t len, size_t greedy_length = 0) const noexcept;
         [[nodiscard]] size_t _erase_no_lock(t_fpos fpos);
+        [[nodiscard]] size_t _erase_region_no_lock(t_fpos fpos, size_t &blocks_erased);
+        [[nodiscard]] size_t _size_of_no_lock() const noexcept;
+
+        // Dense regions, these do not use the mutex.
+        void _write_dense(t_fpos fpos, const char *data, size_t len);
+        [[nodiscard]] t_seek_reads _need_dense_no_lock(t_fpos fpos, size_t len, size_t greedy_length) const noexcept;
+        [[nodiscard]] size_t _erase_dense_no_lock(t_fpos fpos);
+        [[nodiscard]] bool _is_held(t_map::const_iterator iter, size_t offset, size_t len) const noexcept;
+        [[nodiscard]] size_t _held_bytes(t_map::const_iterator iter) const noexcept;
+        [[nodiscard]] size_t _held_runs(t_map::const_iterator iter) const noexcept;
         [[nodiscard]] t_block_touches _block_touches_no_lock() const noexcept;
+        [[nodiscard]] t_block_touch _next_block_touch() noexcept;
+        [[nodiscard]] size_t _punt_region_no_lock(t_fpos fpos);
+
+        // Coverage bitmap, these do not use the mutex.
+        [[nodiscard]] bool _coverage_has(t_fpos fpos, size_t len) const noexcept;
+        void _coverage_add(t_fpos fpos, size_t len);
+        void _coverage_remove(t_fpos fpos, size_t len) noexcept;
+        void _coverage_rebuild();
+        void _coverage_set(size_t page_begin, size_t page_end, bool value);
+
+        // Running totals, these do not use the mutex.
+        [[nodiscard]] size_t _count_heap_bytes(t_fpos fpos_begin, t_fpos fpos_end) const noexcept;
+        [[nodiscard]] size_t _count_runs(t_fpos fpos_begin, t_fpos fpos_end) const noexcept;
+        void _totals_update_no_lock() noexcept;
+        void _totals_unlink_no_lock() noexcept;
+
+        // Spill file, these do not use the mutex.
+        void _write_no_lock(t_fpos fpos, const char *data, size_t len);
+        [[nodiscard]] const char *_read_no_lock(t_fpos fpos, size_t len);
+        [[nodiscard]] SpillFile &_spill_no_lock();
+        void _spill_region_no_lock(t_fpos fpos);
+        void _visit_region_no_lock(t_map::const_iterator iter, const t_visit_function &function) const;
+        void _spill_promote_no_lock(t_fpos fpos, size_t len);
+        [[nodiscard]] t_seek_reads _need_not_spilled_no_lock(t_fpos fpos, size_t len) const;
+
+        // Single flight fetching, these do not use the mutex.
+        [[nodiscard]] t_seek_reads _need_held_no_lock(t_fpos fpos, size_t len, size_t greedy_length) const noexcept;
+        [[nodiscard]] t_seek_reads _subtract_in_flight_no_lock(const t_seek_reads &seek_reads,
+                                                               t_in_flight_futures *in_flight) const;
 
         /** @brief Check result of internal integrity. */
         enum ERROR_CONDITION {
@@ -522,6 +856,12 @@ namespace SVFS {
             ERROR_DUPLICATE_BLOCK,
             /// Two or more blocks have the same block touch value.
             ERROR_DUPLICATE_BLOCK_TOUCH,
+            /// The coverage bitmap does not match the blocks.
+            ERROR_COVERAGE_MISMATCH,
+            /// A dense region has a malformed bitmap or does not start and end with held bytes.
+            ERROR_DENSE_REGION,
+            /// The count of heap bytes or blocks does not match the blocks.
+            ERROR_COUNT_MISMATCH,
         };
 
         [[nodiscard]] ERROR_CONDITION integrity() const noexcept;
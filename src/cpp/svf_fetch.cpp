@@ -0,0 +1,317 @@
+/** @file
+ *
+ * A read-through cache over a Sparse Virtual File or Sparse Virtual File System that fetches missing data itself.
+ *
+ * Created on 2026-10-18.
+ *
+ * @verbatim
+    MIT License
+
+    Copyright (c) 2023-2025 Paul Ross
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+ @endverbatim
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#endif
+
+#include "svf_fetch.h"
+
+namespace SVFS {
+
+#pragma mark - Fetchers
+
+    /**
+     * @brief Open a local file to fetch from.
+     *
+     * This will raise an ExceptionSparseVirtualFile if the file can not be opened.
+     *
+     * @param path The file path.
+     */
+    LocalFileFetcher::LocalFileFetcher(const std::string &path) : m_path(path) {
+        std::ostringstream os;
+        os << "LocalFileFetcher::LocalFileFetcher():";
+#ifdef _WIN32
+        os << " local file fetchers are not supported on this platform.";
+        throw Exceptions::ExceptionSparseVirtualFile(os.str());
+#else
+        m_fd = open(path.c_str(), O_RDONLY);
+        if (m_fd < 0) {
+            os << " can not open \"" << path << "\": " << std::strerror(errno);
+            throw Exceptions::ExceptionSparseVirtualFile(os.str());
+        }
+#endif
+    }
+
+    /**
+     * @brief Read from the local file.
+     *
+     * This will raise an ExceptionSparseVirtualFile if the file can not be read.
+     *
+     * @param fpos The file position.
+     * @param len The number of bytes to read.
+     * @param buffer Where to copy the bytes to, this must have room for \c len bytes.
+     * @return The number of bytes read, less than \c len only at the end of the file.
+     */
+    size_t LocalFileFetcher::operator()(t_fpos fpos, size_t len, char *buffer) const {
+        size_t ret = 0;
+#ifndef _WIN32
+        while (ret < len) {
+            ssize_t count = pread(m_fd, buffer + ret, len - ret, static_cast<off_t>(fpos + ret));
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::ostringstream os;
+                os << "LocalFileFetcher::operator():";
+                os << " can not read " << len << " bytes at " << fpos << " from \"" << m_path << "\": ";
+                os << std::strerror(errno);
+                throw Exceptions::ExceptionSparseVirtualFile(os.str());
+            }
+            if (count == 0) {
+                break;
+            }
+            ret += static_cast<size_t>(count);
+        }
+#endif
+        return ret;
+    }
+
+    LocalFileFetcher::~LocalFileFetcher() noexcept {
+#ifndef _WIN32
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+#endif
+    }
+
+#pragma mark - Read-through
+
+    /**
+     * @brief Widen a read to the alignment, if any.
+     *
+     * @return The (file_position, length) of the widened read.
+     */
+    static t_seek_read _read_through_align(t_fpos fpos, size_t len, const tReadThroughConfig &config) noexcept {
+        t_fpos fpos_end = fpos + len;
+        if (config.alignment) {
+            fpos &= ~static_cast<t_fpos>(config.alignment - 1);
+            fpos_end = (fpos_end + config.alignment - 1) & ~static_cast<t_fpos>(config.alignment - 1);
+        }
+        return {fpos, fpos_end - fpos};
+    }
+
+    /**
+     * @brief Fetch what a read needs, waiting for any of it that another caller is fetching.
+     *
+     * This returns when the data is held or this caller has fetched, or failed to fetch, what is missing.
+     *
+     * @param svf The SVF.
+     * @param fpos The file position of the read.
+     * @param len The length of the read.
+     * @param config The greedy length and alignment.
+     * @param fetch The fetch function.
+     * @param count_fetch Incremented by the number of seek/reads fetched.
+     * @return The number of bytes fetched.
+     */
+    static size_t _read_through_single_flight(SparseVirtualFile &svf, t_fpos fpos, size_t len,
+                                              const tReadThroughConfig &config, const t_fetch_function &fetch,
+                                              std::atomic<size_t> &count_fetch) {
+        size_t ret = 0;
+        t_in_flight_futures in_flight;
+        do {
+            in_flight.clear();
+            t_seek_reads seek_reads = read_through_reserve(svf, fpos, len, config, in_flight);
+            if (!seek_reads.empty()) {
+                count_fetch += seek_reads.size();
+                try {
+                    ret += read_through_fetch(svf, seek_reads, fetch);
+                } catch (...) {
+                    svf.release_need(seek_reads);
+                    throw;
+                }
+                svf.release_need(seek_reads);
+            }
+            for (const auto &future: in_flight) {
+                future.wait();
+            }
+        } while (!in_flight.empty() && !svf.has(fpos, len));
+        return ret;
+    }
+
+    /**
+     * @brief The (file_position, length) pairs that a read-through cache would fetch for a read from a SVF.
+     *
+     * The read is widened to the alignment, if any, then this is what SparseVirtualFile::need() returns for that with
+     * the greedy length.
+     *
+     * @param svf The SVF.
+     * @param fpos The file position of the read.
+     * @param len The length of the read.
+     * @param config The greedy length and alignment.
+     * @return The seek/reads to fetch, empty if all the data is held.
+     */
+    t_seek_reads read_through_plan(const SparseVirtualFile &svf, t_fpos fpos, size_t len,
+                                   const tReadThroughConfig &config) {
+        t_seek_read aligned = _read_through_align(fpos, len, config);
+        return svf.need(aligned.first, aligned.second, config.greedy_length);
+    }
+
+    /**
+     * @brief As \c read_through_plan() but the seek/reads are reserved for the caller to fetch.
+     *
+     * See SparseVirtualFile::reserve_need(), the caller must give the result to SparseVirtualFile::release_need().
+     *
+     * @param svf The SVF.
+     * @param fpos The file position of the read.
+     * @param len The length of the read.
+     * @param config The greedy length and alignment.
+     * @param in_flight The futures of the seek/reads being fetched by other callers are added to this.
+     * @return The seek/reads to fetch, empty if all the data is held or being fetched.
+     */
+    t_seek_reads read_through_reserve(SparseVirtualFile &svf, t_fpos fpos, size_t len,
+                                      const tReadThroughConfig &config, t_in_flight_futures &in_flight) {
+        t_seek_read aligned = _read_through_align(fpos, len, config);
+        return svf.reserve_need(aligned.first, aligned.second, config.greedy_length, in_flight);
+    }
+
+    /**
+     * @brief Fetch the data of each seek/read and write it to a SVF.
+     *
+     * A short fetch means the end of the file so any later seek/reads are not fetched.
+     * Any exception from the fetch function or SparseVirtualFile::write() is propagated, data already written remains.
+     *
+     * @param svf The SVF.
+     * @param plan The seek/reads in file position order, see \c read_through_plan().
+     * @param fetch The fetch function.
+     * @return The number of bytes fetched.
+     */
+    size_t read_through_fetch(SparseVirtualFile &svf, const t_seek_reads &plan, const t_fetch_function &fetch) {
+        size_t ret = 0;
+        std::vector<char> buffer;
+        for (const auto &seek_read: plan) {
+            buffer.resize(seek_read.second);
+            size_t len = std::min(fetch(seek_read.first, seek_read.second, buffer.data()), seek_read.second);
+            if (len) {
+                svf.write(seek_read.first, buffer.data(), len);
+            }
+            ret += len;
+            if (len < seek_read.second) {
+                break;
+            }
+        }
+        return ret;
+    }
+
+    /**
+     * @brief Construct a read-through cache over a SVF.
+     *
+     * @param svf The SVF, this is not owned.
+     * @param fetch The fetch function, see \c t_fetch_function.
+     * @param config The greedy length and alignment used on a miss.
+     */
+    ReadThroughSparseVirtualFile::ReadThroughSparseVirtualFile(SparseVirtualFile &svf, t_fetch_function fetch,
+                                                               const tReadThroughConfig &config)
+            : m_svf(svf), m_fetch(std::move(fetch)), m_config(config) {}
+
+    /**
+     * @brief Read data from the SVF, fetching and writing any that is missing first.
+     *
+     * If all the data is held this is a single SparseVirtualFile::read().
+     * Concurrent misses for the same data fetch it once, the other callers wait for it, see
+     * SparseVirtualFile::reserve_need().
+     * This will raise an ExceptionSparseVirtualFileRead if the data is beyond the end of the original file and any
+     * exception from the fetch function.
+     *
+     * @param fpos The file position.
+     * @param len The length.
+     * @param p Where to copy the data to, this must have room for \c len bytes.
+     */
+    void ReadThroughSparseVirtualFile::read(t_fpos fpos, size_t len, char *p) {
+        try {
+            m_svf.read(fpos, len, p);
+            return;
+        } catch (const Exceptions::ExceptionSparseVirtualFileRead &) {}
+        m_bytes_fetch += _read_through_single_flight(m_svf, fpos, len, m_config, m_fetch, m_count_fetch);
+        m_svf.read(fpos, len, p);
+    }
+
+    /**
+     * @brief What \c read() would fetch, see \c read_through_plan().
+     */
+    t_seek_reads ReadThroughSparseVirtualFile::plan(t_fpos fpos, size_t len) const {
+        return read_through_plan(m_svf, fpos, len, m_config);
+    }
+
+    /**
+     * @brief Construct a read-through cache over a SVFS.
+     *
+     * @param svfs The SVFS, this is not owned.
+     * @param fetch The fetch function, see \c t_fetch_svfs_function.
+     * @param config The greedy length and alignment used on a miss.
+     */
+    ReadThroughSparseVirtualFileSystem::ReadThroughSparseVirtualFileSystem(SparseVirtualFileSystem &svfs,
+                                                                           t_fetch_svfs_function fetch,
+                                                                           const tReadThroughConfig &config)
+            : m_svfs(svfs), m_fetch(std::move(fetch)), m_config(config) {}
+
+    /**
+     * @brief Read data from a SVF, fetching and writing any that is missing first.
+     *
+     * As ReadThroughSparseVirtualFile::read(), if this fetches anything and the SVFS is then over its budget
+     * blocks are evicted after the read, see SparseVirtualFileSystem::evict_over_budget().
+     *
+     * @param id The SVF ID.
+     * @param fpos The file position.
+     * @param len The length.
+     * @param p Where to copy the data to, this must have room for \c len bytes.
+     */
+    void ReadThroughSparseVirtualFileSystem::read(const std::string &id, t_fpos fpos, size_t len, char *p) {
+        t_svf_handle svf = m_svfs.handle(id);
+        if (!svf) {
+            std::ostringstream os;
+            os << "ReadThroughSparseVirtualFileSystem::read():";
+            os << " No SVF ID \"" << id << "\"";
+            throw Exceptions::ExceptionSparseVirtualFileSystemOutOfRange(os.str());
+        }
+        try {
+            svf->read(fpos, len, p);
+            return;
+        } catch (const Exceptions::ExceptionSparseVirtualFileRead &) {}
+        m_bytes_fetch += _read_through_single_flight(
+                *svf, fpos, len, m_config,
+                [this, &id](t_fpos f, size_t l, char *buffer) { return m_fetch(id, f, l, buffer); },
+                m_count_fetch);
+        svf->read(fpos, len, p);
+        // Evict after the read so that the data just fetched is not evicted before it is read.
+        m_svfs.evict_over_budget();
+    }
+}
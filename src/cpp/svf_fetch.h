@@ -0,0 +1,187 @@
+/** @file
+ *
+ * A read-through cache over a Sparse Virtual File or Sparse Virtual File System that fetches missing data itself.
+ *
+ * Created on 2026-10-18.
+ *
+ * @verbatim
+    MIT License
+
+    Copyright (c) 2023-2025 Paul Ross
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+ @endverbatim
+ */
+
+#ifndef CPPSVF_SVF_FETCH_H
+#define CPPSVF_SVF_FETCH_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+
+#include "svf.h"
+#include "svfs.h"
+
+namespace SVFS {
+
+#pragma mark - Fetchers
+
+    /**
+     * Type of the function that fetches data from the original file.
+     * This copies up to \c len bytes at \c fpos into \c buffer and returns the number copied, this is less than \c len
+     * only at the end of the file.
+     * It throws an exception derived from \c std::exception on failure.
+     */
+    typedef std::function<size_t(t_fpos fpos, size_t len, char *buffer)> t_fetch_function;
+
+    /// As \c t_fetch_function for the original file of the given SVF ID.
+    typedef std::function<size_t(const std::string &id, t_fpos fpos, size_t len, char *buffer)> t_fetch_svfs_function;
+
+    /**
+     * @brief A fetcher that reads from a local file, this is mostly for testing and benchmarking.
+     *
+     * This can be used as a \c t_fetch_function and is thread safe.
+     */
+    class LocalFileFetcher {
+    public:
+        /// Open the file, this raises an ExceptionSparseVirtualFile if it can not be opened.
+        explicit LocalFileFetcher(const std::string &path);
+
+        /// Read up to \c len bytes at \c fpos into \c buffer returning the number read.
+        size_t operator()(t_fpos fpos, size_t len, char *buffer) const;
+
+        /// The file path.
+        [[nodiscard]] const std::string &path() const noexcept { return m_path; }
+
+        /// Eliminate copying, wrap in a \c std::shared_ptr or \c std::ref() to use as a \c t_fetch_function.
+        LocalFileFetcher(const LocalFileFetcher &rhs) = delete;
+
+        /// Eliminate copying.
+        LocalFileFetcher &operator=(const LocalFileFetcher &rhs) = delete;
+
+        ~LocalFileFetcher() noexcept;
+
+    private:
+        std::string m_path;
+        int m_fd = -1;
+    };
+
+#pragma mark - Read-through
+
+    /**
+     * @brief How a read-through cache plans what to fetch on a miss.
+     */
+    typedef struct ReadThroughConfig {
+        /// Fetch at least this many bytes at a time, see SparseVirtualFile::need().
+        size_t greedy_length = 0;
+        /// If non-zero the read is widened to this alignment before finding what is needed.
+        /// This must be zero or a power of two.
+        size_t alignment = 0;
+    } tReadThroughConfig;
+
+    /// The (file_position, length) pairs that a read-through cache would fetch for a read from a SVF.
+    [[nodiscard]] t_seek_reads read_through_plan(const SparseVirtualFile &svf, t_fpos fpos, size_t len,
+                                                 const tReadThroughConfig &config);
+
+    /// As \c read_through_plan() but the seek/reads are reserved for the caller, see SparseVirtualFile::reserve_need().
+    [[nodiscard]] t_seek_reads read_through_reserve(SparseVirtualFile &svf, t_fpos fpos, size_t len,
+                                                    const tReadThroughConfig &config, t_in_flight_futures &in_flight);
+
+    /// Fetch the data of a plan and write it to a SVF returning the number of bytes fetched.
+    size_t read_through_fetch(SparseVirtualFile &svf, const t_seek_reads &plan, const t_fetch_function &fetch);
+
+    /**
+     * @brief A read-through cache over a SparseVirtualFile.
+     *
+     * \c read() serves data from the SVF if it is held, otherwise it fetches what is missing, writes it to the SVF
+     * then serves it.
+     * This is thread safe if the SVF and the fetch function are, concurrent misses for the same data fetch it once.
+     */
+    class ReadThroughSparseVirtualFile {
+    public:
+        /// The SVF is not owned and must outlive this.
+        ReadThroughSparseVirtualFile(SparseVirtualFile &svf, t_fetch_function fetch,
+                                     const tReadThroughConfig &config = tReadThroughConfig());
+
+        /// Read, fetching any missing data. This may raise an ExceptionSparseVirtualFileRead at the end of the file.
+        void read(t_fpos fpos, size_t len, char *p);
+
+        /// What \c read() would fetch.
+        [[nodiscard]] t_seek_reads plan(t_fpos fpos, size_t len) const;
+
+        /// The SVF.
+        [[nodiscard]] SparseVirtualFile &svf() const noexcept { return m_svf; }
+
+        /// The configuration.
+        [[nodiscard]] const tReadThroughConfig &config() const noexcept { return m_config; }
+
+        /// The number of calls to the fetch function.
+        [[nodiscard]] size_t count_fetch() const noexcept { return m_count_fetch; }
+
+        /// The number of bytes fetched.
+        [[nodiscard]] size_t bytes_fetch() const noexcept { return m_bytes_fetch; }
+
+    private:
+        SparseVirtualFile &m_svf;
+        t_fetch_function m_fetch;
+        tReadThroughConfig m_config;
+        std::atomic<size_t> m_count_fetch{0};
+        std::atomic<size_t> m_bytes_fetch{0};
+    };
+
+    /**
+     * @brief A read-through cache over a SparseVirtualFileSystem.
+     *
+     * As ReadThroughSparseVirtualFile where the fetch function is given the SVF ID.
+     * The SVF must have been inserted, data fetched is written with any budget applied, see
+     * SparseVirtualFileSystem::set_budget().
+     */
+    class ReadThroughSparseVirtualFileSystem {
+    public:
+        /// The SVFS is not owned and must outlive this.
+        ReadThroughSparseVirtualFileSystem(SparseVirtualFileSystem &svfs, t_fetch_svfs_function fetch,
+                                           const tReadThroughConfig &config = tReadThroughConfig());
+
+        /// Read, fetching any missing data.
+        /// This may raise an ExceptionSparseVirtualFileSystemOutOfRange if there is no SVF of that ID.
+        void read(const std::string &id, t_fpos fpos, size_t len, char *p);
+
+        /// The SVFS.
+        [[nodiscard]] SparseVirtualFileSystem &svfs() const noexcept { return m_svfs; }
+
+        /// The configuration.
+        [[nodiscard]] const tReadThroughConfig &config() const noexcept { return m_config; }
+
+        /// The number of calls to the fetch function.
+        [[nodiscard]] size_t count_fetch() const noexcept { return m_count_fetch; }
+
+        /// The number of bytes fetched.
+        [[nodiscard]] size_t bytes_fetch() const noexcept { return m_bytes_fetch; }
+
+    private:
+        SparseVirtualFileSystem &m_svfs;
+        t_fetch_svfs_function m_fetch;
+        tReadThroughConfig m_config;
+        std::atomic<size_t> m_count_fetch{0};
+        std::atomic<size_t> m_bytes_fetch{0};
+    };
+}
+
+#endif //CPPSVF_SVF_FETCH_H
@@ -0,0 +1,366 @@
+/** @file
+ *
+ * An append only journal of the changes to a Sparse Virtual File System so that they survive a crash.
+ *
+ * Created on 2026-10-18.
+ *
+ * @verbatim
+    MIT License
+
+    Copyright (c) 2023-2025 Paul Ross
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+ @endverbatim
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#endif
+
+#include "svf_journal.h"
+
+namespace SVFS {
+
+    /** @brief The fixed size header of every journal record, this is followed by the ID then any data. */
+    struct t_journal_header {
+        /// Checksum of the rest of the header, the ID and the data.
+        uint64_t checksum;
+        /// A Journal::RECORD_TYPE.
+        uint32_t type;
+        /// Length of the ID.
+        uint32_t id_size;
+        /// File position, or the modification time for an insert.
+        uint64_t fpos;
+        /// Length of the data.
+        uint64_t len;
+    };
+
+    /**
+     * @brief A fast checksum of a buffer, this is FNV-1a taken eight bytes at a time.
+     *
+     * @param hash The initial value or the result of a previous call.
+     * @param data The data.
+     * @param len The length of the data.
+     * @return The checksum.
+     */
+    static uint64_t journal_checksum(uint64_t hash, const char *data, size_t len) noexcept {
+        const uint64_t prime = 0x100000001b3ULL;
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            hash = (hash ^ word) * prime;
+        }
+        for (; i < len; ++i) {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * prime;
+        }
+        return hash;
+    }
+
+    static const uint64_t JOURNAL_CHECKSUM_INITIAL = 0xcbf29ce484222325ULL;
+
+    /**
+     * @brief The checksum of a record.
+     *
+     * @param header The header, its checksum is ignored.
+     * @param id The ID.
+     * @param data The data.
+     * @return The checksum.
+     */
+    static uint64_t journal_record_checksum(const t_journal_header &header, const char *id, const char *data) noexcept {
+        uint64_t ret = journal_checksum(JOURNAL_CHECKSUM_INITIAL,
+                                        reinterpret_cast<const char *>(&header) + sizeof(header.checksum),
+                                        sizeof(header) - sizeof(header.checksum));
+        ret = journal_checksum(ret, id, header.id_size);
+        return journal_checksum(ret, data, header.len);
+    }
+
+    /**
+     * @brief Open a journal for appending, creating the file if necessary.
+     *
+     * This will raise an ExceptionSparseVirtualFile if the file can not be opened.
+     *
+     * @param path The journal path.
+     * @param sync_bytes Records are buffered until there are this many bytes then written and synced, zero writes and
+     * syncs every record.
+     */
+    Journal::Journal(const std::string &path, size_t sync_bytes) : m_path(path), m_sync_bytes(sync_bytes) {
+        _open_no_lock();
+        m_buffer.reserve(sync_bytes);
+    }
+
+    /**
+     * @brief Open the journal file for appending.
+     *
+     * This will raise an ExceptionSparseVirtualFile if the file can not be opened.
+     */
+    void Journal::_open_no_lock() {
+        std::ostringstream os;
+        os << "Journal::Journal():";
+#ifdef _WIN32
+        os << " journals are not supported on this platform.";
+        throw Exceptions::ExceptionSparseVirtualFile(os.str());
+#else
+        m_fd = open(m_path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (m_fd < 0) {
+            os << " can not open \"" << m_path << "\": " << std::strerror(errno);
+            throw Exceptions::ExceptionSparseVirtualFile(os.str());
+        }
+#endif
+    }
+
+    /** @brief Flush and close the journal. */
+    Journal::~Journal() noexcept {
+        try {
+            flush();
+        } catch (const std::exception &) {}
+#ifndef _WIN32
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+#endif
+    }
+
+    /**
+     * @brief Append a record to the buffer and flush it if it has reached the sync size.
+     *
+     * @param type The record type.
+     * @param id The SVF ID.
+     * @param fpos The file position or the bits of the modification time.
+     * @param data The data, may be \c nullptr if the length is zero.
+     * @param len The length of the data.
+     */
+    void Journal::_append(RECORD_TYPE type, const std::string &id, uint64_t fpos, const char *data, size_t len) {
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        t_journal_header header{0, type, static_cast<uint32_t>(id.size()), fpos, len};
+        header.checksum = journal_record_checksum(header, id.data(), data);
+        m_buffer.append(reinterpret_cast<const char *>(&header), sizeof(header));
+        m_buffer.append(id);
+        if (len) {
+            m_buffer.append(data, len);
+        }
+        m_count_records += 1;
+        m_bytes_journal += sizeof(header) + id.size() + len;
+        if (m_buffer.size() >= m_sync_bytes) {
+            _flush_no_lock();
+        }
+    }
+
+    /**
+     * @brief Journal the insertion of a new SVF.
+     *
+     * @param id The SVF ID.
+     * @param mod_time The file modification time.
+     */
+    void Journal::insert(const std::string &id, double mod_time) {
+        uint64_t bits;
+        std::memcpy(&bits, &mod_time, sizeof(bits));
+        _append(RECORD_INSERT, id, bits, nullptr, 0);
+    }
+
+    /**
+     * @brief Journal the removal of an SVF.
+     *
+     * @param id The SVF ID.
+     */
+    void Journal::remove(const std::string &id) {
+        _append(RECORD_REMOVE, id, 0, nullptr, 0);
+    }
+
+    /**
+     * @brief Journal a write to an SVF.
+     *
+     * @param id The SVF ID.
+     * @param fpos The file position.
+     * @param data The data.
+     * @param len The length of the data.
+     */
+    void Journal::write(const std::string &id, t_fpos fpos, const char *data, size_t len) {
+        _append(RECORD_WRITE, id, fpos, data, len);
+    }
+
+    /**
+     * @brief Journal the erasure of a block from an SVF.
+     *
+     * @param id The SVF ID.
+     * @param fpos The file position of the start of the block.
+     */
+    void Journal::erase(const std::string &id, t_fpos fpos) {
+        _append(RECORD_ERASE, id, fpos, nullptr, 0);
+    }
+
+    /**
+     * @brief Journal clearing an SVF.
+     *
+     * @param id The SVF ID.
+     */
+    void Journal::clear(const std::string &id) {
+        _append(RECORD_CLEAR, id, 0, nullptr, 0);
+    }
+
+    /**
+     * @brief Write any buffered records and sync the file.
+     *
+     * This will raise an ExceptionSparseVirtualFile if the write fails.
+     */
+    void Journal::flush() {
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        _flush_no_lock();
+    }
+
+    void Journal::_flush_no_lock() {
+#ifndef _WIN32
+        if (m_buffer.empty()) {
+            return;
+        }
+        size_t offset = 0;
+        while (offset < m_buffer.size()) {
+            ssize_t written = ::write(m_fd, m_buffer.data() + offset, m_buffer.size() - offset);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::ostringstream os;
+                os << "Journal::flush(): can not write to \"" << m_path << "\": " << std::strerror(errno);
+                throw Exceptions::ExceptionSparseVirtualFile(os.str());
+            }
+            offset += static_cast<size_t>(written);
+        }
+        m_buffer.clear();
+#ifdef __APPLE__
+        fsync(m_fd);
+#else
+        fdatasync(m_fd);
+#endif
+        m_count_sync += 1;
+#endif
+    }
+
+    /**
+     * @brief Flush then move the journal aside and start an empty one.
+     *
+     * This is used by a checkpoint, the journal is moved to \c path_rotated() then a snapshot is saved and then the
+     * rotated journal removed.
+     * If a previous checkpoint failed the rotated journal still exists and this journal is appended to it.
+     *
+     * This will raise an ExceptionSparseVirtualFile on failure.
+     */
+    void Journal::rotate() {
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        _flush_no_lock();
+#ifndef _WIN32
+        close(m_fd);
+        m_fd = -1;
+#endif
+        const std::string path_old = path_rotated(m_path);
+        std::error_code error;
+        if (std::filesystem::exists(path_old)) {
+            std::ifstream stream_in(m_path, std::ios::binary);
+            std::ofstream stream_out(path_old, std::ios::binary | std::ios::app);
+            stream_out << stream_in.rdbuf();
+            stream_out.close();
+            if (!stream_out) {
+                std::ostringstream os;
+                os << "Journal::rotate(): can not append \"" << m_path << "\" to \"" << path_old << "\"";
+                _open_no_lock();
+                throw Exceptions::ExceptionSparseVirtualFile(os.str());
+            }
+            std::filesystem::remove(m_path, error);
+        } else {
+            std::filesystem::rename(m_path, path_old, error);
+        }
+        if (error) {
+            std::ostringstream os;
+            os << "Journal::rotate(): can not move \"" << m_path << "\" to \"" << path_old << "\": ";
+            os << error.message();
+            _open_no_lock();
+            throw Exceptions::ExceptionSparseVirtualFile(os.str());
+        }
+        _open_no_lock();
+    }
+
+    /**
+     * @brief Call a function with every valid record in a journal file in the order that they were written.
+     *
+     * Reading stops at the first record that is truncated or has a bad checksum, this is from a crash during a write.
+     * A journal file that does not exist has no records.
+     *
+     * This will raise an ExceptionSparseVirtualFile if the file exists but can not be read.
+     *
+     * @param path The journal path.
+     * @param function Called with each record, the data is only valid during the call.
+     * @return The length of the valid records, any bytes after this should be truncated before appending.
+     */
+    size_t Journal::replay(const std::string &path, const t_replay_function &function) {
+        if (!std::filesystem::exists(path)) {
+            return 0;
+        }
+        std::ifstream stream(path, std::ios::binary);
+        if (!stream) {
+            std::ostringstream os;
+            os << "Journal::replay(): can not open \"" << path << "\": " << std::strerror(errno);
+            throw Exceptions::ExceptionSparseVirtualFile(os.str());
+        }
+        const size_t file_size = std::filesystem::file_size(path);
+        size_t ret = 0;
+        std::string id;
+        std::vector<char> data;
+        t_journal_header header{};
+        while (stream.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+            if (header.type < RECORD_INSERT || header.type > RECORD_CLEAR
+                || header.id_size + header.len > file_size - ret - sizeof(header)) {
+                break;
+            }
+            id.resize(header.id_size);
+            data.resize(header.len);
+            if (!stream.read(id.data(), static_cast<std::streamsize>(id.size()))
+                || !stream.read(data.data(), static_cast<std::streamsize>(data.size()))) {
+                break;
+            }
+            if (journal_record_checksum(header, id.data(), data.data()) != header.checksum) {
+                break;
+            }
+            t_entry entry{static_cast<RECORD_TYPE>(header.type), id, header.fpos, 0.0, data.data(), data.size()};
+            if (entry.type == RECORD_INSERT) {
+                std::memcpy(&entry.mod_time, &header.fpos, sizeof(entry.mod_time));
+                entry.fpos = 0;
+            }
+            function(entry);
+            ret += sizeof(header) + header.id_size + header.len;
+        }
+        return ret;
+    }
+
+} // namespace SVFS
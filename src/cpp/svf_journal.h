@@ -0,0 +1,177 @@
+/** @file
+ *
+ * An append only journal of the changes to a Sparse Virtual File System so that they survive a crash.
+ *
+ * Created on 2026-10-18.
+ *
+ * @verbatim
+    MIT License
+
+    Copyright (c) 2023-2025 Paul Ross
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+ @endverbatim
+ */
+
+#ifndef CPPSVF_SVF_JOURNAL_H
+#define CPPSVF_SVF_JOURNAL_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#ifdef SVF_THREAD_SAFE
+
+#include <mutex>
+
+#endif
+
+#include "svf.h"
+
+namespace SVFS {
+
+#pragma mark - Journal
+
+    /// The default number of journalled bytes between each \c fdatasync().
+    static const size_t SVFS_JOURNAL_SYNC_BYTES_DEFAULT = 1024 * 1024;
+
+    /**
+     * @brief An append only log of the changes to Sparse Virtual Files that can be replayed after a crash.
+     *
+     * Each record has a fixed size header with a checksum, the SVF ID and, for a write, the data.
+     * Records are buffered in memory and are written and synced to the file once the buffer reaches the sync size,
+     * so at most that many bytes of changes are lost on a crash.
+     * A truncated or corrupt record at the end of the file, from a crash during a write, is ignored on replay.
+     *
+     * All integers are in native byte order.
+     *
+     * This is thread safe as it is shared by every SparseVirtualFile in a SparseVirtualFileSystem.
+     */
+    class Journal {
+    public:
+        /// The type of a journal record.
+        enum RECORD_TYPE : uint32_t {
+            /// A new SVF, the file position holds the modification time.
+            RECORD_INSERT = 1,
+            /// An SVF was removed.
+            RECORD_REMOVE,
+            /// Data was written at the file position.
+            RECORD_WRITE,
+            /// The block at the file position was erased or punted.
+            RECORD_ERASE,
+            /// An SVF was cleared.
+            RECORD_CLEAR,
+        };
+
+        /// A record read from a journal.
+        struct t_entry {
+            /// The record type.
+            RECORD_TYPE type;
+            /// The SVF ID.
+            std::string id;
+            /// The file position for a write or erase.
+            t_fpos fpos;
+            /// The modification time for an insert.
+            double mod_time;
+            /// The data for a write.
+            const char *data;
+            /// The length of the data for a write.
+            size_t len;
+        };
+
+        /// Type of the function that is called with each record by \c replay().
+        typedef std::function<void(const t_entry &entry)> t_replay_function;
+
+        Journal(const std::string &path, size_t sync_bytes);
+
+        void insert(const std::string &id, double mod_time);
+
+        void remove(const std::string &id);
+
+        void write(const std::string &id, t_fpos fpos, const char *data, size_t len);
+
+        void erase(const std::string &id, t_fpos fpos);
+
+        void clear(const std::string &id);
+
+        /// Write any buffered records and sync the file.
+        void flush();
+
+        /// Flush then move the journal to \c path_rotated(), appending if that exists, and start an empty journal.
+        void rotate();
+
+        /// Call a function with every valid record in a journal file.
+        /// Returns the length of the valid records.
+        static size_t replay(const std::string &path, const t_replay_function &function);
+
+        /// The path of the journal.
+        [[nodiscard]] const std::string &path() const noexcept { return m_path; }
+
+        /// The path that \c rotate() moves the journal to.
+        [[nodiscard]] static std::string path_rotated(const std::string &path) { return path + ".old"; }
+
+        /// The number of bytes buffered before they are written and synced.
+        [[nodiscard]] size_t sync_bytes() const noexcept { return m_sync_bytes; }
+
+        /// The total count of records.
+        [[nodiscard]] size_t count_records() const noexcept { return m_count_records; }
+
+        /// The total count of bytes journalled.
+        [[nodiscard]] size_t bytes_journal() const noexcept { return m_bytes_journal; }
+
+        /// The total count of syncs.
+        [[nodiscard]] size_t count_sync() const noexcept { return m_count_sync; }
+
+        /// Eliminate copying.
+        Journal(const Journal &rhs) = delete;
+
+        /// Eliminate copying.
+        Journal &operator=(const Journal &rhs) = delete;
+
+        /// Destruction flushes the journal, errors are ignored.
+        ~Journal() noexcept;
+
+    private:
+        void _append(RECORD_TYPE type, const std::string &id, uint64_t fpos, const char *data, size_t len);
+
+        void _flush_no_lock();
+
+        void _open_no_lock();
+
+        /// The journal path.
+        std::string m_path;
+        /// Number of bytes to buffer before writing and syncing.
+        size_t m_sync_bytes;
+        /// File descriptor.
+        int m_fd = -1;
+        /// Records not yet written.
+        std::string m_buffer;
+        /// Statistics.
+        size_t m_count_records = 0;
+        size_t m_bytes_journal = 0;
+        size_t m_count_sync = 0;
+#ifdef SVF_THREAD_SAFE
+        /// The journal is shared by every SVF in an SVFS.
+        mutable std::mutex m_mutex;
+#endif
+    };
+
+} // namespace SVFS
+
+#endif //CPPSVF_SVF_JOURNAL_H
@@ -0,0 +1,683 @@
+/** @file
+ *
+ * A Sparse Virtual File implementation that holds fixed size pages.
+ *
+ * Created on 2026-10-18.
+ *
+ * @verbatim
+    MIT License
+
+    Copyright (c) 2023-2025 Paul Ross
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+ @endverbatim
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+#include "svf_paged.h"
+
+namespace SVFS {
+    /**
+     * @brief Used to overwrite the memory before discarding it (if required).
+     */
+    static const char OVERWRITE_CHAR = '0';
+
+    /**
+     * @brief The number of free pages that keep their data buffer for reuse, the buffers of any other free pages are
+     * released.
+     */
+    static const size_t PAGES_FREE_BUFFERED = 4;
+
+    /**
+     * @brief Create a paged Sparse Virtual File
+     *
+     * This will raise an ExceptionSparseVirtualFile if the page size is not a non-zero power of two.
+     *
+     * @param id The identifier for this file.
+     * @param mod_time The modification time of the remote file in UNIX seconds, this is used for integrity checking.
+     * @param config See \c SVFS::PagedSparseVirtualFileConfig.
+     */
+    PagedSparseVirtualFile::PagedSparseVirtualFile(const std::string &id, double mod_time,
+                                                   const tPagedSparseVirtualFileConfig &config) :
+            m_id(id),
+            m_file_mod_time(mod_time),
+            m_config(config),
+            m_time_write(std::chrono::time_point<std::chrono::system_clock>::min()),
+            m_time_read(std::chrono::time_point<std::chrono::system_clock>::min()) {
+        if (m_config.page_size == 0 || (m_config.page_size & (m_config.page_size - 1))) {
+            std::ostringstream os;
+            os << "PagedSparseVirtualFile::PagedSparseVirtualFile():";
+            os << " page_size " << m_config.page_size << " is not a non-zero power of two.";
+            throw Exceptions::ExceptionSparseVirtualFile(os.str());
+        }
+        while ((static_cast<size_t>(1) << m_page_shift) < m_config.page_size) {
+            ++m_page_shift;
+        }
+    }
+
+#pragma mark - Hash table
+
+    /**
+     * @brief The preferred slot for a page number using Fibonacci hashing.
+     */
+    size_t PagedSparseVirtualFile::_slot_home(t_fpos number) const noexcept {
+        assert(m_table_bits);
+        return static_cast<size_t>((static_cast<uint64_t>(number) * 0x9E3779B97F4A7C15ULL) >> (64 - m_table_bits));
+    }
+
+    /**
+     * @brief Find the page with the given page number.
+     *
+     * @param number The page number.
+     * @return The index into \c m_pages or \c PAGE_NONE if the page is not held.
+     */
+    PagedSparseVirtualFile::t_page_index PagedSparseVirtualFile::_find(t_fpos number) const noexcept {
+        if (m_table.empty()) {
+            return PAGE_NONE;
+        }
+        const size_t mask = m_table.size() - 1;
+        for (size_t slot = _slot_home(number);; slot = (slot + 1) & mask) {
+            if (m_table[slot].page == PAGE_NONE) {
+                return PAGE_NONE;
+            }
+            if (m_table[slot].number == number) {
+                return m_table[slot].page;
+            }
+        }
+    }
+
+    /**
+     * @brief Insert a page number that is not already in the table, this may grow the table.
+     */
+    void PagedSparseVirtualFile::_insert(t_fpos number, t_page_index page) {
+        assert(_find(number) == PAGE_NONE);
+        // Keep the load factor at or below one half.
+        if ((m_num_pages + 1) * 2 > m_table.size()) {
+            _grow();
+        }
+        const size_t mask = m_table.size() - 1;
+        size_t slot = _slot_home(number);
+        while (m_table[slot].page != PAGE_NONE) {
+            slot = (slot + 1) & mask;
+        }
+        m_table[slot].number = number;
+        m_table[slot].page = page;
+    }
+
+    /**
+     * @brief Remove a page number from the table using backward shift deletion so no tombstones are needed.
+     */
+    void PagedSparseVirtualFile::_remove(t_fpos number) noexcept {
+        assert(!m_table.empty());
+        const size_t mask = m_table.size() - 1;
+        size_t slot = _slot_home(number);
+        while (m_table[slot].number != number || m_table[slot].page == PAGE_NONE) {
+            assert(m_table[slot].page != PAGE_NONE);
+            slot = (slot + 1) & mask;
+        }
+        size_t next = slot;
+        while (true) {
+            next = (next + 1) & mask;
+            if (m_table[next].page == PAGE_NONE) {
+                break;
+            }
+            size_t home = _slot_home(m_table[next].number);
+            // Leave the entry alone if its home is cyclically within (slot, next].
+            bool stays = slot <= next ? (slot < home && home <= next) : (slot < home || home <= next);
+            if (!stays) {
+                m_table[slot] = m_table[next];
+                slot = next;
+            }
+        }
+        m_table[slot].page = PAGE_NONE;
+    }
+
+    /**
+     * @brief Double the size of the hash table and re-insert all the pages.
+     */
+    void PagedSparseVirtualFile::_grow() {
+        const unsigned int table_bits = m_table_bits ? m_table_bits + 1 : 4;
+        std::vector<t_slot> table(static_cast<size_t>(1) << table_bits, t_slot{0, PAGE_NONE});
+        m_table.swap(table);
+        m_table_bits = table_bits;
+        const size_t mask = m_table.size() - 1;
+        for (const t_slot &entry: table) {
+            if (entry.page != PAGE_NONE) {
+                size_t slot = _slot_home(entry.number);
+                while (m_table[slot].page != PAGE_NONE) {
+                    slot = (slot + 1) & mask;
+                }
+                m_table[slot] = entry;
+            }
+        }
+    }
+
+#pragma mark - Pages and the LRU list
+
+    /**
+     * @brief Create a new empty page, reusing a free page if possible, and make it the most recently used.
+     *
+     * @param number The page number.
+     * @return The index into \c m_pages.
+     */
+    PagedSparseVirtualFile::t_page_index PagedSparseVirtualFile::_page_new(t_fpos number) {
+        t_page_index page;
+        if (m_pages_free.empty()) {
+            if (m_pages.size() >= PAGE_NONE) {
+                std::ostringstream os;
+                os << "PagedSparseVirtualFile::write():";
+                os << " Can not hold more than " << PAGE_NONE << " pages.";
+                throw Exceptions::ExceptionSparseVirtualFileWrite(os.str());
+            }
+            // Make sure that _page_free() can not allocate.
+            if (m_pages_free.capacity() < m_pages.size() + 1) {
+                m_pages_free.reserve(2 * (m_pages.size() + 1));
+            }
+            m_pages.push_back(t_page{0, 0, PAGE_NONE, PAGE_NONE, std::unique_ptr<char[]>(new char[m_config.page_size])});
+            ++m_pages_buffered;
+            page = static_cast<t_page_index>(m_pages.size() - 1);
+        } else {
+            page = m_pages_free.back();
+            if (!m_pages[page].data) {
+                m_pages[page].data.reset(new char[m_config.page_size]);
+                ++m_pages_buffered;
+            }
+            m_pages_free.pop_back();
+        }
+        try {
+            _insert(number, page);
+        } catch (...) {
+            m_pages_free.push_back(page);
+            throw;
+        }
+        m_pages[page].number = number;
+        m_pages[page].size = 0;
+        _lru_push_front(page);
+        ++m_num_pages;
+        return page;
+    }
+
+    /**
+     * @brief Remove the page from the table and the LRU list and put it on the free list.
+     *
+     * The data buffer is released unless fewer than \c PAGES_FREE_BUFFERED free pages have one.
+     * This does not update the byte count.
+     */
+    void PagedSparseVirtualFile::_page_free(t_page_index page) noexcept {
+        t_page &value = m_pages[page];
+        _remove(value.number);
+        _lru_unlink(page);
+        if (m_config.overwrite_on_exit) {
+            std::memset(value.data.get(), OVERWRITE_CHAR, value.size);
+        }
+        value.size = 0;
+        // Free pages that have a buffer, not counting this one.
+        if (m_pages_buffered - m_num_pages >= PAGES_FREE_BUFFERED) {
+            value.data.reset();
+            --m_pages_buffered;
+        }
+        // This does not allocate as _page_new() reserves space for every page.
+        m_pages_free.push_back(page);
+        --m_num_pages;
+    }
+
+    /**
+     * @brief Remove the page from the LRU list.
+     */
+    void PagedSparseVirtualFile::_lru_unlink(t_page_index page) noexcept {
+        t_page &value = m_pages[page];
+        if (value.lru_prev == PAGE_NONE) {
+            m_lru_head = value.lru_next;
+        } else {
+            m_pages[value.lru_prev].lru_next = value.lru_next;
+        }
+        if (value.lru_next == PAGE_NONE) {
+            m_lru_tail = value.lru_prev;
+        } else {
+            m_pages[value.lru_next].lru_prev = value.lru_prev;
+        }
+        value.lru_prev = value.lru_next = PAGE_NONE;
+    }
+
+    /**
+     * @brief Make the page, which must not be in the LRU list, the most recently used.
+     */
+    void PagedSparseVirtualFile::_lru_push_front(t_page_index page) noexcept {
+        t_page &value = m_pages[page];
+        value.lru_prev = PAGE_NONE;
+        value.lru_next = m_lru_head;
+        if (m_lru_head == PAGE_NONE) {
+            m_lru_tail = page;
+        } else {
+            m_pages[m_lru_head].lru_prev = page;
+        }
+        m_lru_head = page;
+    }
+
+#pragma mark - Read and write
+
+    /**
+     * @brief Does the SVF have the data without using the mutex.
+     */
+    bool PagedSparseVirtualFile::_has_no_lock(t_fpos fpos, size_t len) const noexcept {
+        const t_fpos fpos_end = fpos + len;
+        for (t_fpos number = fpos >> m_page_shift; (number << m_page_shift) < fpos_end; ++number) {
+            t_page_index page = _find(number);
+            if (page == PAGE_NONE) {
+                return false;
+            }
+            // The bytes needed from this page end here.
+            size_t needed = std::min(m_config.page_size, fpos_end - (number << m_page_shift));
+            if (m_pages[page].size < needed) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Checks if the SVF has the data.
+     *
+     * This is constant time for each page spanned.
+     *
+     * @param fpos The file position.
+     * @param len The length.
+     * @return true if the SVF has the data.
+     */
+    bool PagedSparseVirtualFile::has(t_fpos fpos, size_t len) const noexcept {
+        SVF_ASSERT(integrity() == ERROR_NONE);
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        return _has_no_lock(fpos, len);
+    }
+
+    /**
+     * @brief Write the data to the SVF.
+     *
+     * The file position must be at the start of a page or at the end of the data in a partially held page.
+     * This will raise an ExceptionSparseVirtualFileWrite if not.
+     * If \c compare_for_diff is set this will raise an ExceptionSparseVirtualFileDiff if the data differs from data
+     * already held, this is checked before anything is written.
+     *
+     * @param fpos The file position to write to.
+     * @param data The data, assumed to be of the given length.
+     * @param len The length to the data to write.
+     */
+    void PagedSparseVirtualFile::write(t_fpos fpos, const char *data, size_t len) {
+        SVF_ASSERT(integrity() == ERROR_NONE);
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        const size_t page_mask = m_config.page_size - 1;
+        const t_fpos fpos_end = fpos + len;
+        if (fpos & page_mask) {
+            t_page_index page = _find(fpos >> m_page_shift);
+            if (page == PAGE_NONE || m_pages[page].size < (fpos & page_mask)) {
+                std::ostringstream os;
+                os << "PagedSparseVirtualFile::write():";
+                os << " File position " << fpos << " is neither at the start of a page of size "
+                   << m_config.page_size << " nor within the data held by a page.";
+                throw Exceptions::ExceptionSparseVirtualFileWrite(os.str());
+            }
+        }
+        if (m_config.compare_for_diff) {
+            for (t_fpos pos = fpos; pos < fpos_end;) {
+                const size_t offset = pos & page_mask;
+                const size_t count = std::min(m_config.page_size - offset, fpos_end - pos);
+                t_page_index page = _find(pos >> m_page_shift);
+                if (page != PAGE_NONE && m_pages[page].size > offset) {
+                    const size_t overlap = std::min(count, m_pages[page].size - offset);
+                    const char *held = m_pages[page].data.get() + offset;
+                    const char *new_data = data + (pos - fpos);
+                    if (std::memcmp(held, new_data, overlap)) {
+                        size_t index = 0;
+                        while (held[index] == new_data[index]) {
+                            ++index;
+                        }
+                        std::ostringstream os;
+                        os << "PagedSparseVirtualFile::write():";
+                        os << " Difference at position " << pos + index;
+                        os << " '" << new_data[index] << "' != '" << held[index] << "'";
+                        os << " Ordinal " << static_cast<int>(new_data[index]) << " != "
+                           << static_cast<int>(held[index]);
+                        throw Exceptions::ExceptionSparseVirtualFileDiff(os.str());
+                    }
+                }
+                pos += count;
+            }
+        }
+        for (t_fpos pos = fpos; pos < fpos_end;) {
+            const size_t offset = pos & page_mask;
+            const size_t count = std::min(m_config.page_size - offset, fpos_end - pos);
+            t_page_index page = _find(pos >> m_page_shift);
+            if (page == PAGE_NONE) {
+                page = _page_new(pos >> m_page_shift);
+            } else {
+                _lru_unlink(page);
+                _lru_push_front(page);
+            }
+            t_page &value = m_pages[page];
+            std::memcpy(value.data.get() + offset, data + (pos - fpos), count);
+            if (offset + count > value.size) {
+                m_bytes_total += offset + count - value.size;
+                value.size = offset + count;
+            }
+            pos += count;
+        }
+        m_count_write += 1;
+        m_bytes_write += len;
+        m_time_write = std::chrono::system_clock::now();
+        SVF_ASSERT(integrity() == ERROR_NONE);
+    }
+
+    /**
+     * @brief Read data and write to the buffer provided by the caller.
+     *
+     * This will raise an ExceptionSparseVirtualFileRead if the SVF does not have all of the data.
+     * The pages read become the most recently used.
+     *
+     * @param fpos The file position to read from.
+     * @param len The length of the read.
+     * @param p The buffer to write to, this must be at least of size \c len.
+     */
+    void PagedSparseVirtualFile::read(t_fpos fpos, size_t len, char *p) {
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        SVF_ASSERT(integrity() == ERROR_NONE);
+        if (!_has_no_lock(fpos, len)) {
+            std::ostringstream os;
+            os << "PagedSparseVirtualFile::read():";
+            os << " Requested position " << fpos << " length " << len;
+            os << " (end " << fpos + len << ") is not held.";
+            throw Exceptions::ExceptionSparseVirtualFileRead(os.str());
+        }
+        const size_t page_mask = m_config.page_size - 1;
+        const t_fpos fpos_end = fpos + len;
+        for (t_fpos pos = fpos; pos < fpos_end;) {
+            const size_t offset = pos & page_mask;
+            const size_t count = std::min(m_config.page_size - offset, fpos_end - pos);
+            t_page_index page = _find(pos >> m_page_shift);
+            std::memcpy(p + (pos - fpos), m_pages[page].data.get() + offset, count);
+            _lru_unlink(page);
+            _lru_push_front(page);
+            pos += count;
+        }
+        m_count_read += 1;
+        m_bytes_read += len;
+        m_time_read = std::chrono::system_clock::now();
+    }
+
+    /**
+     * @brief Given a file position and a length what data do I need that I don't yet have?
+     *
+     * The result is a list of whole, coalesced, pages so that writing them is always possible.
+     * The last page may extend beyond the end of the actual file, the caller can write a shorter read.
+     *
+     * @param fpos The file position.
+     * @param len The length.
+     * @param greedy_length If non-zero each read is extended to at least this many bytes, rounded up to whole
+     *  pages, and overlapping reads are coalesced.
+     * @return A vector of pairs (file_position, length) that this SVF needs.
+     */
+    t_seek_reads PagedSparseVirtualFile::need(t_fpos fpos, size_t len, size_t greedy_length) const noexcept {
+        SVF_ASSERT(integrity() == ERROR_NONE);
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        t_seek_reads ret;
+        const t_fpos fpos_end = fpos + len;
+        const size_t greedy_pages = (greedy_length + m_config.page_size - 1) >> m_page_shift;
+        for (t_fpos number = fpos >> m_page_shift; (number << m_page_shift) < fpos_end; ++number) {
+            t_page_index page = _find(number);
+            size_t needed = std::min(m_config.page_size, fpos_end - (number << m_page_shift));
+            if (page != PAGE_NONE && m_pages[page].size >= needed) {
+                continue;
+            }
+            const t_fpos page_fpos = number << m_page_shift;
+            if (!ret.empty() && ret.back().first + ret.back().second >= page_fpos) {
+                // Extend or already covered by a greedy read.
+                if (ret.back().first + ret.back().second == page_fpos) {
+                    ret.back().second += m_config.page_size;
+                }
+            } else {
+                ret.emplace_back(page_fpos, std::max(greedy_pages, static_cast<size_t>(1)) << m_page_shift);
+            }
+        }
+        return ret;
+    }
+
+#pragma mark - Removing pages
+
+    /**
+     * @brief Clears the SVF, releasing all the memory, this maintains the ID and configuration.
+     */
+    void PagedSparseVirtualFile::clear() noexcept {
+        SVF_ASSERT(integrity() == ERROR_NONE);
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        if (m_config.overwrite_on_exit) {
+            for (auto &page: m_pages) {
+                if (page.data) {
+                    std::memset(page.data.get(), OVERWRITE_CHAR, page.size);
+                }
+            }
+        }
+        std::vector<t_slot>().swap(m_table);
+        m_table_bits = 0;
+        std::vector<t_page>().swap(m_pages);
+        std::vector<t_page_index>().swap(m_pages_free);
+        m_pages_buffered = 0;
+        m_lru_head = m_lru_tail = PAGE_NONE;
+        m_num_pages = 0;
+        m_bytes_total = 0;
+        m_count_write = 0;
+        m_count_read = 0;
+        m_bytes_write = 0;
+        m_bytes_read = 0;
+        m_time_write = std::chrono::time_point<std::chrono::system_clock>::min();
+        m_time_read = std::chrono::time_point<std::chrono::system_clock>::min();
+        m_blocks_erased = 0;
+        m_bytes_erased = 0;
+        m_blocks_punted = 0;
+        m_bytes_punted = 0;
+        SVF_ASSERT(integrity() == ERROR_NONE);
+    }
+
+    /**
+     * @brief Remove the page at the given file position.
+     *
+     * This will raise an ExceptionSparseVirtualFileErase if the file position is not the start of a held page.
+     *
+     * @param fpos File position of the start of the page.
+     * @return Number of bytes removed.
+     */
+    size_t PagedSparseVirtualFile::erase(t_fpos fpos) {
+        SVF_ASSERT(integrity() == ERROR_NONE);
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        t_page_index page = (fpos & (m_config.page_size - 1)) ? PAGE_NONE : _find(fpos >> m_page_shift);
+        if (page == PAGE_NONE) {
+            std::ostringstream os;
+            os << "PagedSparseVirtualFile::erase():";
+            os << " Non-existent file position " << fpos << " at start of page.";
+            throw Exceptions::ExceptionSparseVirtualFileErase(os.str());
+        }
+        size_t ret = m_pages[page].size;
+        m_bytes_total -= ret;
+        _page_free(page);
+        m_blocks_erased++;
+        m_bytes_erased += ret;
+        SVF_ASSERT(integrity() == ERROR_NONE);
+        return ret;
+    }
+
+    /**
+     * Implements a Last Recently Used punting strategy.
+     * This brings the cache size to < cache_size_upper_bound but leaving at least one page in place.
+     * This is constant time for each page punted.
+     *
+     * @param cache_size_upper_bound The upper bound of the final cache size.
+     * @return The number of bytes removed.
+     */
+    size_t PagedSparseVirtualFile::lru_punt(size_t cache_size_upper_bound) {
+        SVF_ASSERT(integrity() == ERROR_NONE);
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        size_t ret = 0;
+        while (m_num_pages > 1 && m_bytes_total >= cache_size_upper_bound) {
+            t_page_index page = m_lru_tail;
+            size_t size = m_pages[page].size;
+            m_bytes_total -= size;
+            _page_free(page);
+            ret += size;
+            m_blocks_erased++;
+            m_bytes_erased += size;
+            m_blocks_punted++;
+        }
+        m_bytes_punted += ret;
+        SVF_ASSERT(integrity() == ERROR_NONE);
+        return ret;
+    }
+
+#pragma mark - Meta information
+
+    /**
+     * @brief Returns a description of the current pages as a vector of (file_position, length) sorted by file
+     * position.
+     *
+     * This is O(n log(n)) in the number of pages.
+     *
+     * @return The currently held pages.
+     */
+    t_seek_reads PagedSparseVirtualFile::blocks() const noexcept {
+        SVF_ASSERT(integrity() == ERROR_NONE);
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        t_seek_reads ret;
+        ret.reserve(m_num_pages);
+        for (const auto &page: m_pages) {
+            if (page.size) {
+                ret.emplace_back(page.number << m_page_shift, page.size);
+            }
+        }
+        std::sort(ret.begin(), ret.end());
+        return ret;
+    }
+
+    /**
+     * @brief Returns the file position immediately after the last byte held, zero if empty.
+     *
+     * This is O(n) in the number of pages.
+     */
+    t_fpos PagedSparseVirtualFile::last_file_position() const noexcept {
+        SVF_ASSERT(integrity() == ERROR_NONE);
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        t_fpos ret = 0;
+        for (const auto &page: m_pages) {
+            if (page.size) {
+                ret = std::max(ret, (page.number << m_page_shift) + page.size);
+            }
+        }
+        return ret;
+    }
+
+    /**
+     * @brief Gives best guess of total memory usage including the buffers of free pages that are retained for reuse.
+     *
+     * @return Memory usage in bytes.
+     */
+    size_t PagedSparseVirtualFile::size_of() const noexcept {
+        SVF_ASSERT(integrity() == ERROR_NONE);
+#ifdef SVF_THREAD_SAFE
+        std::lock_guard<std::mutex> mutex(m_mutex);
+#endif
+        size_t ret = sizeof(PagedSparseVirtualFile);
+        ret += m_id.size();
+        ret += m_table.capacity() * sizeof(t_slot);
+        ret += m_pages.capacity() * sizeof(t_page);
+        ret += m_pages_buffered * m_config.page_size;
+        ret += m_pages_free.capacity() * sizeof(t_page_index);
+        return ret;
+    }
+
+    /**
+     * @brief Checks the internal integrity of the data structure.
+     *
+     * This is O(n) in the number of pages.
+     *
+     * @return ERROR_NONE on success, something else on failure.
+     */
+    PagedSparseVirtualFile::ERROR_CONDITION PagedSparseVirtualFile::integrity() const noexcept {
+        size_t num_pages = 0;
+        size_t num_bytes = 0;
+        size_t num_buffered = 0;
+        for (t_page_index page = 0; page < m_pages.size(); ++page) {
+            const t_page &value = m_pages[page];
+            if (value.size > m_config.page_size || (value.size && !value.data)) {
+                return ERROR_PAGE_SIZE;
+            }
+            num_buffered += value.data != nullptr;
+            if (value.size) {
+                if (_find(value.number) != page) {
+                    return ERROR_TABLE_MISMATCH;
+                }
+                ++num_pages;
+                num_bytes += value.size;
+            }
+        }
+        if (num_pages != m_num_pages || num_pages + m_pages_free.size() != m_pages.size()
+            || num_buffered != m_pages_buffered) {
+            return ERROR_PAGE_SIZE;
+        }
+        if (num_bytes != m_bytes_total) {
+            return ERROR_BYTE_COUNT_MISMATCH;
+        }
+        size_t table_count = 0;
+        for (const auto &slot: m_table) {
+            table_count += slot.page != PAGE_NONE;
+        }
+        if (table_count != m_num_pages) {
+            return ERROR_TABLE_MISMATCH;
+        }
+        size_t lru_count = 0;
+        t_page_index prev = PAGE_NONE;
+        for (t_page_index page = m_lru_head; page != PAGE_NONE; page = m_pages[page].lru_next) {
+            if (m_pages[page].lru_prev != prev || m_pages[page].size == 0 || ++lru_count > m_num_pages) {
+                return ERROR_LRU_MISMATCH;
+            }
+            prev = page;
+        }
+        if (lru_count != m_num_pages || prev != m_lru_tail) {
+            return ERROR_LRU_MISMATCH;
+        }
+        return ERROR_NONE;
+    }
+
+} // namespace SVFS
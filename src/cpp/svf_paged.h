@@ -0,0 +1,317 @@
+/** @file
+ *
+ * A Sparse Virtual File implementation that holds fixed size pages.
+ *
+ * Created on 2026-10-18.
+ *
+ * @verbatim
+    MIT License
+
+    Copyright (c) 2023-2025 Paul Ross
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+ @endverbatim
+ */
+
+#ifndef CPPSVF_SVF_PAGED_H
+#define CPPSVF_SVF_PAGED_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+
+#ifdef SVF_THREAD_SAFE
+
+#include <mutex>
+
+#endif
+
+#include "svf.h"
+
+namespace SVFS {
+
+#pragma mark - Paged SVF configuration
+
+    /**
+     * @brief Configuration for a \c PagedSparseVirtualFile.
+     */
+    typedef struct PagedSparseVirtualFileConfig {
+        /**
+         * The size of each page, this must be a non-zero power of two.
+         * All writes start on a page boundary unless they extend a partially held page.
+         */
+        size_t page_size = 4096;
+        /**
+         * If true the memory is overwritten with \c OVERWRITE_CHAR when the page is erased, punted or the SVF is
+         * cleared or destroyed.
+         */
+        bool overwrite_on_exit = false;
+        /**
+         * If true then when writing to a page that already holds data the existing data is checked against the new
+         * data and an ExceptionSparseVirtualFileDiff will be raised if there is a difference.
+         */
+        bool compare_for_diff = true;
+    } tPagedSparseVirtualFileConfig;
+
+#pragma mark - The paged SVF class
+
+    /**
+     * @brief Implementation of a *Sparse Virtual File* that holds fixed size pages.
+     *
+     * This is an alternative to \c SparseVirtualFile for clients that access files in page aligned units.
+     * Pages are held in an open addressing hash table keyed by page number so \c has(), \c read() and \c write() are
+     * constant time for each page spanned.
+     * There is no coalescing of blocks.
+     * A page holds a contiguous run of bytes from the start of the page, only the last page of a file is expected to
+     * be partially held.
+     *
+     * \c need() has the same return type as \c SparseVirtualFile::need() but the reads are whole, coalesced, pages.
+     *
+     * Pages are kept in a least recently used list which is updated by \c read() and \c write() so \c lru_punt() is
+     * constant time per page punted.
+     */
+    class PagedSparseVirtualFile {
+    public:
+        explicit PagedSparseVirtualFile(const std::string &id, double mod_time,
+                                        const tPagedSparseVirtualFileConfig &config = tPagedSparseVirtualFileConfig());
+
+        // ---- Read and write etc. ----
+        /// Do I have the data at the given file position and length?
+        [[nodiscard]] bool has(t_fpos fpos, size_t len) const noexcept;
+
+        void write(t_fpos fpos, const char *data, size_t len);
+
+        /** Read data and write to the buffer provided by the caller.
+         * Not const as we update the LRU list and the read statistics. */
+        void read(t_fpos fpos, size_t len, char *p);
+
+        /// Create a new list of page aligned seek/read instructions.
+        [[nodiscard]] t_seek_reads need(t_fpos fpos, size_t len, size_t greedy_length = 0) const noexcept;
+
+        /// Remove all the pages.
+        void clear() noexcept;
+
+        /** Remove the page at the given file position which must be the start of the page.
+         * This will raise an ExceptionSparseVirtualFileErase if there is no page there.
+         * Returns the number of bytes erased. */
+        size_t erase(t_fpos fpos);
+
+        /// Remove least recently used pages until the number of bytes is below the given bound.
+        size_t lru_punt(size_t cache_size_upper_bound);
+
+        // ---- Meta information about the SVF ----
+        /// The existing pages as a sorted list of (file_position, size) pairs.
+        [[nodiscard]] t_seek_reads blocks() const noexcept;
+
+        /// size_of() gives best guess of total memory usage.
+        [[nodiscard]] size_t size_of() const noexcept;
+
+        /// Gives exact number of data bytes held.
+        [[nodiscard]] size_t num_bytes() const noexcept { return m_bytes_total; }
+
+        /// Number of pages held.
+        [[nodiscard]] size_t num_blocks() const noexcept { return m_num_pages; }
+
+        /// The position of the last byte.
+        [[nodiscard]] t_fpos last_file_position() const noexcept;
+
+        /// Check the clients file modification time has changed.
+        [[nodiscard]] bool file_mod_time_matches(const double &file_mod_time) const noexcept {
+            return file_mod_time == m_file_mod_time;
+        }
+
+        // ---- Attribute access ----
+        /// The ID of the file.
+        [[nodiscard]] const std::string &id() const noexcept { return m_id; }
+
+        /// The file modification time as a double representing UNIX seconds.
+        [[nodiscard]] double file_mod_time() const noexcept { return m_file_mod_time; }
+
+        /// The configuration.
+        [[nodiscard]] const tPagedSparseVirtualFileConfig &config() const noexcept { return m_config; }
+
+        /// The page size.
+        [[nodiscard]] size_t page_size() const noexcept { return m_config.page_size; }
+
+        /// Count of \c write() operations.
+        [[nodiscard]] size_t count_write() const noexcept { return m_count_write; }
+
+        /// Count of \c read() operations.
+        [[nodiscard]] size_t count_read() const noexcept { return m_count_read; }
+
+        /// Count of total bytes written with \c write() operations.
+        [[nodiscard]] size_t bytes_write() const noexcept { return m_bytes_write; }
+
+        /// Count of total bytes read with \c read() operations.
+        [[nodiscard]] size_t bytes_read() const noexcept { return m_bytes_read; }
+
+        /// Returns the The total count of pages that have been erased either directly or by punting.
+        [[nodiscard]] size_t blocks_erased() const noexcept { return m_blocks_erased; }
+        /// Returns the The total count of bytes that have been erased either directly or by punting.
+        [[nodiscard]] size_t bytes_erased() const noexcept { return m_bytes_erased; }
+        /// Returns the The total count of pages that have been erased by punting.
+        [[nodiscard]] size_t blocks_punted() const noexcept { return m_blocks_punted; }
+        /// Returns the The total count of bytes that have been erased by punting.
+        [[nodiscard]] size_t bytes_punted() const noexcept { return m_bytes_punted; }
+
+        /// Time of the last \c write() operation.
+        [[nodiscard]] std::chrono::time_point<std::chrono::system_clock> time_write() const noexcept {
+            return m_time_write;
+        }
+
+        /// Time of the last \c read() operation.
+        [[nodiscard]] std::chrono::time_point<std::chrono::system_clock> time_read() const noexcept {
+            return m_time_read;
+        }
+
+        /// Eliminate copying.
+        PagedSparseVirtualFile(const PagedSparseVirtualFile &rhs) = delete;
+
+        /// Eliminate copying.
+        PagedSparseVirtualFile operator=(const PagedSparseVirtualFile &rhs) = delete;
+
+#ifdef SVF_THREAD_SAFE
+
+        /// Prohibit moving, the mutex has no move constructor.
+        PagedSparseVirtualFile(PagedSparseVirtualFile &&other) = delete;
+
+        PagedSparseVirtualFile &operator=(PagedSparseVirtualFile &&rhs) = delete;
+
+#else
+        /// Allow moving
+        PagedSparseVirtualFile(PagedSparseVirtualFile &&other) = default;
+        PagedSparseVirtualFile& operator=(PagedSparseVirtualFile &&rhs) = default;
+#endif
+
+        /// Destruction just clears the pages.
+        ~PagedSparseVirtualFile() { clear(); }
+
+    private:
+        /// Index of a page in \c m_pages.
+        typedef uint32_t t_page_index;
+        /// Marks an empty hash table slot or the end of the LRU list.
+        static constexpr t_page_index PAGE_NONE = UINT32_MAX;
+        /// A page.
+        typedef struct {
+            /// The page number, the file position divided by the page size.
+            t_fpos number;
+            /// Number of bytes held from the start of the page, zero if this page is on the free list.
+            size_t size;
+            /// More recently used page.
+            t_page_index lru_prev;
+            /// Less recently used page.
+            t_page_index lru_next;
+            /// The data, this is null if the page is free and the buffer has been released.
+            std::unique_ptr<char[]> data;
+        } t_page;
+        /// A hash table slot.
+        typedef struct {
+            /// The page number.
+            t_fpos number;
+            /// Index into \c m_pages or \c PAGE_NONE if the slot is empty.
+            t_page_index page;
+        } t_slot;
+
+        /// The SVF ID
+        std::string m_id;
+        /// The original file modification date as UNIX time. This is used for consistency checking.
+        double m_file_mod_time;
+        /// The configuration.
+        tPagedSparseVirtualFileConfig m_config;
+        /// log2 of \c m_config.page_size.
+        unsigned int m_page_shift = 0;
+        /// Open addressing hash table with linear probing. The size is zero or a power of two.
+        std::vector<t_slot> m_table;
+        /// log2 of the size of \c m_table.
+        unsigned int m_table_bits = 0;
+        /// All the pages that have been allocated, held or free.
+        std::vector<t_page> m_pages;
+        /// Indexes of free pages in \c m_pages.
+        std::vector<t_page_index> m_pages_free;
+        /// Number of pages in \c m_pages, held or free, that have a data buffer.
+        size_t m_pages_buffered = 0;
+        /// Most recently used page.
+        t_page_index m_lru_head = PAGE_NONE;
+        /// Least recently used page.
+        t_page_index m_lru_tail = PAGE_NONE;
+        /// Number of pages held.
+        size_t m_num_pages = 0;
+        /// Total number of bytes in this SVF
+        size_t m_bytes_total = 0;
+        /// Access statistics: count of write operations.
+        size_t m_count_write = 0;
+        /// Access statistics: count of read operations.
+        size_t m_count_read = 0;
+        /// Access statistics: total bytes written.
+        size_t m_bytes_write = 0;
+        /// Access statistics: total bytes read.
+        size_t m_bytes_read = 0;
+        /// Last access real-time timestamp for a write.
+        std::chrono::time_point<std::chrono::system_clock> m_time_write;
+        /// Last access real-time timestamp for a read.
+        std::chrono::time_point<std::chrono::system_clock> m_time_read;
+        /// The total count of pages that have been erased either directly or by punting.
+        size_t m_blocks_erased = 0;
+        /// The total count of bytes that have been erased either directly or by punting.
+        size_t m_bytes_erased = 0;
+        /// The count of pages that have been erased by punting.
+        size_t m_blocks_punted = 0;
+        /// The count of bytes that have been erased by punting.
+        size_t m_bytes_punted = 0;
+#ifdef SVF_THREAD_SAFE
+        /// Thread mutex.
+        mutable std::mutex m_mutex;
+#endif
+    private:
+        // Hash table, these do not use the mutex.
+        [[nodiscard]] size_t _slot_home(t_fpos number) const noexcept;
+        [[nodiscard]] t_page_index _find(t_fpos number) const noexcept;
+        void _insert(t_fpos number, t_page_index page);
+        void _remove(t_fpos number) noexcept;
+        void _grow();
+
+        // Pages and the LRU list, these do not use the mutex.
+        [[nodiscard]] t_page_index _page_new(t_fpos number);
+        void _page_free(t_page_index page) noexcept;
+        void _lru_unlink(t_page_index page) noexcept;
+        void _lru_push_front(t_page_index page) noexcept;
+        [[nodiscard]] bool _has_no_lock(t_fpos fpos, size_t len) const noexcept;
+
+        /** @brief Check result of internal integrity. */
+        enum ERROR_CONDITION {
+            /// No error.
+            ERROR_NONE = 0,
+            /// A page in the hash table can not be found or is in the wrong place.
+            ERROR_TABLE_MISMATCH,
+            /// The LRU list does not contain all the held pages.
+            ERROR_LRU_MISMATCH,
+            /// A page is empty or larger than the page size.
+            ERROR_PAGE_SIZE,
+            /// Missmatch in byte count where the count of the bytes in all the pages does not match @c m_bytes_total.
+            ERROR_BYTE_COUNT_MISMATCH,
+        };
+
+        [[nodiscard]] ERROR_CONDITION integrity() const noexcept;
+    };
+
+} // namespace SVFS
+
+#endif //CPPSVF_SVF_PAGED_H
@@ -0,0 +1,426 @@
+/** @file
+ *
+ * Asynchronous prefetching into a Sparse Virtual File or Sparse Virtual File System with a pool of worker threads.
+ *
+ * Created on 2026-10-18.
+ *
+ * @verbatim
+    MIT License
+
+    Copyright (c) 2023-2025 Paul Ross
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+ @endverbatim
+ */
+
+
+#include <algorithm>
+#include <sstream>
+#include <utility>
+
+#include "svf_prefetch.h"
+
+namespace SVFS {
+
+    /**
+     * @brief Construct a prefetcher into a SVFS and start its worker threads.
+     *
+     * @param svfs The SVFS, this is not owned.
+     * @param fetch The fetch function, see \c t_fetch_svfs_function. This is called from the worker threads.
+     * @param config The number of threads, byte limit and the greedy length and alignment of each hint.
+     */
+    Prefetcher::Prefetcher(SparseVirtualFileSystem &svfs, t_fetch_svfs_function fetch,
+                           const tPrefetchConfig &config)
+            : m_svfs(&svfs), m_fetch(std::move(fetch)), m_config(config) {
+        _start_threads();
+    }
+
+    /**
+     * @brief Construct a prefetcher into a single SVF and start its worker threads.
+     *
+     * @param svf The SVF, this is not owned.
+     * @param fetch The fetch function, see \c t_fetch_function. This is called from the worker threads.
+     * @param config The number of threads, byte limit and the greedy length and alignment of each hint.
+     */
+    Prefetcher::Prefetcher(SparseVirtualFile &svf, t_fetch_function fetch, const tPrefetchConfig &config)
+            : m_svf(&svf),
+              m_fetch([fetch = std::move(fetch)](const std::string &, t_fpos fpos, size_t len, char *buffer) {
+                  return fetch(fpos, len, buffer);
+              }),
+              m_config(config) {
+        _start_threads();
+    }
+
+    /**
+     * @brief Start the worker threads, there is always at least one.
+     */
+    void Prefetcher::_start_threads() {
+        size_t num_threads = std::max<size_t>(m_config.num_threads, 1);
+        m_threads.reserve(num_threads);
+        try {
+            for (size_t i = 0; i < num_threads; ++i) {
+                m_threads.emplace_back(&Prefetcher::_run, this);
+            }
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_cond.notify_all();
+            for (auto &thread: m_threads) {
+                thread.join();
+            }
+            throw;
+        }
+    }
+
+    /**
+     * @brief Queue a hint that the data at a file position and length of a SVF will be read.
+     *
+     * This returns immediately, the hint is fetched by a worker thread.
+     * If there is no SVF of that ID when the hint is started it fails.
+     *
+     * @param id The SVF ID, for a single SVF prefetcher this must be the ID of that SVF.
+     * @param fpos The file position.
+     * @param len The length.
+     * @param priority Higher priorities are started first.
+     * @param callback If not \c nullptr this is called when the hint is done, fails or is cancelled.
+     * @return The ticket of the hint for \c cancel().
+     */
+    t_prefetch_ticket Prefetcher::prefetch(const std::string &id, t_fpos fpos, size_t len, int priority,
+                                           t_prefetch_callback callback) {
+        t_prefetch_ticket ret;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ret = ++m_ticket;
+            auto iter = m_queue.emplace(std::make_pair(priority, ret),
+                                        t_hint{id, fpos, len, std::move(callback)}).first;
+            try {
+                m_queued[ret] = iter;
+            } catch (...) {
+                m_queue.erase(iter);
+                throw;
+            }
+        }
+        m_cond.notify_all();
+        return ret;
+    }
+
+    /**
+     * @brief Queue a hint for the SVF of a single SVF prefetcher.
+     *
+     * This will raise an ExceptionSparseVirtualFile if this prefetches into a SVFS.
+     *
+     * @param fpos The file position.
+     * @param len The length.
+     * @param priority Higher priorities are started first.
+     * @param callback If not \c nullptr this is called when the hint is done, fails or is cancelled.
+     * @return The ticket of the hint for \c cancel().
+     */
+    t_prefetch_ticket Prefetcher::prefetch(t_fpos fpos, size_t len, int priority, t_prefetch_callback callback) {
+        if (!m_svf) {
+            std::ostringstream os;
+            os << "Prefetcher::prefetch():";
+            os << " a hint for a SparseVirtualFileSystem needs a SVF ID.";
+            throw Exceptions::ExceptionSparseVirtualFile(os.str());
+        }
+        return prefetch(m_svf->id(), fpos, len, priority, std::move(callback));
+    }
+
+    /**
+     * @brief Cancel a hint that has not started.
+     *
+     * If it is cancelled its callback is called from this thread.
+     *
+     * @param ticket The ticket from \c prefetch().
+     * @return \c true if the hint was cancelled, \c false if it has started or finished or there is no such hint.
+     */
+    bool Prefetcher::cancel(t_prefetch_ticket ticket) {
+        t_prefetch_callback callback;
+        tPrefetchResult result;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto iter_queued = m_queued.find(ticket);
+            if (iter_queued == m_queued.end()) {
+                return false;
+            }
+            auto iter = iter_queued->second;
+            result.ticket = ticket;
+            result.id = iter->second.id;
+            result.fpos = iter->second.fpos;
+            result.len = iter->second.len;
+            result.status = tPrefetchResult::PREFETCH_CANCELLED;
+            callback = std::move(iter->second.callback);
+            m_queue.erase(iter);
+            m_queued.erase(iter_queued);
+            ++m_count_cancelled;
+        }
+        // Waiters in wait() might now have nothing to wait for.
+        m_cond.notify_all();
+        if (callback) {
+            callback(result);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Cancel every hint that has not started.
+     *
+     * Their callbacks are called from this thread.
+     *
+     * @return The number of hints cancelled.
+     */
+    size_t Prefetcher::cancel_all() {
+        std::vector<std::pair<t_prefetch_callback, tPrefetchResult>> cancelled;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            cancelled = _cancel_all_no_lock();
+        }
+        m_cond.notify_all();
+        for (const auto &iter: cancelled) {
+            if (iter.first) {
+                iter.first(iter.second);
+            }
+        }
+        return cancelled.size();
+    }
+
+    /**
+     * @brief Remove every queued hint.
+     *
+     * This does not use the mutex.
+     *
+     * @return The callback and result of each hint removed, in the order they would have started.
+     */
+    std::vector<std::pair<t_prefetch_callback, tPrefetchResult>> Prefetcher::_cancel_all_no_lock() {
+        std::vector<std::pair<t_prefetch_callback, tPrefetchResult>> ret;
+        ret.reserve(m_queue.size());
+        for (auto &iter: m_queue) {
+            tPrefetchResult result;
+            result.ticket = iter.first.second;
+            result.id = iter.second.id;
+            result.fpos = iter.second.fpos;
+            result.len = iter.second.len;
+            result.status = tPrefetchResult::PREFETCH_CANCELLED;
+            ret.emplace_back(std::move(iter.second.callback), std::move(result));
+        }
+        m_count_cancelled += m_queue.size();
+        m_queue.clear();
+        m_queued.clear();
+        return ret;
+    }
+
+    /**
+     * @brief Wait until there are no hints queued or being fetched, including their callbacks.
+     *
+     * Hints queued while waiting, for example by callbacks, are waited for too.
+     */
+    void Prefetcher::wait() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cond.wait(lock, [this]() { return m_queue.empty() && m_num_in_flight == 0; });
+    }
+
+    /**
+     * @brief Can a worker start the next hint?
+     *
+     * This does not use the mutex.
+     */
+    bool Prefetcher::_can_start_no_lock() const noexcept {
+        if (m_queue.empty()) {
+            return false;
+        }
+        return m_config.max_bytes_in_flight == 0 || m_bytes_in_flight == 0
+               || m_bytes_in_flight + m_queue.begin()->second.len <= m_config.max_bytes_in_flight;
+    }
+
+    /**
+     * @brief A worker thread, this takes hints from the queue until stopped.
+     */
+    void Prefetcher::_run() noexcept {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_cond.wait(lock, [this]() { return m_stop || _can_start_no_lock(); });
+            if (m_stop) {
+                break;
+            }
+            auto iter = m_queue.begin();
+            t_prefetch_ticket ticket = iter->first.second;
+            t_hint hint = std::move(iter->second);
+            m_queue.erase(iter);
+            m_queued.erase(ticket);
+            ++m_num_in_flight;
+            m_bytes_in_flight += hint.len;
+            lock.unlock();
+            size_t count_fetch = 0;
+            tPrefetchResult result = _prefetch(ticket, hint, count_fetch);
+            if (hint.callback) {
+                try {
+                    hint.callback(result);
+                } catch (...) {
+                    // There is nowhere to report this.
+                }
+            }
+            lock.lock();
+            --m_num_in_flight;
+            m_bytes_in_flight -= hint.len;
+            m_count_fetch += count_fetch;
+            m_bytes_fetch += result.bytes_fetch;
+            if (result.status == tPrefetchResult::PREFETCH_DONE) {
+                ++m_count_done;
+            } else {
+                ++m_count_failed;
+            }
+            // Another worker might now fit under the byte limit and wait() might be done.
+            m_cond.notify_all();
+        }
+    }
+
+    /**
+     * @brief Fetch what a hint needs and write it to the SVF.
+     *
+     * This does not use the mutex.
+     * If the SVFS has a budget and is then over it blocks are evicted without waiting for any other thread that is
+     * evicting, see SparseVirtualFileSystem::evict_over_budget().
+     *
+     * @param ticket The ticket of the hint.
+     * @param hint The hint.
+     * @param count_fetch Set to the number of calls to the fetch function.
+     * @return The result for the callback.
+     */
+    tPrefetchResult Prefetcher::_prefetch(t_prefetch_ticket ticket, const t_hint &hint, size_t &count_fetch) {
+        tPrefetchResult ret;
+        ret.ticket = ticket;
+        ret.id = hint.id;
+        ret.fpos = hint.fpos;
+        ret.len = hint.len;
+        try {
+            // Keeps the SVF alive if it is removed from the SVFS while fetching.
+            t_svf_handle svf_handle;
+            SparseVirtualFile *svf = m_svf;
+            if (m_svfs) {
+                svf_handle = m_svfs->handle(hint.id);
+                svf = svf_handle.get();
+            } else if (hint.id != m_svf->id()) {
+                svf = nullptr;
+            }
+            if (!svf) {
+                std::ostringstream os;
+                os << "Prefetcher::_prefetch():";
+                os << " No SVF ID \"" << hint.id << "\"";
+                throw Exceptions::ExceptionSparseVirtualFileSystemOutOfRange(os.str());
+            }
+            // Data being fetched by another caller is left to it.
+            t_in_flight_futures in_flight;
+            t_seek_reads seek_reads = read_through_reserve(*svf, hint.fpos, hint.len, m_config.read_through, in_flight);
+            if (!seek_reads.empty()) {
+                count_fetch = seek_reads.size();
+                try {
+                    ret.bytes_fetch = read_through_fetch(*svf, seek_reads, [this, &hint](t_fpos f, size_t l, char *b) {
+                        return m_fetch(hint.id, f, l, b);
+                    });
+                } catch (...) {
+                    svf->release_need(seek_reads);
+                    throw;
+                }
+                svf->release_need(seek_reads);
+                if (m_svfs) {
+                    m_svfs->evict_over_budget();
+                }
+            }
+        } catch (const std::exception &err) {
+            ret.status = tPrefetchResult::PREFETCH_FAILED;
+            ret.error = err.what();
+        }
+        return ret;
+    }
+
+    size_t Prefetcher::num_queued() const noexcept {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_queue.size();
+    }
+
+    size_t Prefetcher::num_in_flight() const noexcept {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_num_in_flight;
+    }
+
+    size_t Prefetcher::bytes_in_flight() const noexcept {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_bytes_in_flight;
+    }
+
+    size_t Prefetcher::count_done() const noexcept {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_count_done;
+    }
+
+    size_t Prefetcher::count_failed() const noexcept {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_count_failed;
+    }
+
+    size_t Prefetcher::count_cancelled() const noexcept {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_count_cancelled;
+    }
+
+    size_t Prefetcher::count_fetch() const noexcept {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_count_fetch;
+    }
+
+    size_t Prefetcher::bytes_fetch() const noexcept {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_bytes_fetch;
+    }
+
+    /**
+     * @brief Cancel the hints that have not started, calling their callbacks, then wait for the rest and stop the
+     * worker threads.
+     */
+    Prefetcher::~Prefetcher() noexcept {
+        std::vector<std::pair<t_prefetch_callback, tPrefetchResult>> cancelled;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            try {
+                cancelled = _cancel_all_no_lock();
+            } catch (...) {
+                // Without the results the callbacks are not called.
+                m_queue.clear();
+                m_queued.clear();
+            }
+        }
+        for (const auto &iter: cancelled) {
+            if (iter.first) {
+                try {
+                    iter.first(iter.second);
+                } catch (...) {}
+            }
+        }
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this]() { return m_num_in_flight == 0; });
+            m_stop = true;
+        }
+        m_cond.notify_all();
+        for (auto &thread: m_threads) {
+            thread.join();
+        }
+    }
+}
@@ -0,0 +1,225 @@
+/** @file
+ *
+ * Asynchronous prefetching into a Sparse Virtual File or Sparse Virtual File System with a pool of worker threads.
+ *
+ * Created on 2026-10-18.
+ *
+ * @verbatim
+    MIT License
+
+    Copyright (c) 2023-2025 Paul Ross
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+ @endverbatim
+ */
+
+
+#ifndef CPPSVF_SVF_PREFETCH_H
+#define CPPSVF_SVF_PREFETCH_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "svf.h"
+#include "svf_fetch.h"
+#include "svfs.h"
+
+#ifndef SVF_THREAD_SAFE
+#error "The prefetcher writes to SVFs from worker threads so needs SVF_THREAD_SAFE."
+#endif
+
+namespace SVFS {
+
+    /**
+     * @brief The configuration of a Prefetcher.
+     */
+    typedef struct PrefetchConfig {
+        /// The number of worker threads, this is the most hints that are fetched at once.
+        size_t num_threads = 4;
+        /// If non-zero a hint is not started if it would take the total length of the hints being fetched over this.
+        /// A hint is always started if nothing else is being fetched.
+        size_t max_bytes_in_flight = 0;
+        /// The greedy length and alignment of each hint.
+        tReadThroughConfig read_through;
+    } tPrefetchConfig;
+
+    /// The ticket of a hint, this is never zero.
+    typedef uint64_t t_prefetch_ticket;
+
+    /**
+     * @brief The outcome of a hint given to its callback.
+     */
+    typedef struct PrefetchResult {
+        /** @brief What happened to the hint. */
+        enum PREFETCH_STATUS {
+            /// The data is held or has been fetched, or is being fetched by another caller.
+            PREFETCH_DONE = 0,
+            /// The SVF does not exist or the fetch or write raised, see \c error.
+            PREFETCH_FAILED,
+            /// The hint was cancelled before it started.
+            PREFETCH_CANCELLED,
+        };
+        t_prefetch_ticket ticket = 0;
+        std::string id;
+        t_fpos fpos = 0;
+        size_t len = 0;
+        PREFETCH_STATUS status = PREFETCH_DONE;
+        /// The number of bytes fetched for this hint.
+        size_t bytes_fetch = 0;
+        /// The exception message if the hint failed.
+        std::string error;
+    } tPrefetchResult;
+
+    /// Type of the function called when a hint completes, fails or is cancelled.
+    typedef std::function<void(const tPrefetchResult &result)> t_prefetch_callback;
+
+    /**
+     * @brief Fetch data into a SVF or SVFS in the background from hints of what will be read.
+     *
+     * Hints are (id, file_position, length) with a priority, higher priorities are started first and equal priorities
+     * in the order they were given.
+     * A pool of worker threads takes hints from the queue, finds what is missing with
+     * SparseVirtualFile::reserve_need(), fetches it with the fetch function and writes it to the SVF.
+     * Data being fetched by another caller, such as a read-through cache, is not fetched again.
+     *
+     * Callbacks are called from the worker threads, or from the thread that cancels the hint, without any lock held.
+     * They must be thread safe and must not destroy the Prefetcher.
+     */
+    class Prefetcher {
+    public:
+        /// Prefetch into a SVFS, the fetch function is given the SVF ID. The SVFS is not owned and must outlive this.
+        Prefetcher(SparseVirtualFileSystem &svfs, t_fetch_svfs_function fetch,
+                   const tPrefetchConfig &config = tPrefetchConfig());
+
+        /// Prefetch into a single SVF. The SVF is not owned and must outlive this.
+        Prefetcher(SparseVirtualFile &svf, t_fetch_function fetch, const tPrefetchConfig &config = tPrefetchConfig());
+
+        /// Queue a hint returning its ticket.
+        t_prefetch_ticket prefetch(const std::string &id, t_fpos fpos, size_t len, int priority = 0,
+                                   t_prefetch_callback callback = nullptr);
+
+        /// Queue a hint for the SVF of a single SVF prefetcher returning its ticket.
+        t_prefetch_ticket prefetch(t_fpos fpos, size_t len, int priority = 0, t_prefetch_callback callback = nullptr);
+
+        /// Cancel a hint that has not started, returns true if it was cancelled.
+        bool cancel(t_prefetch_ticket ticket);
+
+        /// Cancel every hint that has not started, returns the number cancelled.
+        size_t cancel_all();
+
+        /// Wait until there are no hints queued or being fetched.
+        void wait();
+
+        /// The configuration.
+        [[nodiscard]] const tPrefetchConfig &config() const noexcept { return m_config; }
+
+        /// The number of hints queued and not started.
+        [[nodiscard]] size_t num_queued() const noexcept;
+
+        /// The number of hints being fetched.
+        [[nodiscard]] size_t num_in_flight() const noexcept;
+
+        /// The total length of the hints being fetched.
+        [[nodiscard]] size_t bytes_in_flight() const noexcept;
+
+        /// The number of hints done.
+        [[nodiscard]] size_t count_done() const noexcept;
+
+        /// The number of hints that failed.
+        [[nodiscard]] size_t count_failed() const noexcept;
+
+        /// The number of hints cancelled.
+        [[nodiscard]] size_t count_cancelled() const noexcept;
+
+        /// The number of calls to the fetch function.
+        [[nodiscard]] size_t count_fetch() const noexcept;
+
+        /// The number of bytes fetched.
+        [[nodiscard]] size_t bytes_fetch() const noexcept;
+
+        /// Eliminate copying.
+        Prefetcher(const Prefetcher &rhs) = delete;
+
+        /// Eliminate copying.
+        Prefetcher &operator=(const Prefetcher &rhs) = delete;
+
+        /// Cancels the hints that have not started and waits for the rest.
+        ~Prefetcher() noexcept;
+
+    private:
+        /** @brief A queued hint. */
+        struct t_hint {
+            std::string id;
+            t_fpos fpos;
+            size_t len;
+            t_prefetch_callback callback;
+        };
+
+        /** @brief Orders the queue by highest priority then lowest ticket. */
+        struct t_hint_order {
+            bool operator()(const std::pair<int, t_prefetch_ticket> &lhs,
+                            const std::pair<int, t_prefetch_ticket> &rhs) const noexcept {
+                return lhs.first > rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second);
+            }
+        };
+
+        typedef std::map<std::pair<int, t_prefetch_ticket>, t_hint, t_hint_order> t_queue;
+
+        /// Either this or \c m_svf is \c nullptr.
+        SparseVirtualFileSystem *m_svfs = nullptr;
+        SparseVirtualFile *m_svf = nullptr;
+        t_fetch_svfs_function m_fetch;
+        tPrefetchConfig m_config;
+        /// Protects every member below.
+        mutable std::mutex m_mutex;
+        /// Notified when a hint is queued or finishes or when stopping.
+        std::condition_variable m_cond;
+        t_queue m_queue;
+        /// The queue entry of each queued ticket for \c cancel().
+        std::unordered_map<t_prefetch_ticket, t_queue::iterator> m_queued;
+        t_prefetch_ticket m_ticket = 0;
+        size_t m_num_in_flight = 0;
+        size_t m_bytes_in_flight = 0;
+        size_t m_count_done = 0;
+        size_t m_count_failed = 0;
+        size_t m_count_cancelled = 0;
+        size_t m_count_fetch = 0;
+        size_t m_bytes_fetch = 0;
+        bool m_stop = false;
+        std::vector<std::thread> m_threads;
+
+        void _start_threads();
+
+        void _run() noexcept;
+
+        [[nodiscard]] bool _can_start_no_lock() const noexcept;
+
+        [[nodiscard]] tPrefetchResult _prefetch(t_prefetch_ticket ticket, const t_hint &hint, size_t &count_fetch);
+
+        [[nodiscard]] std::vector<std::pair<t_prefetch_callback, tPrefetchResult>> _cancel_all_no_lock();
+    };
+}
+
+#endif //CPPSVF_SVF_PREFETCH_H
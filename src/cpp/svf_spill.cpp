@@ -0,0 +1,460 @@
+/** @file
+ *
+ * A second tier for a Sparse Virtual File that holds punted blocks in a local memory mapped file.
+ *
+ * Created on 2026-10-18.
+ *
+ * @verbatim
+    MIT License
+
+    Copyright (c) 2023-2025 Paul Ross
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+ @endverbatim
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#endif
+
+#include "svf_spill.h"
+
+namespace SVFS {
+
+    /**
+     * @brief Create a spill store, the file is not created until the first block is written to it.
+     *
+     * @param directory The directory to create the file in, if empty the system temporary directory is used.
+     * @param capacity The capacity in bytes, if zero no file is created and only mapped blocks can be held.
+     */
+    SpillStore::SpillStore(const std::string &directory, size_t capacity) : m_directory(directory),
+                                                                            m_capacity(capacity) {}
+
+    /** @brief Has the file been created and mapped. */
+    bool SpillStore::is_open() const noexcept {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_base != nullptr;
+    }
+
+    /**
+     * @brief Create and memory map an unlinked file of the capacity, the file descriptor is closed once mapped.
+     *
+     * This does not use the mutex.
+     * This will raise an ExceptionSparseVirtualFile if the file can not be created or mapped.
+     */
+    void SpillStore::_open() {
+        if (m_base) {
+            return;
+        }
+        assert(m_capacity);
+        std::ostringstream os;
+        os << "SpillStore::_open():";
+#ifdef _WIN32
+        os << " spill files are not supported on this platform.";
+        throw Exceptions::ExceptionSparseVirtualFile(os.str());
+#else
+        std::string path = m_directory.empty() ? std::filesystem::temp_directory_path().string() : m_directory;
+        path += "/svfsc_spill_XXXXXX";
+        int fd = mkstemp(path.data());
+        if (fd < 0) {
+            os << " can not create \"" << path << "\": " << std::strerror(errno);
+            throw Exceptions::ExceptionSparseVirtualFile(os.str());
+        }
+        // The file is removed when unmapped.
+        unlink(path.c_str());
+        if (ftruncate(fd, static_cast<off_t>(m_capacity)) != 0) {
+            os << " can not set \"" << path << "\" to " << m_capacity << " bytes: " << std::strerror(errno);
+            close(fd);
+            throw Exceptions::ExceptionSparseVirtualFile(os.str());
+        }
+        void *base = mmap(nullptr, m_capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            os << " can not map \"" << path << "\": " << std::strerror(errno);
+            close(fd);
+            throw Exceptions::ExceptionSparseVirtualFile(os.str());
+        }
+        // The mapping keeps the file alive.
+        close(fd);
+        m_base = static_cast<char *>(base);
+#endif
+    }
+
+    /** @brief Unmap the file. */
+    SpillStore::~SpillStore() noexcept {
+        assert(m_slots.empty());
+#ifndef _WIN32
+        if (m_base) {
+            munmap(m_base, m_capacity);
+        }
+#endif
+    }
+
+    /**
+     * @brief Create a spill file with its own store.
+     *
+     * @param directory The directory to create the store file in, if empty the system temporary directory is used.
+     * @param capacity The capacity in bytes, if zero only mapped blocks can be held.
+     */
+    SpillFile::SpillFile(const std::string &directory, size_t capacity) :
+            m_store(std::make_shared<SpillStore>(directory, capacity)) {}
+
+    /**
+     * @brief Create a spill file that uses a store that may be shared with other spill files.
+     *
+     * @param store The store.
+     */
+    SpillFile::SpillFile(const std::shared_ptr<SpillStore> &store) : m_store(store) {
+        assert(m_store);
+    }
+
+    /** @brief Remove the blocks of this spill file from the store. */
+    SpillFile::~SpillFile() noexcept {
+        std::lock_guard<std::mutex> lock(m_store->m_mutex);
+        for (const auto &iter: m_index) {
+            if (!iter.second.mapped) {
+                m_store->m_slots.erase(iter.second.offset);
+            }
+        }
+    }
+
+    /**
+     * @brief Add a block, evicting the oldest blocks in the store as necessary.
+     *
+     * Any existing blocks that overlap it are trimmed.
+     * The store file is created by the first block written to it, this will raise an ExceptionSparseVirtualFile if
+     * that fails.
+     *
+     * @param fpos File position.
+     * @param data The data.
+     * @param len Length of the data.
+     * @return \c false if the block is empty or larger than the capacity in which case nothing is done.
+     */
+    bool SpillFile::put(t_fpos fpos, const char *data, size_t len) {
+        std::lock_guard<std::mutex> lock(m_store->m_mutex);
+        SpillStore &store = *m_store;
+        if (len == 0 || len > store.m_capacity) {
+            return false;
+        }
+        store._open();
+        _discard_no_lock(fpos, len);
+        if (store.m_head + len > store.m_capacity) {
+            store.m_head = 0;
+        }
+        // Evict the blocks that the head is about to overwrite, these are the oldest.
+        auto iter = store.m_slots.lower_bound(store.m_head);
+        while (iter != store.m_slots.end() && iter->first < store.m_head + len) {
+            SpillFile *owner = iter->second.first;
+            auto index_iter = owner->m_index.find(iter->second.second);
+            assert(index_iter != owner->m_index.end());
+            ++owner->m_blocks_evicted;
+            owner->m_bytes_evicted += index_iter->second.len;
+            ++iter;
+            owner->_remove(index_iter);
+        }
+        std::memcpy(store.m_base + store.m_head, data, len);
+        _insert(fpos, t_entry{store.m_head, len, nullptr});
+        store.m_head += len;
+        m_bytes_spilled += len;
+        return true;
+    }
+
+    /**
+     * @brief Add a block that is held in a read only memory mapping.
+     *
+     * Any existing blocks that overlap it are trimmed.
+     * The mapping is kept alive for as long as this spill file holds a reference to it.
+     *
+     * @param mapping The memory mapping that contains the data.
+     * @param fpos File position.
+     * @param data The data within the mapping.
+     * @param len Length of the data.
+     */
+    void SpillFile::map(const std::shared_ptr<const char> &mapping, t_fpos fpos, const char *data, size_t len) {
+        if (len == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_store->m_mutex);
+        if (m_mappings.empty() || m_mappings.back() != mapping) {
+            m_mappings.push_back(mapping);
+        }
+        _discard_no_lock(fpos, len);
+        _insert(fpos, t_entry{0, len, data});
+    }
+
+    /**
+     * @brief Add an index entry and, if it is in the store, its slot.
+     *
+     * This does not use the mutex.
+     *
+     * @param fpos File position.
+     * @param entry The entry.
+     */
+    void SpillFile::_insert(t_fpos fpos, const t_entry &entry) {
+        m_index.emplace(fpos, entry);
+        if (entry.mapped) {
+            m_bytes_mapped += entry.len;
+        } else {
+            m_store->m_slots.emplace(entry.offset, std::make_pair(this, fpos));
+        }
+        m_bytes_total += entry.len;
+    }
+
+    /**
+     * @brief Remove an index entry and its slot.
+     *
+     * This does not use the mutex.
+     *
+     * @param iter The index entry.
+     * @return The next index entry.
+     */
+    SpillFile::t_index::iterator SpillFile::_remove(t_index::iterator iter) noexcept {
+        if (iter->second.mapped) {
+            m_bytes_mapped -= iter->second.len;
+        } else {
+            m_store->m_slots.erase(iter->second.offset);
+        }
+        m_bytes_total -= iter->second.len;
+        return m_index.erase(iter);
+    }
+
+    /**
+     * @brief The first index entry that overlaps or follows the file position.
+     *
+     * @param fpos File position.
+     * @return The entry or \c end().
+     */
+    SpillFile::t_index::iterator SpillFile::_first_overlap(t_fpos fpos) noexcept {
+        auto iter = m_index.upper_bound(fpos);
+        if (iter != m_index.begin()) {
+            auto iter_prev = std::prev(iter);
+            if (iter_prev->first + iter_prev->second.len > fpos) {
+                return iter_prev;
+            }
+        }
+        return iter;
+    }
+
+    SpillFile::t_index::const_iterator SpillFile::_first_overlap(t_fpos fpos) const noexcept {
+        return const_cast<SpillFile *>(this)->_first_overlap(fpos);
+    }
+
+    /**
+     * @brief Returns \c true if all the bytes are held by one or more contiguous blocks.
+     *
+     * @param fpos File position.
+     * @param len Length.
+     * @return \c true if held.
+     */
+    bool SpillFile::has(t_fpos fpos, size_t len) const noexcept {
+        std::lock_guard<std::mutex> lock(m_store->m_mutex);
+        auto iter = _first_overlap(fpos);
+        t_fpos fpos_to = fpos + len;
+        while (fpos < fpos_to) {
+            if (iter == m_index.end() || iter->first > fpos) {
+                return false;
+            }
+            fpos = iter->first + iter->second.len;
+            ++iter;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Returns the parts of the given seek/reads that are not held.
+     *
+     * @param seek_reads Vector of (file_position, length) pairs.
+     * @return Vector of (file_position, length) pairs that are not held.
+     */
+    t_seek_reads SpillFile::subtract(const t_seek_reads &seek_reads) const {
+        std::lock_guard<std::mutex> lock(m_store->m_mutex);
+        t_seek_reads ret;
+        for (const auto &seek_read: seek_reads) {
+            t_fpos fpos = seek_read.first;
+            const t_fpos fpos_to = seek_read.first + seek_read.second;
+            for (auto iter = _first_overlap(fpos); fpos < fpos_to; ++iter) {
+                if (iter == m_index.end() || iter->first >= fpos_to) {
+                    ret.emplace_back(fpos, fpos_to - fpos);
+                    break;
+                }
+                if (iter->first > fpos) {
+                    ret.emplace_back(fpos, iter->first - fpos);
+                }
+                fpos = iter->first + iter->second.len;
+            }
+        }
+        return ret;
+    }
+
+    /**
+     * @brief Call a function with every block that overlaps the given bytes then remove the block.
+     *
+     * If the function throws then that block and any later ones are not removed.
+     * The function is called with the mutex held so it must not use this or any spill file that shares the store.
+     *
+     * @param fpos File position.
+     * @param len Length.
+     * @param function Called with the file position, data and length of each block.
+     * @return The number of bytes taken.
+     */
+    size_t SpillFile::take(t_fpos fpos, size_t len, const t_take_function &function) {
+        std::lock_guard<std::mutex> lock(m_store->m_mutex);
+        size_t ret = 0;
+        auto iter = _first_overlap(fpos);
+        while (iter != m_index.end() && iter->first < fpos + len) {
+            function(iter->first, _data(iter->second), iter->second.len);
+            ret += iter->second.len;
+            iter = _remove(iter);
+        }
+        m_bytes_taken += ret;
+        return ret;
+    }
+
+    /**
+     * @brief Call a function with every block in file position order.
+     *
+     * The function is called with the mutex held so it must not use this or any spill file that shares the store.
+     *
+     * @param function Called with the file position, data and length of each block.
+     */
+    void SpillFile::visit(const t_take_function &function) const {
+        std::lock_guard<std::mutex> lock(m_store->m_mutex);
+        for (const auto &iter: m_index) {
+            function(iter.first, _data(iter.second), iter.second.len);
+        }
+    }
+
+    /**
+     * @brief Remove the given bytes, blocks that partly overlap them are trimmed.
+     *
+     * @param fpos File position.
+     * @param len Length.
+     * @return The number of bytes removed.
+     */
+    size_t SpillFile::discard(t_fpos fpos, size_t len) noexcept {
+        std::lock_guard<std::mutex> lock(m_store->m_mutex);
+        return _discard_no_lock(fpos, len);
+    }
+
+    size_t SpillFile::_discard_no_lock(t_fpos fpos, size_t len) noexcept {
+        size_t ret = 0;
+        const t_fpos fpos_to = fpos + len;
+        auto iter = _first_overlap(fpos);
+        while (iter != m_index.end() && iter->first < fpos_to) {
+            const t_fpos block_fpos = iter->first;
+            const t_entry entry = iter->second;
+            const t_fpos block_fpos_to = block_fpos + entry.len;
+            iter = _remove(iter);
+            if (block_fpos < fpos) {
+                // Keep the part before.
+                _insert(block_fpos, t_entry{entry.offset, fpos - block_fpos, entry.mapped});
+            }
+            if (block_fpos_to > fpos_to) {
+                // Keep the part after, this is the last overlapping block.
+                const size_t delta = fpos_to - block_fpos;
+                _insert(fpos_to, t_entry{entry.mapped ? 0 : entry.offset + delta, block_fpos_to - fpos_to,
+                                         entry.mapped ? entry.mapped + delta : nullptr});
+            }
+            ret += std::min(block_fpos_to, fpos_to) - std::max(block_fpos, fpos);
+        }
+        return ret;
+    }
+
+    /** @brief Remove every block and release any mappings, the statistics are retained. */
+    void SpillFile::clear() noexcept {
+        std::lock_guard<std::mutex> lock(m_store->m_mutex);
+        for (auto iter = m_index.begin(); iter != m_index.end();) {
+            iter = _remove(iter);
+        }
+        m_mappings.clear();
+        assert(m_bytes_total == 0 && m_bytes_mapped == 0);
+    }
+
+    /**
+     * @brief Returns the blocks held.
+     *
+     * @return Vector of (file_position, length) pairs.
+     */
+    t_seek_reads SpillFile::blocks() const noexcept {
+        std::lock_guard<std::mutex> lock(m_store->m_mutex);
+        t_seek_reads ret;
+        ret.reserve(m_index.size());
+        for (const auto &iter: m_index) {
+            ret.emplace_back(iter.first, iter.second.len);
+        }
+        return ret;
+    }
+
+    /**
+     * @brief Returns an estimate of the memory used by the index.
+     *
+     * @return Memory size.
+     */
+    size_t SpillFile::size_of() const noexcept {
+        std::lock_guard<std::mutex> lock(m_store->m_mutex);
+        return sizeof(SpillFile)
+               + m_index.size() * (sizeof(t_index::value_type)
+                                   + sizeof(decltype(SpillStore::m_slots)::value_type));
+    }
+
+    size_t SpillFile::num_bytes() const noexcept {
+        std::lock_guard<std::mutex> lock(m_store->m_mutex);
+        return m_bytes_total;
+    }
+
+    size_t SpillFile::num_bytes_mapped() const noexcept {
+        std::lock_guard<std::mutex> lock(m_store->m_mutex);
+        return m_bytes_mapped;
+    }
+
+    size_t SpillFile::num_blocks() const noexcept {
+        std::lock_guard<std::mutex> lock(m_store->m_mutex);
+        return m_index.size();
+    }
+
+    size_t SpillFile::bytes_spilled() const noexcept {
+        std::lock_guard<std::mutex> lock(m_store->m_mutex);
+        return m_bytes_spilled;
+    }
+
+    size_t SpillFile::bytes_taken() const noexcept {
+        std::lock_guard<std::mutex> lock(m_store->m_mutex);
+        return m_bytes_taken;
+    }
+
+    size_t SpillFile::blocks_evicted() const noexcept {
+        std::lock_guard<std::mutex> lock(m_store->m_mutex);
+        return m_blocks_evicted;
+    }
+
+    size_t SpillFile::bytes_evicted() const noexcept {
+        std::lock_guard<std::mutex> lock(m_store->m_mutex);
+        return m_bytes_evicted;
+    }
+
+} // namespace SVFS
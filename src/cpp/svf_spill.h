@@ -0,0 +1,249 @@
+/** @file
+ *
+ * A second tier for a Sparse Virtual File that holds punted blocks in a local memory mapped file.
+ *
+ * Created on 2026-10-18.
+ *
+ * @verbatim
+    MIT License
+
+    Copyright (c) 2023-2025 Paul Ross
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+ @endverbatim
+ */
+
+#ifndef CPPSVF_SVF_SPILL_H
+#define CPPSVF_SVF_SPILL_H
+
+#include <string>
+#include <map>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "svf.h"
+
+namespace SVFS {
+
+#pragma mark - Spill store
+
+    class SpillFile;
+
+    /**
+     * @brief A local memory mapped file of fixed capacity that holds the spilled blocks of one or more SpillFile.
+     *
+     * A SparseVirtualFileSystem shares one of these between all of its SparseVirtualFile objects so that there is a
+     * single file and a single capacity however many files are held.
+     *
+     * The file is not created until the first block is written to it.
+     * It is unlinked immediately and the file descriptor is closed once it is mapped so it is removed when unmapped or
+     * if the process crashes.
+     * The file is used as a ring, blocks are written at the head which wraps to the start when a block would overrun
+     * the end.
+     * Blocks in the way of the head are evicted from whichever SpillFile holds them so the oldest spilled blocks are
+     * evicted first.
+     *
+     * This is thread safe, every SpillFile that uses it holds the mutex.
+     */
+    class SpillStore {
+    public:
+        SpillStore(const std::string &directory, size_t capacity);
+
+        /// The capacity of the file in bytes.
+        [[nodiscard]] size_t capacity() const noexcept { return m_capacity; }
+
+        /// Has the file been created and mapped.
+        [[nodiscard]] bool is_open() const noexcept;
+
+        /// Eliminate copying.
+        SpillStore(const SpillStore &rhs) = delete;
+
+        /// Eliminate copying.
+        SpillStore &operator=(const SpillStore &rhs) = delete;
+
+        ~SpillStore() noexcept;
+
+    private:
+        friend class SpillFile;
+
+        /// Create and map the file if that has not been done already.
+        void _open();
+
+        /// The directory to create the file in.
+        std::string m_directory;
+        /// Capacity in bytes.
+        size_t m_capacity;
+        /// The memory mapped file, \c nullptr until the first block is written.
+        char *m_base = nullptr;
+        /// Offset into the file where the next block is written.
+        size_t m_head = 0;
+        /// Map of offset into the file to the SpillFile and file position of the block there, used for eviction.
+        std::map<size_t, std::pair<SpillFile *, t_fpos>> m_slots;
+        /// Access mutex, shared by every SpillFile that uses this.
+        mutable std::mutex m_mutex;
+    };
+
+#pragma mark - Spill file
+
+    /**
+     * @brief The blocks punted from a SparseVirtualFile so that they need not be fetched again.
+     *
+     * The data is held in a SpillStore which may be shared with other spill files, when it is full the oldest blocks
+     * of any of them are evicted.
+     * An index of file position to offset in the store is held in memory, spilled blocks never overlap.
+     *
+     * Blocks can also be mapped from a read only memory mapped file, such as one written by
+     * SparseVirtualFileSystem::save(), these are never evicted.
+     * A spill file with zero capacity only holds mapped blocks.
+     *
+     * This is thread safe with respect to other spill files that share the store, the owning SparseVirtualFile holds
+     * its own lock.
+     */
+    class SpillFile {
+    public:
+        /// Create a spill file with its own store.
+        SpillFile(const std::string &directory, size_t capacity);
+
+        /// Create a spill file that uses a store that may be shared with other spill files.
+        explicit SpillFile(const std::shared_ptr<SpillStore> &store);
+
+        /// Add a block, any existing blocks that overlap it are trimmed.
+        /// Returns \c false if the block is larger than the capacity.
+        bool put(t_fpos fpos, const char *data, size_t len);
+
+        /// Add a block that is held in a read only memory mapping, any existing blocks that overlap it are trimmed.
+        void map(const std::shared_ptr<const char> &mapping, t_fpos fpos, const char *data, size_t len);
+
+        /// Are all the bytes held by a contiguous run of blocks.
+        [[nodiscard]] bool has(t_fpos fpos, size_t len) const noexcept;
+
+        /// The parts of the given seek/reads that are not held.
+        [[nodiscard]] t_seek_reads subtract(const t_seek_reads &seek_reads) const;
+
+        /// Type of the function that takes a block from \c take().
+        typedef std::function<void(t_fpos fpos, const char *data, size_t len)> t_take_function;
+
+        /// Call \c function with each block that overlaps the given bytes then remove it.
+        /// Returns the number of bytes taken.
+        size_t take(t_fpos fpos, size_t len, const t_take_function &function);
+
+        /// Call \c function with each block without removing it.
+        void visit(const t_take_function &function) const;
+
+        /// Remove the given bytes without reading them, blocks that partly overlap are trimmed.
+        /// Returns the number of bytes removed.
+        size_t discard(t_fpos fpos, size_t len) noexcept;
+
+        /// Remove every block.
+        void clear() noexcept;
+
+        /// The blocks held as (file_position, size) pairs.
+        [[nodiscard]] t_seek_reads blocks() const noexcept;
+
+        /// The capacity of the store in bytes, this may be shared with other spill files.
+        [[nodiscard]] size_t capacity() const noexcept { return m_store->capacity(); }
+
+        /// The store.
+        [[nodiscard]] const SpillStore &store() const noexcept { return *m_store; }
+
+        /// The number of bytes held.
+        [[nodiscard]] size_t num_bytes() const noexcept;
+
+        /// The number of bytes held in read only mappings.
+        [[nodiscard]] size_t num_bytes_mapped() const noexcept;
+
+        /// The number of blocks held.
+        [[nodiscard]] size_t num_blocks() const noexcept;
+
+        /// Estimate of the memory used by the index, the store itself is not counted.
+        [[nodiscard]] size_t size_of() const noexcept;
+
+        /// The total count of bytes written to the store.
+        [[nodiscard]] size_t bytes_spilled() const noexcept;
+
+        /// The total count of bytes taken back from the store.
+        [[nodiscard]] size_t bytes_taken() const noexcept;
+
+        /// The total count of blocks evicted to make room, by this or any spill file that shares the store.
+        [[nodiscard]] size_t blocks_evicted() const noexcept;
+
+        /// The total count of bytes evicted to make room, by this or any spill file that shares the store.
+        [[nodiscard]] size_t bytes_evicted() const noexcept;
+
+        /// Eliminate copying.
+        SpillFile(const SpillFile &rhs) = delete;
+
+        /// Eliminate copying.
+        SpillFile &operator=(const SpillFile &rhs) = delete;
+
+        ~SpillFile() noexcept;
+
+    private:
+        /// Where a block is in the spill file or a mapping.
+        struct t_entry {
+            /// Offset into the spill file, unused if mapped.
+            size_t offset;
+            /// Length of the block.
+            size_t len;
+            /// The data if this is held in a read only mapping, \c nullptr if in the spill file.
+            const char *mapped;
+        };
+        typedef std::map<t_fpos, t_entry> t_index;
+
+        /// The first index entry that overlaps or follows the file position.
+        [[nodiscard]] t_index::iterator _first_overlap(t_fpos fpos) noexcept;
+
+        [[nodiscard]] t_index::const_iterator _first_overlap(t_fpos fpos) const noexcept;
+
+        /// Remove an index entry and its slot.
+        t_index::iterator _remove(t_index::iterator iter) noexcept;
+
+        /// Add an index entry and, if in the store, its slot.
+        void _insert(t_fpos fpos, const t_entry &entry);
+
+        /// Remove the given bytes, this does not use the mutex.
+        size_t _discard_no_lock(t_fpos fpos, size_t len) noexcept;
+
+        /// The data for an index entry.
+        [[nodiscard]] const char *_data(const t_entry &entry) const noexcept {
+            return entry.mapped ? entry.mapped : m_store->m_base + entry.offset;
+        }
+
+        /// The store, this may be shared with other spill files.
+        std::shared_ptr<SpillStore> m_store;
+        /// Map of file position to location in the store.
+        t_index m_index;
+        /// The read only mappings that hold mapped blocks, these are shared with other spill files.
+        std::vector<std::shared_ptr<const char>> m_mappings;
+        /// Number of bytes held.
+        size_t m_bytes_total = 0;
+        /// Number of bytes held in read only mappings.
+        size_t m_bytes_mapped = 0;
+        /// Statistics.
+        size_t m_bytes_spilled = 0;
+        size_t m_bytes_taken = 0;
+        size_t m_blocks_evicted = 0;
+        size_t m_bytes_evicted = 0;
+    };
+
+} // namespace SVFS
+
+#endif //CPPSVF_SVF_SPILL_H
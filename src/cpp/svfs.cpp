@@ -29,26 +29,72 @@
  @endverbatim
  */
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
 #include <sstream>
+#include <unordered_set>
 #include <utility>
 
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#endif
+
+#include "svf_journal.h"
+#include "svf_spill.h"
 #include "svfs.h"
 
 namespace SVFS {
 
+    /** @brief Constructor takes a tSparseVirtualFileConfig that is passed to every new SparseVirtualFile.
+     *
+     * @param config The configuration.
+     * @param reserve_count The number of SVFs to pre-size for, see \c reserve().
+     */
+    SparseVirtualFileSystem::SparseVirtualFileSystem(const tSparseVirtualFileConfig &config, size_t reserve_count)
+            : m_config(config) {
+        if (m_config.spill_capacity) {
+            m_spill_store = std::make_shared<SpillStore>(m_config.spill_directory, m_config.spill_capacity);
+        }
+        if (reserve_count) {
+            reserve(reserve_count);
+        }
+    }
+
+    /** @brief Pre-size for a number of SVFs so that inserting them does not pause to rehash.
+     *
+     * Each shard is sized for its share with a quarter again to allow for uneven hashing.
+     *
+     * @param count The number of SVFs.
+     */
+    void SparseVirtualFileSystem::reserve(size_t count) {
+        size_t count_shard = count / SVFS_SHARD_COUNT;
+        count_shard += count_shard / 4 + 1;
+        for (auto &shard: m_shards) {
+#ifdef SVFS_THREAD_SAFE
+            std::unique_lock<std::shared_mutex> lock_shard(shard.mutex);
+#endif
+            shard.svfs.reserve(count_shard);
+        }
+    }
+
     /** @brief Inserts a new SparseVirtualFile corresponding to the given ID and file modification timestamp.
      *
      * @param id The file ID.
      * @param mod_time The file modification time.
      */
     void SparseVirtualFileSystem::insert(const std::string &id, double mod_time) {
-#ifdef SVFS_THREAD_SAFE
-        std::lock_guard<std::mutex> mutex(m_mutex);
-#endif
-        auto result = m_svfs.emplace(std::piecewise_construct,
-                                     std::forward_as_tuple(id),
-                                     std::forward_as_tuple(id, mod_time, m_config));
-        if (! result.second) {
+        bool inserted = false;
+        _get_or_insert(id, mod_time, inserted);
+        if (! inserted) {
             // Error, insertion failed
             std::ostringstream os;
             os << "SparseVirtualFileSystem::insert():";
@@ -57,24 +103,74 @@ namespace SVFS {
         }
     }
 
+    /** @brief Return a handle to the SparseVirtualFile of the given ID, inserting a new one if there is none.
+     *
+     * This is a single atomic lookup rather than \c has() then \c insert().
+     * If the SparseVirtualFile exists the modification time is ignored.
+     *
+     * @param id The file ID.
+     * @param mod_time The file modification time if a new SparseVirtualFile is inserted.
+     * @return The handle.
+     */
+    t_svf_handle SparseVirtualFileSystem::get_or_insert(const std::string &id, double mod_time) {
+        bool inserted = false;
+        return _get_or_insert(id, mod_time, inserted);
+    }
+
+    t_svf_handle SparseVirtualFileSystem::_get_or_insert(const std::string &id, double mod_time, bool &inserted) {
+        t_shard &shard = _shard(id);
+#ifdef SVFS_THREAD_SAFE
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        std::unique_lock<std::shared_mutex> lock_shard(shard.mutex);
+#endif
+        auto result = shard.svfs.try_emplace(id);
+        inserted = result.second;
+        if (inserted) {
+            try {
+                result.first->second = std::make_shared<SparseVirtualFile>(id, mod_time, m_config);
+                result.first->second->set_totals(&m_totals);
+                result.first->second->set_spill_store(m_spill_store);
+                if (m_journal) {
+                    m_journal->insert(id, mod_time);
+                    result.first->second->set_journal(m_journal.get());
+                }
+            } catch (...) {
+                if (result.first->second) {
+                    result.first->second->set_totals(nullptr);
+                }
+                shard.svfs.erase(result.first);
+                throw;
+            }
+        }
+        return result.first->second;
+    }
+
     /** @brief Remove the SparseVirtualFile corresponding to the given ID.
      *
      * This will raise an ExceptionSparseVirtualFileSystemRemove if the given ID does not exist.
+     * The SparseVirtualFile is destroyed when the last handle to it, see \c handle(), is released.
      *
      * @param id The SparseVirtualFile ID.
      */
     void SparseVirtualFileSystem::remove(const std::string &id) {
+        t_shard &shard = _shard(id);
 #ifdef SVFS_THREAD_SAFE
-        std::lock_guard<std::mutex> mutex(m_mutex);
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        std::unique_lock<std::shared_mutex> lock_shard(shard.mutex);
 #endif
-        auto iter = m_svfs.find(id);
-        if (iter == m_svfs.end()) {
+        auto iter = shard.svfs.find(id);
+        if (iter == shard.svfs.end()) {
             std::ostringstream os;
             os << "SparseVirtualFileSystem::remove():";
             os << " id \"" << id << "\" not found.";
             throw Exceptions::ExceptionSparseVirtualFileSystemRemove(os.str());
         } else {
-            m_svfs.erase(iter);
+            if (m_journal) {
+                m_journal->remove(id);
+                iter->second->set_journal(nullptr);
+            }
+            iter->second->set_totals(nullptr);
+            shard.svfs.erase(iter);
         }
     }
 
@@ -86,8 +182,12 @@ namespace SVFS {
      * @return The SparseVirtualFile.
      */
     const SparseVirtualFile &SparseVirtualFileSystem::at(const std::string &id) const {
+        const t_shard &shard = _shard(id);
+#ifdef SVFS_THREAD_SAFE
+        std::shared_lock<std::shared_mutex> lock_shard(shard.mutex);
+#endif
         try {
-            return m_svfs.at(id);
+            return *shard.svfs.at(id);
         } catch (std::out_of_range &err) {
             throw Exceptions::ExceptionSparseVirtualFileSystemOutOfRange(err.what());
         }
@@ -101,47 +201,93 @@ namespace SVFS {
      * @return The SparseVirtualFile.
      */
     SparseVirtualFile &SparseVirtualFileSystem::at(const std::string &id) {
+        t_shard &shard = _shard(id);
+#ifdef SVFS_THREAD_SAFE
+        std::shared_lock<std::shared_mutex> lock_shard(shard.mutex);
+#endif
         try {
-            return m_svfs.at(id);
+            return *shard.svfs.at(id);
         } catch (std::out_of_range &err) {
             throw Exceptions::ExceptionSparseVirtualFileSystemOutOfRange(err.what());
         }
     }
 
+    /** @brief Return a handle to the SparseVirtualFile of the given ID or \c nullptr if there is none.
+     *
+     * Unlike a reference from \c at() the handle keeps the SparseVirtualFile alive if it is removed by another thread,
+     * so it can be used without holding any lock on this SparseVirtualFileSystem.
+     *
+     * @param id The SparseVirtualFile ID.
+     * @return The handle.
+     */
+    t_svf_handle SparseVirtualFileSystem::handle(const std::string &id) const noexcept {
+        const t_shard &shard = _shard(id);
+#ifdef SVFS_THREAD_SAFE
+        std::shared_lock<std::shared_mutex> lock_shard(shard.mutex);
+#endif
+        auto iter = shard.svfs.find(id);
+        if (iter == shard.svfs.end()) {
+            return nullptr;
+        }
+        return iter->second;
+    }
+
+    /** @brief Returns true if there is a SparseVirtualFile with the given ID.
+     *
+     * @param id The SparseVirtualFile ID.
+     * @return True if present.
+     */
+    bool SparseVirtualFileSystem::has(const std::string &id) const noexcept {
+        const t_shard &shard = _shard(id);
+#ifdef SVFS_THREAD_SAFE
+        std::shared_lock<std::shared_mutex> lock_shard(shard.mutex);
+#endif
+        return shard.svfs.find(id) != shard.svfs.end();
+    }
+
+    /** @brief Returns the number of SparseVirtualFiles.
+     *
+     * @return Number of SVFs.
+     */
+    size_t SparseVirtualFileSystem::size() const noexcept {
+        size_t ret = 0;
+        for (const auto &shard: m_shards) {
+#ifdef SVFS_THREAD_SAFE
+            std::shared_lock<std::shared_mutex> lock_shard(shard.mutex);
+#endif
+            ret += shard.svfs.size();
+        }
+        return ret;
+    }
+
     /** @brief Returns the total in-memory size of the SparseVirtualFileSystem structure in bytes.
+     *
+     * Each SparseVirtualFile keeps this up to date as it changes so this is constant time and takes no lock.
      *
      * @return Memory size.
      */
     size_t SparseVirtualFileSystem::size_of() const noexcept {
-        size_t ret = sizeof(SparseVirtualFileSystem);
-        for (auto &iter: m_svfs) {
-            ret += iter.second.size_of();
-        }
-        return ret;
+        return sizeof(SparseVirtualFileSystem) + m_totals.size_of.load(std::memory_order_relaxed);
     }
 
     /** @brief Returns the total number of readable bytes in the SparseVirtualFileSystem.
+     *
+     * This is a running total so is constant time and takes no lock.
      *
      * @return Readable size.
      */
     size_t SparseVirtualFileSystem::num_bytes() const noexcept {
-        size_t ret = 0;
-        for (auto &iter: m_svfs) {
-            ret += iter.second.num_bytes();
-        }
-        return ret;
+        return m_totals.num_bytes.load(std::memory_order_relaxed);
     }
 
     /** @brief Returns the total number of blocks in the SparseVirtualFileSystem.
+     *
+     * This is a running total so is constant time and takes no lock.
      *
      * @return Total number of blocks.
      */
     size_t SparseVirtualFileSystem::num_blocks() const noexcept {
-        size_t ret = 0;
-        for (auto &iter: m_svfs) {
-            ret += iter.second.num_blocks();
-        }
-        return ret;
+        return m_totals.num_blocks.load(std::memory_order_relaxed);
     }
 
     /** @brief Return all the SVF IDs (unordered).
@@ -150,19 +296,705 @@ namespace SVFS {
      */
     std::vector<std::string> SparseVirtualFileSystem::keys() const noexcept {
         std::vector<std::string> ret;
-        ret.reserve(m_svfs.size());
-        for(const auto &iter: m_svfs) {
-            ret.push_back(iter.first);
+        for (const auto &shard: m_shards) {
+#ifdef SVFS_THREAD_SAFE
+            std::shared_lock<std::shared_mutex> lock_shard(shard.mutex);
+#endif
+            for (const auto &iter: shard.svfs) {
+                ret.push_back(iter.first);
+            }
+        }
+        return ret;
+    }
+
+#pragma mark - Budget
+
+    /**
+     * @brief Write to a SparseVirtualFile then, if \c num_bytes() is over the budget, evict blocks.
+     *
+     * See SparseVirtualFile::write() for the exceptions that this may raise.
+     * This evicts down to \c low_water() so the next few writes need not evict.
+     * This evicts at most \c evict_max_blocks() so a large excess is reduced over several writes.
+     * If another thread is already evicting this does not wait for it, see \c evict_over_budget().
+     *
+     * @param id The SparseVirtualFile ID.
+     * @param fpos File position.
+     * @param data The data.
+     * @param len The length of the data.
+     */
+    void SparseVirtualFileSystem::write(const std::string &id, t_fpos fpos, const char *data, size_t len) {
+        t_svf_handle svf = handle(id);
+        if (! svf) {
+            std::ostringstream os;
+            os << "SparseVirtualFileSystem::write():";
+            os << " No SVF ID \"" << id << "\"";
+            throw Exceptions::ExceptionSparseVirtualFileSystemOutOfRange(os.str());
+        }
+        svf->write(fpos, data, len);
+        evict_over_budget();
+    }
+
+    /**
+     * @brief If \c num_bytes() is over the budget evict down to \c low_water(), at most \c evict_max_blocks() at a
+     * time.
+     *
+     * This is what \c write() does after writing and is for callers that write to a SparseVirtualFile directly, such
+     * as a read through cache.
+     * If another thread is already evicting this does not wait for it, that thread will bring \c num_bytes() down.
+     *
+     * @param skip If given then blocks of the SparseVirtualFile for which this returns true are not evicted.
+     * @return The number of bytes punted.
+     */
+    size_t SparseVirtualFileSystem::evict_over_budget(const t_evict_skip_function &skip) {
+        size_t budget_bytes = budget();
+        if (budget_bytes == 0 || num_bytes() <= budget_bytes) {
+            return 0;
+        }
+#ifdef SVFS_THREAD_SAFE
+        std::unique_lock<std::mutex> lock(m_evict_mutex, std::try_to_lock);
+        if (! lock.owns_lock()) {
+            return 0;
+        }
+#endif
+        return _evict_no_lock(evict_max_blocks(), low_water(), skip);
+    }
+
+    /**
+     * @brief Set the byte budget for the total \c num_bytes() of every SparseVirtualFile.
+     *
+     * This does not evict anything, that happens on the next \c write() or \c evict().
+     *
+     * @param budget The budget in bytes, zero means no budget.
+     * @param evict_max_blocks The most blocks that a \c write() evicts, zero means no limit.
+     */
+    void SparseVirtualFileSystem::set_budget(size_t budget, size_t evict_max_blocks) noexcept {
+        m_budget = budget;
+        m_evict_max_blocks = evict_max_blocks;
+    }
+
+    /**
+     * @brief Punt the least recently used blocks of any SparseVirtualFile until \c num_bytes() is within the budget
+     * or a lower target.
+     *
+     * Every SparseVirtualFile takes its block touches from a clock shared by this SparseVirtualFileSystem so blocks
+     * from different files are punted oldest first, see SparseVirtualFile::punt().
+     * Blocks are found by a scan of every SparseVirtualFile that keeps the oldest, the rest of those are kept for
+     * later calls so a scan is only needed once they are used up.
+     * A block touched since the scan is not punted.
+     * Dense regions are punted as a whole.
+     *
+     * This will block in a multi-threaded environment.
+     *
+     * If there is no budget this does nothing.
+     *
+     * @param max_blocks The most blocks to punt, zero means no limit.
+     * @param target Punt until \c num_bytes() is at most this, zero means the budget, for example \c low_water().
+     * @param skip If given then blocks of the SparseVirtualFile for which this returns true are not punted, for
+     *  example those with data that is referenced elsewhere.
+     * @return The number of bytes punted.
+     */
+    size_t SparseVirtualFileSystem::evict(size_t max_blocks, size_t target, const t_evict_skip_function &skip) {
+#ifdef SVFS_THREAD_SAFE
+        std::lock_guard<std::mutex> lock(m_evict_mutex);
+#endif
+        return _evict_no_lock(max_blocks, target, skip);
+    }
+
+    size_t SparseVirtualFileSystem::_evict_no_lock(size_t max_blocks, size_t target,
+                                                   const t_evict_skip_function &skip) {
+        if (budget() == 0) {
+            return 0;
+        }
+        const size_t target_bytes = target ? std::min(target, budget()) : budget();
+        size_t ret = 0;
+        size_t count = 0;
+        // Scan again only if the blocks from the last scan punted something.
+        size_t ret_at_scan = std::numeric_limits<size_t>::max();
+        while (num_bytes() > target_bytes && (max_blocks == 0 || count < max_blocks)) {
+            if (m_evict_candidates.empty()) {
+                if (ret == ret_at_scan) {
+                    break;
+                }
+                ret_at_scan = ret;
+                _evict_scan_no_lock(skip);
+                continue;
+            }
+            t_evict_candidate candidate = std::move(m_evict_candidates.back());
+            m_evict_candidates.pop_back();
+            t_svf_handle svf = candidate.svf.lock();
+            // Candidates may be left from a scan that did not skip this SVF.
+            if (svf && !(skip && skip(*svf))) {
+                ret += svf->punt(candidate.fpos, candidate.block_touch);
+            }
+            ++count;
         }
         return ret;
     }
 
-    /** @brief Destructor. */
+    /**
+     * @brief Find the least recently used blocks of every SparseVirtualFile.
+     *
+     * This finds enough to bring \c num_bytes() within the budget if the blocks are of average size, and at least
+     * \c SVFS_EVICT_BATCH.
+     * Block touches are compared by their age from the shared clock so this is correct when the clock wraps.
+     *
+     * @param skip If given then blocks of the SparseVirtualFile for which this returns true are not found.
+     */
+    void SparseVirtualFileSystem::_evict_scan_no_lock(const t_evict_skip_function &skip) {
+        std::vector<t_svf_handle> svfs;
+        for (const auto &shard: m_shards) {
+#ifdef SVFS_THREAD_SAFE
+            std::shared_lock<std::shared_mutex> lock_shard(shard.mutex);
+#endif
+            for (const auto &iter: shard.svfs) {
+                if (!(skip && skip(*iter.second))) {
+                    svfs.push_back(iter.second);
+                }
+            }
+        }
+        // Twice the estimate as blocks may be smaller than average or touched before they are punted.
+        size_t count = SVFS_EVICT_BATCH;
+        const size_t bytes = num_bytes();
+        const size_t blocks = num_blocks();
+        if (blocks && bytes > budget()) {
+            count = std::max(count, (bytes - budget()) / (bytes / blocks + 1) * 2);
+        }
+        const t_block_touch clock = m_totals.block_touch.load(std::memory_order_relaxed);
+        auto age = [clock](const t_evict_candidate &candidate) {
+            return static_cast<t_block_touch>(clock - candidate.block_touch);
+        };
+        // A heap of the oldest found so far with the youngest of those at the front.
+        auto younger = [&age](const t_evict_candidate &lhs, const t_evict_candidate &rhs) {
+            return age(lhs) > age(rhs);
+        };
+        m_evict_candidates.clear();
+        for (const auto &svf: svfs) {
+            for (const auto &iter: svf->block_touches()) {
+                t_evict_candidate candidate{svf, iter.second, iter.first};
+                if (m_evict_candidates.size() < count) {
+                    m_evict_candidates.push_back(std::move(candidate));
+                    std::push_heap(m_evict_candidates.begin(), m_evict_candidates.end(), younger);
+                } else if (age(candidate) > age(m_evict_candidates.front())) {
+                    std::pop_heap(m_evict_candidates.begin(), m_evict_candidates.end(), younger);
+                    m_evict_candidates.back() = std::move(candidate);
+                    std::push_heap(m_evict_candidates.begin(), m_evict_candidates.end(), younger);
+                }
+            }
+        }
+        // Oldest at the back.
+        std::sort(m_evict_candidates.begin(), m_evict_candidates.end(),
+                  [&age](const t_evict_candidate &lhs, const t_evict_candidate &rhs) {
+                      return age(lhs) < age(rhs);
+                  });
+    }
+
+    /** @brief Right size the memory of every SparseVirtualFile, see SparseVirtualFile::compact().
+     *
+     * If \c max_time is non-zero this stops after roughly that many seconds, each SparseVirtualFile continues from
+     * where it stopped on the next call.
+     *
+     * @param max_time The time budget in seconds, zero means no limit.
+     * @return The number of heap bytes reclaimed.
+     */
+    size_t SparseVirtualFileSystem::compact(double max_time) {
+#ifdef SVFS_THREAD_SAFE
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+#endif
+        auto time_start = std::chrono::steady_clock::now();
+        size_t ret = 0;
+        for (auto &shard: m_shards) {
+            for (auto &iter: shard.svfs) {
+                double time_remaining = 0.0;
+                if (max_time > 0.0) {
+                    std::chrono::duration<double> time_exec = std::chrono::steady_clock::now() - time_start;
+                    time_remaining = max_time - time_exec.count();
+                    if (time_remaining <= 0.0) {
+                        return ret;
+                    }
+                }
+                ret += iter.second->compact(time_remaining);
+            }
+        }
+        return ret;
+    }
+
+#pragma mark - Save and load
+
+    /**
+     * @brief The header at the start of a saved file.
+     *
+     * All integers are in native byte order, \c byte_order detects a file from a machine of different endianness.
+     *
+     * The layout of a saved file is:
+     *
+     * - This header, padded to \c SVFS_SAVE_PAGE_SIZE.
+     * - The block payloads. Each SVF starts on a page boundary and so does every block of a page or more.
+     * - The index, for each SVF: a \c uint64_t ID length, the ID padded to eight bytes, the \c double modification
+     *   time, a \c uint64_t block count then that many \c t_save_block values.
+     */
+    struct t_save_header {
+        /// Identifies the file.
+        char magic[8];
+        /// Always \c SVFS_SAVE_BYTE_ORDER.
+        uint32_t byte_order;
+        /// The format version.
+        uint32_t version;
+        /// The alignment of the payloads.
+        uint64_t page_size;
+        /// The number of SVFs.
+        uint64_t num_files;
+        /// Offset of the index from the start of the file.
+        uint64_t index_offset;
+        /// Size of the index in bytes.
+        uint64_t index_size;
+    };
+
+    /** @brief An index entry for a single block in a saved file. */
+    struct t_save_block {
+        /// File position of the block.
+        uint64_t fpos;
+        /// Offset of the data from the start of the saved file.
+        uint64_t offset;
+        /// Length of the block.
+        uint64_t len;
+    };
+
+    static const char SVFS_SAVE_MAGIC[8] = {'S', 'V', 'F', 'S', 'S', 'A', 'V', 'E'};
+    static const uint32_t SVFS_SAVE_BYTE_ORDER = 0x01020304;
+    static const uint32_t SVFS_SAVE_VERSION = 1;
+    static const uint64_t SVFS_SAVE_PAGE_SIZE = 4096;
+
+    /// Round up to a multiple of the alignment which must be a power of two.
+    static uint64_t save_align(uint64_t value, uint64_t alignment) noexcept {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    /**
+     * @brief Write every SparseVirtualFile, including any spilled or mapped blocks, to a file.
+     *
+     * The file is written to a temporary file alongside it that is then renamed so an existing file, which may be
+     * memory mapped by \c load(), is replaced atomically.
+     * The statistics and block touch values are not saved.
+     *
+     * This will raise an ExceptionSparseVirtualFileSystemSaveLoad if the file can not be written.
+     *
+     * @param path The file path.
+     */
+    void SparseVirtualFileSystem::save(const std::string &path) const {
+#ifdef SVFS_THREAD_SAFE
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+#endif
+        _save_no_lock(path);
+    }
+
+    void SparseVirtualFileSystem::_save_no_lock(const std::string &path) const {
+        std::ostringstream os;
+        os << "SparseVirtualFileSystem::save():";
+        const std::string path_temp = path + ".tmp";
+        std::ofstream stream(path_temp, std::ios::binary | std::ios::trunc);
+        if (!stream) {
+            os << " can not open \"" << path_temp << "\": " << std::strerror(errno);
+            throw Exceptions::ExceptionSparseVirtualFileSystemSaveLoad(os.str());
+        }
+        // Sort the IDs so that the output is reproducible.
+        std::vector<std::string> ids = keys();
+        std::sort(ids.begin(), ids.end());
+
+        const std::string padding(SVFS_SAVE_PAGE_SIZE, '\0');
+        uint64_t offset = SVFS_SAVE_PAGE_SIZE;
+        stream.write(padding.data(), SVFS_SAVE_PAGE_SIZE);
+        std::string index;
+        for (const auto &id: ids) {
+            const SparseVirtualFile &svf = at(id);
+            std::vector<t_save_block> save_blocks;
+            svf.visit_blocks([&](t_fpos fpos, const char *data, size_t len) {
+                // Small blocks are packed together.
+                uint64_t offset_block = offset;
+                if (len >= SVFS_SAVE_PAGE_SIZE || save_blocks.empty()) {
+                    offset_block = save_align(offset, SVFS_SAVE_PAGE_SIZE);
+                }
+                stream.write(padding.data(), static_cast<std::streamsize>(offset_block - offset));
+                stream.write(data, static_cast<std::streamsize>(len));
+                save_blocks.push_back(t_save_block{fpos, offset_block, len});
+                offset = offset_block + len;
+            });
+            uint64_t id_size = id.size();
+            double mod_time = svf.file_mod_time();
+            uint64_t num_blocks = save_blocks.size();
+            index.append(reinterpret_cast<const char *>(&id_size), sizeof(id_size));
+            index.append(id);
+            index.append(save_align(id_size, sizeof(uint64_t)) - id_size, '\0');
+            index.append(reinterpret_cast<const char *>(&mod_time), sizeof(mod_time));
+            index.append(reinterpret_cast<const char *>(&num_blocks), sizeof(num_blocks));
+            index.append(reinterpret_cast<const char *>(save_blocks.data()), num_blocks * sizeof(t_save_block));
+        }
+        t_save_header header{};
+        std::memcpy(header.magic, SVFS_SAVE_MAGIC, sizeof(header.magic));
+        header.byte_order = SVFS_SAVE_BYTE_ORDER;
+        header.version = SVFS_SAVE_VERSION;
+        header.page_size = SVFS_SAVE_PAGE_SIZE;
+        header.num_files = ids.size();
+        header.index_offset = save_align(offset, sizeof(uint64_t));
+        header.index_size = index.size();
+        stream.write(padding.data(), static_cast<std::streamsize>(header.index_offset - offset));
+        stream.write(index.data(), static_cast<std::streamsize>(index.size()));
+        stream.seekp(0);
+        stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        stream.close();
+        if (!stream) {
+            os << " can not write \"" << path_temp << "\"";
+            std::filesystem::remove(path_temp);
+            throw Exceptions::ExceptionSparseVirtualFileSystemSaveLoad(os.str());
+        }
+#ifndef _WIN32
+        // Make the data durable before the rename so that a crash can not leave an empty or partial file at path.
+        int fd = open(path_temp.c_str(), O_WRONLY);
+        if (fd < 0 || fsync(fd) != 0) {
+            os << " can not sync \"" << path_temp << "\": " << std::strerror(errno);
+            if (fd >= 0) {
+                close(fd);
+            }
+            std::filesystem::remove(path_temp);
+            throw Exceptions::ExceptionSparseVirtualFileSystemSaveLoad(os.str());
+        }
+        close(fd);
+#endif
+        std::error_code error;
+        std::filesystem::rename(path_temp, path, error);
+        if (error) {
+            os << " can not rename \"" << path_temp << "\" to \"" << path << "\": " << error.message();
+            std::filesystem::remove(path_temp);
+            throw Exceptions::ExceptionSparseVirtualFileSystemSaveLoad(os.str());
+        }
+    }
+
+    /**
+     * @brief Add every SparseVirtualFile in a file written by \c save().
+     *
+     * The file is memory mapped and only the index is read, so this is fast regardless of the size of the file.
+     * The blocks are mapped into each SparseVirtualFile, see SparseVirtualFile::map_block(), so \c has() and
+     * \c need() treat them as present and \c read() copies them into memory as they are needed.
+     * The file can be removed or replaced once loaded, the mapping is released when every mapped block has been read,
+     * erased or cleared.
+     * The new SparseVirtualFiles use the configuration of this SparseVirtualFileSystem.
+     *
+     * This will raise an ExceptionSparseVirtualFileSystemSaveLoad if the file can not be read or is invalid, or an
+     * ExceptionSparseVirtualFileSystemInsert if any ID already exists.
+     * In either case nothing is added.
+     *
+     * @param path The file path.
+     */
+    void SparseVirtualFileSystem::load(const std::string &path) {
+#ifdef SVFS_THREAD_SAFE
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+#endif
+        std::ostringstream os;
+        os << "SparseVirtualFileSystem::load():";
+#ifdef _WIN32
+        os << " loading is not supported on this platform.";
+        throw Exceptions::ExceptionSparseVirtualFileSystemSaveLoad(os.str());
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            os << " can not open \"" << path << "\": " << std::strerror(errno);
+            throw Exceptions::ExceptionSparseVirtualFileSystemSaveLoad(os.str());
+        }
+        struct stat file_stat{};
+        if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(t_save_header)) {
+            close(fd);
+            os << " \"" << path << "\" is not a saved file.";
+            throw Exceptions::ExceptionSparseVirtualFileSystemSaveLoad(os.str());
+        }
+        const size_t file_size = static_cast<size_t>(file_stat.st_size);
+        void *base = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping remains valid after the file is closed.
+        close(fd);
+        if (base == MAP_FAILED) {
+            os << " can not map \"" << path << "\": " << std::strerror(errno);
+            throw Exceptions::ExceptionSparseVirtualFileSystemSaveLoad(os.str());
+        }
+        std::shared_ptr<const char> mapping(static_cast<const char *>(base), [file_size](const char *ptr) {
+            munmap(const_cast<char *>(ptr), file_size);
+        });
+
+        // Read and check the whole index before adding anything.
+        const char *data = mapping.get();
+        t_save_header header{};
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, SVFS_SAVE_MAGIC, sizeof(header.magic)) != 0
+            || header.byte_order != SVFS_SAVE_BYTE_ORDER) {
+            os << " \"" << path << "\" is not a saved file or is from a machine of different byte order.";
+            throw Exceptions::ExceptionSparseVirtualFileSystemSaveLoad(os.str());
+        }
+        if (header.version != SVFS_SAVE_VERSION) {
+            os << " \"" << path << "\" has version " << header.version << " expected " << SVFS_SAVE_VERSION << ".";
+            throw Exceptions::ExceptionSparseVirtualFileSystemSaveLoad(os.str());
+        }
+        if (header.index_offset % sizeof(uint64_t) || header.index_offset > file_size
+            || header.index_size > file_size - header.index_offset) {
+            os << " \"" << path << "\" is truncated.";
+            throw Exceptions::ExceptionSparseVirtualFileSystemSaveLoad(os.str());
+        }
+        struct t_load_file {
+            std::string id;
+            double mod_time;
+            const t_save_block *blocks;
+            uint64_t num_blocks;
+        };
+        std::vector<t_load_file> load_files;
+        std::unordered_set<std::string> load_ids;
+        const char *index = data + header.index_offset;
+        const char *index_end = index + header.index_size;
+        auto index_corrupt = [&]() {
+            os << " \"" << path << "\" has a corrupt index.";
+            throw Exceptions::ExceptionSparseVirtualFileSystemSaveLoad(os.str());
+        };
+        auto index_read = [&](void *dest, size_t size) {
+            if (static_cast<size_t>(index_end - index) < size) {
+                index_corrupt();
+            }
+            if (dest) {
+                std::memcpy(dest, index, size);
+            }
+            index += size;
+        };
+        for (uint64_t i = 0; i < header.num_files; ++i) {
+            t_load_file load_file;
+            uint64_t id_size = 0;
+            index_read(&id_size, sizeof(id_size));
+            // Sizes from the file are checked against the rest of the index before any arithmetic that could wrap.
+            if (id_size > static_cast<size_t>(index_end - index)) {
+                index_corrupt();
+            }
+            const char *id_data = index;
+            index_read(nullptr, save_align(id_size, sizeof(uint64_t)));
+            load_file.id.assign(id_data, id_size);
+            index_read(&load_file.mod_time, sizeof(load_file.mod_time));
+            index_read(&load_file.num_blocks, sizeof(load_file.num_blocks));
+            if (load_file.num_blocks > static_cast<size_t>(index_end - index) / sizeof(t_save_block)) {
+                index_corrupt();
+            }
+            load_file.blocks = reinterpret_cast<const t_save_block *>(index);
+            index_read(nullptr, load_file.num_blocks * sizeof(t_save_block));
+            for (uint64_t b = 0; b < load_file.num_blocks; ++b) {
+                const t_save_block &block = load_file.blocks[b];
+                if (block.offset > file_size || block.len > file_size - block.offset) {
+                    os << " \"" << path << "\" block at " << block.fpos << " of \"" << load_file.id;
+                    os << "\" is outside the file.";
+                    throw Exceptions::ExceptionSparseVirtualFileSystemSaveLoad(os.str());
+                }
+            }
+            if (has(load_file.id) || !load_ids.insert(load_file.id).second) {
+                os << " can not insert \"" << load_file.id << "\"";
+                throw Exceptions::ExceptionSparseVirtualFileSystemInsert(os.str());
+            }
+            load_files.push_back(std::move(load_file));
+        }
+        for (const auto &load_file: load_files) {
+            t_shard &shard = _shard(load_file.id);
+#ifdef SVFS_THREAD_SAFE
+            std::unique_lock<std::shared_mutex> lock_shard(shard.mutex);
+#endif
+            auto result = shard.svfs.emplace(
+                    load_file.id, std::make_shared<SparseVirtualFile>(load_file.id, load_file.mod_time, m_config));
+            result.first->second->set_totals(&m_totals);
+            result.first->second->set_spill_store(m_spill_store);
+            for (uint64_t b = 0; b < load_file.num_blocks; ++b) {
+                const t_save_block &block = load_file.blocks[b];
+                result.first->second->map_block(mapping, block.fpos, data + block.offset, block.len);
+            }
+            // Loaded blocks are in the saved file so only later changes are journalled.
+            if (m_journal) {
+                m_journal->insert(load_file.id, load_file.mod_time);
+                result.first->second->set_journal(m_journal.get());
+            }
+        }
+#endif
+    }
+
+#pragma mark - Journal
+
+    /**
+     * @brief Replay a journal into this SparseVirtualFileSystem then record every change in it.
+     *
+     * Any journal moved aside by an incomplete \c checkpoint() is replayed first.
+     * Replay is tolerant of records that have already been applied, such as those in a snapshot loaded with
+     * \c load() before this is called, so the usual sequence on startup is \c load() the last checkpoint then
+     * \c journal_open().
+     * A truncated record at the end of the journal, from a crash, is removed.
+     *
+     * Every \c insert(), \c remove() and each SparseVirtualFile \c write(), \c erase(), punt and \c clear() is then
+     * appended to the journal.
+     * Records are written and synced with \c fdatasync() once there are \c sync_bytes of them, or on
+     * \c journal_flush(), so at most \c sync_bytes of changes are lost on a crash.
+     * Data in a spill file is not journalled and reads that move spilled or loaded blocks into memory are not
+     * journalled so replay may restore more blocks than were in memory.
+     *
+     * This will raise an ExceptionSparseVirtualFileSystemJournal if a journal is already open or the journal can not
+     * be read or opened.
+     *
+     * @param path The journal path.
+     * @param sync_bytes The number of bytes buffered before they are written and synced, zero syncs every change.
+     */
+    void SparseVirtualFileSystem::journal_open(const std::string &path, size_t sync_bytes) {
+#ifdef SVFS_THREAD_SAFE
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+#endif
+        std::ostringstream os;
+        os << "SparseVirtualFileSystem::journal_open():";
+        if (m_journal) {
+            os << " journal \"" << m_journal->path() << "\" is already open.";
+            throw Exceptions::ExceptionSparseVirtualFileSystemJournal(os.str());
+        }
+        try {
+            _journal_replay_no_lock(Journal::path_rotated(path));
+            _journal_replay_no_lock(path);
+            m_journal = std::make_unique<Journal>(path, sync_bytes);
+        } catch (const Exceptions::ExceptionSparseVirtualFile &err) {
+            os << " " << err.message();
+            throw Exceptions::ExceptionSparseVirtualFileSystemJournal(os.str());
+        }
+        for (auto &shard: m_shards) {
+            for (auto &iter: shard.svfs) {
+                iter.second->set_journal(m_journal.get());
+            }
+        }
+    }
+
+    /**
+     * @brief Apply every record of a journal file and truncate any invalid records at the end.
+     *
+     * Records that can not be applied, such as erasing a block that no longer exists, are ignored.
+     *
+     * @param path The journal path.
+     */
+    void SparseVirtualFileSystem::_journal_replay_no_lock(const std::string &path) {
+        size_t size_valid = Journal::replay(path, [this](const Journal::t_entry &entry) {
+            t_shard &shard = _shard(entry.id);
+#ifdef SVFS_THREAD_SAFE
+            std::unique_lock<std::shared_mutex> lock_shard(shard.mutex);
+#endif
+            auto iter = shard.svfs.find(entry.id);
+            switch (entry.type) {
+                case Journal::RECORD_INSERT:
+                    if (iter == shard.svfs.end()) {
+                        auto result = shard.svfs.emplace(
+                                entry.id, std::make_shared<SparseVirtualFile>(entry.id, entry.mod_time, m_config));
+                        result.first->second->set_totals(&m_totals);
+                        result.first->second->set_spill_store(m_spill_store);
+                    }
+                    break;
+                case Journal::RECORD_REMOVE:
+                    if (iter != shard.svfs.end()) {
+                        iter->second->set_totals(nullptr);
+                        shard.svfs.erase(iter);
+                    }
+                    break;
+                case Journal::RECORD_WRITE:
+                    if (iter != shard.svfs.end()) {
+                        iter->second->write(entry.fpos, entry.data, entry.len);
+                    }
+                    break;
+                case Journal::RECORD_ERASE:
+                    if (iter != shard.svfs.end()) {
+                        try {
+                            iter->second->erase(entry.fpos);
+                        } catch (const Exceptions::ExceptionSparseVirtualFileErase &) {
+                            // Already erased.
+                        }
+                    }
+                    break;
+                case Journal::RECORD_CLEAR:
+                    if (iter != shard.svfs.end()) {
+                        iter->second->clear();
+                    }
+                    break;
+            }
+        });
+        if (std::filesystem::exists(path) && std::filesystem::file_size(path) > size_valid) {
+            std::filesystem::resize_file(path, size_valid);
+        }
+    }
+
+    /**
+     * @brief Write any buffered journal records and sync the journal.
+     *
+     * This does nothing if there is no journal.
+     */
+    void SparseVirtualFileSystem::journal_flush() {
+#ifdef SVFS_THREAD_SAFE
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+#endif
+        if (m_journal) {
+            try {
+                m_journal->flush();
+            } catch (const Exceptions::ExceptionSparseVirtualFile &err) {
+                throw Exceptions::ExceptionSparseVirtualFileSystemJournal(err.message());
+            }
+        }
+    }
+
+    /**
+     * @brief Flush the journal and stop journalling.
+     *
+     * This does nothing if there is no journal.
+     */
+    void SparseVirtualFileSystem::journal_close() {
+#ifdef SVFS_THREAD_SAFE
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+#endif
+        for (auto &shard: m_shards) {
+            for (auto &iter: shard.svfs) {
+                iter.second->set_journal(nullptr);
+            }
+        }
+        m_journal.reset();
+    }
+
+    /**
+     * @brief Save a snapshot, see \c save(), and empty the journal.
+     *
+     * The journal is moved aside first so that changes made during the save are journalled, the moved journal is
+     * removed once the snapshot is complete.
+     * If this fails the moved journal is kept and is replayed by \c journal_open().
+     *
+     * This will raise an ExceptionSparseVirtualFileSystemJournal if there is no journal or it can not be moved,
+     * or an ExceptionSparseVirtualFileSystemSaveLoad if the snapshot can not be saved.
+     *
+     * @param path The snapshot path.
+     */
+    void SparseVirtualFileSystem::checkpoint(const std::string &path) {
+#ifdef SVFS_THREAD_SAFE
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+#endif
+        std::ostringstream os;
+        os << "SparseVirtualFileSystem::checkpoint():";
+        if (!m_journal) {
+            os << " there is no journal.";
+            throw Exceptions::ExceptionSparseVirtualFileSystemJournal(os.str());
+        }
+        try {
+            m_journal->rotate();
+        } catch (const Exceptions::ExceptionSparseVirtualFile &err) {
+            os << " " << err.message();
+            throw Exceptions::ExceptionSparseVirtualFileSystemJournal(os.str());
+        }
+        _save_no_lock(path);
+        std::filesystem::remove(Journal::path_rotated(m_journal->path()));
+    }
+
+    /** @brief Destructor, this is not journalled. Any SparseVirtualFile with an outstanding handle keeps its data. */
     SparseVirtualFileSystem::~SparseVirtualFileSystem() noexcept {
-        for (auto &iter: m_svfs) {
-            iter.second.clear();
+        for (auto &shard: m_shards) {
+            for (auto &iter: shard.svfs) {
+                iter.second->set_journal(nullptr);
+                iter.second->set_totals(nullptr);
+                if (iter.second.use_count() == 1) {
+                    iter.second->clear();
+                }
+            }
+            shard.svfs.clear();
         }
-        m_svfs.clear();
     }
 
 }
@@ -32,12 +32,18 @@
 #ifndef CPPSVF_SVFS_H
 #define CPPSVF_SVFS_H
 
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #ifdef SVFS_THREAD_SAFE
 
 #include <mutex>
+#include <shared_mutex>
 
 #endif
 
@@ -76,6 +82,20 @@ namespace SVFS {
                     msg) {}
         };
 
+        /** @brief Exception specialisation on save or load error. */
+        class ExceptionSparseVirtualFileSystemSaveLoad : public ExceptionSparseVirtualFileSystem {
+        public:
+            explicit ExceptionSparseVirtualFileSystemSaveLoad(const std::string &msg)
+                    : ExceptionSparseVirtualFileSystem(msg) {}
+        };
+
+        /** @brief Exception specialisation on journal error. */
+        class ExceptionSparseVirtualFileSystemJournal : public ExceptionSparseVirtualFileSystem {
+        public:
+            explicit ExceptionSparseVirtualFileSystemJournal(const std::string &msg)
+                    : ExceptionSparseVirtualFileSystem(msg) {}
+        };
+
         /** @brief Exception specialisation on remove error. */
         class ExceptionSparseVirtualFileSystemRemove : public ExceptionSparseVirtualFileSystem {
         public:
@@ -87,22 +107,56 @@ namespace SVFS {
 
 #pragma mark - The SVFS class
 
+    class Journal;
+
+    /// The number of shards of the SVF map in a SparseVirtualFileSystem, this must be a power of two.
+    static const size_t SVFS_SHARD_COUNT = 16;
+
+    /// A reference counted handle to a SparseVirtualFile in a SparseVirtualFileSystem.
+    typedef std::shared_ptr<SparseVirtualFile> t_svf_handle;
+
+    /// The least number of blocks that SparseVirtualFileSystem::evict() finds in one scan of every SVF.
+    static const size_t SVFS_EVICT_BATCH = 4096;
+
+    /// A write over the budget evicts down to the budget less 1/SVFS_EVICT_HEADROOM of it, see \c low_water().
+    static const size_t SVFS_EVICT_HEADROOM = 64;
+
     /**
      * @brief A SparseVirtualFileSystem is a key/value store where the key is a file ID as a string and the value is a
      * SparseVirtualFile.
+     *
+     * The store is split into \c SVFS_SHARD_COUNT shards by the hash of the ID, each with its own lock if
+     * \c SVFS_THREAD_SAFE is defined.
+     * \c has(), \c at() and the totals can be called concurrently with \c insert() and \c remove() of other IDs,
+     * a reference from \c at() remains valid until that ID is removed.
+     * A handle from \c handle() or \c get_or_insert() remains valid after the ID is removed so the SparseVirtualFile
+     * can be used outside any lock on the SparseVirtualFileSystem.
+     * \c size_of(), \c num_bytes() and \c num_blocks() are running totals that each SparseVirtualFile updates as it
+     * changes so these are constant time and take no lock.
+     * With a budget, see \c set_budget(), \c write() and \c evict() punt the least recently used blocks of any
+     * SparseVirtualFile to keep \c num_bytes() within it.
      */
     class SparseVirtualFileSystem {
     public:
         /** @brief Constructor takes a tSparseVirtualFileConfig that is passed to every new SparseVirtualFile */
-        explicit SparseVirtualFileSystem(const tSparseVirtualFileConfig &config = tSparseVirtualFileConfig()) : \
-            m_config(config) {}
+        explicit SparseVirtualFileSystem(const tSparseVirtualFileConfig &config = tSparseVirtualFileConfig(),
+                                         size_t reserve_count = 0);
+
+        // Pre-size for this many SVFs so that inserting them does not rehash.
+        void reserve(size_t count);
 
         // Insert a new SVF
         void insert(const std::string &id, double mod_time);
 
+        // Return a handle to an SVF, inserting it if there is none.
+        t_svf_handle get_or_insert(const std::string &id, double mod_time);
+
         // Remove a specific SVF.
         void remove(const std::string &id);
 
+        // Return a handle to an SVF or nullptr.
+        [[nodiscard]] t_svf_handle handle(const std::string &id) const noexcept;
+
         // May raise an ExceptionSparseVirtualFileSystemOutOfRange
         [[nodiscard]] const SparseVirtualFile &at(const std::string &id) const;
 
@@ -110,10 +164,10 @@ namespace SVFS {
         [[nodiscard]] SparseVirtualFile &at(const std::string &id);
 
         // Has an SVF
-        [[nodiscard]] bool has(const std::string &id) const noexcept { return m_svfs.find(id) != m_svfs.end(); }
+        [[nodiscard]] bool has(const std::string &id) const noexcept;
 
         // Number of SVFs
-        [[nodiscard]] size_t size() const noexcept { return m_svfs.size(); }
+        [[nodiscard]] size_t size() const noexcept;
 
         // Total estimated memory usage.
         [[nodiscard]] size_t size_of() const noexcept;
@@ -127,6 +181,56 @@ namespace SVFS {
         // All the SVF IDs.
         [[nodiscard]] std::vector<std::string> keys() const noexcept;
 
+        // Write to an SVF then evict blocks if over the budget.
+        void write(const std::string &id, t_fpos fpos, const char *data, size_t len);
+
+        // Set the byte budget for every SVF and the most blocks that write() evicts, zero is no limit.
+        void set_budget(size_t budget, size_t evict_max_blocks = 0) noexcept;
+
+        /// The byte budget, zero if there is none.
+        [[nodiscard]] size_t budget() const noexcept { return m_budget.load(std::memory_order_relaxed); }
+
+        /// The most blocks that \c write() evicts, zero is no limit.
+        [[nodiscard]] size_t evict_max_blocks() const noexcept {
+            return m_evict_max_blocks.load(std::memory_order_relaxed);
+        }
+
+        /// What \c write() evicts down to, a little below the budget so that not every write has to evict.
+        [[nodiscard]] size_t low_water() const noexcept { return budget() - budget() / SVFS_EVICT_HEADROOM; }
+
+        /// Type of the function that returns true if the blocks of a SVF must not be evicted.
+        typedef std::function<bool(const SparseVirtualFile &svf)> t_evict_skip_function;
+
+        // Punt the least recently used blocks of any SVF until within the target or, if zero, the budget.
+        size_t evict(size_t max_blocks = 0, size_t target = 0, const t_evict_skip_function &skip = nullptr);
+
+        // If over the budget evict as write() does unless another thread is already evicting.
+        size_t evict_over_budget(const t_evict_skip_function &skip = nullptr);
+
+        // Right size the memory of every SVF.
+        size_t compact(double max_time = 0.0);
+
+        // Write every SVF to a file.
+        void save(const std::string &path) const;
+
+        // Add every SVF in a saved file, the data is read lazily.
+        void load(const std::string &path);
+
+        // Replay a journal then record every change to it.
+        void journal_open(const std::string &path, size_t sync_bytes);
+
+        // Write and sync the journal.
+        void journal_flush();
+
+        // Flush and stop journalling.
+        void journal_close();
+
+        // Save a snapshot and empty the journal.
+        void checkpoint(const std::string &path);
+
+        /// The journal or \c nullptr.
+        [[nodiscard]] const Journal *journal() const noexcept { return m_journal.get(); }
+
         /// The configuration.
         [[nodiscard]] const tSparseVirtualFileConfig &config() const noexcept { return m_config; }
 
@@ -139,15 +243,76 @@ namespace SVFS {
         ~SparseVirtualFileSystem() noexcept;
 
     protected:
-        /// The key/value store of SVF values.
-        std::unordered_map<std::string, SparseVirtualFile> m_svfs;
+        /// The key/value store of SVF handles.
+        typedef std::unordered_map<std::string, t_svf_handle> t_map;
+
+        /** @brief One shard of the key/value store. */
+        struct t_shard {
+            /// The SVF values with an ID that hashes to this shard.
+            t_map svfs;
+#ifdef SVFS_THREAD_SAFE
+            /// Shared for a lookup, exclusive to insert or remove.
+            mutable std::shared_mutex mutex;
+#endif
+        };
+
+        /// The shard for an ID, this ignores the low bits of the hash as the map uses those for its buckets.
+        [[nodiscard]] t_shard &_shard(const std::string &id) noexcept {
+            return m_shards[(std::hash<std::string>{}(id) >> 8) & (SVFS_SHARD_COUNT - 1)];
+        }
+
+        /// The shard for an ID.
+        [[nodiscard]] const t_shard &_shard(const std::string &id) const noexcept {
+            return m_shards[(std::hash<std::string>{}(id) >> 8) & (SVFS_SHARD_COUNT - 1)];
+        }
+
+        /// The shards of the key/value store.
+        std::array<t_shard, SVFS_SHARD_COUNT> m_shards;
         /// The configuration for all SVF values.
         tSparseVirtualFileConfig m_config;
 #ifdef SVFS_THREAD_SAFE
-        /// The access mutex if multi-threaded. This is used when inserting or removing an SVF.
+        /// The access mutex if multi-threaded.
+        /// This is shared when inserting or removing an SVF and exclusive for operations on every SVF such as \c save().
         /// @note Each SVFS has its own mutex.
-        mutable std::mutex m_mutex;
+        mutable std::shared_mutex m_mutex;
 #endif
+        /// The journal if open.
+        std::unique_ptr<Journal> m_journal;
+        /// Running totals that every SVF adds its changes to so that \c num_bytes() etc. are constant time.
+        tSparseVirtualFileTotals m_totals;
+        /// The spill store shared by every SVF so that there is one spill file and one capacity, see
+        /// \c tSparseVirtualFileConfig::spill_capacity. \c nullptr if that is zero.
+        std::shared_ptr<SpillStore> m_spill_store;
+        /// The byte budget, see \c set_budget().
+        std::atomic<size_t> m_budget{0};
+        /// The most blocks that \c write() evicts.
+        std::atomic<size_t> m_evict_max_blocks{0};
+
+        /** @brief A block that \c evict() might punt. */
+        struct t_evict_candidate {
+            /// The SVF, this might have been removed since.
+            std::weak_ptr<SparseVirtualFile> svf;
+            /// The file position of the block.
+            t_fpos fpos;
+            /// The block touch when found, if the block has been touched since it is not punted.
+            t_block_touch block_touch;
+        };
+        /// The least recently used blocks found by the last scan with the oldest at the back.
+        std::vector<t_evict_candidate> m_evict_candidates;
+#ifdef SVFS_THREAD_SAFE
+        /// Only one thread evicts at a time.
+        std::mutex m_evict_mutex;
+#endif
+    private:
+        t_svf_handle _get_or_insert(const std::string &id, double mod_time, bool &inserted);
+
+        void _save_no_lock(const std::string &path) const;
+
+        void _journal_replay_no_lock(const std::string &path);
+
+        size_t _evict_no_lock(size_t max_blocks, size_t target, const t_evict_skip_function &skip);
+
+        void _evict_scan_no_lock(const t_evict_skip_function &skip);
     };
 }
 
@@ -29,10 +29,14 @@
  @endverbatim
  */
 
+#include <cstring>
+#include <filesystem>
 #include <iostream>
 #include <iomanip>
 #include <thread>
 
+#include "svf_journal.h"
+#include "svf_spill.h"
 #include "test_svf.h"
 
 
@@ -249,6 +253,12 @@ namespace SVFS {
                 //        ^==|    |==|
                 //          |++++++|
                 {"New joins two blocks", {{8, 4}, {16, 4}, {10, 8}}, {{8, 12}},},
+                //      ^==|    |==|
+                //           |+++++|
+                {"New after a block overlaps the next block", {{2, 4}, {16, 4}, {10, 8}}, {{2, 4}, {10, 10}},},
+                //      ^==|    |==|
+                //            |+++|
+                {"New after a block is adjacent to the next block", {{2, 4}, {16, 4}, {12, 4}}, {{2, 4}, {12, 8}},},
 #endif
 
                 //        ^==|    |==|
@@ -1943,6 +1953,761 @@ namespace SVFS {
             return count;
         }
 
+        /**
+         * Compare \c has() and \c need() on a SVF with a coverage bitmap against one without over a sequence of
+         * writes, an erase and a punt.
+         */
+        TestCount test_coverage_matches_map(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            tSparseVirtualFileConfig config;
+            config.coverage_page_size = 4;
+            SparseVirtualFile svf_coverage("", 0.0, config);
+            SparseVirtualFile svf("", 0.0);
+
+            auto time_start = std::chrono::high_resolution_clock::now();
+            auto check = [&]() {
+                for (t_fpos fpos = 0; fpos < 256; ++fpos) {
+                    for (size_t len = 1; len < 48; ++len) {
+                        result |= svf_coverage.has(fpos, len) != svf.has(fpos, len);
+                        result |= svf_coverage.need(fpos, len) != svf.need(fpos, len);
+                    }
+                }
+            };
+            const t_seek_reads writes = {{8, 4}, {17, 25}, {64, 3}, {70, 30}, {67, 3}, {128, 64}, {160, 60}};
+            for (const auto &write: writes) {
+                svf_coverage.write(write.first, test_data_bytes_512 + write.first, write.second);
+                svf.write(write.first, test_data_bytes_512 + write.first, write.second);
+                check();
+            }
+            result |= svf_coverage.erase(17) != svf.erase(17);
+            check();
+            result |= svf_coverage.lru_punt(128) != svf.lru_punt(128);
+            check();
+            result |= svf_coverage.num_blocks() != svf.num_blocks();
+            svf_coverage.clear();
+            svf.clear();
+            check();
+
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            TestResult test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(),
+                                                svf.num_bytes());
+            results.push_back(test_result);
+            count.add_result(test_result.result());
+            return count;
+        }
+
+        /**
+         * As \c test_coverage_matches_map() but with ranges that span many words and leaves of the coverage bitmap.
+         */
+        TestCount test_coverage_matches_map_words(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            tSparseVirtualFileConfig config;
+            config.coverage_page_size = 1;
+            SparseVirtualFile svf_coverage("", 0.0, config);
+            SparseVirtualFile svf("", 0.0);
+            const std::string data(16384, 'x');
+
+            auto time_start = std::chrono::high_resolution_clock::now();
+            auto check = [&]() {
+                for (t_fpos fpos: {0, 63, 64, 100, 101, 4095, 4096, 5000, 8191, 8192, 10099}) {
+                    for (size_t len: {1, 63, 64, 65, 128, 4000, 4096, 4097, 8192, 9999, 10000, 12000}) {
+                        result |= svf_coverage.has(fpos, len) != svf.has(fpos, len);
+                    }
+                }
+            };
+            const t_seek_reads writes = {{100, 10000}, {10200, 1800}, {10100, 100}};
+            for (const auto &write: writes) {
+                svf_coverage.write(write.first, data.c_str(), write.second);
+                svf.write(write.first, data.c_str(), write.second);
+                check();
+            }
+            result |= svf_coverage.erase(100) != svf.erase(100);
+            check();
+            svf_coverage.write(4096, data.c_str(), 4096);
+            svf.write(4096, data.c_str(), 4096);
+            check();
+
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            TestResult test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(),
+                                                svf.num_bytes());
+            results.push_back(test_result);
+            count.add_result(test_result.result());
+            return count;
+        }
+
+        /**
+         * Time 1M \c has() calls of 4 bytes scattered over 16Mb of data held as 65536 blocks of 256 bytes.
+         *
+         * @param results The test results.
+         * @param coverage_page_size The coverage bitmap page size, zero disables the bitmap.
+         */
+        static TestCount _test_perf_has_coverage(t_test_results &results, size_t coverage_page_size) {
+            TestCount count;
+            tSparseVirtualFileConfig config;
+            config.coverage_page_size = coverage_page_size;
+            SparseVirtualFile svf("", 0.0, config);
+            const size_t block_size = 256;
+            const size_t num_blocks = 65536;
+            for (size_t i = 0; i < num_blocks; ++i) {
+                svf.write(i * (block_size + 1), test_data_bytes_512, block_size);
+            }
+            const size_t extent = num_blocks * (block_size + 1);
+            int result = svf.num_blocks() != num_blocks;
+            size_t hits = 0;
+            auto time_start = std::chrono::high_resolution_clock::now();
+            t_fpos fpos = 0;
+            for (size_t i = 0; i < 1024 * 1024; ++i) {
+                // Scatter the reads over the whole extent.
+                fpos = (fpos + 7919 * 7) % extent;
+                hits += svf.has(fpos, 4);
+            }
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            // Every block of 256 bytes has 253 hits in 257 file positions.
+            result |= hits < (1024 * 1024 * 240) / 257;
+
+            std::ostringstream os;
+            os << "1M has(), coverage_page_size " << std::setw(4) << coverage_page_size;
+            os << " hits " << hits;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, std::string(os.str()), result, "", time_exec.count(),
+                                          1024 * 1024);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        TestCount test_perf_has_coverage_off(t_test_results &results) {
+            return _test_perf_has_coverage(results, 0);
+        }
+
+        TestCount test_perf_has_coverage_on(t_test_results &results) {
+            return _test_perf_has_coverage(results, 64);
+        }
+
+        /**
+         * Compare the public API of a SVF with dense regions against one without over a sequence of writes,
+         * including ones that fill gaps, and erases of leading, middle and trailing blocks of a region.
+         */
+        TestCount test_dense_matches_map(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            tSparseVirtualFileConfig config;
+            config.dense_gap = 8;
+            SparseVirtualFile svf_dense("", 0.0, config);
+            SparseVirtualFile svf("", 0.0);
+
+            auto time_start = std::chrono::high_resolution_clock::now();
+            auto check = [&]() {
+                result |= svf_dense.blocks() != svf.blocks();
+                result |= svf_dense.num_blocks() != svf.num_blocks();
+                result |= svf_dense.num_bytes() != svf.num_bytes();
+                for (t_fpos fpos = 0; fpos < 256; ++fpos) {
+                    for (size_t len = 1; len < 48; ++len) {
+                        result |= svf_dense.has(fpos, len) != svf.has(fpos, len);
+                        result |= svf_dense.need(fpos, len) != svf.need(fpos, len);
+                        result |= svf_dense.need(fpos, len, 64) != svf.need(fpos, len, 64);
+                    }
+                }
+                for (const auto &block: svf.blocks()) {
+                    char buffer[256];
+                    svf_dense.read(block.first, block.second, buffer);
+                    result |= std::memcmp(buffer, test_data_bytes_512 + block.first, block.second) != 0;
+                    result |= svf_dense.block_size(block.first) != block.second;
+                }
+            };
+            const t_seek_reads writes = {
+                    {8, 4}, {17, 3}, {24, 4}, {40, 8}, {12, 5}, {64, 3}, {100, 10}, {70, 30}, {128, 64}, {200, 8}
+            };
+            for (const auto &write: writes) {
+                svf_dense.write(write.first, test_data_bytes_512 + write.first, write.second);
+                svf.write(write.first, test_data_bytes_512 + write.first, write.second);
+                check();
+            }
+            for (t_fpos fpos: {200, 8, 40}) {
+                result |= svf_dense.erase(fpos) != svf.erase(fpos);
+                check();
+            }
+            svf_dense.clear();
+            svf.clear();
+            check();
+
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            TestResult test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(),
+                                                svf.num_bytes());
+            results.push_back(test_result);
+            count.add_result(test_result.result());
+            return count;
+        }
+
+        // As test_perf_write_1M_uncoalesced_size_of() but with dense_gap set to 1 so that the blocks are held in a
+        // single dense region.
+        TestCount test_perf_write_1M_uncoalesced_dense_size_of(t_test_results &results) {
+            TestCount count;
+            for (size_t block_size = 1; block_size <= 256; block_size *= 2) {
+                tSparseVirtualFileConfig config;
+                config.dense_gap = 1;
+                SparseVirtualFile svf("", 0.0, config);
+
+                size_t num_blocks = (1024 * 1024 * 1) / block_size;
+
+                auto time_start = std::chrono::high_resolution_clock::now();
+                for (t_fpos i = 0; i < num_blocks; ++i) {
+                    t_fpos fpos = i * block_size + i;
+                    svf.write(fpos, test_data_bytes_512, block_size);
+                }
+                std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+                int result = svf.num_blocks() != num_blocks;
+
+                std::ostringstream os;
+                os << "1Mb, block size " << std::setw(3) << block_size << " sized blocks";
+                os << " num_blocks " << num_blocks;
+                os << " size_of " << svf.size_of();
+                os << " Overhead " << svf.size_of() - svf.num_bytes();
+                os << " per block " << (svf.size_of() - svf.num_bytes()) / num_blocks;
+                auto test_result = TestResult(__PRETTY_FUNCTION__, std::string(os.str()), result, "",
+                                              time_exec.count(), svf.size_of());
+                count.add_result(test_result.result());
+                results.push_back(test_result);
+            }
+
+            return count;
+        }
+
+
+        // Exercise BlockValue moving between inline and heap storage.
+        TestCount test_block_value(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            auto time_start = std::chrono::high_resolution_clock::now();
+            auto matches = [](const BlockValue &value, const char *data, size_t len) {
+                return value.size() == len && std::memcmp(value.data(), data, len) == 0;
+            };
+
+            BlockValue value;
+            result |= !value.empty() || !value.is_inline() || value.capacity() != BlockValue::INLINE_CAPACITY;
+            value.append(test_data_bytes_512, BlockValue::INLINE_CAPACITY);
+            result |= !value.is_inline() || !matches(value, test_data_bytes_512, BlockValue::INLINE_CAPACITY);
+            // One more byte moves to the heap.
+            value.push_back(test_data_bytes_512[BlockValue::INLINE_CAPACITY]);
+            result |= value.is_inline() || !matches(value, test_data_bytes_512, BlockValue::INLINE_CAPACITY + 1);
+            value.append(test_data_bytes_512 + BlockValue::INLINE_CAPACITY + 1, 100);
+            result |= !matches(value, test_data_bytes_512, BlockValue::INLINE_CAPACITY + 101);
+            value.erase_front(110);
+            result |= !matches(value, test_data_bytes_512 + 110, BlockValue::INLINE_CAPACITY - 9);
+            // Shrinking moves back inline.
+            value.shrink_to_fit();
+            result |= !value.is_inline() || !matches(value, test_data_bytes_512 + 110, BlockValue::INLINE_CAPACITY - 9);
+            // Resize zero fills.
+            value.resize(64);
+            result |= value.is_inline() || value.size() != 64 || value[63] != 0;
+            value.assign(8, 'x');
+            value.shrink_to_fit();
+            result |= !value.is_inline() || value.size() != 8 || value[7] != 'x';
+            // A bitmap is only held on the heap and is kept by shrink_to_fit().
+            value.bitmap().assign(1, 0xff);
+            value.shrink_to_fit();
+            result |= value.is_inline() || !value.has_bitmap() || value.size() != 8 || value[0] != 'x';
+            value.clear_bitmap();
+            value.shrink_to_fit();
+            result |= !value.is_inline() || value.has_bitmap();
+            // Moves leave the source empty.
+            value.block_touch = 42;
+            BlockValue other(std::move(value));
+            result |= !value.empty() || other.size() != 8 || other.block_touch != 42;
+            other.resize(1000);
+            value = std::move(other);
+            result |= !other.empty() || value.size() != 1000 || value.is_inline();
+
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            TestResult test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(), 0);
+            results.push_back(test_result);
+            count.add_result(test_result.result());
+            return count;
+        }
+
+        // Write blocks that are coalesced by appending so that they have capacity to spare.
+        static void _write_blocks_with_slack(SparseVirtualFile &svf, size_t num_blocks) {
+            for (t_fpos i = 0; i < num_blocks; ++i) {
+                t_fpos fpos = i * 1024;
+                svf.write(fpos, test_data_bytes_512, 100);
+                svf.write(fpos + 100, test_data_bytes_512, 101);
+            }
+        }
+
+        TestCount test_compact(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            SparseVirtualFile svf("", 0.0);
+            _write_blocks_with_slack(svf, 16);
+            // Small blocks are held inline and have no slack.
+            svf.write(100000, test_data_bytes_512, 8);
+
+            auto time_start = std::chrono::high_resolution_clock::now();
+            size_t size_of = svf.size_of();
+            size_t reclaimed = svf.compact();
+            result |= reclaimed == 0;
+            result |= svf.size_of() + reclaimed != size_of;
+            // Nothing more to do until a write.
+            result |= svf.compact() != 0;
+            for (t_fpos i = 0; i < 16; ++i) {
+                char buffer[201];
+                svf.read(i * 1024, 201, buffer);
+                result |= std::memcmp(buffer, test_data_bytes_512, 100) != 0;
+                result |= std::memcmp(buffer + 100, test_data_bytes_512, 101) != 0;
+            }
+            svf.write(16 * 1024, test_data_bytes_512, 100);
+            svf.write(16 * 1024 + 100, test_data_bytes_512, 101);
+            result |= svf.compact() == 0;
+            result |= svf.num_blocks() != 18;
+
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            TestResult test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(),
+                                                svf.num_bytes());
+            results.push_back(test_result);
+            count.add_result(test_result.result());
+            return count;
+        }
+
+        // An incremental compact() with a tiny time budget reclaims the same as a single compact().
+        TestCount test_compact_incremental(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            SparseVirtualFile svf("", 0.0);
+            SparseVirtualFile svf_incremental("", 0.0);
+            _write_blocks_with_slack(svf, 4096);
+            _write_blocks_with_slack(svf_incremental, 4096);
+
+            auto time_start = std::chrono::high_resolution_clock::now();
+            size_t reclaimed = svf.compact();
+            size_t reclaimed_incremental = 0;
+            size_t calls = 0;
+            while (svf_incremental.size_of() > svf.size_of()) {
+                reclaimed_incremental += svf_incremental.compact(1e-9);
+                ++calls;
+            }
+            result |= calls < 2;
+            result |= reclaimed_incremental != reclaimed;
+            result |= svf_incremental.compact(1e-9) != 0;
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            std::ostringstream os;
+            os << test_name << " calls " << calls << " reclaimed " << reclaimed;
+            TestResult test_result = TestResult(__PRETTY_FUNCTION__, os.str(), result, "", time_exec.count(),
+                                                reclaimed);
+            results.push_back(test_result);
+            count.add_result(test_result.result());
+            return count;
+        }
+
+        TestCount test_spill_file(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            auto time_start = std::chrono::high_resolution_clock::now();
+            SpillFile spill("", 1024);
+
+            result |= spill.put(0, test_data_bytes_512, 2048);
+            result |= !spill.put(100, test_data_bytes_512 + 100, 100);
+            result |= !spill.put(200, test_data_bytes_512 + 200, 50);
+            result |= !spill.has(100, 150) || spill.has(100, 151) || spill.has(99, 2);
+            result |= spill.subtract({{50, 300}}) != t_seek_reads({{50, 50}, {250, 100}});
+            // Overwriting the middle trims the existing block.
+            result |= !spill.put(120, test_data_bytes_512 + 120, 10);
+            result |= spill.blocks() != t_seek_reads({{100, 20}, {120, 10}, {130, 70}, {200, 50}});
+            result |= spill.num_bytes() != 150;
+            result |= spill.discard(110, 100) != 100;
+            result |= spill.blocks() != t_seek_reads({{100, 10}, {210, 40}});
+            // Taking returns the original data.
+            size_t taken = spill.take(0, 215, [&](t_fpos fpos, const char *data, size_t len) {
+                result |= std::memcmp(data, test_data_bytes_512 + fpos, len) != 0;
+            });
+            result |= taken != 50 || spill.num_blocks() != 0;
+            // Filling the file evicts the oldest blocks.
+            for (t_fpos fpos = 0; fpos < 4096; fpos += 256) {
+                result |= !spill.put(fpos, test_data_bytes_512, 256);
+            }
+            result |= spill.blocks() != t_seek_reads({{3072, 256}, {3328, 256}, {3584, 256}, {3840, 256}});
+            result |= spill.blocks_evicted() != 12 || spill.bytes_evicted() != 12 * 256;
+            spill.clear();
+            result |= spill.num_bytes() != 0 || spill.has(3072, 1);
+
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            TestResult test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(), 0);
+            results.push_back(test_result);
+            count.add_result(test_result.result());
+            return count;
+        }
+
+        // Spill files that share a store share its capacity, the oldest block of any of them is evicted first.
+        TestCount test_spill_store_shared(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            auto time_start = std::chrono::high_resolution_clock::now();
+            auto store = std::make_shared<SpillStore>("", 1024);
+            SpillFile spill_a(store);
+            {
+                SpillFile spill_b(store);
+                // No file until the first block is written.
+                result |= store->is_open();
+                result |= !spill_a.put(0, test_data_bytes_512, 512);
+                result |= !store->is_open();
+                result |= !spill_b.put(0, test_data_bytes_512, 512);
+                // This wraps and evicts the block of spill_a.
+                result |= !spill_b.put(512, test_data_bytes_512, 256);
+                result |= spill_a.num_blocks() != 0 || spill_a.blocks_evicted() != 1 || spill_a.bytes_evicted() != 512;
+                result |= spill_b.blocks() != t_seek_reads({{0, 512}, {512, 256}}) || spill_b.blocks_evicted() != 0;
+                // This goes where the block of spill_a was.
+                result |= !spill_a.put(0, test_data_bytes_512, 256);
+                result |= spill_b.num_blocks() != 2 || spill_b.blocks_evicted() != 0;
+            }
+            // Destroying spill_b frees its space so nothing of spill_a is evicted.
+            result |= !spill_a.put(256, test_data_bytes_512 + 256, 256);
+            result |= !spill_a.put(512, test_data_bytes_512, 256);
+            result |= spill_a.blocks() != t_seek_reads({{0, 256}, {256, 256}, {512, 256}});
+            result |= spill_a.blocks_evicted() != 1;
+            spill_a.take(0, 512, [&](t_fpos fpos, const char *data, size_t len) {
+                result |= std::memcmp(data, test_data_bytes_512 + fpos, len) != 0;
+            });
+
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            TestResult test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(), 0);
+            results.push_back(test_result);
+            count.add_result(test_result.result());
+            return count;
+        }
+
+        // Punted blocks are spilled so has(), need() and read() behave as if they had never been punted.
+        TestCount test_spill_matches_map(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            tSparseVirtualFileConfig config;
+            config.spill_capacity = 1024 * 1024;
+            SparseVirtualFile svf_spill("", 0.0, config);
+            SparseVirtualFile svf("", 0.0);
+
+            auto time_start = std::chrono::high_resolution_clock::now();
+            const t_seek_reads writes = {
+                    {8, 4}, {17, 3}, {24, 4}, {40, 8}, {64, 3}, {100, 10}, {128, 64}, {200, 8}
+            };
+            for (const auto &write: writes) {
+                svf_spill.write(write.first, test_data_bytes_512 + write.first, write.second);
+                svf.write(write.first, test_data_bytes_512 + write.first, write.second);
+            }
+            svf_spill.lru_punt(10);
+            result |= svf_spill.num_blocks() != 1 || svf_spill.spill()->num_blocks() != writes.size() - 1;
+            for (t_fpos fpos = 0; fpos < 256; ++fpos) {
+                for (size_t len = 1; len < 48; ++len) {
+                    result |= svf_spill.has(fpos, len) != svf.has(fpos, len);
+                    result |= svf_spill.need(fpos, len) != svf.need(fpos, len);
+                    result |= svf_spill.need(fpos, len, 64) != svf.need(fpos, len, 64);
+                }
+            }
+            // Reading promotes the block back to memory.
+            char buffer[64];
+            svf_spill.read(140, 20, buffer);
+            result |= std::memcmp(buffer, test_data_bytes_512 + 140, 20) != 0;
+            result |= svf_spill.block_size(128) != 64 || svf_spill.spill()->has(128, 1);
+            // Writing over spilled blocks and reading promotes and coalesces them.
+            svf_spill.write(43, test_data_bytes_512 + 43, 30);
+            svf_spill.read(40, 33, buffer);
+            result |= std::memcmp(buffer, test_data_bytes_512 + 40, 33) != 0;
+            result |= svf_spill.block_size(40) != 33 || svf_spill.spill()->has(64, 1);
+            // Erasing removes the spilled data as well.
+            svf_spill.erase(128);
+            result |= svf_spill.has(128, 1) || svf_spill.need(128, 64) != t_seek_reads({{128, 64}});
+            svf_spill.clear();
+            result |= svf_spill.spill()->num_bytes() != 0 || svf_spill.has(200, 8);
+
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            TestResult test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(),
+                                                svf.num_bytes());
+            results.push_back(test_result);
+            count.add_result(test_result.result());
+            return count;
+        }
+
+        // Write 16Mb as 512 byte blocks then punt to 1Mb. Compare what has to be fetched again to read it all back,
+        // and the time to do so, with and without a spill file.
+        TestCount test_perf_spill_refetch_avoided(t_test_results &results) {
+            TestCount count;
+            const size_t block_size = 512;
+            const size_t num_blocks = 16 * 1024 * 1024 / block_size;
+            for (size_t spill_capacity: {static_cast<size_t>(0), static_cast<size_t>(32 * 1024 * 1024)}) {
+                tSparseVirtualFileConfig config;
+                config.spill_capacity = spill_capacity;
+                SparseVirtualFile svf("", 0.0, config);
+                for (t_fpos i = 0; i < num_blocks; ++i) {
+                    svf.write(i * 2 * block_size, test_data_bytes_512, block_size);
+                }
+                svf.lru_punt(1024 * 1024);
+
+                auto time_start = std::chrono::high_resolution_clock::now();
+                size_t refetch_count = 0;
+                size_t refetch_bytes = 0;
+                char buffer[block_size];
+                for (t_fpos i = 0; i < num_blocks; ++i) {
+                    t_fpos fpos = i * 2 * block_size;
+                    for (const auto &seek_read: svf.need(fpos, block_size)) {
+                        // Simulate the fetch from the origin.
+                        svf.write(seek_read.first, test_data_bytes_512, seek_read.second);
+                        ++refetch_count;
+                        refetch_bytes += seek_read.second;
+                    }
+                    svf.read(fpos, block_size, buffer);
+                }
+                std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+                int result = spill_capacity ? refetch_count != 0 : refetch_bytes < 15 * 1024 * 1024;
+
+                std::ostringstream os;
+                os << "16Mb of " << block_size << " byte blocks punted to 1Mb, spill_capacity " << spill_capacity;
+                os << " re-fetches " << refetch_count << " bytes " << refetch_bytes;
+                auto test_result = TestResult(__PRETTY_FUNCTION__, std::string(os.str()), result, "",
+                                              time_exec.count(), num_blocks * block_size);
+                count.add_result(test_result.result());
+                results.push_back(test_result);
+            }
+            return count;
+        }
+
+        // Write 1Mb of test_data_bytes_512 in uncoalesced blocks as test_perf_write_1M_uncoalesced() with and without a
+        // journal and report the journal overhead.
+        TestCount test_perf_write_1M_uncoalesced_journal(t_test_results &results) {
+            TestCount count;
+            const std::string path = (std::filesystem::temp_directory_path() / "svfsc_test_perf_journal.log").string();
+            for (size_t block_size = 1; block_size <= 256; block_size *= 4) {
+                double times[2] = {0.0, 0.0};
+                size_t num_bytes = 0;
+                for (int use_journal = 0; use_journal < 2; ++use_journal) {
+                    std::filesystem::remove(path);
+                    std::unique_ptr<Journal> journal;
+                    SparseVirtualFile svf("", 0.0);
+                    if (use_journal) {
+                        journal = std::make_unique<Journal>(path, SVFS_JOURNAL_SYNC_BYTES_DEFAULT);
+                        svf.set_journal(journal.get());
+                    }
+                    auto time_start = std::chrono::high_resolution_clock::now();
+                    for (t_fpos i = 0; i < (1024 * 1024 * 1) / block_size; ++i) {
+                        t_fpos fpos = i * block_size + i;
+                        svf.write(fpos, test_data_bytes_512, block_size);
+                    }
+                    if (journal) {
+                        journal->flush();
+                    }
+                    std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+                    times[use_journal] = time_exec.count();
+                    num_bytes = svf.num_bytes();
+                    svf.set_journal(nullptr);
+                }
+                std::ostringstream os;
+                os << "1Mb, " << std::setw(3) << block_size << " sized blocks, uncoalesced, journal overhead ";
+                os << std::fixed << std::setprecision(0) << 100.0 * (times[1] - times[0]) / times[0] << "%";
+                auto result = TestResult(__PRETTY_FUNCTION__, std::string(os.str()), 0, "", times[1], num_bytes);
+                count.add_result(result.result());
+                results.push_back(result);
+            }
+            std::filesystem::remove(path);
+            return count;
+        }
+
+        // append() of sorted, non touching, blocks matches write() and falls back to write() when out of order.
+        TestCount test_append(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            tSparseVirtualFileConfig config;
+            config.coverage_page_size = 16;
+            SparseVirtualFile svf_append("", 0.0, config);
+            SparseVirtualFile svf("", 0.0, config);
+
+            auto time_start = std::chrono::high_resolution_clock::now();
+            const t_seek_reads writes = {
+                    {8, 4}, {17, 3}, {24, 4}, {40, 8}, {64, 3}, {100, 10}, {128, 64}, {200, 8}
+            };
+            for (const auto &write: writes) {
+                svf_append.append(write.first, test_data_bytes_512 + write.first, write.second);
+                svf.write(write.first, test_data_bytes_512 + write.first, write.second);
+            }
+            result |= svf_append.blocks() != svf.blocks();
+            result |= svf_append.count_write() != svf.count_write() || svf_append.bytes_write() != svf.bytes_write();
+            for (t_fpos fpos = 0; fpos < 256; ++fpos) {
+                for (size_t len = 1; len < 48; ++len) {
+                    result |= svf_append.has(fpos, len) != svf.has(fpos, len);
+                    result |= svf_append.need(fpos, len) != svf.need(fpos, len);
+                }
+            }
+            // Out of order, overlapping and touching blocks are written and coalesced.
+            svf_append.append(0, test_data_bytes_512, 10);
+            svf_append.append(205, test_data_bytes_512 + 205, 10);
+            svf_append.append(215, test_data_bytes_512 + 215, 1);
+            result |= svf_append.blocks() != t_seek_reads(
+                    {{0, 12}, {17, 3}, {24, 4}, {40, 8}, {64, 3}, {100, 10}, {128, 64}, {200, 16}});
+
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            TestResult test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(),
+                                                svf_append.num_bytes());
+            results.push_back(test_result);
+            count.add_result(test_result.result());
+            return count;
+        }
+
+        // load_blocks() adopts the block values, matches write() and rejects blocks out of order, overlapping or
+        // touching without changing the SVF.
+        TestCount test_load_blocks(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            tSparseVirtualFileConfig config;
+            config.coverage_page_size = 16;
+            SparseVirtualFile svf("", 0.0, config);
+
+            auto time_start = std::chrono::high_resolution_clock::now();
+            const t_seek_reads writes = {
+                    {8, 4}, {17, 3}, {24, 4}, {40, 8}, {64, 3}, {100, 10}, {128, 64}, {200, 8}
+            };
+            t_block_values blocks;
+            std::vector<const char *> block_data;
+            for (const auto &write: writes) {
+                svf.write(write.first, test_data_bytes_512 + write.first, write.second);
+                BlockValue value;
+                value.append(test_data_bytes_512 + write.first, write.second);
+                blocks.emplace_back(write.first, std::move(value));
+                block_data.push_back(blocks.back().second.data());
+            }
+            SparseVirtualFile svf_load("", 0.0, std::move(blocks), config);
+            result |= !blocks.empty();
+            result |= svf_load.blocks() != svf.blocks() || svf_load.num_bytes() != svf.num_bytes();
+            result |= svf_load.count_write() != svf.count_write() || svf_load.bytes_write() != svf.bytes_write();
+            for (t_fpos fpos = 0; fpos < 256; ++fpos) {
+                for (size_t len = 1; len < 48; ++len) {
+                    result |= svf_load.has(fpos, len) != svf.has(fpos, len);
+                    result |= svf_load.need(fpos, len) != svf.need(fpos, len);
+                }
+            }
+            // Heap allocated block values are adopted, not copied.
+            size_t index = 0;
+            svf_load.visit_blocks([&](t_fpos, const char *data, size_t len) {
+                if (len > BlockValue::INLINE_CAPACITY) {
+                    result |= data != block_data[index];
+                }
+                ++index;
+            });
+            // Invalid blocks are rejected and nothing is loaded.
+            for (const t_seek_reads &invalid: {
+                    t_seek_reads({{208, 4}}),
+                    t_seek_reads({{300, 4}, {300, 4}}),
+                    t_seek_reads({{300, 4}, {304, 4}}),
+                    t_seek_reads({{300, 4}, {302, 4}}),
+                    t_seek_reads({{300, 4}, {250, 4}}),
+                    t_seek_reads({{300, 0}}),
+            }) {
+                t_block_values invalid_blocks;
+                for (const auto &block: invalid) {
+                    BlockValue value;
+                    value.append(test_data_bytes_512 + block.first, block.second);
+                    invalid_blocks.emplace_back(block.first, std::move(value));
+                }
+                try {
+                    svf_load.load_blocks(std::move(invalid_blocks));
+                    result |= 1;
+                } catch (const Exceptions::ExceptionSparseVirtualFileWrite &err) {}
+                result |= svf_load.blocks() != svf.blocks();
+            }
+            // Blocks beyond the end are added.
+            t_block_values more_blocks;
+            more_blocks.emplace_back(209, BlockValue());
+            more_blocks.back().second.append(test_data_bytes_512 + 209, 4);
+            svf_load.load_blocks(std::move(more_blocks));
+            svf.write(209, test_data_bytes_512 + 209, 4);
+            result |= svf_load.blocks() != svf.blocks();
+            char buffer[4];
+            svf_load.read(209, 4, buffer);
+            result |= std::memcmp(buffer, test_data_bytes_512 + 209, 4) != 0;
+
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            TestResult test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(),
+                                                svf_load.num_bytes());
+            results.push_back(test_result);
+            count.add_result(test_result.result());
+            return count;
+        }
+
+        // Restore 1M sorted, non-touching, 64 byte blocks with write(), append() and load_blocks().
+        TestCount test_perf_load_blocks_1M(t_test_results &results) {
+            TestCount count;
+            const size_t num_blocks = 1024 * 1024;
+            const size_t block_size = 64;
+            for (const std::string method: {"write()", "append()", "load_blocks()"}) {
+                SparseVirtualFile svf("", 0.0);
+                auto time_start = std::chrono::high_resolution_clock::now();
+                if (method == "write()") {
+                    for (t_fpos i = 0; i < num_blocks; ++i) {
+                        svf.write(i * block_size * 2, test_data_bytes_512, block_size);
+                    }
+                } else if (method == "append()") {
+                    for (t_fpos i = 0; i < num_blocks; ++i) {
+                        svf.append(i * block_size * 2, test_data_bytes_512, block_size);
+                    }
+                } else {
+                    // This includes the cost of creating the block values.
+                    t_block_values blocks;
+                    blocks.reserve(num_blocks);
+                    for (t_fpos i = 0; i < num_blocks; ++i) {
+                        blocks.emplace_back(i * block_size * 2, BlockValue());
+                        blocks.back().second.append(test_data_bytes_512, block_size);
+                    }
+                    svf.load_blocks(std::move(blocks));
+                }
+                std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+                int result = svf.num_blocks() != num_blocks || svf.num_bytes() != num_blocks * block_size;
+                std::ostringstream os;
+                os << "Restore 1M 64 byte blocks with " << method;
+                auto test_result = TestResult(__PRETTY_FUNCTION__, std::string(os.str()), result, "",
+                                              time_exec.count(), svf.num_bytes());
+                count.add_result(test_result.result());
+                results.push_back(test_result);
+            }
+            return count;
+        }
+
+        // read_view() returns a pointer to the data in the block, updates the read statistics and throws as read().
+        TestCount test_read_view(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            SparseVirtualFile svf("", 0.0);
+
+            auto time_start = std::chrono::high_resolution_clock::now();
+            svf.write(8, test_data_bytes_512 + 8, 4);
+            svf.write(64, test_data_bytes_512 + 64, 256);
+            const char *data = svf.read_view(64, 256);
+            result |= std::memcmp(data, test_data_bytes_512 + 64, 256) != 0;
+            result |= svf.read_view(100, 20) != data + 36;
+            result |= std::memcmp(svf.read_view(9, 2), test_data_bytes_512 + 9, 2) != 0;
+            result |= svf.count_read() != 3 || svf.bytes_read() != 278;
+            result |= svf.block_touches() != t_block_touches({{3, 64}, {4, 8}});
+            for (const t_seek_read &invalid: {t_seek_read(0, 4), t_seek_read(10, 4), t_seek_read(300, 64)}) {
+                try {
+                    data = svf.read_view(invalid.first, invalid.second);
+                    result |= 1;
+                } catch (const Exceptions::ExceptionSparseVirtualFileRead &err) {}
+            }
+            result |= svf.count_read() != 3;
+
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            TestResult test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(),
+                                                svf.num_bytes());
+            results.push_back(test_result);
+            count.add_result(test_result.result());
+            return count;
+        }
 
 #define INCLUDE_TESTS 1
 
@@ -2016,6 +2781,42 @@ namespace SVFS {
             count += test_erase_updates_counters(results);
             count += test_erase_updates_counters_not_punt(results);
             count += test_punt_updates_counters(results);
+#endif
+#if INCLUDE_TESTS
+            // Coverage bitmap.
+            count += test_coverage_matches_map(results);
+            count += test_coverage_matches_map_words(results);
+            count += test_perf_has_coverage_off(results);
+            count += test_perf_has_coverage_on(results);
+#endif
+#if INCLUDE_TESTS
+            // Dense regions.
+            count += test_dense_matches_map(results);
+            count += test_perf_write_1M_uncoalesced_dense_size_of(results);
+#endif
+#if INCLUDE_TESTS
+            count += test_block_value(results);
+#endif
+#if INCLUDE_TESTS
+            count += test_compact(results);
+            count += test_compact_incremental(results);
+#endif
+#if INCLUDE_TESTS
+            count += test_spill_file(results);
+            count += test_spill_store_shared(results);
+            count += test_spill_matches_map(results);
+            count += test_perf_spill_refetch_avoided(results);
+#endif
+#if INCLUDE_TESTS
+            count += test_perf_write_1M_uncoalesced_journal(results);
+#endif
+#if INCLUDE_TESTS
+            count += test_append(results);
+            count += test_load_blocks(results);
+            count += test_perf_load_blocks_1M(results);
+#endif
+#if INCLUDE_TESTS
+            count += test_read_view(results);
 #endif
             return count;
         }
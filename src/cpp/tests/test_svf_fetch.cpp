@@ -0,0 +1,297 @@
+/** @file
+ *
+ * Tests of the read-through cache and fetchers.
+ *
+ * Created on 2026-10-18.
+ *
+ * @verbatim
+    MIT License
+
+    Copyright (c) 2023-2025 Paul Ross
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+ @endverbatim
+ */
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#include "svf.h"
+#include "svf_fetch.h"
+#include "svfs.h"
+#include "test_svf_fetch.h"
+
+namespace SVFS {
+    namespace Test {
+
+        /// Write a local file of \c size bytes of \c test_data_bytes_512 repeated and return its path.
+        static std::string _write_test_file(const std::string &name, size_t size) {
+            const std::string path = (std::filesystem::temp_directory_path() / name).string();
+            std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+            for (size_t fpos = 0; fpos < size; fpos += 512) {
+                stream.write(test_data_bytes_512, static_cast<std::streamsize>(std::min<size_t>(512, size - fpos)));
+            }
+            return path;
+        }
+
+        // Reads fetch the aligned data that is missing, later reads of it do not fetch.
+        TestCount test_read_through_svf(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            auto time_start = std::chrono::high_resolution_clock::now();
+            const std::string path = _write_test_file("svfsc_test_read_through_svf.bin", 4096);
+            {
+                auto fetcher = std::make_shared<LocalFileFetcher>(path);
+                SparseVirtualFile svf(path, 0.0);
+                tReadThroughConfig config;
+                config.alignment = 256;
+                ReadThroughSparseVirtualFile read_through(
+                        svf, [fetcher](t_fpos fpos, size_t len, char *buffer) {
+                            return (*fetcher)(fpos, len, buffer);
+                        }, config);
+                char buffer[512];
+                result |= read_through.plan(100, 50) != t_seek_reads({{0, 256}});
+                read_through.read(100, 50, buffer);
+                result |= std::memcmp(buffer, test_data_bytes_512 + 100, 50) != 0;
+                result |= read_through.count_fetch() != 1 || read_through.bytes_fetch() != 256;
+                read_through.read(10, 20, buffer);
+                result |= read_through.count_fetch() != 1;
+                // Only the missing part of the aligned read is fetched.
+                read_through.read(200, 100, buffer);
+                result |= std::memcmp(buffer, test_data_bytes_512 + 200, 100) != 0;
+                result |= read_through.count_fetch() != 2 || read_through.bytes_fetch() != 512;
+                result |= svf.blocks() != t_seek_reads({{0, 512}});
+                read_through.read(4000, 96, buffer);
+                result |= std::memcmp(buffer, test_data_bytes_512 + 4000 % 512, 96) != 0;
+                // Beyond the end of the file.
+                try {
+                    read_through.read(4090, 10, buffer);
+                    result |= 1;
+                } catch (Exceptions::ExceptionSparseVirtualFileRead &err) {}
+                result |= svf.num_bytes() != 768;
+                try {
+                    LocalFileFetcher missing(path + ".missing");
+                    result |= 1;
+                } catch (Exceptions::ExceptionSparseVirtualFile &err) {}
+            }
+            std::filesystem::remove(path);
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(), 0);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        // The SVFS fetcher is given the ID and fetched data is subject to the budget.
+        TestCount test_read_through_svfs(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            auto time_start = std::chrono::high_resolution_clock::now();
+            const std::string path = _write_test_file("svfsc_test_read_through_svfs.bin", 4096);
+            {
+                LocalFileFetcher fetcher(path);
+                std::vector<std::string> ids;
+                SparseVirtualFileSystem svfs;
+                svfs.set_budget(512);
+                svfs.insert("A", 12.0);
+                svfs.insert("B", 12.0);
+                ReadThroughSparseVirtualFileSystem read_through(
+                        svfs, [&fetcher, &ids](const std::string &id, t_fpos fpos, size_t len, char *buffer) {
+                            ids.push_back(id);
+                            return fetcher(fpos, len, buffer);
+                        });
+                char buffer[256];
+                read_through.read("A", 0, 256, buffer);
+                read_through.read("B", 256, 256, buffer);
+                result |= std::memcmp(buffer, test_data_bytes_512 + 256, 256) != 0;
+                result |= ids != std::vector<std::string>({"A", "B"});
+                result |= read_through.count_fetch() != 2 || read_through.bytes_fetch() != 512;
+                // Over the budget the least recently used is evicted after the read.
+                read_through.read("A", 1024, 256, buffer);
+                result |= std::memcmp(buffer, test_data_bytes_512, 256) != 0;
+                result |= svfs.num_bytes() > 512 || !svfs.at("A").has(1024, 256);
+                try {
+                    read_through.read("C", 0, 256, buffer);
+                    result |= 1;
+                } catch (Exceptions::ExceptionSparseVirtualFileSystemOutOfRange &err) {}
+            }
+            std::filesystem::remove(path);
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(), 0);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        // Reserved ranges are excluded from need() and reserve_need() until they are released.
+        TestCount test_reserve_need(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            auto time_start = std::chrono::high_resolution_clock::now();
+            {
+                SparseVirtualFile svf("", 0.0);
+                svf.write(64, test_data_bytes_512, 64);
+                t_in_flight_futures in_flight;
+                t_seek_reads reserved = svf.reserve_need(0, 256, 0, in_flight);
+                result |= reserved != t_seek_reads({{0, 64}, {128, 128}});
+                result |= !in_flight.empty() || svf.num_in_flight() != 2;
+                result |= svf.need(0, 512) != t_seek_reads({{256, 256}});
+                t_seek_reads many = {{32, 8}, {300, 8}};
+                result |= svf.need_many(many) != t_seek_reads({{300, 8}});
+                // Another caller gets what is not in flight and the futures of what is.
+                t_in_flight_futures in_flight_other;
+                t_seek_reads reserved_other = svf.reserve_need(100, 200, 0, in_flight_other);
+                result |= reserved_other != t_seek_reads({{256, 44}});
+                result |= in_flight_other.size() != 1;
+                result |= in_flight_other[0].wait_for(std::chrono::seconds(0)) != std::future_status::timeout;
+                svf.write(128, test_data_bytes_512, 128);
+                svf.release_need(reserved);
+                result |= in_flight_other[0].wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+                // The range at 0 was released without being written so it is needed again.
+                result |= svf.need(0, 256) != t_seek_reads({{0, 64}});
+                svf.release_need(reserved_other);
+                svf.release_need(reserved_other);
+                result |= svf.num_in_flight() != 0;
+                // Destroying the SVF readies the futures of ranges still in flight.
+                in_flight.clear();
+                {
+                    SparseVirtualFile svf_destroyed("", 0.0);
+                    reserved = svf_destroyed.reserve_need(0, 8, 0, in_flight);
+                    t_in_flight_futures in_flight_destroyed;
+                    result |= !svf_destroyed.reserve_need(0, 8, 0, in_flight_destroyed).empty();
+                    in_flight = in_flight_destroyed;
+                }
+                result |= in_flight.size() != 1;
+                result |= in_flight[0].wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+            }
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(), 0);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        // Many threads missing on the same data at once fetch it once.
+        TestCount test_read_through_single_flight(t_test_results &results) {
+            TestCount count;
+            const int num_threads = 32;
+            const size_t file_size = 64 * 1024;
+            const std::string path = _write_test_file("svfsc_test_read_through_single_flight.bin", file_size);
+            int result = 0;
+            double time = 0.0;
+            {
+                LocalFileFetcher fetcher(path);
+                SparseVirtualFile svf(path, 0.0);
+                tReadThroughConfig config;
+                config.alignment = 4096;
+                // Simulate a remote fetch.
+                ReadThroughSparseVirtualFile read_through(
+                        svf, [&fetcher](t_fpos fpos, size_t len, char *buffer) {
+                            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                            return fetcher(fpos, len, buffer);
+                        }, config);
+                std::vector<std::thread> threads;
+                std::vector<int> thread_results(num_threads, 0);
+                auto time_start = std::chrono::high_resolution_clock::now();
+                for (int i = 0; i < num_threads; ++i) {
+                    threads.emplace_back([&read_through, &thread_results, i]() {
+                        char buffer[512];
+                        // All read the header and each also reads one page of its own, some pages are shared.
+                        read_through.read(0, 512, buffer);
+                        thread_results[i] |= std::memcmp(buffer, test_data_bytes_512, 512) != 0;
+                        read_through.read(4096 * (1 + i % 8), 512, buffer);
+                        thread_results[i] |= std::memcmp(buffer, test_data_bytes_512, 512) != 0;
+                    });
+                }
+                for (auto &thread: threads) {
+                    thread.join();
+                }
+                std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+                time = time_exec.count();
+                for (int thread_result: thread_results) {
+                    result |= thread_result;
+                }
+                result |= read_through.bytes_fetch() != 9 * 4096 || svf.num_in_flight() != 0;
+            }
+            std::filesystem::remove(path);
+            std::ostringstream os;
+            os << "Read through single flight [" << num_threads << "] threads";
+            auto test_result = TestResult(__PRETTY_FUNCTION__, os.str(), result, "", time, 9 * 4096);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        // Random small reads of a local file through the read-through cache.
+        TestCount test_perf_read_through(t_test_results &results) {
+            TestCount count;
+            const size_t file_size = 1024 * 1024;
+            const size_t num_reads = 100000;
+            const size_t alignment = 4096;
+            const std::string path = _write_test_file("svfsc_test_perf_read_through.bin", file_size);
+            int result = 0;
+            double time = 0.0;
+            {
+                LocalFileFetcher fetcher(path);
+                SparseVirtualFile svf(path, 0.0);
+                tReadThroughConfig config;
+                config.alignment = alignment;
+                ReadThroughSparseVirtualFile read_through(svf, std::ref(fetcher), config);
+                std::mt19937 generator(42);
+                std::uniform_int_distribution<t_fpos> distribution(0, file_size - 64);
+                char buffer[64];
+                auto time_start = std::chrono::high_resolution_clock::now();
+                for (size_t i = 0; i < num_reads; ++i) {
+                    t_fpos fpos = distribution(generator);
+                    read_through.read(fpos, 64, buffer);
+                    result |= std::memcmp(buffer, test_data_bytes_512 + fpos % 512, std::min<size_t>(64, 512 - fpos % 512)) != 0;
+                }
+                std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+                time = time_exec.count();
+                // Each aligned page is fetched once.
+                result |= read_through.bytes_fetch() != file_size || svf.num_blocks() != 1;
+            }
+            std::filesystem::remove(path);
+            std::ostringstream os;
+            os << "Read through " << num_reads << " reads of 64 bytes with alignment " << alignment;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, os.str(), result, "", time, num_reads * 64);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        TestCount test_svf_fetch_all(t_test_results &results) {
+            TestCount count;
+            count += test_read_through_svf(results);
+            count += test_read_through_svfs(results);
+            count += test_reserve_need(results);
+            count += test_read_through_single_flight(results);
+            count += test_perf_read_through(results);
+            return count;
+        }
+    } // namespace Test
+} // namespace SVFS
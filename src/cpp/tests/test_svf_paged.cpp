@@ -0,0 +1,344 @@
+/** @file
+ *
+ * Tests of the paged Sparse Virtual File.
+ *
+ * Created on 2026-10-18.
+ *
+ * @verbatim
+    MIT License
+
+    Copyright (c) 2023-2025 Paul Ross
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+ @endverbatim
+ */
+
+#include <cstring>
+#include <iomanip>
+
+#include "svf.h"
+#include "svf_paged.h"
+#include "test_svf_paged.h"
+
+namespace SVFS {
+    namespace Test {
+
+        /// Write pages 0, 1, 3 and a partial page 5 of size 16 and check has(), read() and need().
+        TestCount test_paged_write_read_has_need(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            tPagedSparseVirtualFileConfig config;
+            config.page_size = 64;
+            PagedSparseVirtualFile svf("", 0.0, config);
+
+            auto time_start = std::chrono::high_resolution_clock::now();
+            svf.write(0, test_data_bytes_512, 128);
+            svf.write(192, test_data_bytes_512 + 192, 64);
+            svf.write(320, test_data_bytes_512 + 320, 16);
+            result |= svf.num_blocks() != 4;
+            result |= svf.num_bytes() != 128 + 64 + 16;
+            result |= svf.last_file_position() != 336;
+            result |= svf.blocks() != t_seek_reads({{0, 64}, {64, 64}, {192, 64}, {320, 16}});
+            result |= !svf.has(0, 128);
+            result |= !svf.has(60, 8);
+            result |= svf.has(120, 16);
+            result |= !svf.has(320, 16);
+            result |= svf.has(320, 17);
+            char buffer[128];
+            svf.read(60, 8, buffer);
+            result |= std::memcmp(buffer, test_data_bytes_512 + 60, 8) != 0;
+            result |= svf.need(0, 128) != t_seek_reads();
+            result |= svf.need(100, 200) != t_seek_reads({{128, 64}, {256, 64}});
+            result |= svf.need(100, 240) != t_seek_reads({{128, 64}, {256, 128}});
+            // Greedy reads are whole pages.
+            result |= svf.need(100, 240, 100) != t_seek_reads({{128, 256}});
+            // Extend the partial page.
+            svf.write(336, test_data_bytes_512 + 336, 48);
+            result |= !svf.has(320, 64);
+            result |= svf.num_blocks() != 4;
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+
+            TestResult test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(),
+                                                svf.num_bytes());
+            results.push_back(test_result);
+            count.add_result(test_result.result());
+            return count;
+        }
+
+        /// A write that is not page aligned and does not extend a held page throws.
+        TestCount test_paged_write_unaligned_throws(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 1; // Failure unless the exception is caught.
+            tPagedSparseVirtualFileConfig config;
+            config.page_size = 64;
+            PagedSparseVirtualFile svf("", 0.0, config);
+            std::string message;
+
+            svf.write(0, test_data_bytes_512, 16);
+            try {
+                svf.write(32, test_data_bytes_512 + 32, 16);
+            } catch (Exceptions::ExceptionSparseVirtualFileWrite &err) {
+                message = err.message();
+                result = message != "PagedSparseVirtualFile::write(): File position 32 is neither at the start of a"
+                                    " page of size 64 nor within the data held by a page.";
+            }
+            TestResult test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, message, 0.0,
+                                                svf.num_bytes());
+            results.push_back(test_result);
+            count.add_result(test_result.result());
+            return count;
+        }
+
+        /// A write that differs from the held data throws and leaves the SVF unchanged.
+        TestCount test_paged_write_diff_throws(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 1; // Failure unless the exception is caught.
+            tPagedSparseVirtualFileConfig config;
+            config.page_size = 64;
+            PagedSparseVirtualFile svf("", 0.0, config);
+            std::string message;
+
+            svf.write(64, test_data_bytes_512 + 64, 64);
+            char data[128];
+            std::memcpy(data, test_data_bytes_512, 128);
+            data[80] = '?';
+            try {
+                svf.write(0, data, 128);
+            } catch (Exceptions::ExceptionSparseVirtualFileDiff &err) {
+                message = err.message();
+                result = message.find("PagedSparseVirtualFile::write(): Difference at position 80 '?' != '") != 0;
+            }
+            result |= svf.num_blocks() != 1;
+            result |= svf.num_bytes() != 64;
+            TestResult test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, message, 0.0,
+                                                svf.num_bytes());
+            results.push_back(test_result);
+            count.add_result(test_result.result());
+            return count;
+        }
+
+        /// Erase pages, erasing a file position that is not the start of a held page throws.
+        TestCount test_paged_erase(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            tPagedSparseVirtualFileConfig config;
+            config.page_size = 64;
+            PagedSparseVirtualFile svf("", 0.0, config);
+
+            svf.write(0, test_data_bytes_512, 200);
+            result |= svf.erase(64) != 64;
+            result |= svf.erase(192) != 8;
+            result |= svf.blocks() != t_seek_reads({{0, 64}, {128, 64}});
+            result |= svf.blocks_erased() != 2;
+            result |= svf.bytes_erased() != 72;
+            for (t_fpos fpos: {32, 64, 512}) {
+                try {
+                    svf.erase(fpos);
+                    result |= 1;
+                } catch (Exceptions::ExceptionSparseVirtualFileErase &err) {}
+            }
+            // Free pages are reused.
+            svf.write(256, test_data_bytes_512 + 256, 128);
+            result |= svf.num_blocks() != 4;
+            TestResult test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", 0.0, svf.num_bytes());
+            results.push_back(test_result);
+            count.add_result(test_result.result());
+            return count;
+        }
+
+        /// lru_punt() removes the least recently read or written pages.
+        TestCount test_paged_lru_punt(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            tPagedSparseVirtualFileConfig config;
+            config.page_size = 64;
+            PagedSparseVirtualFile svf("", 0.0, config);
+
+            // Pages written in the order 3, 1, 0, 2
+            for (t_fpos page: {3, 1, 0, 2}) {
+                svf.write(page * 64, test_data_bytes_512 + page * 64, 64);
+            }
+            // Reading page 3 makes it the most recently used.
+            char buffer[64];
+            svf.read(3 * 64, 64, buffer);
+            // Order is now 1, 0, 2, 3
+            result |= svf.lru_punt(128 + 1) != 128;
+            result |= svf.blocks() != t_seek_reads({{128, 64}, {192, 64}});
+            result |= svf.blocks_punted() != 2;
+            result |= svf.bytes_punted() != 128;
+            // At least one page is left.
+            result |= svf.lru_punt(0) != 64;
+            result |= svf.blocks() != t_seek_reads({{192, 64}});
+            TestResult test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", 0.0, svf.num_bytes());
+            results.push_back(test_result);
+            count.add_result(test_result.result());
+            return count;
+        }
+
+        /// lru_punt() and erase() release the page buffers beyond a small reserve so size_of() drops.
+        TestCount test_paged_lru_punt_size_of(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            tPagedSparseVirtualFileConfig config;
+            config.page_size = 64;
+            PagedSparseVirtualFile svf("", 0.0, config);
+
+            for (t_fpos page = 0; page < 8; ++page) {
+                svf.write(page * 64, test_data_bytes_512 + page * 64, 64);
+            }
+            size_t size_of = svf.size_of();
+            // Punts seven pages, four keep their buffer.
+            result |= svf.lru_punt(64 + 1) != 7 * 64;
+            result |= svf.size_of() != size_of - 3 * 64;
+            // Reuse the free pages, this allocates three buffers.
+            for (t_fpos page = 0; page < 7; ++page) {
+                svf.write(page * 64, test_data_bytes_512 + page * 64, 64);
+            }
+            result |= svf.size_of() != size_of;
+            // Erase five pages, four keep their buffer.
+            for (t_fpos page = 0; page < 5; ++page) {
+                svf.erase(page * 64);
+            }
+            result |= svf.size_of() != size_of - 64;
+            result |= svf.num_blocks() != 3;
+            TestResult test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", 0.0, svf.num_bytes());
+            results.push_back(test_result);
+            count.add_result(test_result.result());
+            return count;
+        }
+
+        /// The page size must be a non-zero power of two.
+        TestCount test_paged_ctor_throws(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            for (size_t page_size: {0, 3, 100}) {
+                tPagedSparseVirtualFileConfig config;
+                config.page_size = page_size;
+                try {
+                    PagedSparseVirtualFile svf("", 0.0, config);
+                    result |= 1;
+                } catch (Exceptions::ExceptionSparseVirtualFile &err) {}
+            }
+            TestResult test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", 0.0, 0);
+            results.push_back(test_result);
+            count.add_result(test_result.result());
+            return count;
+        }
+
+        /**
+         * Head to head comparison of a SparseVirtualFile with a PagedSparseVirtualFile.
+         * 4096 pages of 4096 bytes are written to every other page (so the SparseVirtualFile does not coalesce them)
+         * in a scattered order.
+         * Then 1M scattered has() and read() of 64 bytes are made.
+         *
+         * @param results The test results.
+         * @param svf Either SVF implementation.
+         * @param name Name of the implementation.
+         */
+        template<typename T>
+        static TestCount _test_perf_paged_head_to_head(t_test_results &results, T &svf, const std::string &name) {
+            TestCount count;
+            const size_t page_size = 4096;
+            const size_t num_pages = 4096;
+            std::vector<char> page(page_size);
+            for (size_t i = 0; i < page_size; ++i) {
+                page[i] = test_data_bytes_512[i % 512];
+            }
+            int result = 0;
+
+            auto time_start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < num_pages; ++i) {
+                // 1999 is prime and coprime with num_pages so this visits every page once.
+                size_t page_number = (i * 1999) % num_pages;
+                svf.write(page_number * 2 * page_size, page.data(), page_size);
+            }
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            result |= svf.num_blocks() != num_pages;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, name + " write 4096 pages of 4096 bytes", result, "",
+                                          time_exec.count(), svf.num_bytes());
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+
+            const size_t extent = num_pages * 2 * page_size;
+            const size_t num_ops = 1024 * 1024;
+            size_t hits = 0;
+            t_fpos fpos = 0;
+            time_start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < num_ops; ++i) {
+                fpos = (fpos + 7919 * 64) % extent;
+                hits += svf.has(fpos, 64);
+            }
+            time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            // Half the file is held.
+            result = hits < num_ops / 3 || hits > (2 * num_ops) / 3;
+            test_result = TestResult(__PRETTY_FUNCTION__, name + " 1M has() of 64 bytes", result, "",
+                                     time_exec.count(), num_ops);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+
+            char buffer[64];
+            size_t reads = 0;
+            time_start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < num_ops; ++i) {
+                // Reads from the held pages only.
+                fpos = ((i * 7919) % num_pages) * 2 * page_size + (i * 64) % (page_size - 64);
+                svf.read(fpos, 64, buffer);
+                reads += 64;
+            }
+            time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            test_result = TestResult(__PRETTY_FUNCTION__, name + " 1M read() of 64 bytes", 0, "",
+                                     time_exec.count(), reads);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        TestCount test_perf_paged_head_to_head_svf(t_test_results &results) {
+            SparseVirtualFile svf("", 0.0);
+            return _test_perf_paged_head_to_head(results, svf, "SparseVirtualFile");
+        }
+
+        TestCount test_perf_paged_head_to_head_paged(t_test_results &results) {
+            PagedSparseVirtualFile svf("", 0.0);
+            return _test_perf_paged_head_to_head(results, svf, "PagedSparseVirtualFile");
+        }
+
+        TestCount test_svf_paged_all(t_test_results &results) {
+            TestCount count;
+            count += test_paged_write_read_has_need(results);
+            count += test_paged_write_unaligned_throws(results);
+            count += test_paged_write_diff_throws(results);
+            count += test_paged_erase(results);
+            count += test_paged_lru_punt(results);
+            count += test_paged_lru_punt_size_of(results);
+            count += test_paged_ctor_throws(results);
+            count += test_perf_paged_head_to_head_svf(results);
+            count += test_perf_paged_head_to_head_paged(results);
+            return count;
+        }
+
+    } // namespace Test
+} // namespace SVFS
@@ -0,0 +1,359 @@
+/** @file
+ *
+ * Tests of the prefetcher.
+ *
+ * Created on 2026-10-18.
+ *
+ * @verbatim
+    MIT License
+
+    Copyright (c) 2023-2025 Paul Ross
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+ @endverbatim
+ */
+
+
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <sstream>
+#include <thread>
+
+#include "svf.h"
+#include "svf_fetch.h"
+#include "svf_prefetch.h"
+#include "svfs.h"
+#include "test_svf_prefetch.h"
+
+namespace SVFS {
+    namespace Test {
+
+        /// Write a local file of \c size bytes of \c test_data_bytes_512 repeated and return its path.
+        static std::string _write_test_file(const std::string &name, size_t size) {
+            const std::string path = (std::filesystem::temp_directory_path() / name).string();
+            std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+            for (size_t fpos = 0; fpos < size; fpos += 512) {
+                stream.write(test_data_bytes_512, static_cast<std::streamsize>(std::min<size_t>(512, size - fpos)));
+            }
+            return path;
+        }
+
+        /// A fetch function that reads a local file after a delay to simulate a remote file.
+        static t_fetch_function _latency_fetcher(const LocalFileFetcher &fetcher, std::chrono::microseconds latency) {
+            return [&fetcher, latency](t_fpos fpos, size_t len, char *buffer) {
+                std::this_thread::sleep_for(latency);
+                return fetcher(fpos, len, buffer);
+            };
+        }
+
+        // Hints are fetched in the background and the callbacks are given the outcome.
+        TestCount test_prefetch_svf(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            auto time_start = std::chrono::high_resolution_clock::now();
+            const std::string path = _write_test_file("svfsc_test_prefetch_svf.bin", 16 * 1024);
+            {
+                LocalFileFetcher fetcher(path);
+                SparseVirtualFile svf(path, 0.0);
+                tPrefetchConfig config;
+                config.read_through.alignment = 1024;
+                std::mutex mutex;
+                std::vector<tPrefetchResult> prefetch_results;
+                auto callback = [&mutex, &prefetch_results](const tPrefetchResult &prefetch_result) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    prefetch_results.push_back(prefetch_result);
+                };
+                {
+                    Prefetcher prefetcher(svf, std::ref(fetcher), config);
+                    t_prefetch_ticket ticket = prefetcher.prefetch(100, 100, 0, callback);
+                    result |= ticket == 0;
+                    result |= prefetcher.prefetch(8192, 2048, 0, callback) <= ticket;
+                    prefetcher.prefetch("other", 0, 8, 0, callback);
+                    prefetcher.wait();
+                    result |= svf.blocks() != t_seek_reads({{0, 1024}, {8192, 2048}});
+                    result |= prefetcher.count_done() != 2 || prefetcher.count_failed() != 1;
+                    result |= prefetcher.bytes_fetch() != 3072 || prefetcher.count_fetch() != 2;
+                    result |= prefetcher.num_queued() != 0 || prefetcher.num_in_flight() != 0;
+                    // Held data is not fetched again.
+                    prefetcher.prefetch(0, 512, 0, callback);
+                    prefetcher.wait();
+                    result |= prefetcher.bytes_fetch() != 3072 || prefetcher.count_done() != 3;
+                }
+                result |= prefetch_results.size() != 4;
+                size_t failed = 0;
+                for (const auto &prefetch_result: prefetch_results) {
+                    if (prefetch_result.status == tPrefetchResult::PREFETCH_FAILED) {
+                        result |= prefetch_result.id != "other" || prefetch_result.error.empty();
+                        ++failed;
+                    }
+                }
+                result |= failed != 1;
+                char buffer[100];
+                svf.read(100, 100, buffer);
+                result |= std::memcmp(buffer, test_data_bytes_512 + 100, 100) != 0;
+            }
+            std::filesystem::remove(path);
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(), 0);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        // Hints start in priority order, can be cancelled before they start and the destructor cancels the rest.
+        TestCount test_prefetch_priority_cancel(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            auto time_start = std::chrono::high_resolution_clock::now();
+            const std::string path = _write_test_file("svfsc_test_prefetch_priority_cancel.bin", 16 * 1024);
+            {
+                LocalFileFetcher fetcher(path);
+                SparseVirtualFile svf(path, 0.0);
+                std::promise<void> started;
+                std::promise<void> gate;
+                std::shared_future<void> gate_future = gate.get_future().share();
+                bool first = true;
+                // The first fetch blocks the only worker until the gate opens.
+                auto fetch = [&](t_fpos fpos, size_t len, char *buffer) {
+                    if (first) {
+                        first = false;
+                        started.set_value();
+                        gate_future.wait();
+                    }
+                    return fetcher(fpos, len, buffer);
+                };
+                std::vector<t_fpos> order;
+                std::vector<t_fpos> cancelled;
+                auto callback = [&order, &cancelled](const tPrefetchResult &prefetch_result) {
+                    if (prefetch_result.status == tPrefetchResult::PREFETCH_CANCELLED) {
+                        cancelled.push_back(prefetch_result.fpos);
+                    } else {
+                        order.push_back(prefetch_result.fpos);
+                    }
+                };
+                tPrefetchConfig config;
+                config.num_threads = 1;
+                {
+                    Prefetcher prefetcher(svf, fetch, config);
+                    prefetcher.prefetch(0, 64, 0, callback);
+                    started.get_future().wait();
+                    prefetcher.prefetch(1024, 64, 1, callback);
+                    t_prefetch_ticket ticket = prefetcher.prefetch(2048, 64, 5, callback);
+                    prefetcher.prefetch(3072, 64, 5, callback);
+                    prefetcher.prefetch(4096, 64, -1, callback);
+                    result |= prefetcher.num_queued() != 4 || prefetcher.num_in_flight() != 1;
+                    result |= prefetcher.bytes_in_flight() != 64;
+                    result |= !prefetcher.cancel(ticket);
+                    result |= prefetcher.cancel(ticket);
+                    gate.set_value();
+                    prefetcher.wait();
+                    result |= order != std::vector<t_fpos>({0, 3072, 1024, 4096});
+                    result |= cancelled != std::vector<t_fpos>({2048});
+                    // Hints that have not started when the prefetcher is destroyed are cancelled.
+                    std::promise<void> started_again;
+                    std::promise<void> gate_again;
+                    gate_future = gate_again.get_future().share();
+                    started = std::move(started_again);
+                    first = true;
+                    prefetcher.prefetch(8192, 64, 0, callback);
+                    started.get_future().wait();
+                    prefetcher.prefetch(9216, 64, 0, callback);
+                    prefetcher.prefetch(10240, 64, 0, callback);
+                    result |= prefetcher.cancel_all() != 2 || prefetcher.count_cancelled() != 3;
+                    prefetcher.prefetch(11264, 64, 0, callback);
+                    gate_again.set_value();
+                }
+                // The hint queued after cancel_all() either started or was cancelled by the destructor.
+                if (svf.has(11264, 64)) {
+                    result |= order != std::vector<t_fpos>({0, 3072, 1024, 4096, 8192, 11264});
+                    result |= cancelled != std::vector<t_fpos>({2048, 9216, 10240});
+                } else {
+                    result |= order != std::vector<t_fpos>({0, 3072, 1024, 4096, 8192});
+                    result |= cancelled != std::vector<t_fpos>({2048, 9216, 10240, 11264});
+                }
+            }
+            std::filesystem::remove(path);
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(), 0);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        // No more than max_bytes_in_flight bytes of hints are fetched at once.
+        TestCount test_prefetch_max_bytes_in_flight(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            auto time_start = std::chrono::high_resolution_clock::now();
+            const std::string path = _write_test_file("svfsc_test_prefetch_max_bytes.bin", 64 * 1024);
+            {
+                LocalFileFetcher fetcher(path);
+                SparseVirtualFile svf(path, 0.0);
+                std::atomic<size_t> fetching{0};
+                std::atomic<size_t> fetching_max{0};
+                auto fetch = [&](t_fpos fpos, size_t len, char *buffer) {
+                    size_t now = ++fetching;
+                    size_t previous = fetching_max.load();
+                    while (now > previous && !fetching_max.compare_exchange_weak(previous, now)) {}
+                    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                    --fetching;
+                    return fetcher(fpos, len, buffer);
+                };
+                tPrefetchConfig config;
+                config.num_threads = 8;
+                config.max_bytes_in_flight = 8192;
+                {
+                    Prefetcher prefetcher(svf, fetch, config);
+                    for (t_fpos fpos = 0; fpos < 64 * 1024; fpos += 4096) {
+                        prefetcher.prefetch(fpos, 4096);
+                    }
+                    prefetcher.wait();
+                    result |= prefetcher.count_done() != 16;
+                }
+                result |= fetching_max > 2 || fetching_max == 0;
+                result |= svf.num_bytes() != 64 * 1024;
+            }
+            std::filesystem::remove(path);
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(), 0);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        // Hints for a SVFS are given the SVF ID and fetched data is subject to the budget.
+        TestCount test_prefetch_svfs(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            auto time_start = std::chrono::high_resolution_clock::now();
+            const std::string path = _write_test_file("svfsc_test_prefetch_svfs.bin", 16 * 1024);
+            {
+                LocalFileFetcher fetcher(path);
+                SparseVirtualFileSystem svfs;
+                svfs.insert("A", 12.0);
+                svfs.insert("B", 12.0);
+                svfs.set_budget(8192);
+                std::mutex mutex;
+                std::vector<std::string> ids;
+                {
+                    Prefetcher prefetcher(
+                            svfs, [&](const std::string &id, t_fpos fpos, size_t len, char *buffer) {
+                                {
+                                    std::lock_guard<std::mutex> lock(mutex);
+                                    ids.push_back(id);
+                                }
+                                return fetcher(fpos, len, buffer);
+                            });
+                    prefetcher.prefetch("A", 0, 4096);
+                    prefetcher.prefetch("B", 4096, 4096);
+                    prefetcher.prefetch("C", 0, 4096);
+                    prefetcher.wait();
+                    result |= !svfs.at("A").has(0, 4096) || !svfs.at("B").has(4096, 4096);
+                    result |= prefetcher.count_done() != 2 || prefetcher.count_failed() != 1;
+                    prefetcher.prefetch("A", 8192, 8192);
+                    prefetcher.wait();
+                    result |= svfs.num_bytes() > 8192;
+                    try {
+                        prefetcher.prefetch(0, 8);
+                        result |= 1;
+                    } catch (Exceptions::ExceptionSparseVirtualFile &err) {}
+                }
+                std::sort(ids.begin(), ids.end());
+                result |= ids != std::vector<std::string>({"A", "A", "B"});
+            }
+            std::filesystem::remove(path);
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(), 0);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        /// Busy wait to simulate computation on the data just read.
+        static void _compute(std::chrono::microseconds duration) {
+            auto time_end = std::chrono::high_resolution_clock::now() + duration;
+            while (std::chrono::high_resolution_clock::now() < time_end) {}
+        }
+
+        // Read tiles of a file with a fetch latency, computing on each, with and without prefetching them first.
+        // With prefetching the fetching overlaps the computation.
+        TestCount test_perf_prefetch_overlap(bool prefetch, t_test_results &results) {
+            TestCount count;
+            const size_t num_tiles = 64;
+            const size_t tile_size = 4096;
+            const auto latency = std::chrono::microseconds(2000);
+            const auto compute = std::chrono::microseconds(2000);
+            const std::string path = _write_test_file("svfsc_test_perf_prefetch_overlap.bin", num_tiles * tile_size);
+            int result = 0;
+            double time = 0.0;
+            {
+                LocalFileFetcher fetcher(path);
+                SparseVirtualFile svf(path, 0.0);
+                t_fetch_function fetch = _latency_fetcher(fetcher, latency);
+                ReadThroughSparseVirtualFile read_through(svf, fetch);
+                tPrefetchConfig config;
+                config.num_threads = 4;
+                Prefetcher prefetcher(svf, fetch, config);
+                std::vector<char> buffer(tile_size);
+                auto time_start = std::chrono::high_resolution_clock::now();
+                if (prefetch) {
+                    for (size_t i = 0; i < num_tiles; ++i) {
+                        prefetcher.prefetch(i * tile_size, tile_size, -static_cast<int>(i));
+                    }
+                }
+                for (size_t i = 0; i < num_tiles; ++i) {
+                    // A tile being prefetched is waited for rather than fetched again.
+                    read_through.read(i * tile_size, tile_size, buffer.data());
+                    result |= std::memcmp(buffer.data(), test_data_bytes_512, 512) != 0;
+                    _compute(compute);
+                }
+                std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+                time = time_exec.count();
+                prefetcher.wait();
+                result |= read_through.bytes_fetch() + prefetcher.bytes_fetch() != num_tiles * tile_size;
+            }
+            std::filesystem::remove(path);
+            std::ostringstream os;
+            os << "Read " << num_tiles << " tiles with " << latency.count() << "us latency and " << compute.count();
+            os << "us compute, prefetch: " << prefetch;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, os.str(), result, "", time, num_tiles * tile_size);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        TestCount test_svf_prefetch_all(t_test_results &results) {
+            TestCount count;
+            count += test_prefetch_svf(results);
+            count += test_prefetch_priority_cancel(results);
+            count += test_prefetch_max_bytes_in_flight(results);
+            count += test_prefetch_svfs(results);
+            count += test_perf_prefetch_overlap(false, results);
+            count += test_perf_prefetch_overlap(true, results);
+            return count;
+        }
+    } // namespace Test
+} // namespace SVFS
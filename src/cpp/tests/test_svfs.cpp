@@ -31,9 +31,15 @@
 
 //#include <iostream>
 //#include <iomanip>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
 #include <sstream>
-//#include <thread>
+#include <thread>
 
+#include "svf_journal.h"
+#include "svf_spill.h"
 #include "svfs.h"
 #include "test_svfs.h"
 
@@ -108,9 +114,640 @@ namespace SVFS {
         }
 
 
+        TestCount test_svfs_compact(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            SparseVirtualFileSystem svfs;
+            for (const auto &id: {"A", "B", "C"}) {
+                svfs.insert(id, 12.0);
+                for (t_fpos fpos = 0; fpos < 64 * 1024; fpos += 1024) {
+                    // Appending grows the block beyond its size.
+                    svfs.at(id).write(fpos, test_data_bytes_512, 100);
+                    svfs.at(id).write(fpos + 100, test_data_bytes_512, 101);
+                }
+            }
+            auto time_start = std::chrono::high_resolution_clock::now();
+            size_t size_of = svfs.size_of();
+            size_t reclaimed = svfs.compact();
+            result |= reclaimed == 0;
+            result |= svfs.size_of() + reclaimed != size_of;
+            result |= svfs.compact() != 0;
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(), reclaimed);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        TestCount test_svfs_save_load(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            const std::string path = (std::filesystem::temp_directory_path() / "svfsc_test_save_load.svfs").string();
+            SparseVirtualFileSystem svfs;
+            const t_seek_reads writes = {{8, 4}, {17, 3}, {64, 3}, {100, 10}, {128, 384}};
+            for (const auto &id: {"A", "B", "C"}) {
+                svfs.insert(id, 12.0);
+                for (const auto &write: writes) {
+                    svfs.at(id).write(write.first, test_data_bytes_512 + write.first, write.second);
+                }
+            }
+            svfs.insert("Empty", 1.0);
+            auto time_start = std::chrono::high_resolution_clock::now();
+            svfs.save(path);
+            SparseVirtualFileSystem svfs_load;
+            svfs_load.load(path);
+            result |= svfs_load.size() != 4 || svfs_load.at("A").file_mod_time() != 12.0;
+            // Nothing is in memory until it is read.
+            result |= svfs_load.num_bytes() != 0;
+            for (const auto &id: {"A", "B", "C"}) {
+                const SparseVirtualFile &svf = svfs.at(id);
+                SparseVirtualFile &svf_load = svfs_load.at(id);
+                for (t_fpos fpos = 0; fpos < 512; fpos += 3) {
+                    for (size_t len = 1; len < 20; ++len) {
+                        result |= svf_load.has(fpos, len) != svf.has(fpos, len);
+                        result |= svf_load.need(fpos, len) != svf.need(fpos, len);
+                    }
+                }
+                char buffer[512];
+                for (const auto &write: writes) {
+                    svf_load.read(write.first, write.second, buffer);
+                    result |= std::memcmp(buffer, test_data_bytes_512 + write.first, write.second) != 0;
+                }
+                result |= svf_load.blocks() != svf.blocks() || svf_load.spill()->num_bytes() != 0;
+            }
+            // Saving a loaded SVFS to the same path includes the mapped blocks.
+            svfs_load.save(path);
+            SparseVirtualFileSystem svfs_reload;
+            svfs_reload.load(path);
+            result |= svfs_reload.at("A").spill()->num_bytes() != svfs.at("A").num_bytes();
+            // The IDs exist already.
+            try {
+                svfs_reload.load(path);
+                result |= 1;
+            } catch (Exceptions::ExceptionSparseVirtualFileSystemInsert &err) {}
+            // Not a saved file.
+            {
+                std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+                stream.write(test_data_bytes_512, 512);
+            }
+            try {
+                SparseVirtualFileSystem svfs_bad;
+                svfs_bad.load(path);
+                result |= 1;
+            } catch (Exceptions::ExceptionSparseVirtualFileSystemSaveLoad &err) {}
+            std::filesystem::remove(path);
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(),
+                                          svfs.num_bytes());
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        // Save 256Mb in 4096 byte blocks across 16 files then time the load and the first read of every block.
+        TestCount test_perf_svfs_save_load(t_test_results &results) {
+            TestCount count;
+            const std::string path = (std::filesystem::temp_directory_path() / "svfsc_test_perf_save_load.svfs").string();
+            const size_t block_size = 4096;
+            const size_t num_files = 16;
+            const size_t num_blocks = 256 * 1024 * 1024 / block_size / num_files;
+            std::vector<char> block(block_size);
+            for (size_t i = 0; i < block_size; ++i) {
+                block[i] = test_data_bytes_512[i % 512];
+            }
+            size_t num_bytes = 0;
+            {
+                SparseVirtualFileSystem svfs;
+                for (size_t f = 0; f < num_files; ++f) {
+                    std::string id = "File " + std::to_string(f);
+                    svfs.insert(id, 0.0);
+                    for (t_fpos i = 0; i < num_blocks; ++i) {
+                        svfs.at(id).write(i * 2 * block_size, block.data(), block_size);
+                    }
+                }
+                num_bytes = svfs.num_bytes();
+                auto time_start = std::chrono::high_resolution_clock::now();
+                svfs.save(path);
+                std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+                auto test_result = TestResult(__PRETTY_FUNCTION__, "Save 256Mb in 4096 byte blocks", 0, "",
+                                              time_exec.count(), num_bytes);
+                count.add_result(test_result.result());
+                results.push_back(test_result);
+            }
+            SparseVirtualFileSystem svfs;
+            auto time_start = std::chrono::high_resolution_clock::now();
+            svfs.load(path);
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            int result = svfs.size() != num_files || svfs.at("File 0").need(0, block_size).size() != 0;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, "Load 256Mb in 4096 byte blocks", result, "",
+                                          time_exec.count(), num_bytes);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            // The file can be removed once loaded.
+            std::filesystem::remove(path);
+
+            time_start = std::chrono::high_resolution_clock::now();
+            result = 0;
+            for (size_t f = 0; f < num_files; ++f) {
+                SparseVirtualFile &svf = svfs.at("File " + std::to_string(f));
+                for (t_fpos i = 0; i < num_blocks; ++i) {
+                    svf.read(i * 2 * block_size, block_size, block.data());
+                }
+                result |= svf.num_bytes() != num_blocks * block_size;
+            }
+            time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            test_result = TestResult(__PRETTY_FUNCTION__, "First read of loaded 256Mb in 4096 byte blocks", result, "",
+                                     time_exec.count(), num_bytes);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        // Compare every SVF in two SVFS.
+        static int _svfs_compare(const SparseVirtualFileSystem &svfs, const SparseVirtualFileSystem &svfs_expected) {
+            int result = svfs.size() != svfs_expected.size();
+            for (const auto &id: svfs_expected.keys()) {
+                result |= !svfs.has(id);
+                if (svfs.has(id)) {
+                    result |= svfs.at(id).blocks() != svfs_expected.at(id).blocks();
+                    result |= svfs.at(id).file_mod_time() != svfs_expected.at(id).file_mod_time();
+                }
+            }
+            return result;
+        }
+
+        TestCount test_svfs_journal(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            const std::string path = (std::filesystem::temp_directory_path() / "svfsc_test_journal.log").string();
+            const std::string path_snapshot = (std::filesystem::temp_directory_path() / "svfsc_test_journal.svfs").string();
+            std::filesystem::remove(path);
+            std::filesystem::remove(Journal::path_rotated(path));
+            auto time_start = std::chrono::high_resolution_clock::now();
+
+            SparseVirtualFileSystem svfs;
+            svfs.journal_open(path, 256);
+            for (const auto &id: {"A", "B", "C"}) {
+                svfs.insert(id, 12.0);
+                for (t_fpos fpos = 0; fpos < 4096; fpos += 128) {
+                    svfs.at(id).write(fpos, test_data_bytes_512, 100);
+                }
+            }
+            svfs.at("A").erase(128);
+            svfs.at("B").lru_punt(1024);
+            svfs.at("C").clear();
+            svfs.at("C").write(8, test_data_bytes_512, 8);
+            svfs.insert("D", 1.0);
+            svfs.remove("D");
+            svfs.journal_close();
+            result |= svfs.journal() != nullptr;
+            {
+                // Replay.
+                SparseVirtualFileSystem svfs_replay;
+                svfs_replay.journal_open(path, 256);
+                result |= _svfs_compare(svfs_replay, svfs);
+            }
+            // A torn record at the end is ignored and removed.
+            size_t file_size = std::filesystem::file_size(path);
+            {
+                std::ofstream stream(path, std::ios::binary | std::ios::app);
+                stream.write(test_data_bytes_512, 40);
+            }
+            {
+                SparseVirtualFileSystem svfs_replay;
+                svfs_replay.journal_open(path, 256);
+                result |= _svfs_compare(svfs_replay, svfs);
+                result |= std::filesystem::file_size(path) != file_size;
+                // Checkpoint then make more changes.
+                svfs_replay.checkpoint(path_snapshot);
+                result |= std::filesystem::file_size(path) != 0 || std::filesystem::exists(Journal::path_rotated(path));
+                svfs_replay.at("A").write(128, test_data_bytes_512, 100);
+                svfs_replay.insert("E", 2.0);
+                svfs_replay.at("E").write(0, test_data_bytes_512, 512);
+                svfs.at("A").write(128, test_data_bytes_512, 100);
+                svfs.insert("E", 2.0);
+                svfs.at("E").write(0, test_data_bytes_512, 512);
+            }
+            {
+                // Restart from the snapshot and the journal.
+                SparseVirtualFileSystem svfs_replay;
+                svfs_replay.load(path_snapshot);
+                svfs_replay.journal_open(path, 256);
+                for (const auto &id: svfs_replay.keys()) {
+                    for (const auto &block: svfs.at(id).blocks()) {
+                        char buffer[4096];
+                        svfs_replay.at(id).read(block.first, block.second, buffer);
+                    }
+                }
+                result |= _svfs_compare(svfs_replay, svfs);
+                try {
+                    svfs_replay.journal_open(path, 256);
+                    result |= 1;
+                } catch (const Exceptions::ExceptionSparseVirtualFileSystemJournal &err) {}
+            }
+            std::filesystem::remove(path);
+            std::filesystem::remove(path_snapshot);
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(),
+                                          svfs.num_bytes());
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        TestCount test_svfs_reserve(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            auto time_start = std::chrono::high_resolution_clock::now();
+            SparseVirtualFileSystem svfs(tSparseVirtualFileConfig(), 1000);
+            for (size_t i = 0; i < 1000; ++i) {
+                svfs.insert(std::to_string(i), 12.0);
+            }
+            result |= svfs.size() != 1000;
+            result |= svfs.keys().size() != 1000;
+            for (size_t i = 0; i < 1000; i += 2) {
+                svfs.remove(std::to_string(i));
+            }
+            result |= svfs.size() != 500;
+            result |= svfs.has("0");
+            result |= !svfs.has("1");
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(), svfs.size());
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        TestCount test_svfs_handle(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            auto time_start = std::chrono::high_resolution_clock::now();
+            SparseVirtualFileSystem svfs;
+            result |= svfs.handle("A") != nullptr;
+            t_svf_handle handle = svfs.get_or_insert("A", 12.0);
+            result |= handle == nullptr;
+            result |= svfs.get_or_insert("A", 14.0) != handle;
+            result |= svfs.handle("A") != handle;
+            result |= handle->file_mod_time() != 12.0;
+            handle->write(8, test_data_bytes_512, 4);
+            // The handle outlives removal.
+            svfs.remove("A");
+            result |= svfs.has("A");
+            result |= svfs.handle("A") != nullptr;
+            result |= handle->num_bytes() != 4;
+            // Many threads get or insert the same IDs.
+            std::vector<t_svf_handle> handles(8);
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i < handles.size(); ++i) {
+                threads.emplace_back([&svfs, &handles, i]() {
+                    for (size_t j = 0; j < 1000; ++j) {
+                        svfs.get_or_insert(std::to_string(j), 12.0);
+                    }
+                    handles[i] = svfs.get_or_insert("B", 12.0);
+                });
+            }
+            for (auto &thread: threads) {
+                thread.join();
+            }
+            result |= svfs.size() != 1001;
+            for (const auto &iter: handles) {
+                result |= iter != handles[0];
+            }
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(), svfs.size());
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        // The running totals must match the sum over every SVF however the SVFs change.
+        TestCount test_svfs_totals(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            auto time_start = std::chrono::high_resolution_clock::now();
+            tSparseVirtualFileConfig config;
+            config.dense_gap = 16;
+            // The overwrites below are of different data.
+            config.compare_for_diff = false;
+            SparseVirtualFileSystem svfs(config);
+            auto totals_match = [&svfs]() {
+                size_t num_bytes = 0;
+                size_t num_blocks = 0;
+                size_t size_of = sizeof(SparseVirtualFileSystem);
+                for (const auto &id: svfs.keys()) {
+                    num_bytes += svfs.at(id).num_bytes();
+                    num_blocks += svfs.at(id).num_blocks();
+                    size_of += svfs.at(id).size_of();
+                }
+                return svfs.num_bytes() == num_bytes && svfs.num_blocks() == num_blocks && svfs.size_of() == size_of;
+            };
+            result |= svfs.num_bytes() != 0 || svfs.num_blocks() != 0 || svfs.size_of() != sizeof(svfs);
+            for (const auto &id: {"A", "B", "C"}) {
+                svfs.insert(id, 12.0);
+                // Each SVF is a single dense region of 256 blocks.
+                for (t_fpos fpos = 0; fpos < 4096; fpos += 16) {
+                    svfs.at(id).write(fpos, test_data_bytes_512, 4 + (fpos / 16) % 4);
+                }
+            }
+            result |= !totals_match() || svfs.num_blocks() != 3 * 256;
+            // Fill in the gaps at the start of a dense region.
+            svfs.at("A").write(0, test_data_bytes_512, 512);
+            result |= !totals_match();
+            result |= svfs.at("B").erase(16) != 5;
+            result |= !totals_match();
+            svfs.at("B").lru_punt(1024);
+            result |= !totals_match();
+            svfs.compact();
+            result |= !totals_match();
+            svfs.at("C").clear();
+            result |= !totals_match();
+            // A handle that outlives removal no longer counts.
+            t_svf_handle handle = svfs.handle("A");
+            svfs.remove("A");
+            handle->write(8192, test_data_bytes_512, 8);
+            result |= !totals_match();
+            svfs.remove("B");
+            svfs.remove("C");
+            result |= svfs.num_bytes() != 0 || svfs.num_blocks() != 0 || svfs.size_of() != sizeof(svfs);
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(), 0);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        // Poll the totals of a SVFS with many SVFs and blocks as monitoring would.
+        TestCount test_perf_svfs_totals(t_test_results &results) {
+            TestCount count;
+            const size_t num_ids = 10000;
+            const size_t num_polls = 1000;
+            SparseVirtualFileSystem svfs(tSparseVirtualFileConfig(), num_ids);
+            for (size_t i = 0; i < num_ids; ++i) {
+                auto handle = svfs.get_or_insert(std::to_string(i), 12.0);
+                for (t_fpos fpos = 0; fpos < 100 * 16; fpos += 16) {
+                    handle->write(fpos, test_data_bytes_512, 8);
+                }
+            }
+            auto time_start = std::chrono::high_resolution_clock::now();
+            size_t total = 0;
+            for (size_t i = 0; i < num_polls; ++i) {
+                total += svfs.num_bytes() + svfs.num_blocks() + svfs.size_of();
+            }
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            int result = svfs.num_bytes() != num_ids * 100 * 8 || svfs.num_blocks() != num_ids * 100 || total == 0;
+            std::ostringstream os;
+            os << "Poll totals " << num_polls << " times over " << num_ids << " SVFs";
+            auto test_result = TestResult(__PRETTY_FUNCTION__, os.str(), result, "", time_exec.count(), num_polls);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        // Writes through the SVFS evict the least recently used blocks of any SVF to stay within the budget.
+        TestCount test_svfs_budget(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            auto time_start = std::chrono::high_resolution_clock::now();
+            SparseVirtualFileSystem svfs;
+            svfs.set_budget(1024);
+            result |= svfs.budget() != 1024 || svfs.evict_max_blocks() != 0;
+            svfs.insert("A", 12.0);
+            svfs.insert("B", 12.0);
+            for (const auto &id: {"A", "B"}) {
+                for (t_fpos fpos = 0; fpos < 8 * 256; fpos += 256) {
+                    svfs.write(id, fpos, test_data_bytes_512, 128);
+                }
+            }
+            // Every block of A is older than any block of B.
+            result |= svfs.num_bytes() != 1024 || svfs.at("A").num_blocks() != 0 || svfs.at("B").num_blocks() != 8;
+            // Reading a block makes it the most recently used.
+            char buffer[128];
+            svfs.at("B").read(0, 128, buffer);
+            // This evicts down to the low water mark.
+            result |= svfs.low_water() != 1008;
+            svfs.write("A", 0, test_data_bytes_512, 128);
+            result |= svfs.num_bytes() != 896 || !svfs.at("B").has(0, 128) || svfs.at("B").has(256, 128);
+            result |= svfs.at("B").has(512, 128) || svfs.at("B").blocks_punted() != 2;
+            // Bounded work, each write evicts at most one block.
+            svfs.set_budget(512, 1);
+            svfs.write("A", 4096, test_data_bytes_512, 128);
+            result |= svfs.num_bytes() != 896;
+            svfs.remove("A");
+            result |= svfs.evict() != 128 || svfs.num_bytes() != 512;
+            // Blocks of a removed SVF are skipped.
+            svfs.set_budget(1);
+            result |= svfs.evict() != 512 || svfs.num_bytes() != 0;
+            try {
+                svfs.write("A", 0, test_data_bytes_512, 128);
+                result |= 1;
+            } catch (Exceptions::ExceptionSparseVirtualFileSystemOutOfRange &err) {}
+            // No budget, no eviction.
+            svfs.set_budget(0);
+            svfs.write("B", 8192, test_data_bytes_512, 512);
+            result |= svfs.evict() != 0 || svfs.num_bytes() != 512;
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(), 0);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        // evict_over_budget() can skip the blocks of some SVFs and does not wait for another thread that is evicting.
+        TestCount test_svfs_evict_over_budget(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            auto time_start = std::chrono::high_resolution_clock::now();
+            SparseVirtualFileSystem svfs;
+            for (const auto &id: {"A", "B"}) {
+                svfs.insert(id, 12.0);
+                for (t_fpos fpos = 0; fpos < 4 * 256; fpos += 256) {
+                    svfs.write(id, fpos, test_data_bytes_512, 128);
+                }
+            }
+            result |= svfs.evict_over_budget() != 0;
+            svfs.set_budget(512);
+            // The blocks of A are the oldest but are skipped.
+            auto skip_a = [](const SparseVirtualFile &svf) { return svf.id() == "A"; };
+            result |= svfs.evict_over_budget(skip_a) != 512;
+            result |= svfs.at("A").num_blocks() != 4 || svfs.at("B").num_blocks() != 0;
+#ifdef SVFS_THREAD_SAFE
+            // Writing to the SVF directly does not evict.
+            svfs.at("B").write(0, test_data_bytes_512, 128);
+            std::promise<void> entered;
+            std::promise<void> proceed;
+            std::shared_future<void> proceed_future = proceed.get_future().share();
+            bool waited = false;
+            std::thread thread([&]() {
+                svfs.evict(0, 0, [&](const SparseVirtualFile &) {
+                    if (!waited) {
+                        waited = true;
+                        entered.set_value();
+                        proceed_future.wait();
+                    }
+                    return false;
+                });
+            });
+            entered.get_future().wait();
+            // The other thread is evicting so this returns at once.
+            result |= svfs.evict_over_budget() != 0 || svfs.num_bytes() != 640;
+            proceed.set_value();
+            thread.join();
+            result |= svfs.num_bytes() > 512;
+#endif
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(), 0);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        // Every SVF spills to one store that is not created until a block is punted.
+        TestCount test_svfs_spill_shared(t_test_results &results) {
+            TestCount count;
+            std::string test_name(__FUNCTION__);
+            int result = 0; // Success
+            auto time_start = std::chrono::high_resolution_clock::now();
+            tSparseVirtualFileConfig config;
+            config.spill_capacity = 512;
+            SparseVirtualFileSystem svfs(config);
+            // Far more SVFs than file descriptors are typically allowed.
+            for (size_t i = 0; i < 4096; ++i) {
+                svfs.insert(std::to_string(i), 12.0);
+            }
+            for (const auto &id: {"A", "B"}) {
+                svfs.insert(id, 12.0);
+                svfs.write(id, 0, test_data_bytes_512, 256);
+                svfs.write(id, 512, test_data_bytes_512, 256);
+                result |= svfs.at(id).spill() != nullptr;
+                result |= svfs.at(id).lru_punt(0) != 256;
+            }
+            result |= svfs.at("0").spill() != nullptr;
+            result |= &svfs.at("A").spill()->store() != &svfs.at("B").spill()->store();
+            result |= svfs.at("A").spill()->num_blocks() != 1 || svfs.at("B").spill()->num_blocks() != 1;
+            // The store is full so spilling another block of B evicts the block of A.
+            svfs.write("B", 1024, test_data_bytes_512, 256);
+            result |= svfs.at("B").lru_punt(0) != 256;
+            result |= svfs.at("A").spill()->num_blocks() != 0 || svfs.at("A").spill()->blocks_evicted() != 1;
+            result |= svfs.at("B").spill()->num_blocks() != 2 || !svfs.at("B").has(0, 256);
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, test_name, result, "", time_exec.count(), 0);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        // Write many more blocks than the budget holds across many SVFs.
+        TestCount test_perf_svfs_budget(t_test_results &results) {
+            TestCount count;
+            const size_t num_ids = 100;
+            const size_t num_writes = 100000;
+            const size_t budget = 1024 * 1024;
+            SparseVirtualFileSystem svfs(tSparseVirtualFileConfig(), num_ids);
+            svfs.set_budget(budget, 64);
+            for (size_t i = 0; i < num_ids; ++i) {
+                svfs.insert(std::to_string(i), 12.0);
+            }
+            auto time_start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < num_writes; ++i) {
+                svfs.write(std::to_string(i % num_ids), (i / num_ids) * 1024, test_data_bytes_512, 512);
+            }
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            // Only the most recent writes are held.
+            int result = svfs.num_bytes() > budget || svfs.num_bytes() < svfs.low_water() - 512;
+            result |= !svfs.at("0").has((num_writes / num_ids - 1) * 1024, 512) || svfs.at("0").has(0, 512);
+            std::ostringstream os;
+            os << "Write " << num_writes << " blocks to " << num_ids << " SVFs with a budget of " << budget;
+            auto test_result = TestResult(__PRETTY_FUNCTION__, os.str(), result, "", time_exec.count(), num_writes * 512);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        // Reader threads look up a fixed set of IDs while one thread inserts and removes other IDs.
+        TestCount _test_perf_svfs_lookup_churn(size_t num_threads, t_test_results &results) {
+            TestCount count;
+            const size_t num_ids = 1000;
+            const size_t num_lookups = 100000;
+            const size_t num_churn = 10000;
+            SparseVirtualFileSystem svfs(tSparseVirtualFileConfig(), num_ids + num_churn);
+            for (size_t i = 0; i < num_ids; ++i) {
+                svfs.insert("ID" + std::to_string(i), 12.0);
+                svfs.at("ID" + std::to_string(i)).write(0, test_data_bytes_512, 8);
+            }
+            std::vector<int> thread_results(num_threads, 0);
+            auto lookup = [&](size_t index) {
+                size_t num_bytes = 0;
+                for (size_t i = 0; i < num_lookups; ++i) {
+                    const std::string id = "ID" + std::to_string((i * 7 + index) % num_ids);
+                    if (svfs.has(id)) {
+                        num_bytes += svfs.at(id).num_bytes();
+                    }
+                }
+                thread_results[index] = num_bytes != num_lookups * 8;
+            };
+            auto churn = [&]() {
+                for (size_t i = 0; i < num_churn; ++i) {
+                    const std::string id = "Churn" + std::to_string(i);
+                    svfs.insert(id, 12.0);
+                    svfs.remove(id);
+                }
+            };
+            auto time_start = std::chrono::high_resolution_clock::now();
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i < num_threads; ++i) {
+                threads.emplace_back(lookup, i);
+            }
+            threads.emplace_back(churn);
+            for (auto &thread: threads) {
+                thread.join();
+            }
+            std::chrono::duration<double> time_exec = std::chrono::high_resolution_clock::now() - time_start;
+            int result = svfs.size() != num_ids;
+            for (int thread_result: thread_results) {
+                result |= thread_result;
+            }
+            std::ostringstream os;
+            os << "Lookup with churn [" << num_threads << "] threads " << num_lookups << " lookups each";
+            auto test_result = TestResult(__PRETTY_FUNCTION__, os.str(), result, "", time_exec.count(),
+                                          num_threads * num_lookups);
+            count.add_result(test_result.result());
+            results.push_back(test_result);
+            return count;
+        }
+
+        TestCount test_perf_svfs_lookup_churn(t_test_results &results) {
+            TestCount count;
+            count += _test_perf_svfs_lookup_churn(1, results);
+            count += _test_perf_svfs_lookup_churn(2, results);
+            count += _test_perf_svfs_lookup_churn(4, results);
+            count += _test_perf_svfs_lookup_churn(8, results);
+            return count;
+        }
+
         TestCount test_svfs_all(t_test_results &results) {
             TestCount count;
             count += test_perf_write_sim_index_svfs(results);
+            count += test_svfs_compact(results);
+            count += test_svfs_save_load(results);
+            count += test_perf_svfs_save_load(results);
+            count += test_svfs_journal(results);
+            count += test_svfs_reserve(results);
+            count += test_svfs_handle(results);
+            count += test_svfs_totals(results);
+            count += test_perf_svfs_totals(results);
+            count += test_svfs_budget(results);
+            count += test_svfs_evict_over_budget(results);
+            count += test_svfs_spill_shared(results);
+            count += test_perf_svfs_budget(results);
+            count += test_perf_svfs_lookup_churn(results);
             return count;
         }
     } // namespace Test
@@ -1,4 +1,5 @@
 # Auto-generated from svfsc version 0.4.1 by stubgen_simple.py at 2025-03-24 14:48:03.196773+00:00 UTC
+import array
 import typing
 import datetime
 
@@ -14,7 +15,9 @@ SVF_THREAD_SAFE: int
 class cSVF:
     def block_touch(self) -> int: ...
     def block_touches(self) -> typing.Dict[int, int]: ...
+    def block_touches_array(self) -> array.array: ...
     def blocks(self) -> typing.Tuple[typing.Tuple[int, int], ...]: ...
+    def blocks_array(self) -> array.array: ...
     def blocks_erased(self) -> int: ...
     def blocks_punted(self) -> int: ...
     def bytes_erased(self) -> int: ...
@@ -22,53 +25,88 @@ class cSVF:
     def bytes_read(self) -> int: ...
     def bytes_write(self) -> int: ...
     def clear(self) -> None: ...
-    def config(self) -> typing.Dict[str, bool]: ...
+    def compact(self, max_time: float = 0.0) -> int: ...
+    def config(self) -> typing.Dict[str, typing.Union[bool, int, str]]: ...
     def count_read(self) -> int: ...
     def count_write(self) -> int: ...
     def erase(self, file_position: int) -> None: ...
     def file_mod_time(self) -> float: ...
     def file_mod_time_matches(self, file_mod_time: float) -> bool: ...
     def has_data(self, file_position: int, length: int) -> bool: ...
+    def has_data_many(self, seek_reads: typing.Union[typing.Sequence[typing.Tuple[int, int]], memoryview]) -> bytes: ...
     def id(self) -> str: ...
     def last_file_position(self) -> int: ...
     def lru_punt(self, cache_size_upper_bound: int) -> int: ...
     def need(self, file_position: int, length: int, greedy_length: int = 0) -> typing.Tuple[typing.Tuple[int, int], ...]: ...
-    def need_many(self, seek_reads: typing.List[typing.Tuple[int, int]], greedy_length: int = 0) -> typing.Tuple[typing.Tuple[int, int], ...]: ...
+    def need_array(self, file_position: int, length: int, greedy_length: int = 0) -> array.array: ...
+    def need_many(self, seek_reads: typing.Union[typing.List[typing.Tuple[int, int]], array.array, memoryview], greedy_length: int = 0) -> typing.Tuple[typing.Tuple[int, int], ...]: ...
     def num_blocks(self) -> int: ...
     def num_bytes(self) -> int: ...
     def read(self, file_position: int, length: int) -> bytes: ...
+    def read_into(self, file_position: int, buffer: typing.Union[bytearray, memoryview]) -> int: ...
+    def read_many(self, seek_reads: typing.Union[typing.Sequence[typing.Tuple[int, int]], memoryview]) -> bytes: ...
+    def read_through(self, file_position: int, length: int, fetch: typing.Callable[[int, int], typing.Any], greedy_length: int = 0, alignment: int = 0) -> bytes: ...
+    def read_view(self, file_position: int, length: int) -> memoryview: ...
     def size_of(self) -> int: ...
     def time_read(self) -> typing.Optional[datetime.datetime]: ...
     def time_write(self) -> typing.Optional[datetime.datetime]: ...
-    def write(self, file_position: int, data: bytes) -> None: ...
+    def write(self, file_position: int, data: typing.Union[bytes, bytearray, memoryview]) -> None: ...
+    def write_many(self, seek_reads: typing.Union[typing.Sequence[typing.Tuple[int, int]], memoryview], data: typing.Union[bytes, bytearray, memoryview]) -> None: ...
 
 class cSVFS:
     def block_touches(self, id: str) -> typing.Dict[int, int]: ...
+    def block_touches_array(self, id: str) -> array.array: ...
     def blocks(self, id: str) -> typing.Tuple[typing.Tuple[int, int], ...]: ...
+    def blocks_array(self, id: str) -> array.array: ...
+    def budget(self) -> int: ...
     def bytes_read(self, id: str) -> int: ...
     def bytes_write(self, id: str) -> int: ...
-    def config(self) -> typing.Dict[str, bool]: ...
+    def checkpoint(self, path: str) -> None: ...
+    def compact(self, max_time: float = 0.0) -> int: ...
+    def config(self) -> typing.Dict[str, typing.Union[bool, int, str]]: ...
     def count_read(self, id: str) -> int: ...
     def count_write(self, id: str) -> int: ...
     def erase(self, id: str, file_position: int) -> None: ...
+    def evict(self, max_blocks: int = 0) -> int: ...
     def file_mod_time(self, id: str) -> float: ...
     def file_mod_time_matches(self, id: str) -> bool: ...
     def has(self, id: str) -> bool: ...
     def has_data(self, id: str, file_position: int, length: int) -> bool: ...
+    def has_data_many(self, id: str, seek_reads: typing.Union[typing.Sequence[typing.Tuple[int, int]], memoryview]) -> bytes: ...
     def insert(self, id: str) -> None: ...
+    def journal_close(self) -> None: ...
+    def journal_flush(self) -> None: ...
+    def journal_open(self, path: str, sync_bytes: int = 1048576) -> None: ...
     def keys(self) -> typing.List[str]: ...
+    def load(self, path: str) -> None: ...
     def lru_punt(self, id: str, cache_size_upper_bound: int) -> int: ...
     def lru_punt_all(self, cache_size_upper_bound: int) -> int: ...
     def need(self, id: str, file_position: int, length: int, greedy_length: int = 0) -> typing.Tuple[typing.Tuple[int, int], ...]: ...
-    def need_many(self, id: str, seek_reads: typing.List[typing.Tuple[int, int]], greedy_length: int = 0) -> typing.Tuple[typing.Tuple[int, int], ...]: ...
+    def need_array(self, id: str, file_position: int, length: int, greedy_length: int = 0) -> array.array: ...
+    def need_many(self, id: str, seek_reads: typing.Union[typing.List[typing.Tuple[int, int]], array.array, memoryview], greedy_length: int = 0) -> typing.Tuple[typing.Tuple[int, int], ...]: ...
     def num_blocks(self, id: str) -> int: ...
     def num_bytes(self, id: str) -> int: ...
+    def open(self, id: str) -> cSVFSHandle: ...
     def read(self, id: str, file_position: int, length: int) -> bytes: ...
+    def read_into(self, id: str, file_position: int, buffer: typing.Union[bytearray, memoryview]) -> int: ...
+    def read_many(self, id: str, seek_reads: typing.Union[typing.Sequence[typing.Tuple[int, int]], memoryview]) -> bytes: ...
+    def read_through(self, id: str, file_position: int, length: int, fetch: typing.Callable[[str, int, int], typing.Any], greedy_length: int = 0, alignment: int = 0) -> bytes: ...
+    def read_view(self, id: str, file_position: int, length: int) -> memoryview: ...
     def remove(self, id: str) -> None: ...
+    def save(self, path: str) -> None: ...
+    def set_budget(self, budget: int, evict_max_blocks: int = 0) -> None: ...
     def size_of(self, id: str) -> int: ...
     def time_read(self, id: str) -> typing.Optional[datetime.datetime]: ...
     def time_write(self, id: str) -> typing.Optional[datetime.datetime]: ...
     def total_blocks(self) -> int: ...
     def total_bytes(self) -> int: ...
     def total_size_of(self) -> int: ...
-    def write(self, id: str, file_position: int, data: bytes) -> None: ...
+    def write(self, id: str, file_position: int, data: typing.Union[bytes, bytearray, memoryview]) -> None: ...
+    def write_many(self, id: str, seek_reads: typing.Union[typing.Sequence[typing.Tuple[int, int]], memoryview], data: typing.Union[bytes, bytearray, memoryview]) -> None: ...
+
+class cSVFSHandle:
+    id: str
+    def has_data(self, file_position: int, length: int) -> bool: ...
+    def need(self, file_position: int, length: int, greedy_length: int = 0) -> typing.Tuple[typing.Tuple[int, int], ...]: ...
+    def read(self, file_position: int, length: int) -> bytes: ...
+    def write(self, file_position: int, data: typing.Union[bytes, bytearray, memoryview]) -> None: ...
@@ -21,6 +21,8 @@ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 """
+import array
+
 import pytest
 
 import svfsc
@@ -493,3 +495,163 @@ def test_svf_need_uncoal_greedy(size, block_size, need_size, greedy_length, benc
     assert svf.count_write() == block_count
     assert len(svf.blocks()) == block_count
     benchmark(_simulate_need_all, svf, 0, need_size, greedy_length)
+
+
+# Batch operations compared with a loop of single calls over many small fields.
+BATCH_COUNT = 10_000
+BATCH_FIELD_SIZE = 8
+
+
+def _batch_seek_reads():
+    """Un-coalesced fields with a one byte gap."""
+    return [(i * (BATCH_FIELD_SIZE + 1), BATCH_FIELD_SIZE) for i in range(BATCH_COUNT)]
+
+
+def _simulate_write_loop(seek_reads, data):
+    svf = svfsc.cSVF(ID)
+    for fpos, length in seek_reads:
+        svf.write(fpos, data[:length])
+    return svf
+
+
+def _simulate_write_many(seek_reads, data):
+    svf = svfsc.cSVF(ID)
+    svf.write_many(seek_reads, data * len(seek_reads))
+    return svf
+
+
+@pytest.mark.slow
+def test_svf_batch_write_loop(benchmark):
+    svf = benchmark(_simulate_write_loop, _batch_seek_reads(), b' ' * BATCH_FIELD_SIZE)
+    assert svf.num_blocks() == BATCH_COUNT
+
+
+@pytest.mark.slow
+def test_svf_batch_write_many(benchmark):
+    svf = benchmark(_simulate_write_many, _batch_seek_reads(), b' ' * BATCH_FIELD_SIZE)
+    assert svf.num_blocks() == BATCH_COUNT
+
+
+def _simulate_read_loop(svf, seek_reads):
+    return [svf.read(fpos, length) for fpos, length in seek_reads]
+
+
+def _simulate_read_many(svf, seek_reads):
+    return svf.read_many(seek_reads)
+
+
+@pytest.mark.slow
+def test_svf_batch_read_loop(benchmark):
+    seek_reads = _batch_seek_reads()
+    svf = _simulate_write_many(seek_reads, b' ' * BATCH_FIELD_SIZE)
+    result = benchmark(_simulate_read_loop, svf, seek_reads)
+    assert len(result) == BATCH_COUNT
+
+
+@pytest.mark.slow
+def test_svf_batch_read_many(benchmark):
+    seek_reads = _batch_seek_reads()
+    svf = _simulate_write_many(seek_reads, b' ' * BATCH_FIELD_SIZE)
+    result = benchmark(_simulate_read_many, svf, seek_reads)
+    assert len(result) == BATCH_COUNT * BATCH_FIELD_SIZE
+
+
+@pytest.mark.slow
+def test_svf_batch_read_many_array(benchmark):
+    seek_reads = _batch_seek_reads()
+    svf = _simulate_write_many(seek_reads, b' ' * BATCH_FIELD_SIZE)
+    seek_reads_array = array.array('Q', [v for seek_read in seek_reads for v in seek_read])
+    result = benchmark(_simulate_read_many, svf, seek_reads_array)
+    assert len(result) == BATCH_COUNT * BATCH_FIELD_SIZE
+
+
+def _simulate_has_data_loop(svf, seek_reads):
+    return [svf.has_data(fpos, length) for fpos, length in seek_reads]
+
+
+def _simulate_has_data_many(svf, seek_reads):
+    return svf.has_data_many(seek_reads)
+
+
+@pytest.mark.slow
+def test_svf_batch_has_data_loop(benchmark):
+    seek_reads = _batch_seek_reads()
+    svf = _simulate_write_many(seek_reads, b' ' * BATCH_FIELD_SIZE)
+    result = benchmark(_simulate_has_data_loop, svf, seek_reads)
+    assert all(result)
+
+
+@pytest.mark.slow
+def test_svf_batch_has_data_many(benchmark):
+    seek_reads = _batch_seek_reads()
+    svf = _simulate_write_many(seek_reads, b' ' * BATCH_FIELD_SIZE)
+    result = benchmark(_simulate_has_data_many, svf, seek_reads)
+    assert all(result)
+
+
+def _simulate_blocks(svf):
+    return svf.blocks()
+
+
+def _simulate_blocks_array(svf):
+    return svf.blocks_array()
+
+
+@pytest.mark.slow
+def test_svf_array_blocks(benchmark):
+    svf = _simulate_write_many(_batch_seek_reads(), b' ' * BATCH_FIELD_SIZE)
+    result = benchmark(_simulate_blocks, svf)
+    assert len(result) == BATCH_COUNT
+
+
+@pytest.mark.slow
+def test_svf_array_blocks_array(benchmark):
+    svf = _simulate_write_many(_batch_seek_reads(), b' ' * BATCH_FIELD_SIZE)
+    result = benchmark(_simulate_blocks_array, svf)
+    assert len(result) == 2 * BATCH_COUNT
+
+
+def _simulate_block_touches(svf):
+    return svf.block_touches()
+
+
+def _simulate_block_touches_array(svf):
+    return svf.block_touches_array()
+
+
+@pytest.mark.slow
+def test_svf_array_block_touches(benchmark):
+    svf = _simulate_write_many(_batch_seek_reads(), b' ' * BATCH_FIELD_SIZE)
+    result = benchmark(_simulate_block_touches, svf)
+    assert len(result) == BATCH_COUNT
+
+
+@pytest.mark.slow
+def test_svf_array_block_touches_array(benchmark):
+    svf = _simulate_write_many(_batch_seek_reads(), b' ' * BATCH_FIELD_SIZE)
+    result = benchmark(_simulate_block_touches_array, svf)
+    assert len(result) == 2 * BATCH_COUNT
+
+
+def _simulate_need(svf, length):
+    return svf.need(0, length)
+
+
+def _simulate_need_array(svf, length):
+    return svf.need_array(0, length)
+
+
+@pytest.mark.slow
+def test_svf_array_need(benchmark):
+    seek_reads = _batch_seek_reads()
+    svf = _simulate_write_many(seek_reads, b' ' * BATCH_FIELD_SIZE)
+    result = benchmark(_simulate_need, svf, seek_reads[-1][0] + BATCH_FIELD_SIZE)
+    assert len(result) == BATCH_COUNT - 1
+
+
+@pytest.mark.slow
+def test_svf_array_need_array(benchmark):
+    seek_reads = _batch_seek_reads()
+    svf = _simulate_write_many(seek_reads, b' ' * BATCH_FIELD_SIZE)
+    result = benchmark(_simulate_need_array, svf, seek_reads[-1][0] + BATCH_FIELD_SIZE)
+    assert len(result) == 2 * (BATCH_COUNT - 1)
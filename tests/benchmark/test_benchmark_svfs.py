@@ -194,3 +194,104 @@ def _sim_write_index(vr_count, lr_count):
 def test_svfs_sim_write_index(vr_count, lr_count, benchmark):
     result = benchmark(_sim_write_index, vr_count, lr_count)
     # assert result == vr_count * lr_count
+
+
+def _svfs_small_reads_by_id(file_system, count):
+    for i in range(count):
+        file_system.read(ID, (i % 128) * 8, 8)
+
+
+def _svfs_small_reads_by_handle(handle, count):
+    for i in range(count):
+        handle.read((i % 128) * 8, 8)
+
+
+@pytest.mark.slow
+@pytest.mark.parametrize('count', (1000, 10000,))
+def test_svfs_small_reads_by_id(count, benchmark):
+    file_system = svfsc.cSVFS()
+    file_system.insert(ID, 12.0)
+    file_system.write(ID, 0, b' ' * 1024)
+    benchmark(_svfs_small_reads_by_id, file_system, count)
+
+
+@pytest.mark.slow
+@pytest.mark.parametrize('count', (1000, 10000,))
+def test_svfs_small_reads_by_handle(count, benchmark):
+    file_system = svfsc.cSVFS()
+    file_system.insert(ID, 12.0)
+    file_system.write(ID, 0, b' ' * 1024)
+    benchmark(_svfs_small_reads_by_handle, file_system.open(ID), count)
+
+
+def _svfs_totals(file_system):
+    return file_system.total_bytes() + file_system.total_blocks() + file_system.total_size_of()
+
+
+@pytest.mark.slow
+@pytest.mark.parametrize('count', (1, 100, 10000,))
+def test_svfs_totals(count, benchmark):
+    file_system = svfsc.cSVFS()
+    for i in range(count):
+        id = f'{i}'
+        file_system.insert(id, 12.0)
+        for fpos in range(0, 1600, 16):
+            file_system.write(id, fpos, b' ' * 8)
+    result = benchmark(_svfs_totals, file_system)
+    assert result > count * 100 * 9
+
+
+def _svfs_write_with_budget(file_system, ids, data):
+    for i in range(10000):
+        file_system.write(ids[i % len(ids)], i * len(data), data)
+    return file_system.total_bytes()
+
+
+@pytest.mark.slow
+@pytest.mark.parametrize('budget, evict_max_blocks', ((0, 0), (1024 ** 2, 0), (1024 ** 2, 64),))
+def test_svfs_write_with_budget(budget, evict_max_blocks, benchmark):
+    file_system = svfsc.cSVFS(budget=budget, evict_max_blocks=evict_max_blocks, compare_for_diff=False)
+    ids = [f'{i}' for i in range(100)]
+    for id in ids:
+        file_system.insert(id, 12.0)
+    result = benchmark(_svfs_write_with_budget, file_system, ids, b' ' * 512)
+    if budget:
+        assert result <= budget
+
+
+def _svfs_read_manual(file_system, file, count, length):
+    ret = 0
+    for i in range(count):
+        fpos = (i * 7919 * length) % (1024 ** 2 - length)
+        for seek, read in file_system.need('file', fpos, length):
+            file.seek(seek)
+            file_system.write('file', seek, file.read(read))
+        ret += len(file_system.read('file', fpos, length))
+    return ret
+
+
+def _svfs_read_through(file_system, file, count, length):
+    def fetch(id, fpos, length):
+        file.seek(fpos)
+        return file.read(length)
+
+    ret = 0
+    for i in range(count):
+        fpos = (i * 7919 * length) % (1024 ** 2 - length)
+        ret += len(file_system.read_through('file', fpos, length, fetch))
+    return ret
+
+
+@pytest.mark.slow
+@pytest.mark.parametrize('function', (_svfs_read_manual, _svfs_read_through,))
+def test_svfs_read_through(function, tmp_path, benchmark):
+    path = tmp_path / 'file.bin'
+    path.write_bytes(bytes(range(256)) * 4096)
+    with open(path, 'rb') as file:
+        def setup():
+            file_system = svfsc.cSVFS(compare_for_diff=False)
+            file_system.insert('file', 12.0)
+            return (file_system, file, 10000, 64), {}
+
+        result = benchmark.pedantic(function, setup=setup, rounds=10)
+    assert result == 10000 * 64
@@ -0,0 +1,114 @@
+"""
+MIT License
+
+Copyright (c) 2020-2025 Paul Ross
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Multi-threaded throughput. The GIL is released around large copies so, with a SVF per thread, the total time for a
+fixed amount of work should fall as threads are added up to the number of cores.
+"""
+import threading
+
+import pytest
+
+import svfsc
+
+ID = 'abc'
+BLOCK_SIZE = 4 * 1024 * 1024
+# Total number of block copies shared between the threads.
+COPY_COUNT = 64
+
+
+def _run_threads(thread_count, target, args_per_thread):
+    threads = [threading.Thread(target=target, args=args) for args in args_per_thread[:thread_count]]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+
+def _read_into(svf: svfsc.cSVF, buffer: bytearray, count: int):
+    for _i in range(count):
+        svf.read_into(0, buffer)
+
+
+def _write(svf: svfsc.cSVF, data: bytes, count: int):
+    for _i in range(count):
+        svf.write(0, data)
+
+
+@pytest.mark.slow
+@pytest.mark.parametrize('thread_count', (1, 2, 4, 8,), ids=['01', '02', '04', '08', ])
+def test_svf_threads_read_into(thread_count, benchmark):
+    args_per_thread = []
+    for _i in range(thread_count):
+        svf = svfsc.cSVF(ID)
+        svf.write(0, b' ' * BLOCK_SIZE)
+        args_per_thread.append((svf, bytearray(BLOCK_SIZE), COPY_COUNT // thread_count))
+    benchmark(_run_threads, thread_count, _read_into, args_per_thread)
+
+
+@pytest.mark.slow
+@pytest.mark.parametrize('thread_count', (1, 2, 4, 8,), ids=['01', '02', '04', '08', ])
+def test_svf_threads_write(thread_count, benchmark):
+    """Writes over existing data so this is the memcmp() of compare_for_diff."""
+    args_per_thread = []
+    for _i in range(thread_count):
+        svf = svfsc.cSVF(ID)
+        svf.write(0, b' ' * BLOCK_SIZE)
+        args_per_thread.append((svf, b' ' * BLOCK_SIZE, COPY_COUNT // thread_count))
+    benchmark(_run_threads, thread_count, _write, args_per_thread)
+
+
+@pytest.mark.slow
+@pytest.mark.parametrize('thread_count', (1, 2, 4, 8,), ids=['01', '02', '04', '08', ])
+def test_svfs_threads_read_into(thread_count, benchmark):
+    """The threads share one SVFS with a SVF each, each SVF has its own lock."""
+    svfs = svfsc.cSVFS()
+    args_per_thread = []
+    for i in range(thread_count):
+        svfs.insert(f'{ID}{i}', 1.0)
+        svfs.write(f'{ID}{i}', 0, b' ' * BLOCK_SIZE)
+        args_per_thread.append((svfs, f'{ID}{i}', bytearray(BLOCK_SIZE), COPY_COUNT // thread_count))
+
+    def _svfs_read_into(svfs: svfsc.cSVFS, id: str, buffer: bytearray, count: int):
+        for _i in range(count):
+            svfs.read_into(id, 0, buffer)
+
+    benchmark(_run_threads, thread_count, _svfs_read_into, args_per_thread)
+
+
+@pytest.mark.slow
+@pytest.mark.parametrize('thread_count', (1, 2, 4, 8,), ids=['01', '02', '04', '08', ])
+def test_svfs_threads_write(thread_count, benchmark):
+    """The threads share one SVFS with a SVF each, writes over existing data so this is the memcmp() of
+    compare_for_diff."""
+    svfs = svfsc.cSVFS()
+    args_per_thread = []
+    for i in range(thread_count):
+        svfs.insert(f'{ID}{i}', 1.0)
+        svfs.write(f'{ID}{i}', 0, b' ' * BLOCK_SIZE)
+        args_per_thread.append((svfs, f'{ID}{i}', b' ' * BLOCK_SIZE, COPY_COUNT // thread_count))
+
+    def _svfs_write(svfs: svfsc.cSVFS, id: str, data: bytes, count: int):
+        for _i in range(count):
+            svfs.write(id, 0, data)
+
+    benchmark(_run_threads, thread_count, _svfs_write, args_per_thread)
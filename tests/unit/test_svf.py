@@ -21,6 +21,8 @@ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 """
+import array
+import mmap
 import pickle
 import pickletools
 import sys
@@ -182,6 +184,48 @@ def test_SVF_write_success(blocks, expected_blocks):
     assert s.blocks() == expected_blocks
 
 
+@pytest.mark.parametrize(
+    'data',
+    (
+            bytearray(b'ABCDEFGH'),
+            memoryview(b'__ABCDEFGH__')[2:-2],
+            array.array('B', b'ABCDEFGH'),
+    ),
+    ids=['bytearray', 'memoryview slice', 'array.array', ],
+)
+def test_SVF_write_buffer(data):
+    s = svfsc.cSVF('id', 1.0)
+    s.write(8, data)
+    assert s.blocks() == ((8, 8),)
+    assert s.read(8, 8) == b'ABCDEFGH'
+
+
+def test_SVF_write_buffer_mmap():
+    s = svfsc.cSVF('id', 1.0)
+    with mmap.mmap(-1, 8) as mm:
+        mm.write(b'ABCDEFGH')
+        s.write(8, mm)
+    assert s.read(8, 8) == b'ABCDEFGH'
+
+
+def test_SVF_write_buffer_empty():
+    s = svfsc.cSVF('id', 1.0)
+    s.write(8, bytearray())
+    assert s.blocks() == tuple()
+
+
+@pytest.mark.parametrize(
+    'data',
+    ('ABCDEFGH', 8, None, memoryview(b'ABCDEFGH')[::2], ),
+    ids=['str', 'int', 'None', 'non-contiguous memoryview', ],
+)
+def test_SVF_write_buffer_raises(data):
+    s = svfsc.cSVF('id', 1.0)
+    with pytest.raises((TypeError, BufferError)):
+        s.write(8, data)
+    assert s.blocks() == tuple()
+
+
 @pytest.mark.parametrize(
     'blocks, expected_blocks',
     INSERT_FPOS_BYTES_EXPECTED_BLOCKS,
@@ -237,6 +281,300 @@ def test_SVF_read(blocks, expected_blocks):
         assert s.read(file_position=fpos, length=length) is not None
 
 
+@pytest.mark.parametrize(
+    'blocks, expected_blocks',
+    INSERT_FPOS_BYTES_EXPECTED_BLOCKS,
+    ids=INSERT_FPOS_BYTES_EXPECTED_BLOCKS_IDS,
+)
+def test_SVF_read_view(blocks, expected_blocks):
+    s = svfsc.cSVF('id', 1.0)
+    for fpos, data in blocks:
+        s.write(fpos, data)
+    for fpos, length in expected_blocks:
+        view = s.read_view(file_position=fpos, length=length)
+        assert isinstance(view, memoryview)
+        assert view.readonly
+        assert view == s.read(fpos, length)
+        view.release()
+
+
+def test_SVF_read_view_pins():
+    s = svfsc.cSVF('id', 1.0)
+    s.write(8, b'ABCDEFGH')
+    view = s.read_view(10, 4)
+    assert view.tobytes() == b'CDEF'
+    assert s.count_read() == 1
+    # Objects made from the view also pin the SVF.
+    cast = view.cast('H')
+    view.release()
+    with pytest.raises(BufferError) as err:
+        s.write(16, b'IJ')
+    assert err.value.args[0] == 'cp_SparseVirtualFile_write(): Existing exports of data: the SVF can not be changed.'
+    with pytest.raises(BufferError):
+        s.erase(8)
+    with pytest.raises(BufferError):
+        s.clear()
+    with pytest.raises(BufferError):
+        s.lru_punt(0)
+    with pytest.raises(BufferError):
+        s.compact()
+    # Reads are allowed.
+    assert s.read(8, 8) == b'ABCDEFGH'
+    with s.read_view(8, 2) as other_view:
+        assert other_view == b'AB'
+    cast.release()
+    s.write(16, b'IJ')
+    assert s.blocks() == ((8, 10),)
+
+
+def test_SVF_read_view_raises():
+    s = svfsc.cSVF('id', 1.0)
+    s.write(8, b'ABCDEFGH')
+    with pytest.raises(IOError):
+        s.read_view(4, 8)
+    with pytest.raises(IOError):
+        s.read_view(12, 8)
+    # A failed read does not pin the SVF.
+    s.write(16, b'IJ')
+
+
+def test_SVF_read_into():
+    s = svfsc.cSVF('id', 1.0)
+    s.write(8, b'ABCDEFGH')
+    buffer = bytearray(4)
+    assert s.read_into(10, buffer) == 4
+    assert buffer == b'CDEF'
+    # A reused buffer and a slice of it.
+    assert s.read_into(file_position=8, buffer=memoryview(buffer)[1:3]) == 2
+    assert buffer == b'CABF'
+    assert s.read_into(8, bytearray()) == 0
+    data = array.array('B', bytes(8))
+    assert s.read_into(8, data) == 8
+    assert data.tobytes() == b'ABCDEFGH'
+    assert s.count_read() == 3
+
+
+@pytest.mark.parametrize(
+    'seek_reads',
+    (
+            [(8, 4), (16, 2), (24, 0), ],
+            ((8, 4), (16, 2), (24, 0), ),
+            array.array('Q', [8, 4, 16, 2, 24, 0]),
+            memoryview(array.array('Q', [8, 4, 16, 2, 24, 0])).cast('B').cast('Q'),
+    ),
+    ids=['list', 'tuple', 'array.array', 'memoryview', ],
+)
+def test_SVF_write_many_read_many(seek_reads):
+    s = svfsc.cSVF('id', 1.0)
+    s.write_many(seek_reads, b'ABCDEF')
+    assert s.blocks() == ((8, 4), (16, 2),)
+    assert s.count_write() == 2
+    assert s.read_many(seek_reads) == b'ABCDEF'
+    assert s.read_many(seek_reads=[]) == b''
+
+
+def test_SVF_has_data_many():
+    s = svfsc.cSVF('id', 1.0)
+    s.write_many([(8, 4), (16, 2), ], bytearray(b'ABCDEF'))
+    assert s.has_data_many([(8, 4), (9, 2), (10, 4), (16, 2), (0, 1), ]) == b'\x01\x01\x00\x01\x00'
+    assert s.has_data_many(array.array('Q', [8, 4, 10, 4])) == b'\x01\x00'
+    assert s.has_data_many([]) == b''
+
+
+@pytest.mark.parametrize(
+    'seek_reads, data, error',
+    (
+            ([(8, 4), ], b'ABC', ValueError),
+            ([(8, 4), ], b'ABCDE', ValueError),
+            ([8, 4], b'ABCD', TypeError),
+            ([(8, 4, 0), ], b'ABCD', TypeError),
+            (8, b'ABCD', TypeError),
+            (array.array('L' if array.array('L').itemsize == 4 else 'I', [8, 4]), b'ABCD', TypeError),
+            (array.array('Q', [8, 4, 16]), b'ABCD', ValueError),
+            (b'ABCDEFGHIJKLMNOP', b'ABCD', TypeError),
+            ([(8, 4), ], 'ABCD', TypeError),
+    ),
+    ids=['data short', 'data long', 'not tuples', 'tuple length', 'not a sequence', 'array 32 bit', 'array odd',
+         'bytes', 'str data', ],
+)
+def test_SVF_write_many_raises(seek_reads, data, error):
+    s = svfsc.cSVF('id', 1.0)
+    with pytest.raises(error):
+        s.write_many(seek_reads, data)
+    assert s.blocks() == tuple()
+
+
+def test_SVF_write_many_diff_raises():
+    s = svfsc.cSVF('id', 1.0)
+    s.write(16, b'XY')
+    with pytest.raises(IOError):
+        s.write_many([(8, 4), (16, 2), (24, 2), ], b'ABCDEFGH')
+    # The blocks before the error are written.
+    assert s.blocks() == ((8, 4), (16, 2),)
+
+
+def test_SVF_read_many_raises():
+    s = svfsc.cSVF('id', 1.0)
+    s.write(8, b'ABCD')
+    with pytest.raises(IOError):
+        s.read_many([(8, 4), (16, 2), ])
+    with pytest.raises(TypeError):
+        s.read_many([(8, 'a'), ])
+
+
+FILE_DATA = bytes(range(256)) * 16
+
+
+def _fetch_file_data(calls):
+    def fetch(file_position, length):
+        calls.append((file_position, length))
+        return FILE_DATA[file_position:file_position + length]
+
+    return fetch
+
+
+def test_SVF_read_through():
+    s = svfsc.cSVF('id', 1.0)
+    calls = []
+    fetch = _fetch_file_data(calls)
+    assert s.read_through(100, 50, fetch, alignment=256) == FILE_DATA[100:150]
+    assert calls == [(0, 256)]
+    assert s.read_through(10, 20, fetch, alignment=256) == FILE_DATA[10:30]
+    assert calls == [(0, 256)]
+    # Only what is missing is fetched.
+    assert s.read_through(200, 100, fetch, alignment=256) == FILE_DATA[200:300]
+    assert calls == [(0, 256), (256, 256)]
+    assert s.read_through(1024, 8, fetch, greedy_length=64) == FILE_DATA[1024:1032]
+    assert calls[-1] == (1024, 64)
+    assert s.blocks() == ((0, 512), (1024, 64))
+
+
+def test_SVF_read_through_end_of_file():
+    s = svfsc.cSVF('id', 1.0)
+    calls = []
+    fetch = _fetch_file_data(calls)
+    assert s.read_through(4000, 96, fetch, alignment=256) == FILE_DATA[4000:]
+    with pytest.raises(IOError):
+        s.read_through(4090, 10, fetch, alignment=256)
+    assert calls == [(3840, 256), (4096, 256)]
+
+
+def test_SVF_read_through_single_flight():
+    """Threads that miss on the same data at once fetch it once."""
+    s = svfsc.cSVF('id', 1.0)
+    calls = []
+    fetch_data = _fetch_file_data(calls)
+
+    def fetch(file_position, length):
+        time.sleep(0.05)
+        return fetch_data(file_position, length)
+
+    results = []
+
+    def read():
+        results.append(s.read_through(0, 512, fetch, alignment=256))
+
+    threads = [threading.Thread(target=read) for _i in range(16)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    assert results == [FILE_DATA[:512]] * 16
+    assert calls == [(0, 512)]
+
+
+def test_SVF_read_through_single_flight_fails():
+    """If the thread that is fetching fails a waiting thread fetches instead."""
+    s = svfsc.cSVF('id', 1.0)
+    calls = []
+    fetch_data = _fetch_file_data(calls)
+    fetching = threading.Event()
+
+    def fetch_fails(file_position, length):
+        fetching.set()
+        time.sleep(0.05)
+        raise IOError('Failed.')
+
+    def read_fails():
+        with pytest.raises(IOError):
+            s.read_through(0, 64, fetch_fails)
+
+    thread = threading.Thread(target=read_fails)
+    thread.start()
+    fetching.wait()
+    assert s.read_through(0, 64, fetch_data) == FILE_DATA[:64]
+    thread.join()
+    assert calls == [(0, 64)]
+
+
+def test_SVF_read_through_local_file(tmp_path):
+    path = tmp_path / 'file.bin'
+    path.write_bytes(FILE_DATA)
+    s = svfsc.cSVF(str(path), 1.0)
+    with open(path, 'rb') as file:
+        def fetch(file_position, length):
+            file.seek(file_position)
+            return file.read(length)
+
+        for file_position in range(0, len(FILE_DATA) - 64, 97):
+            assert s.read_through(file_position, 64, fetch, alignment=1024) == FILE_DATA[file_position:file_position + 64]
+    assert s.blocks() == ((0, len(FILE_DATA)),)
+
+
+@pytest.mark.parametrize(
+    'fetch, kwargs, error',
+    (
+            (None, {}, TypeError),
+            (lambda fpos, length: 1, {}, TypeError),
+            (lambda fpos, length: b' ' * (length + 1), {}, ValueError),
+            (lambda fpos, length: 1 / 0, {}, ZeroDivisionError),
+            (lambda fpos, length: b' ' * length, {'alignment': 3}, ValueError),
+            (lambda fpos, length: b' ' * length, {'greedy_length': -1}, ValueError),
+    )
+)
+def test_SVF_read_through_raises(fetch, kwargs, error):
+    s = svfsc.cSVF('id', 1.0)
+    with pytest.raises(error):
+        s.read_through(0, 8, fetch, **kwargs)
+    assert s.num_bytes() == 0
+
+
+def test_SVF_read_through_partial():
+    """Data already held is not fetched again."""
+    s = svfsc.cSVF('id', 1.0)
+    s.write(8, b'ABCD')
+    calls = []
+
+    def fetch(file_position, length):
+        calls.append((file_position, length))
+        return b' ' * length
+
+    assert s.read_through(0, 16, fetch) == b'        ABCD    '
+    assert calls == [(0, 8), (12, 4)]
+
+
+def test_SVF_write_many_pins():
+    s = svfsc.cSVF('id', 1.0)
+    s.write(8, b'ABCD')
+    with s.read_view(8, 4):
+        with pytest.raises(BufferError):
+            s.write_many([(16, 2), ], b'EF')
+    s.write_many([(16, 2), ], b'EF')
+
+
+def test_SVF_read_into_raises():
+    s = svfsc.cSVF('id', 1.0)
+    s.write(8, b'ABCDEFGH')
+    buffer = bytearray(b'        ')
+    with pytest.raises(IOError):
+        s.read_into(4, buffer)
+    with pytest.raises(IOError):
+        s.read_into(12, buffer)
+    with pytest.raises(TypeError):
+        s.read_into(8, b'        ')
+    assert buffer == b'        '
+
+
 @pytest.mark.parametrize(
     'blocks, expected_blocks',
     (
@@ -620,6 +958,58 @@ def test_SVF_need_many_raises(blocks_need, expected_error):
     assert err.value.args[0] == expected_error
 
 
+def test_SVF_blocks_array():
+    s = svfsc.cSVF('id', 1.0)
+    assert s.blocks_array() == array.array('Q')
+    s.write(8, b'ABCD')
+    s.write(20, b'XY')
+    result = s.blocks_array()
+    assert isinstance(result, array.array)
+    assert result.typecode == 'Q'
+    assert result.tolist() == [v for block in s.blocks() for v in block]
+
+
+def test_SVF_block_touches_array():
+    s = svfsc.cSVF('id', 1.0)
+    s.write(8, b'ABCD')
+    s.write(20, b'XY')
+    s.read(8, 2)
+    assert s.block_touches_array().tolist() == [v for touch in s.block_touches().items() for v in touch]
+
+
+@pytest.mark.parametrize(
+    'fpos, length, greedy_length',
+    (
+            (0, 30, 0),
+            (8, 4, 0),
+            (0, 30, 16),
+    ),
+)
+def test_SVF_need_array(fpos, length, greedy_length):
+    s = svfsc.cSVF('id', 1.0)
+    s.write(8, b'ABCD')
+    s.write(20, b'XY')
+    result = s.need_array(fpos, length, greedy_length=greedy_length)
+    assert result.tolist() == [v for need in s.need(fpos, length, greedy_length) for v in need]
+
+
+def test_SVF_need_many_array():
+    s = svfsc.cSVF('id', 1.0)
+    s.write(8, b'ABCD')
+    s.write(20, b'XY')
+    seek_reads = [(0, 12), (18, 8), ]
+    expected = s.need_many(seek_reads)
+    assert s.need_many(array.array('Q', [0, 12, 18, 8])) == expected
+    assert s.need_many(memoryview(array.array('Q', [0, 12, 18, 8]))) == expected
+    # The result of need_array() can be written and read with the batch methods.
+    need = s.need_array(0, 24)
+    s.write_many(need, b' ' * sum(need[1::2]))
+    assert s.need_array(0, 24) == array.array('Q')
+    assert s.blocks_array().tolist() == [0, 24]
+    with pytest.raises(TypeError):
+        s.need_many(array.array('i', [0, 12]))
+
+
 def test_SVF_need_write_special():
     """Special case with error found in RaPiVot tiff_dump.py when using a SVF:
 
@@ -744,6 +1134,87 @@ def test_SVF_pickle_dumps_size(block_count, block_size, expected_overhead):
     assert len(pickle_result) - data_count == expected_overhead
 
 
+@pytest.mark.parametrize(
+    'blocks, expected_blocks',
+    INSERT_FPOS_BYTES_EXPECTED_BLOCKS,
+    ids=INSERT_FPOS_BYTES_EXPECTED_BLOCKS_IDS,
+)
+def test_SVF_pickle_protocol_5_loads(blocks, expected_blocks):
+    s = svfsc.cSVF('id', 1.0)
+    for fpos, data in blocks:
+        s.write(fpos, data)
+    pickle_result = pickle.dumps(s, protocol=5)
+    new_s = pickle.loads(pickle_result)
+    assert new_s.blocks() == expected_blocks
+    for fpos, length in expected_blocks:
+        assert new_s.read(fpos, length) == s.read(fpos, length)
+    # In-band protocol 5 pickles are the same as protocol 4 apart from the protocol number.
+    assert pickle_result[2:] == pickle.dumps(s, protocol=4)[2:]
+
+
+def test_SVF_pickle_protocol_5_out_of_band():
+    s = svfsc.cSVF('id', 1.0)
+    s.write(1, b'ABC')
+    s.write(100, b'D' * 1024)
+    s.write(4096, b'E' * 4096)
+    buffers = []
+    pickle_result = pickle.dumps(s, protocol=5, buffer_callback=buffers.append)
+    assert len(buffers) == 3
+    assert len(pickle_result) < 256
+    assert [bytes(b.raw()) for b in buffers] == [b'ABC', b'D' * 1024, b'E' * 4096]
+    # The SVF can not be changed while the buffers exist.
+    with pytest.raises(BufferError) as err:
+        s.write(8, b' ')
+    assert err.value.args[0] == 'cp_SparseVirtualFile_write(): Existing exports of data: the SVF can not be changed.'
+    with pytest.raises(BufferError):
+        s.erase(1)
+    with pytest.raises(BufferError):
+        s.clear()
+    with pytest.raises(BufferError):
+        s.lru_punt(0)
+    with pytest.raises(BufferError):
+        s.compact()
+    assert s.read(1, 3) == b'ABC'
+    new_s = pickle.loads(pickle_result, buffers=buffers)
+    assert new_s.id() == 'id'
+    assert new_s.file_mod_time() == 1.0
+    assert new_s.blocks() == ((1, 3), (100, 1024), (4096, 4096))
+    assert new_s.read(4096, 4096) == b'E' * 4096
+    # The new SVF owns a copy of the data.
+    new_s.write(8, b' ')
+    del buffers
+    s.write(8, b' ')
+    assert s.blocks() == new_s.blocks()
+
+
+@pytest.mark.parametrize(
+    'blocks, expected_blocks, expected_count_write',
+    (
+            (((0, b'ABC'), (8, b'DEF')), ((0, 3), (8, 3)), 2),
+            # Not created by __getstate__() so these are written and coalesced.
+            (((8, b'DEF'), (0, b'ABC')), ((0, 3), (8, 3)), 2),
+            (((0, b'ABC'), (3, b'DEF')), ((0, 6),), 2),
+            (((0, b'ABC'), (1, b'BCD')), ((0, 4),), 2),
+            # As write() empty data is ignored.
+            (((0, b'ABC'), (8, b'')), ((0, 3),), 1),
+    ),
+    ids=[
+        'Sorted',
+        'Unsorted',
+        'Touching',
+        'Overlapping',
+        'Empty',
+    ],
+)
+def test_SVF_setstate_blocks(blocks, expected_blocks, expected_count_write):
+    s = svfsc.cSVF('id', 1.0)
+    state = s.__getstate__()
+    state['blocks'] = blocks
+    s.__setstate__(state)
+    assert s.blocks() == expected_blocks
+    assert s.count_write() == expected_count_write
+
+
 def write_to_svf(svf: svfsc.cSVF, values: typing.Tuple[typing.Tuple[int, int], ...], offset: int):
     for fpos, length in values:
         svf.write(fpos + offset, b' ' * length)
@@ -843,6 +1314,36 @@ def test_multi_threaded_write_un_coalesced(number_of_threads, expected_bytes):
     assert svf.num_bytes() == expected_bytes
 
 
+def test_multi_threaded_release_gil():
+    """Large writes and reads release the GIL so other threads use the SVF while one is in C++."""
+    svf = svfsc.cSVF("Some ID")
+    size = 1024 * 1024
+    errors = []
+
+    def write_read(index: int):
+        data = bytes([index]) * size
+        buffer = bytearray(size)
+        try:
+            for _i in range(8):
+                svf.write(index * 2 * size, data)
+                svf.read_into(index * 2 * size, buffer)
+                assert buffer == data
+                assert svf.read(index * 2 * size, size) == data
+                assert svf.has_data(index * 2 * size, size)
+                pickle.loads(pickle.dumps(svf))
+        except Exception as err:
+            errors.append(err)
+
+    threads = [threading.Thread(target=write_read, args=(i,)) for i in range(4)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    assert errors == []
+    assert svf.num_bytes() == 4 * size
+    assert svf.num_blocks() == 4
+
+
 @pytest.mark.parametrize(
     'number_of_writes',
     (
@@ -897,15 +1398,24 @@ def test_SVF_size_of_overhead(block_size, num_blocks):
 @pytest.mark.parametrize(
     'args, kwargs, expected',
     (
-            ([], {}, {'compare_for_diff': True, 'overwrite_on_exit': False},),
-            ([True, ], {}, {'compare_for_diff': True, 'overwrite_on_exit': True},),
-            ([False, ], {}, {'compare_for_diff': True, 'overwrite_on_exit': False},),
-            ([False, False, ], {}, {'compare_for_diff': False, 'overwrite_on_exit': False},),
-            ([True, False, ], {}, {'compare_for_diff': False, 'overwrite_on_exit': True},),
-            ([False, True, ], {}, {'compare_for_diff': True, 'overwrite_on_exit': False},),
-            ([True, True, ], {}, {'compare_for_diff': True, 'overwrite_on_exit': True},),
-            ([], {'compare_for_diff': False, 'overwrite_on_exit': True},
-             {'compare_for_diff': False, 'overwrite_on_exit': True},),
+            ([], {}, {'compare_for_diff': True, 'overwrite_on_exit': False, 'coverage_page_size': 0, 'dense_gap': 0,
+              'spill_capacity': 0, 'spill_directory': ''},),
+            ([True, ], {}, {'compare_for_diff': True, 'overwrite_on_exit': True, 'coverage_page_size': 0, 'dense_gap': 0,
+              'spill_capacity': 0, 'spill_directory': ''},),
+            ([False, ], {}, {'compare_for_diff': True, 'overwrite_on_exit': False, 'coverage_page_size': 0, 'dense_gap': 0,
+              'spill_capacity': 0, 'spill_directory': ''},),
+            ([False, False, ], {}, {'compare_for_diff': False, 'overwrite_on_exit': False, 'coverage_page_size': 0, 'dense_gap': 0,
+              'spill_capacity': 0, 'spill_directory': ''},),
+            ([True, False, ], {}, {'compare_for_diff': False, 'overwrite_on_exit': True, 'coverage_page_size': 0, 'dense_gap': 0,
+              'spill_capacity': 0, 'spill_directory': ''},),
+            ([False, True, ], {}, {'compare_for_diff': True, 'overwrite_on_exit': False, 'coverage_page_size': 0, 'dense_gap': 0,
+              'spill_capacity': 0, 'spill_directory': ''},),
+            ([True, True, ], {}, {'compare_for_diff': True, 'overwrite_on_exit': True, 'coverage_page_size': 0, 'dense_gap': 0,
+              'spill_capacity': 0, 'spill_directory': ''},),
+            ([], {'compare_for_diff': False, 'overwrite_on_exit': True, 'coverage_page_size': 0, 'dense_gap': 0,
+              'spill_capacity': 0, 'spill_directory': ''},
+             {'compare_for_diff': False, 'overwrite_on_exit': True, 'coverage_page_size': 0, 'dense_gap': 0,
+              'spill_capacity': 0, 'spill_directory': ''},),
     )
 )
 def test_SVF_ctor_config(args, kwargs, expected):
@@ -919,6 +1429,123 @@ def test_SVF_ctor_config(args, kwargs, expected):
     # assert 0
 
 
+@pytest.mark.parametrize('coverage_page_size', (-1, 3, 100,))
+def test_SVF_ctor_coverage_page_size_raises(coverage_page_size):
+    with pytest.raises(ValueError) as err:
+        svfsc.cSVF('id', 1.0, coverage_page_size=coverage_page_size)
+    assert err.value.args[0] == f'coverage_page_size {coverage_page_size} must be zero or a positive power of two'
+
+
+@pytest.mark.parametrize('coverage_page_size', (1, 4, 64,))
+def test_SVF_coverage_has_need_matches(coverage_page_size):
+    svf = svfsc.cSVF('id', 1.0, coverage_page_size=coverage_page_size)
+    svf_expected = svfsc.cSVF('id', 1.0)
+    assert svf.config()['coverage_page_size'] == coverage_page_size
+    for fpos, length in ((8, 4), (17, 25), (64, 3), (70, 30), (67, 3), (128, 64),):
+        svf.write(fpos, b' ' * length)
+        svf_expected.write(fpos, b' ' * length)
+    svf.erase(17)
+    svf_expected.erase(17)
+    for fpos in range(256):
+        for length in range(1, 32):
+            assert svf.has_data(fpos, length) == svf_expected.has_data(fpos, length)
+            assert svf.need(fpos, length) == svf_expected.need(fpos, length)
+
+
+def test_SVF_ctor_dense_gap_raises():
+    with pytest.raises(ValueError) as err:
+        svfsc.cSVF('id', 1.0, dense_gap=-1)
+    assert err.value.args[0] == 'dense_gap -1 must not be negative'
+
+
+@pytest.mark.parametrize('dense_gap', (1, 4, 64,))
+def test_SVF_dense_matches(dense_gap):
+    svf = svfsc.cSVF('id', 1.0, dense_gap=dense_gap)
+    svf_expected = svfsc.cSVF('id', 1.0)
+    assert svf.config()['dense_gap'] == dense_gap
+    data = bytes(range(256))
+    for fpos, length in ((8, 4), (17, 3), (24, 4), (12, 5), (64, 3), (70, 30), (67, 3), (128, 64),):
+        svf.write(fpos, data[fpos:fpos + length])
+        svf_expected.write(fpos, data[fpos:fpos + length])
+    svf.erase(8)
+    svf_expected.erase(8)
+    assert svf.blocks() == svf_expected.blocks()
+    assert svf.num_blocks() == svf_expected.num_blocks()
+    assert svf.num_bytes() == svf_expected.num_bytes()
+    for fpos, length in svf_expected.blocks():
+        assert svf.read(fpos, length) == svf_expected.read(fpos, length)
+    for fpos in range(256):
+        for length in range(1, 32):
+            assert svf.has_data(fpos, length) == svf_expected.has_data(fpos, length)
+            assert svf.need(fpos, length) == svf_expected.need(fpos, length)
+
+
+def test_SVF_ctor_spill_capacity_raises():
+    with pytest.raises(ValueError) as err:
+        svfsc.cSVF('id', 1.0, spill_capacity=-1)
+    assert err.value.args[0] == 'spill_capacity -1 must not be negative'
+
+
+def test_SVF_spill_matches():
+    svf = svfsc.cSVF('id', 1.0, spill_capacity=1024 * 1024)
+    svf_expected = svfsc.cSVF('id', 1.0)
+    assert svf.config()['spill_capacity'] == 1024 * 1024
+    data = bytes(range(256))
+    for fpos, length in ((8, 4), (17, 3), (24, 4), (40, 8), (64, 3), (100, 10), (128, 64), (200, 8),):
+        svf.write(fpos, data[fpos:fpos + length])
+        svf_expected.write(fpos, data[fpos:fpos + length])
+    # Punted blocks go to the spill file.
+    svf.lru_punt(10)
+    assert svf.num_blocks() == 1
+    for fpos in range(256):
+        for length in range(1, 32):
+            assert svf.has_data(fpos, length) == svf_expected.has_data(fpos, length)
+            assert svf.need(fpos, length) == svf_expected.need(fpos, length)
+    # Reading brings them back.
+    for fpos, length in svf_expected.blocks():
+        assert svf.read(fpos, length) == svf_expected.read(fpos, length)
+    assert svf.blocks() == svf_expected.blocks()
+
+
+def test_SVF_compact():
+    svf = svfsc.cSVF('id', 1.0)
+    data = bytes(range(256))
+    for fpos in range(0, 64 * 1024, 1024):
+        # Appending grows the block beyond its size.
+        svf.write(fpos, data[:100])
+        svf.write(fpos + 100, data[100:201])
+    size_of = svf.size_of()
+    reclaimed = svf.compact()
+    assert reclaimed > 0
+    assert svf.size_of() + reclaimed == size_of
+    assert svf.compact() == 0
+    for fpos in range(0, 64 * 1024, 1024):
+        assert svf.read(fpos, 201) == data[:201]
+
+
+def test_SVF_compact_incremental():
+    svf = svfsc.cSVF('id', 1.0)
+    data = bytes(range(256))
+    for fpos in range(0, 4096 * 1024, 1024):
+        svf.write(fpos, data[:100])
+        svf.write(fpos + 100, data[100:201])
+    size_of = svf.size_of()
+    reclaimed = 0
+    for _i in range(10000):
+        reclaimed_now = svf.compact(max_time=1e-9)
+        if reclaimed_now == 0:
+            break
+        reclaimed += reclaimed_now
+    assert svf.size_of() + reclaimed == size_of
+
+
+def test_SVF_compact_raises():
+    svf = svfsc.cSVF('id', 1.0)
+    with pytest.raises(ValueError) as err:
+        svf.compact(-1.0)
+    assert err.value.args[0] == 'max_time must not be negative'
+
+
 @pytest.mark.parametrize(
     'actions, expected_block_touch, expected_block_touches',
     (
@@ -21,7 +21,10 @@ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 """
+import array
+import struct
 import sys
+import threading
 import time
 
 import pytest
@@ -143,6 +146,33 @@ def test_SVFS_write(blocks, expected_blocks):
     assert s.blocks(ID) == expected_blocks
 
 
+@pytest.mark.parametrize(
+    'data',
+    (
+            bytearray(b'ABCDEFGH'),
+            memoryview(b'__ABCDEFGH__')[2:-2],
+            array.array('B', b'ABCDEFGH'),
+    ),
+    ids=['bytearray', 'memoryview slice', 'array.array', ],
+)
+def test_SVFS_write_buffer(data):
+    s = svfsc.cSVFS()
+    ID = 'abc'
+    s.insert(ID, 1.0)
+    s.write(ID, 8, data)
+    assert s.blocks(ID) == ((8, 8),)
+    assert s.read(ID, 8, 8) == b'ABCDEFGH'
+
+
+def test_SVFS_write_buffer_raises():
+    s = svfsc.cSVFS()
+    ID = 'abc'
+    s.insert(ID, 1.0)
+    with pytest.raises(TypeError):
+        s.write(ID, 8, 'ABCDEFGH')
+    assert s.blocks(ID) == tuple()
+
+
 @pytest.mark.parametrize(
     'blocks, need_fpos, need_length, expected_need',
     (
@@ -262,6 +292,116 @@ def test_SVFS_num_bytes():
     assert s.num_bytes(ID) == 4
 
 
+def test_SVFS_read_view():
+    s = svfsc.cSVFS()
+    s.insert('abc', 1.0)
+    s.insert('xyz', 1.0)
+    s.write('abc', 8, b'ABCDEFGH')
+    s.write('xyz', 0, b'    ')
+    view = s.read_view(id='abc', file_position=10, length=4)
+    assert isinstance(view, memoryview)
+    assert view.readonly
+    assert view == b'CDEF'
+    # That SVF can not be changed or removed.
+    with pytest.raises(BufferError) as err:
+        s.write('abc', 16, b'IJ')
+    assert err.value.args[0] == (
+        'cp_SparseVirtualFileSystem_svf_write(): Existing exports of data: the SVF can not be changed.'
+    )
+    with pytest.raises(BufferError):
+        s.erase('abc', 8)
+    with pytest.raises(BufferError):
+        s.remove('abc')
+    with pytest.raises(BufferError):
+        s.lru_punt('abc', 0)
+    with pytest.raises(BufferError):
+        s.lru_punt_all(0)
+    with pytest.raises(BufferError):
+        s.compact()
+    # Other SVFs can.
+    s.write('xyz', 4, b'    ')
+    s.erase('xyz', 0)
+    view.release()
+    s.write('abc', 16, b'IJ')
+    s.remove('abc')
+
+
+def test_SVFS_read_view_raises():
+    s = svfsc.cSVFS()
+    s.insert('abc', 1.0)
+    s.write('abc', 8, b'ABCDEFGH')
+    with pytest.raises(IndexError):
+        s.read_view('xyz', 8, 4)
+    with pytest.raises(IOError):
+        s.read_view('abc', 4, 8)
+    s.remove('abc')
+
+
+def test_SVFS_read_into():
+    s = svfsc.cSVFS()
+    s.insert('abc', 1.0)
+    s.write('abc', 8, b'ABCDEFGH')
+    buffer = bytearray(4)
+    assert s.read_into('abc', 10, buffer) == 4
+    assert buffer == b'CDEF'
+    assert s.read_into(id='abc', file_position=8, buffer=memoryview(buffer)[1:3]) == 2
+    assert buffer == b'CABF'
+
+
+def test_SVFS_write_many_read_many():
+    s = svfsc.cSVFS()
+    s.insert('abc', 1.0)
+    s.write_many('abc', [(8, 4), (16, 2), ], b'ABCDEF')
+    assert s.blocks('abc') == ((8, 4), (16, 2),)
+    assert s.read_many('abc', array.array('Q', [8, 4, 16, 2])) == b'ABCDEF'
+    assert s.read_many(id='abc', seek_reads=[(9, 2), ]) == b'BC'
+    assert s.has_data_many('abc', [(8, 4), (10, 4), ]) == b'\x01\x00'
+
+
+def test_SVFS_write_many_read_many_raises():
+    s = svfsc.cSVFS()
+    s.insert('abc', 1.0)
+    with pytest.raises(IndexError):
+        s.write_many('xyz', [(8, 4), ], b'ABCD')
+    with pytest.raises(ValueError):
+        s.write_many('abc', [(8, 4), ], b'ABC')
+    with pytest.raises(IndexError):
+        s.read_many('xyz', [(8, 4), ])
+    with pytest.raises(IOError):
+        s.read_many('abc', [(8, 4), ])
+    with pytest.raises(IndexError):
+        s.has_data_many('xyz', [(8, 4), ])
+
+
+def test_SVFS_arrays():
+    s = svfsc.cSVFS()
+    s.insert('abc', 1.0)
+    s.write('abc', 8, b'ABCD')
+    s.write('abc', 20, b'XY')
+    assert s.blocks_array('abc').tolist() == [8, 4, 20, 2]
+    assert s.block_touches_array('abc').tolist() == [0, 8, 1, 20]
+    assert s.need_array('abc', 0, 30).tolist() == [v for need in s.need('abc', 0, 30) for v in need]
+    assert s.need_many('abc', s.need_array('abc', 0, 30)) == s.need('abc', 0, 30)
+    for method in (s.blocks_array, s.block_touches_array):
+        with pytest.raises(IndexError):
+            method('xyz')
+    with pytest.raises(IndexError):
+        s.need_array('xyz', 0, 30)
+
+
+def test_SVFS_read_into_raises():
+    s = svfsc.cSVFS()
+    s.insert('abc', 1.0)
+    s.write('abc', 8, b'ABCDEFGH')
+    buffer = bytearray(4)
+    with pytest.raises(IndexError):
+        s.read_into('xyz', 8, buffer)
+    with pytest.raises(IOError):
+        s.read_into('abc', 4, buffer)
+    with pytest.raises(TypeError):
+        s.read_into('abc', 8, b'    ')
+
+
 def test_SVFS_erase():
     s = svfsc.cSVFS()
     ID = 'abc'
@@ -318,15 +458,24 @@ def test_SVFS_erase_raises():
 @pytest.mark.parametrize(
     'args, kwargs, expected',
     (
-            ([], {}, {'compare_for_diff': True, 'overwrite_on_exit': False},),
-            ([True, ], {}, {'compare_for_diff': True, 'overwrite_on_exit': True},),
-            ([False, ], {}, {'compare_for_diff': True, 'overwrite_on_exit': False},),
-            ([False, False, ], {}, {'compare_for_diff': False, 'overwrite_on_exit': False},),
-            ([True, False, ], {}, {'compare_for_diff': False, 'overwrite_on_exit': True},),
-            ([False, True, ], {}, {'compare_for_diff': True, 'overwrite_on_exit': False},),
-            ([True, True, ], {}, {'compare_for_diff': True, 'overwrite_on_exit': True},),
-            ([], {'compare_for_diff': False, 'overwrite_on_exit': True},
-             {'compare_for_diff': False, 'overwrite_on_exit': True},),
+            ([], {}, {'compare_for_diff': True, 'overwrite_on_exit': False, 'coverage_page_size': 0, 'dense_gap': 0,
+              'spill_capacity': 0, 'spill_directory': ''},),
+            ([True, ], {}, {'compare_for_diff': True, 'overwrite_on_exit': True, 'coverage_page_size': 0, 'dense_gap': 0,
+              'spill_capacity': 0, 'spill_directory': ''},),
+            ([False, ], {}, {'compare_for_diff': True, 'overwrite_on_exit': False, 'coverage_page_size': 0, 'dense_gap': 0,
+              'spill_capacity': 0, 'spill_directory': ''},),
+            ([False, False, ], {}, {'compare_for_diff': False, 'overwrite_on_exit': False, 'coverage_page_size': 0, 'dense_gap': 0,
+              'spill_capacity': 0, 'spill_directory': ''},),
+            ([True, False, ], {}, {'compare_for_diff': False, 'overwrite_on_exit': True, 'coverage_page_size': 0, 'dense_gap': 0,
+              'spill_capacity': 0, 'spill_directory': ''},),
+            ([False, True, ], {}, {'compare_for_diff': True, 'overwrite_on_exit': False, 'coverage_page_size': 0, 'dense_gap': 0,
+              'spill_capacity': 0, 'spill_directory': ''},),
+            ([True, True, ], {}, {'compare_for_diff': True, 'overwrite_on_exit': True, 'coverage_page_size': 0, 'dense_gap': 0,
+              'spill_capacity': 0, 'spill_directory': ''},),
+            ([], {'compare_for_diff': False, 'overwrite_on_exit': True, 'coverage_page_size': 0, 'dense_gap': 0,
+              'spill_capacity': 0, 'spill_directory': ''},
+             {'compare_for_diff': False, 'overwrite_on_exit': True, 'coverage_page_size': 0, 'dense_gap': 0,
+              'spill_capacity': 0, 'spill_directory': ''},),
     )
 )
 def test_SVFS_ctor_config(args, kwargs, expected):
@@ -365,6 +514,23 @@ def test_SVFS_lru_punt():
     assert svfs.num_blocks(ID) == 896 // block_size
 
 
+@pytest.mark.skipif(not sys.platform.startswith('linux'), reason='Counts file descriptors in /proc')
+def test_SVFS_spill_shared_file_descriptors():
+    """Every SVF spills to one file, created on the first punt, that holds no file descriptor."""
+    import os
+
+    svfs = svfsc.cSVFS(spill_capacity=1 << 20)
+    fd_count = len(os.listdir('/proc/self/fd'))
+    for i in range(2048):
+        ID = f'{i}'
+        svfs.insert(ID, 1.0)
+        svfs.write(ID, 0, b' ' * 128)
+        svfs.write(ID, 256, b' ' * 128)
+        assert svfs.lru_punt(ID, 0) == 128
+        assert svfs.has_data(ID, 0, 128)
+    assert len(os.listdir('/proc/self/fd')) <= fd_count + 1
+
+
 def test_SVFS_lru_punt_all():
     """Near duplicate of test_SVFS_lru_punt()."""
     # svf = svfsc.cSVF('id', 1.0)
@@ -390,6 +556,285 @@ def test_SVFS_lru_punt_all():
     assert svfs.num_blocks(ID) == 896 // block_size
 
 
+def test_SVFS_budget():
+    """Writes evict the least recently used blocks of any ID to stay within the budget."""
+    svfs = svfsc.cSVFS(budget=1024)
+    assert svfs.budget() == 1024
+    for ID in ('abc', 'xyz'):
+        svfs.insert(ID, 1.0)
+        for fpos in range(0, 8 * 256, 256):
+            svfs.write(ID, fpos, b' ' * 128)
+    # Every block of 'abc' is older than any block of 'xyz'.
+    assert svfs.total_bytes() == 1024
+    assert svfs.num_blocks('abc') == 0
+    assert svfs.num_blocks('xyz') == 8
+    # Reading a block makes it the most recently used.
+    svfs.read('xyz', 0, 128)
+    svfs.open('abc').write(0, b' ' * 128)
+    assert svfs.has_data('xyz', 0, 128)
+    assert not svfs.has_data('xyz', 256, 128)
+    # Evicting down to a little below the budget so the next writes need not evict.
+    assert svfs.total_bytes() == 896
+    svfs.write_many('abc', [(1024, 128), (2048, 128)], b' ' * 256)
+    assert svfs.total_bytes() == 896
+    assert svfs.blocks('abc') == ((0, 128), (1024, 128), (2048, 128))
+
+
+def test_SVFS_budget_evict_max_blocks():
+    svfs = svfsc.cSVFS()
+    svfs.insert('abc', 1.0)
+    for fpos in range(0, 8 * 256, 256):
+        svfs.write('abc', fpos, b' ' * 128)
+    assert svfs.budget() == 0
+    assert svfs.evict() == 0
+    svfs.set_budget(256, evict_max_blocks=1)
+    # Each write evicts at most one block.
+    svfs.write('abc', 4096, b' ' * 128)
+    assert svfs.total_bytes() == 1024
+    assert svfs.evict(max_blocks=2) == 256
+    assert svfs.evict() == 512
+    assert svfs.total_bytes() == 256
+    assert svfs.blocks('abc') == ((1792, 128), (4096, 128))
+
+
+def test_SVFS_budget_raises():
+    with pytest.raises(ValueError):
+        svfsc.cSVFS(budget=-1)
+    svfs = svfsc.cSVFS(budget=128)
+    svfs.insert('abc', 1.0)
+    svfs.write('abc', 0, b' ' * 128)
+    view = svfs.read_view('abc', 0, 128)
+    # Nothing is evicted by evict() while a block is exported.
+    svfs.set_budget(64)
+    with pytest.raises(BufferError):
+        svfs.evict()
+    view.release()
+    assert svfs.evict() == 128
+
+
+def test_SVFS_budget_exported():
+    """Writes over the budget evict the blocks of every ID other than those with exported blocks."""
+    svfs = svfsc.cSVFS(budget=512)
+    svfs.insert('abc', 1.0)
+    svfs.write('abc', 0, b'a' * 128)
+    view = svfs.read_view('abc', 0, 128)
+    svfs.insert('xyz', 1.0)
+    for fpos in range(0, 4 * 256, 256):
+        svfs.write('xyz', fpos, b' ' * 128)
+    # The block of 'abc' is the oldest but is exported so the oldest of 'xyz' are evicted instead.
+    assert svfs.total_bytes() == 384
+    assert svfs.blocks('abc') == ((0, 128),)
+    assert svfs.blocks('xyz') == ((512, 128), (768, 128))
+    assert view.tobytes() == b'a' * 128
+    view.release()
+    # Once released the block of 'abc' can be evicted.
+    for fpos in range(1024, 2048, 256):
+        svfs.write('xyz', fpos, b' ' * 128)
+    assert svfs.blocks('abc') == ()
+    assert svfs.total_bytes() <= 512
+
+
+def test_SVFS_read_through():
+    data = bytes(range(256)) * 16
+    calls = []
+
+    def fetch(id, file_position, length):
+        calls.append((id, file_position, length))
+        return data[file_position:file_position + length]
+
+    svfs = svfsc.cSVFS(budget=512)
+    svfs.insert('abc', 1.0)
+    svfs.insert('xyz', 1.0)
+    assert svfs.read_through('abc', 100, 50, fetch, alignment=256) == data[100:150]
+    assert svfs.read_through('xyz', 300, 8, fetch, alignment=256) == data[300:308]
+    assert svfs.read_through('abc', 0, 256, fetch) == data[:256]
+    assert calls == [('abc', 0, 256), ('xyz', 256, 256)]
+    # Over the budget the least recently used is evicted after the read.
+    assert svfs.read_through('abc', 1024, 256, fetch) == data[1024:1280]
+    assert svfs.total_bytes() <= 512
+    assert svfs.has_data('abc', 1024, 256)
+    with pytest.raises(IndexError):
+        svfs.read_through('other', 0, 8, fetch)
+    with pytest.raises(TypeError):
+        svfs.read_through('abc', 0, 8, None)
+
+
+def test_SVFS_read_through_single_flight():
+    """Threads that miss on the same data at once fetch it once."""
+    data = bytes(range(256)) * 16
+    calls = []
+
+    def fetch(id, file_position, length):
+        calls.append((id, file_position, length))
+        time.sleep(0.05)
+        return data[file_position:file_position + length]
+
+    svfs = svfsc.cSVFS()
+    svfs.insert('abc', 1.0)
+    results = []
+
+    def read():
+        results.append(svfs.read_through('abc', 0, 512, fetch, alignment=256))
+
+    threads = [threading.Thread(target=read) for _i in range(16)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    assert results == [data[:512]] * 16
+    assert calls == [('abc', 0, 512)]
+
+
+def test_SVFS_read_through_removed():
+    """The SVF is removed by the fetch function."""
+    svfs = svfsc.cSVFS()
+    svfs.insert('abc', 1.0)
+
+    def fetch(id, file_position, length):
+        svfs.remove(id)
+        return b' ' * length
+
+    with pytest.raises(IndexError):
+        svfs.read_through('abc', 0, 8, fetch)
+
+
+def test_SVFS_compact():
+    svfs = svfsc.cSVFS()
+    data = bytes(range(256))
+    for ID in ('abc', 'xyz'):
+        svfs.insert(ID, 1.0)
+        for fpos in range(0, 64 * 1024, 1024):
+            # Appending grows the block beyond its size.
+            svfs.write(ID, fpos, data[:100])
+            svfs.write(ID, fpos + 100, data[100:201])
+    total_size_of = svfs.total_size_of()
+    reclaimed = svfs.compact()
+    assert reclaimed > 0
+    assert svfs.total_size_of() + reclaimed == total_size_of
+    assert svfs.compact() == 0
+    assert svfs.read('xyz', 1024, 201) == data[:201]
+
+
+
+def test_SVFS_save_load(tmp_path):
+    path = str(tmp_path / 'cache.svfs')
+    svfs = svfsc.cSVFS()
+    data = bytes(range(256))
+    for ID in ('abc', 'xyz'):
+        svfs.insert(ID, 1.0)
+        for fpos, length in ((8, 4), (17, 3), (64, 3), (100, 10), (128, 128),):
+            svfs.write(ID, fpos, data[fpos:fpos + length])
+    svfs.save(path)
+    svfs_load = svfsc.cSVFS()
+    svfs_load.load(path)
+    assert sorted(svfs_load.keys()) == ['abc', 'xyz']
+    assert svfs_load.file_mod_time('abc') == 1.0
+    # Nothing is read until needed.
+    assert svfs_load.total_bytes() == 0
+    for ID in ('abc', 'xyz'):
+        for fpos in range(256):
+            for length in range(1, 16):
+                assert svfs_load.has_data(ID, fpos, length) == svfs.has_data(ID, fpos, length)
+                assert svfs_load.need(ID, fpos, length) == svfs.need(ID, fpos, length)
+        for fpos, length in svfs.blocks(ID):
+            assert svfs_load.read(ID, fpos, length) == svfs.read(ID, fpos, length)
+        assert svfs_load.blocks(ID) == svfs.blocks(ID)
+
+
+def test_SVFS_load_raises(tmp_path):
+    path = str(tmp_path / 'cache.svfs')
+    svfs = svfsc.cSVFS()
+    with pytest.raises(OSError) as err:
+        svfs.load(path)
+    assert err.value.args[0].startswith('SparseVirtualFileSystem::load(): can not open')
+    with open(path, 'wb') as file:
+        file.write(b' ' * 512)
+    with pytest.raises(OSError) as err:
+        svfs.load(path)
+    assert err.value.args[0].endswith('is not a saved file or is from a machine of different byte order.')
+    svfs.insert('abc', 1.0)
+    svfs.save(path)
+    with pytest.raises(RuntimeError) as err:
+        svfs.load(path)
+    assert err.value.args[0] == 'SparseVirtualFileSystem::load(): can not insert "abc"'
+
+
+@pytest.mark.parametrize(
+    'index_position, value',
+    (
+        # ID length that would wrap when padded.
+        (0, 2 ** 64 - 1),
+        # Block count that would wrap when multiplied by the size of a block entry to 24 bytes.
+        (24, 2 ** 61 + 1),
+    ),
+)
+def test_SVFS_load_corrupt_index(tmp_path, index_position, value):
+    path = str(tmp_path / 'cache.svfs')
+    svfs = svfsc.cSVFS()
+    svfs.insert('abc', 1.0)
+    svfs.write('abc', 0, b' ' * 64)
+    svfs.save(path)
+    with open(path, 'r+b') as file:
+        header = file.read(48)
+        index_offset = struct.unpack_from('=Q', header, 32)[0]
+        file.seek(index_offset + index_position)
+        file.write(struct.pack('=Q', value))
+    svfs = svfsc.cSVFS()
+    with pytest.raises(OSError) as err:
+        svfs.load(path)
+    assert err.value.args[0].endswith('has a corrupt index.')
+    assert svfs.keys() == []
+
+
+def test_SVFS_journal(tmp_path):
+    path = str(tmp_path / 'cache.journal')
+    path_snapshot = str(tmp_path / 'cache.svfs')
+    data = bytes(range(256))
+    svfs = svfsc.cSVFS()
+    svfs.journal_open(path)
+    for ID in ('abc', 'xyz'):
+        svfs.insert(ID, 1.0)
+        for fpos in range(0, 4096, 128):
+            svfs.write(ID, fpos, data[:100])
+    svfs.erase('abc', 128)
+    svfs.lru_punt('xyz', 1024)
+    svfs.journal_flush()
+    # Replay without closing, as if after a crash.
+    svfs_replay = svfsc.cSVFS()
+    svfs_replay.journal_open(path)
+    assert sorted(svfs_replay.keys()) == ['abc', 'xyz']
+    for ID in ('abc', 'xyz'):
+        assert svfs_replay.blocks(ID) == svfs.blocks(ID)
+    svfs_replay.journal_close()
+    # Checkpoint then restart from the snapshot and the journal.
+    svfs.checkpoint(path_snapshot)
+    svfs.write('abc', 128, data[:100])
+    svfs.journal_close()
+    svfs_replay = svfsc.cSVFS()
+    svfs_replay.load(path_snapshot)
+    svfs_replay.journal_open(path)
+    assert svfs_replay.has_data('abc', 128, 100)
+    for ID in ('abc', 'xyz'):
+        for fpos, length in svfs.blocks(ID):
+            assert svfs_replay.read(ID, fpos, length) == svfs.read(ID, fpos, length)
+        assert svfs_replay.blocks(ID) == svfs.blocks(ID)
+
+
+def test_SVFS_journal_raises(tmp_path):
+    path = str(tmp_path / 'cache.journal')
+    svfs = svfsc.cSVFS()
+    with pytest.raises(ValueError) as err:
+        svfs.journal_open(path, sync_bytes=-1)
+    assert err.value.args[0] == 'sync_bytes -1 must not be negative'
+    with pytest.raises(OSError) as err:
+        svfs.checkpoint(str(tmp_path / 'cache.svfs'))
+    assert err.value.args[0] == 'SparseVirtualFileSystem::checkpoint(): there is no journal.'
+    svfs.journal_open(path)
+    with pytest.raises(OSError) as err:
+        svfs.journal_open(path)
+    assert err.value.args[0] == f'SparseVirtualFileSystem::journal_open(): journal "{path}" is already open.'
+
+
 def main():
     # test_simulate_write_coalesced(1)
     # test_simulate_write_coalesced(2)
@@ -400,3 +845,218 @@ def main():
 
 if __name__ == '__main__':
     sys.exit(main())
+
+
+def test_SVFS_multi_threaded_per_file():
+    """Threads use their own SVF while others insert and remove SVFs and total the SVFS."""
+    svfs = svfsc.cSVFS()
+    size = 1024 * 1024
+    errors = []
+
+    def write_read(index: int):
+        id = f'abc{index}'
+        data = bytes([index]) * size
+        buffer = bytearray(size)
+        try:
+            svfs.insert(id, 1.0)
+            for _i in range(8):
+                svfs.write(id, 0, data)
+                svfs.read_into(id, 0, buffer)
+                assert buffer == data
+                assert svfs.read(id, 0, size) == data
+                assert svfs.has_data(id, 0, size)
+        except Exception as err:
+            errors.append(err)
+
+    def churn():
+        try:
+            for i in range(64):
+                svfs.insert(f'churn{i}', 1.0)
+                svfs.write(f'churn{i}', 0, b' ' * size)
+                svfs.total_bytes()
+                svfs.remove(f'churn{i}')
+        except Exception as err:
+            errors.append(err)
+
+    threads = [threading.Thread(target=write_read, args=(i,)) for i in range(4)]
+    threads.append(threading.Thread(target=churn))
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    assert errors == []
+    assert sorted(svfs.keys()) == [f'abc{i}' for i in range(4)]
+    assert svfs.total_bytes() == 4 * size
+    assert svfs.total_blocks() == 4
+
+
+def _change_while_waiting_for_file_lock(change) -> None:
+    """change(svfs, block) changes the SVF 'abc' after calling block().
+    block() starts a thread that holds the file lock with a long read then a thread that waits for the file lock to
+    make a view, so the change waits for the file lock after the view and must raise a BufferError."""
+    size = 64 * 1024 * 1024
+    svfs = svfsc.cSVFS()
+    svfs.insert('abc', 1.0)
+    svfs.write('abc', 0, b'A' * size)
+    buffer = bytearray(size)
+    holding = threading.Event()
+    views = []
+    times = {}
+
+    def hold_file_lock():
+        holding.set()
+        svfs.read_into('abc', 0, buffer)
+        times['held'] = time.perf_counter()
+
+    def make_view():
+        views.append(svfs.read_view('abc', 0, 4096))
+
+    threads = [threading.Thread(target=hold_file_lock), threading.Thread(target=make_view)]
+
+    def block():
+        threads[0].start()
+        holding.wait()
+        time.sleep(0.001)
+        threads[1].start()
+        time.sleep(0.001)
+        times['blocked'] = time.perf_counter()
+
+    try:
+        change(svfs, block)
+    except BufferError:
+        for thread in threads:
+            thread.join()
+        assert views[0] == b'A' * 4096
+        views[0].release()
+    else:
+        for thread in threads:
+            thread.join()
+        # Only if the read was too quick for the change to wait behind the view.
+        assert times['blocked'] > times['held']
+
+
+def _change_write(svfs, block):
+    block()
+    svfs.write('abc', 64 * 1024 * 1024, b'B' * 1024)
+
+
+def _change_write_many(svfs, block):
+    block()
+    svfs.write_many('abc', ((64 * 1024 * 1024, 1024),), b'B' * 1024)
+
+
+def _change_erase(svfs, block):
+    block()
+    svfs.erase('abc', 0)
+
+
+def _change_lru_punt(svfs, block):
+    block()
+    svfs.lru_punt('abc', 0)
+
+
+def _change_handle_write(svfs, block):
+    handle = svfs.open('abc')
+    block()
+    handle.write(64 * 1024 * 1024, b'B' * 1024)
+
+
+def _change_read_through(svfs, block):
+    def fetch(id, file_position, length):
+        block()
+        return b'B' * length
+
+    svfs.read_through('abc', 64 * 1024 * 1024, 1024, fetch)
+
+
+def _change_read_through_single_flight(svfs, block):
+    """Another thread waits for the fetch of the same data then fetches it itself."""
+    errors = []
+
+    def read_through():
+        try:
+            svfs.read_through('abc', 64 * 1024 * 1024, 1024, lambda id, file_position, length: b'B' * length)
+        except Exception as err:
+            errors.append(err)
+
+    thread = threading.Thread(target=read_through)
+
+    def fetch(id, file_position, length):
+        thread.start()
+        block()
+        return b'B' * length
+
+    try:
+        svfs.read_through('abc', 64 * 1024 * 1024, 1024, fetch)
+    except BufferError:
+        thread.join()
+        assert len(errors) == 1 and isinstance(errors[0], BufferError)
+        raise
+    thread.join()
+
+
+@pytest.mark.parametrize(
+    'change',
+    (
+        _change_write, _change_write_many, _change_erase, _change_lru_punt, _change_handle_write,
+        _change_read_through, _change_read_through_single_flight,
+    ),
+)
+def test_SVFS_change_waiting_for_file_lock(change):
+    """A change that waits for the file lock while a view is made raises a BufferError."""
+    _change_while_waiting_for_file_lock(change)
+
+
+def test_SVFS_open():
+    s = svfsc.cSVFS()
+    s.insert('abc', 1.0)
+    handle = s.open('abc')
+    assert isinstance(handle, svfsc.cSVFSHandle)
+    assert handle.id == 'abc'
+    assert not handle.has_data(8, 4)
+    assert handle.need(8, 4) == s.need('abc', 8, 4)
+    handle.write(8, b'ABCD')
+    assert handle.has_data(8, 4)
+    assert handle.read(8, 4) == b'ABCD'
+    assert handle.need(0, 16) == s.need('abc', 0, 16)
+    handle.write(12, bytearray(b'EF'))
+    assert s.read('abc', 8, 6) == b'ABCDEF'
+    assert s.blocks('abc') == ((8, 6),)
+    assert handle.need(0, 16, greedy_length=32) == s.need('abc', 0, 16, 32)
+
+
+def test_SVFS_open_raises():
+    s = svfsc.cSVFS()
+    with pytest.raises(IndexError):
+        s.open('abc')
+    s.insert('abc', 1.0)
+    handle = s.open('abc')
+    handle.write(8, b'ABCD')
+    with pytest.raises(IOError):
+        handle.read(0, 4)
+    with pytest.raises(IOError):
+        handle.write(8, b'XYZW')
+    s.remove('abc')
+    for method, args in ((handle.has_data, (8, 4)), (handle.read, (8, 4)), (handle.write, (8, b'ABCD')),
+                         (handle.need, (8, 4))):
+        with pytest.raises(IndexError):
+            method(*args)
+    with pytest.raises(TypeError):
+        svfsc.cSVFSHandle()
+
+
+def test_SVFS_open_journal(tmp_path):
+    """A handle survives the locks being discarded by opening a journal."""
+    s = svfsc.cSVFS()
+    s.insert('abc', 1.0)
+    handle = s.open('abc')
+    handle.write(0, b'ABCD')
+    s.journal_open(str(tmp_path / 'journal.log'))
+    handle.write(4, b'EF')
+    s.journal_close()
+    assert handle.read(0, 6) == b'ABCDEF'
+    # The insert was before the journal was opened.
+    t = svfsc.cSVFS()
+    t.insert('abc', 1.0)
+    t.journal_open(str(tmp_path / 'journal.log'))
+    assert t.blocks('abc') == ((4, 2),)